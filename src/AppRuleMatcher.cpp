@@ -0,0 +1,84 @@
+#include "AppRuleMatcher.h"
+#include <cstdio>
+#include "PerfectHash.h"
+
+AppRuleMatcher::AppRuleMatcher(AppIdentitySource& source) : _source(source) {
+    ClearCache();
+}
+
+void AppRuleMatcher::SetRules(const std::vector<AppRule>& rules) {
+    _table.Build(rules);
+}
+
+void AppRuleMatcher::ClearCache() {
+    for (CacheEntry& entry : _cache) {
+        entry.owner = 0;
+    }
+    _cacheCount = 0;
+}
+
+AppPolicy AppRuleMatcher::Resolve(HWND window) {
+    if (_table.IsEmpty() || !window) {
+        return AppPolicy();
+    }
+    ++_counters.resolves;
+
+    uint32_t processId = 0;
+    uint32_t threadId = 0;
+    char16_t className[MAX_NAME_LENGTH];
+    size_t classLength = 0;
+    if (!_source.QueryWindow(window, processId, threadId, className, MAX_NAME_LENGTH, classLength)) {
+        return AppPolicy();
+    }
+
+    uint64_t classKey = classLength ? AppRuleTable::ClassKey(className, classLength) : AppRuleTable::NO_KEY;
+    const AppPolicy* policy = _table.Match(ProcessKeyOf(processId, threadId), classKey);
+    if (!policy) {
+        return AppPolicy();
+    }
+    ++_counters.matches;
+    return *policy;
+}
+
+uint64_t AppRuleMatcher::ProcessKeyOf(uint32_t processId, uint32_t threadId) {
+    uint64_t owner = (static_cast<uint64_t>(processId) << 32) | threadId;
+    if (owner == 0) return AppRuleTable::NO_KEY;
+
+    // Linear probing from the owner's hash
+    size_t index = PerfectHash::Reduce(PerfectHash::Hash(owner, 0), CACHE_SIZE);
+    while (_cache[index].owner != 0) {
+        if (_cache[index].owner == owner) {
+            ++_counters.cacheHits;
+            return _cache[index].processKey;
+        }
+        index = (index + 1) % CACHE_SIZE;
+    }
+
+    ++_counters.imageQueries;
+    char16_t name[MAX_NAME_LENGTH];
+    size_t length = 0;
+    uint64_t processKey = _source.QueryImageName(processId, name, MAX_NAME_LENGTH, length) && length > 0
+                              ? AppRuleTable::ProcessKey(name, length)
+                              : AppRuleTable::NO_KEY;
+
+    // Probes stay short while the table is at most three quarters full
+    if (_cacheCount >= CACHE_SIZE * 3 / 4) {
+        ClearCache();
+        index = PerfectHash::Reduce(PerfectHash::Hash(owner, 0), CACHE_SIZE);
+    }
+    _cache[index].owner = owner;
+    _cache[index].processKey = processKey;
+    ++_cacheCount;
+    return processKey;
+}
+
+std::string AppRuleMatcher::Format() const {
+    char line[200];
+    double hitRate = _counters.resolves ? 100.0 * _counters.cacheHits / _counters.resolves : 0.0;
+    snprintf(line, sizeof(line),
+             "application rules: %zu names, %llu resolves, %.1f%% cached, %llu image queries, %llu matched\n",
+             _table.KeyCount(), static_cast<unsigned long long>(_counters.resolves), hitRate,
+             static_cast<unsigned long long>(_counters.imageQueries),
+             static_cast<unsigned long long>(_counters.matches));
+    return line;
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "AppRules.h"
+
+// Where AppRuleMatcher learns who owns a window. Win32AppIdentity asks
+// user32 and the owning process; FakeAppIdentity is the host-side one.
+class AppIdentitySource {
+public:
+    virtual ~AppIdentitySource() {}
+
+    // Owning process and thread of window, and its class name. False when
+    // the window is gone.
+    virtual bool QueryWindow(HWND window, uint32_t& processId, uint32_t& threadId,
+                             char16_t* className, size_t capacity, size_t& length) = 0;
+
+    // Image path or file name of the process; false when it cannot be opened
+    virtual bool QueryImageName(uint32_t processId, char16_t* name, size_t capacity, size_t& length) = 0;
+};
+
+// Resolves the rule for the foreground window once per focus change. The
+// class name is a cheap user32 read; the process image name means opening
+// the process, so its key is cached per owning process and thread. Ids are
+// reused only after the owner exits, and a new owner with both the same
+// process and thread id is unlikely enough to ignore; the cache is emptied
+// whenever it fills up.
+// Owned by the UI thread; not thread-safe.
+class AppRuleMatcher {
+public:
+    static const size_t CACHE_SIZE = 256;
+    static const size_t MAX_NAME_LENGTH = 260;
+
+    struct Counters {
+        uint64_t resolves = 0;
+        uint64_t cacheHits = 0;
+        uint64_t imageQueries = 0;
+        uint64_t matches = 0;       // Resolves that found a rule
+    };
+
+    explicit AppRuleMatcher(AppIdentitySource& source);
+
+    // Compiles the rules; cached names stay valid
+    void SetRules(const std::vector<AppRule>& rules);
+    const AppRuleTable& Table() const { return _table; }
+
+    // The policy for window; the default one when no rule matches. Without
+    // rules nothing is queried.
+    AppPolicy Resolve(HWND window);
+
+    void ClearCache();
+    const Counters& GetCounters() const { return _counters; }
+
+    // One line: rule keys, resolves, cache hit rate, image queries, matches
+    std::string Format() const;
+
+private:
+    struct CacheEntry {
+        uint64_t owner;             // Process id << 32 | thread id, 0 when free
+        uint64_t processKey;
+    };
+
+    uint64_t ProcessKeyOf(uint32_t processId, uint32_t threadId);
+
+    AppIdentitySource& _source;
+    AppRuleTable _table;
+    CacheEntry _cache[CACHE_SIZE];
+    size_t _cacheCount;
+    Counters _counters;
+};
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "AppRules.h"
+#include <unordered_map>
+#include "TextUtils.h"
+
+namespace {
+
+const uint64_t PROCESS_SEED = 0xCBF29CE484222325ull;
+const uint64_t CLASS_SEED = 0x84222325CBF29CE4ull;
+
+// FNV-1a over case-folded UTF-16 code units
+uint64_t FoldedHash(const char16_t* text, size_t length, uint64_t seed) {
+    uint64_t hash = seed;
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ ToLowerChar(text[i])) * 0x100000001B3ull;
+    }
+    return hash != AppRuleTable::NO_KEY ? hash : 1;
+}
+
+std::u16string FromUtf8(const std::string& text) {
+    std::u16string out;
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size();) {
+        unsigned char lead = static_cast<unsigned char>(text[i]);
+        uint32_t code;
+        size_t extra;
+        if (lead < 0x80) {
+            code = lead;
+            extra = 0;
+        } else if ((lead & 0xE0) == 0xC0) {
+            code = lead & 0x1F;
+            extra = 1;
+        } else if ((lead & 0xF0) == 0xE0) {
+            code = lead & 0x0F;
+            extra = 2;
+        } else {
+            code = lead & 0x07;
+            extra = 3;
+        }
+        ++i;
+        for (; extra > 0 && i < text.size(); --extra, ++i) {
+            code = (code << 6) | (static_cast<unsigned char>(text[i]) & 0x3F);
+        }
+
+        if (code >= 0x10000) {
+            code -= 0x10000;
+            out += static_cast<char16_t>(0xD800 + (code >> 10));
+            out += static_cast<char16_t>(0xDC00 + (code & 0x3FF));
+        } else {
+            out += static_cast<char16_t>(code);
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+AppRuleTable::AppRuleTable() : _keyCount(0) {
+}
+
+void AppRuleTable::Build(const std::vector<AppRule>& rules) {
+    _hashData.clear();
+    _hash = PerfectHash();
+    _slotKeys.clear();
+    _slotPolicies.clear();
+    _policies.clear();
+    _keyCount = 0;
+
+    std::unordered_map<uint64_t, uint32_t> owners;
+    owners.reserve(rules.size() * 2);
+    for (const AppRule& rule : rules) {
+        if (rule.process.empty() && rule.windowClass.empty()) continue;
+
+        uint32_t policy = static_cast<uint32_t>(_policies.size());
+        _policies.push_back(rule.policy);
+        if (!rule.process.empty()) owners[ProcessKey(rule.process)] = policy;
+        if (!rule.windowClass.empty()) owners[ClassKey(rule.windowClass)] = policy;
+    }
+    if (owners.empty()) {
+        _policies.clear();
+        return;
+    }
+
+    std::vector<uint64_t> keys;
+    keys.reserve(owners.size());
+    for (const auto& owner : owners) {
+        keys.push_back(owner.first);
+    }
+    std::vector<uint32_t> slots;
+    if (!PerfectHashBuilder::Build(keys, _hashData, slots) || !_hash.Attach(_hashData.data(), _hashData.size())) {
+        _policies.clear();
+        return;
+    }
+
+    _slotKeys.assign(_hash.SlotCount(), static_cast<uint64_t>(NO_KEY));
+    _slotPolicies.assign(_hash.SlotCount(), 0);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        _slotKeys[slots[i]] = keys[i];
+        _slotPolicies[slots[i]] = owners[keys[i]];
+    }
+    _keyCount = keys.size();
+}
+
+uint64_t AppRuleTable::ProcessKey(const char16_t* name, size_t length) {
+    // The file name of a path, without ".exe"
+    size_t start = length;
+    while (start > 0 && name[start - 1] != u'\\' && name[start - 1] != u'/') {
+        --start;
+    }
+    name += start;
+    length -= start;
+
+    static const char16_t EXTENSION[] = u".exe";
+    if (length > 4) {
+        bool isExe = true;
+        for (size_t i = 0; i < 4; ++i) {
+            isExe = isExe && ToLowerChar(name[length - 4 + i]) == EXTENSION[i];
+        }
+        if (isExe) length -= 4;
+    }
+    return FoldedHash(name, length, PROCESS_SEED);
+}
+
+uint64_t AppRuleTable::ClassKey(const char16_t* name, size_t length) {
+    return FoldedHash(name, length, CLASS_SEED);
+}
+
+uint64_t AppRuleTable::ProcessKey(const std::string& utf8) {
+    std::u16string name = FromUtf8(utf8);
+    return ProcessKey(name.data(), name.size());
+}
+
+uint64_t AppRuleTable::ClassKey(const std::string& utf8) {
+    std::u16string name = FromUtf8(utf8);
+    return ClassKey(name.data(), name.size());
+}
\ No newline at end of file
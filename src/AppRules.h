@@ -0,0 +1,104 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Win32Compat.h"
+#include "PerfectHash.h"
+
+// What a rule changes while an application it matches is in front. The
+// default is what applies without a rule: every feature on, automatic
+// injection, the layout left alone.
+struct AppPolicy {
+    enum Flags : uint8_t {
+        NO_BUFFERING = 0x01,    // Keys are not recorded: nothing to correct or auto-correct
+        NO_HOTKEYS = 0x02       // Pause and Alt+Shift pass through to the application
+    };
+
+    enum Injection : uint8_t {
+        INJECTION_AUTO = 0,     // Unicode text when the target layout can type it, else keys
+        INJECTION_KEYS          // Always retype the keys, for applications that drop VK_PACKET
+    };
+
+    uint8_t flags = 0;
+    uint8_t injection = INJECTION_AUTO;
+
+    // Layout to switch to when the application comes to the front: a full
+    // HKL value, or a language id (0x0409) for the first layout of that
+    // language. 0 leaves the layout alone.
+    uint32_t layout = 0;
+
+    bool operator==(const AppPolicy& other) const {
+        return flags == other.flags && injection == other.injection && layout == other.layout;
+    }
+    bool operator!=(const AppPolicy& other) const { return !(*this == other); }
+
+    static bool MatchesLayout(uint32_t layout, HKL hkl) {
+        uint32_t value = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(hkl));
+        return layout <= 0xFFFF ? (value & 0xFFFF) == layout : value == layout;
+    }
+};
+
+// One rules: section of settings.yml. A rule names a process, a window
+// class, or both; each is a separate key into the table.
+struct AppRule {
+    std::string name;           // Section name
+    std::string process;        // Executable name or path; case and ".exe" ignored
+    std::string windowClass;    // Top-level window class; case ignored
+    AppPolicy policy;
+
+    bool operator==(const AppRule& other) const {
+        return name == other.name && process == other.process && windowClass == other.windowClass &&
+               policy == other.policy;
+    }
+    bool operator!=(const AppRule& other) const { return !(*this == other); }
+};
+
+// Rules compiled for constant-time lookup. Every process name and window
+// class is folded to a 64-bit key and indexed by a PerfectHash; each slot
+// keeps its key to reject names no rule mentions. Built when the rules
+// change; a lookup is two hashes and a compare.
+class AppRuleTable {
+public:
+    static const uint64_t NO_KEY = 0;
+
+    AppRuleTable();
+    AppRuleTable(const AppRuleTable&) = delete;
+    AppRuleTable& operator=(const AppRuleTable&) = delete;
+
+    // When two rules name the same process or class, the later one wins
+    void Build(const std::vector<AppRule>& rules);
+
+    bool IsEmpty() const { return _policies.empty(); }
+    size_t KeyCount() const { return _keyCount; }
+
+    // A window class rule is the more specific and wins over a process
+    // rule. Null when neither key has a rule.
+    const AppPolicy* Match(uint64_t processKey, uint64_t classKey) const {
+        const AppPolicy* policy = Find(classKey);
+        return policy ? policy : Find(processKey);
+    }
+
+    // Keys of names as the system reports them: a process image path or
+    // name, and a window class. Never NO_KEY.
+    static uint64_t ProcessKey(const char16_t* name, size_t length);
+    static uint64_t ClassKey(const char16_t* name, size_t length);
+
+    // The same for names written in settings.yml
+    static uint64_t ProcessKey(const std::string& utf8);
+    static uint64_t ClassKey(const std::string& utf8);
+
+private:
+    const AppPolicy* Find(uint64_t key) const {
+        if (key == NO_KEY || _policies.empty()) return nullptr;
+        uint32_t slot = _hash.Slot(key);
+        return _slotKeys[slot] == key ? &_policies[_slotPolicies[slot]] : nullptr;
+    }
+
+    std::vector<uint8_t> _hashData;
+    PerfectHash _hash;
+    std::vector<uint64_t> _slotKeys;
+    std::vector<uint32_t> _slotPolicies;
+    std::vector<AppPolicy> _policies;
+    size_t _keyCount;
+};
\ No newline at end of file
@@ -0,0 +1,159 @@
+#include "AppendFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+AppendFile::AppendFile()
+    : _size(0),
+#ifdef _WIN32
+      _file(INVALID_HANDLE_VALUE) {
+#else
+      _fd(-1) {
+#endif
+}
+
+AppendFile::~AppendFile() {
+    Close();
+}
+
+#ifdef _WIN32
+
+bool AppendFile::Open(const NativePath& path) {
+    Close();
+
+    // Readers may map the file and the compactor may rename it while open
+    _file = CreateFileW(path.c_str(), FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                        OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (_file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(_file, &fileSize)) {
+        Close();
+        return false;
+    }
+    _size = static_cast<uint64_t>(fileSize.QuadPart);
+    return true;
+}
+
+void AppendFile::Close() {
+    if (_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(_file);
+        _file = INVALID_HANDLE_VALUE;
+    }
+    _size = 0;
+}
+
+bool AppendFile::IsOpen() const {
+    return _file != INVALID_HANDLE_VALUE;
+}
+
+bool AppendFile::Append(const void* data, size_t size) {
+    if (_file == INVALID_HANDLE_VALUE) return false;
+    DWORD written = 0;
+    if (!WriteFile(_file, data, static_cast<DWORD>(size), &written, nullptr)) return false;
+    _size += written;
+    return written == size;
+}
+
+bool AppendFile::WriteAtomically(const NativePath& path, const void* data, size_t size) {
+    NativePath tempPath = path + L".tmp";
+    HANDLE file = CreateFileW(tempPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    DWORD written = 0;
+    bool complete = WriteFile(file, data, static_cast<DWORD>(size), &written, nullptr) && written == size &&
+                    FlushFileBuffers(file);
+    CloseHandle(file);
+
+    bool replaced = complete && MoveFileExW(tempPath.c_str(), path.c_str(),
+                                            MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+    if (!replaced) {
+        DeleteFileW(tempPath.c_str());
+    }
+    return replaced;
+}
+
+bool AppendFile::Exists(const NativePath& path) {
+    return GetFileAttributesW(path.c_str()) != INVALID_FILE_ATTRIBUTES;
+}
+
+bool AppendFile::Move(const NativePath& from, const NativePath& to) {
+    return MoveFileExW(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+bool AppendFile::Remove(const NativePath& path) {
+    return DeleteFileW(path.c_str()) != 0;
+}
+
+#else
+
+bool AppendFile::Open(const NativePath& path) {
+    Close();
+
+    _fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (_fd < 0) return false;
+
+    struct stat info;
+    if (fstat(_fd, &info) != 0) {
+        Close();
+        return false;
+    }
+    _size = static_cast<uint64_t>(info.st_size);
+    return true;
+}
+
+void AppendFile::Close() {
+    if (_fd >= 0) {
+        close(_fd);
+        _fd = -1;
+    }
+    _size = 0;
+}
+
+bool AppendFile::IsOpen() const {
+    return _fd >= 0;
+}
+
+bool AppendFile::Append(const void* data, size_t size) {
+    if (_fd < 0) return false;
+    ssize_t written = write(_fd, data, size);
+    if (written < 0) return false;
+    _size += static_cast<uint64_t>(written);
+    return static_cast<size_t>(written) == size;
+}
+
+bool AppendFile::WriteAtomically(const NativePath& path, const void* data, size_t size) {
+    NativePath tempPath = path + ".tmp";
+    int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    bool complete = write(fd, data, size) == static_cast<ssize_t>(size) && fsync(fd) == 0;
+    complete = close(fd) == 0 && complete;
+
+    bool replaced = complete && rename(tempPath.c_str(), path.c_str()) == 0;
+    if (!replaced) {
+        unlink(tempPath.c_str());
+    }
+    return replaced;
+}
+
+bool AppendFile::Exists(const NativePath& path) {
+    return access(path.c_str(), F_OK) == 0;
+}
+
+bool AppendFile::Move(const NativePath& from, const NativePath& to) {
+    return rename(from.c_str(), to.c_str()) == 0;
+}
+
+bool AppendFile::Remove(const NativePath& path) {
+    return unlink(path.c_str()) == 0;
+}
+
+#endif
\ No newline at end of file
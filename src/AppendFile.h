@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "MappedFile.h"
+
+// Write side of the files MappedFile reads: a file only ever appended to,
+// and whole files swapped in with a rename so readers see the old or the
+// new contents, never a mix. Appends are one write call each and are not
+// flushed to disk; they survive the process, not a power cut.
+class AppendFile {
+public:
+    AppendFile();
+    ~AppendFile();
+
+    AppendFile(const AppendFile&) = delete;
+    AppendFile& operator=(const AppendFile&) = delete;
+
+    // Creates the file when missing
+    bool Open(const NativePath& path);
+    void Close();
+
+    bool IsOpen() const;
+    uint64_t Size() const { return _size; }
+
+    bool Append(const void* data, size_t size);
+
+    // Writes data next to path, flushes it and renames it over path
+    static bool WriteAtomically(const NativePath& path, const void* data, size_t size);
+
+    static bool Exists(const NativePath& path);
+    static bool Move(const NativePath& from, const NativePath& to);
+    static bool Remove(const NativePath& path);
+
+private:
+    uint64_t _size;
+#ifdef _WIN32
+    void* _file;
+#else
+    int _fd;
+#endif
+};
\ No newline at end of file
@@ -0,0 +1,214 @@
+#include "BadgeAtlas.h"
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Rows top to bottom, bit 4 is the leftmost pixel
+const uint8_t FONT[36][7] = {
+    { 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 },     // A
+    { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E },     // B
+    { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E },     // C
+    { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C },     // D
+    { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F },     // E
+    { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 },     // F
+    { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F },     // G
+    { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 },     // H
+    { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E },     // I
+    { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C },     // J
+    { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 },     // K
+    { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F },     // L
+    { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 },     // M
+    { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 },     // N
+    { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E },     // O
+    { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 },     // P
+    { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D },     // Q
+    { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 },     // R
+    { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E },     // S
+    { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 },     // T
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E },     // U
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 },     // V
+    { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A },     // W
+    { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 },     // X
+    { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 },     // Y
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F },     // Z
+    { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E },     // 0
+    { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E },     // 1
+    { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F },     // 2
+    { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E },     // 3
+    { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 },     // 4
+    { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E },     // 5
+    { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E },     // 6
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 },     // 7
+    { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E },     // 8
+    { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C },     // 9
+};
+
+// Badge fill and letters; a light badge stands out on a dark taskbar
+const uint32_t BACKGROUND_COLORS[BadgeAtlas::THEME_COUNT] = { 0xFF202020, 0xFFF0F0F0 };
+const uint32_t TEXT_COLORS[BadgeAtlas::THEME_COUNT] = { 0xFFF0F0F0, 0xFF202020 };
+
+// Samples per pixel side when computing coverage
+const int SUBSAMPLES = 4;
+
+bool InsideRoundedRect(float x, float y, float size, float radius) {
+    float dx = 0;
+    float dy = 0;
+    if (x < radius) dx = radius - x;
+    else if (x > size - radius) dx = x - (size - radius);
+    if (y < radius) dy = radius - y;
+    else if (y > size - radius) dy = y - (size - radius);
+    return dx * dx + dy * dy <= radius * radius;
+}
+
+} // namespace
+
+BadgeAtlas::BadgeAtlas() : _size(0) {
+    memset(_scales, 0, sizeof(_scales));
+    memset(_glyphOffsets, 0xFF, sizeof(_glyphOffsets));
+}
+
+bool BadgeAtlas::Build(int size) {
+    if (size < MIN_SIZE || size > MAX_SIZE) return false;
+
+    _size = size;
+    _glyphs.clear();
+    memset(_glyphOffsets, 0xFF, sizeof(_glyphOffsets));
+
+    // Whole font pixels where they fit keep small badges sharp; only three
+    // letters at the smallest sizes fall back to a fractional scale
+    int padding = size >= 32 ? size / 16 : 1;
+    float available = static_cast<float>(size - 2 * padding);
+    const int textUnits[SCALE_COUNT] = { 2 * FONT_WIDTH + 1, 3 * FONT_WIDTH + 2 };
+    for (int i = 0; i < SCALE_COUNT; ++i) {
+        float unit = available / textUnits[i];
+        float tallest = available * 0.75f / FONT_HEIGHT;
+        if (unit > tallest) unit = tallest;
+        if (unit >= 1.0f) unit = std::floor(unit);
+
+        _scales[i].unit = unit;
+        _scales[i].cellWidth = static_cast<int>(std::ceil(FONT_WIDTH * unit));
+        _scales[i].cellHeight = static_cast<int>(std::ceil(FONT_HEIGHT * unit));
+    }
+
+    // The badge fills the icon; coverage of its rounded corners is shared by
+    // both themes
+    float radius = size * 0.2f;
+    for (int theme = 0; theme < THEME_COUNT; ++theme) {
+        _backgrounds[theme].resize(static_cast<size_t>(size) * size);
+    }
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            int inside = 0;
+            for (int sy = 0; sy < SUBSAMPLES; ++sy) {
+                for (int sx = 0; sx < SUBSAMPLES; ++sx) {
+                    inside += InsideRoundedRect(x + (sx + 0.5f) / SUBSAMPLES, y + (sy + 0.5f) / SUBSAMPLES,
+                                                static_cast<float>(size), radius);
+                }
+            }
+            uint32_t alpha = static_cast<uint32_t>(inside * 255 / (SUBSAMPLES * SUBSAMPLES));
+            for (int theme = 0; theme < THEME_COUNT; ++theme) {
+                _backgrounds[theme][static_cast<size_t>(y) * size + x] = (alpha << 24) | (BACKGROUND_COLORS[theme] & 0xFFFFFF);
+            }
+        }
+    }
+    return true;
+}
+
+int BadgeAtlas::GlyphIndex(char ch) {
+    if (ch >= 'A' && ch <= 'Z') return ch - 'A';
+    if (ch >= '0' && ch <= '9') return 26 + (ch - '0');
+    return -1;
+}
+
+const uint8_t* BadgeAtlas::Glyph(ScaleClass scaleClass, int glyph) {
+    int32_t& offset = _glyphOffsets[scaleClass][glyph];
+    if (offset >= 0) return &_glyphs[offset];
+
+    const Scale& scale = _scales[scaleClass];
+    offset = static_cast<int32_t>(_glyphs.size());
+    _glyphs.resize(_glyphs.size() + static_cast<size_t>(scale.cellWidth) * scale.cellHeight);
+    uint8_t* mask = &_glyphs[offset];
+
+    // Box-filtered font pixels; whole-pixel scales give exact 0 or 255
+    for (int y = 0; y < scale.cellHeight; ++y) {
+        for (int x = 0; x < scale.cellWidth; ++x) {
+            int covered = 0;
+            for (int sy = 0; sy < SUBSAMPLES; ++sy) {
+                int fy = static_cast<int>((y + (sy + 0.5f) / SUBSAMPLES) / scale.unit);
+                if (fy >= FONT_HEIGHT) continue;
+                for (int sx = 0; sx < SUBSAMPLES; ++sx) {
+                    int fx = static_cast<int>((x + (sx + 0.5f) / SUBSAMPLES) / scale.unit);
+                    if (fx < FONT_WIDTH && (FONT[glyph][fy] >> (FONT_WIDTH - 1 - fx)) & 1) ++covered;
+                }
+            }
+            *mask++ = static_cast<uint8_t>(covered * 255 / (SUBSAMPLES * SUBSAMPLES));
+        }
+    }
+    return &_glyphs[offset];
+}
+
+size_t BadgeAtlas::NormalizeCode(const char* code, char* out) {
+    size_t length = 0;
+    for (; code && *code && length < MAX_CODE_LENGTH; ++code) {
+        char ch = *code;
+        if (ch >= 'a' && ch <= 'z') ch = static_cast<char>(ch - 'a' + 'A');
+        if (GlyphIndex(ch) >= 0) out[length++] = ch;
+    }
+    out[length] = '\0';
+    return length;
+}
+
+void BadgeAtlas::Compose(const char* code, Theme theme, uint32_t* pixels) {
+    if (_size == 0) return;
+    memcpy(pixels, _backgrounds[theme].data(), _backgrounds[theme].size() * sizeof(uint32_t));
+
+    char text[MAX_CODE_LENGTH + 1];
+    size_t length = NormalizeCode(code, text);
+    if (length == 0) return;
+
+    ScaleClass scaleClass = length == MAX_CODE_LENGTH ? SCALE_LONG : SCALE_SHORT;
+    const Scale& scale = _scales[scaleClass];
+    float advance = (FONT_WIDTH + 1) * scale.unit;
+    float textWidth = (length * (FONT_WIDTH + 1) - 1) * scale.unit;
+    float left = (_size - textWidth) / 2;
+    int top = static_cast<int>(std::lround((_size - FONT_HEIGHT * scale.unit) / 2));
+
+    uint32_t color = TEXT_COLORS[theme];
+    for (size_t i = 0; i < length; ++i) {
+        const uint8_t* mask = Glyph(scaleClass, GlyphIndex(text[i]));
+        int x0 = static_cast<int>(std::lround(left + i * advance));
+
+        for (int y = 0; y < scale.cellHeight; ++y) {
+            int py = top + y;
+            if (py < 0 || py >= _size) continue;
+            uint32_t* row = pixels + static_cast<size_t>(py) * _size;
+            const uint8_t* coverageRow = mask + static_cast<size_t>(y) * scale.cellWidth;
+
+            for (int x = 0; x < scale.cellWidth; ++x) {
+                uint32_t coverage = coverageRow[x];
+                int px = x0 + x;
+                if (coverage == 0 || px < 0 || px >= _size) continue;
+
+                // Letters only recolor the badge; its alpha keeps the
+                // rounded corners
+                uint32_t dst = row[px];
+                uint32_t out = dst & 0xFF000000;
+                for (int shift = 0; shift < 24; shift += 8) {
+                    uint32_t d = (dst >> shift) & 0xFF;
+                    uint32_t s = (color >> shift) & 0xFF;
+                    out |= ((d * (255 - coverage) + s * coverage) / 255) << shift;
+                }
+                row[px] = out;
+            }
+        }
+    }
+}
+
+size_t BadgeAtlas::MemoryUsage() const {
+    size_t bytes = _glyphs.capacity();
+    for (int theme = 0; theme < THEME_COUNT; ++theme) {
+        bytes += _backgrounds[theme].capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
\ No newline at end of file
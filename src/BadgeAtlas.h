@@ -0,0 +1,69 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Tray icon badges showing the active layout's language code ("EN", "RU").
+// Letters come from a built-in 5x7 pixel font and are rasterized into
+// coverage masks the first time a size needs them; composing a badge is a
+// copy of the cached background plus a blend of two or three masks, so no
+// text is rendered when the layout changes. Pixels are 0xAARRGGBB with
+// straight alpha, top-down: the color bitmap of a 32-bit icon.
+class BadgeAtlas {
+public:
+    // Theme of the taskbar the badge is shown on
+    enum Theme {
+        THEME_LIGHT = 0,
+        THEME_DARK,
+        THEME_COUNT
+    };
+
+    static const size_t MAX_CODE_LENGTH = 3;
+    static const int MIN_SIZE = 8;
+    static const int MAX_SIZE = 256;
+
+    BadgeAtlas();
+
+    // Drops cached glyphs and renders the backgrounds for size x size badges
+    bool Build(int size);
+    int Size() const { return _size; }
+
+    // Writes Size() * Size() pixels. Only ASCII letters and digits are drawn,
+    // upper-cased, and at most MAX_CODE_LENGTH of them.
+    void Compose(const char* code, Theme theme, uint32_t* pixels);
+
+    // Upper-cases and filters code into out, which holds
+    // MAX_CODE_LENGTH + 1 characters; returns the length
+    static size_t NormalizeCode(const char* code, char* out);
+
+    size_t MemoryUsage() const;
+
+private:
+    static const int GLYPH_COUNT = 36;      // A-Z, 0-9
+    static const int FONT_WIDTH = 5;
+    static const int FONT_HEIGHT = 7;
+
+    // Two-letter codes and shorter share a scale; three letters are smaller
+    enum ScaleClass {
+        SCALE_SHORT = 0,
+        SCALE_LONG,
+        SCALE_COUNT
+    };
+
+    struct Scale {
+        float unit;                 // Pixels per font pixel
+        int cellWidth;
+        int cellHeight;
+    };
+
+    static int GlyphIndex(char ch);
+    const uint8_t* Glyph(ScaleClass scaleClass, int glyph);
+
+    int _size;
+    Scale _scales[SCALE_COUNT];
+    std::vector<uint32_t> _backgrounds[THEME_COUNT];
+
+    // Coverage masks, cellWidth * cellHeight bytes each, rendered on demand
+    std::vector<uint8_t> _glyphs;
+    int32_t _glyphOffsets[SCALE_COUNT][GLYPH_COUNT];
+};
\ No newline at end of file
@@ -0,0 +1,551 @@
+#include "CorrectionEngine.h"
+#include <algorithm>
+#include "TextUtils.h"
+
+CorrectionEngine::CorrectionEngine(PlatformBackend& backend, LatencyMetrics& latency, size_t keystrokeCapacity)
+    : _backend(backend), _latency(latency), _state(keystrokeCapacity), _injection(AppPolicy::INJECTION_AUTO),
+      _phraseWords(0), _window(nullptr), _wordLayoutCount(0), _wordLayout(nullptr),
+      _userWords(&_sessionWords) {
+    // Plans for any buffer or phrase fit without growing on the worker
+    _plan.inputs.reserve(CorrectionPlanner::MaxInputCount(PhraseHistory::MAX_KEYS));
+}
+
+void CorrectionEngine::SetAutoCorrect(const AutoCorrectOptions& options) {
+    _autoCorrect = options;
+    _scorer.Invalidate();
+}
+
+void CorrectionEngine::Reset() {
+    _state.Reset();
+    _window = nullptr;
+    _scorer.Invalidate();
+    _autoStats = AutoCorrectStats();
+}
+
+bool CorrectionEngine::UpdateFocus() {
+    return SetFocus(_backend.ForegroundWindow());
+}
+
+bool CorrectionEngine::SetFocus(HWND window) {
+    if (window == _window) {
+        return false;
+    }
+    _state.SetWindow(reinterpret_cast<uintptr_t>(window));
+    _window = window;
+
+    // The scores were for the other window's word
+    _scorer.Invalidate();
+    return true;
+}
+
+void CorrectionEngine::Process(const KeyEvent& event) {
+    if (event.flags & KeyEvent::MouseClick) {
+        _state.ClearBuffer();
+    } else if (event.flags & KeyEvent::Correction) {
+        Correct();
+    } else if (event.flags & KeyEvent::Phrase) {
+        CorrectPhrase();
+    } else if (event.flags & KeyEvent::Selection) {
+        ConvertSelection();
+    } else {
+        InputStateMachine::Recorded recorded = _state.RecordKeystroke(event);
+        if (_autoCorrect.enabled) {
+            OnRecorded(recorded);
+        }
+    }
+}
+
+CorrectionEngine::Result CorrectionEngine::Correct() {
+    InputStateMachine::Correction correction;
+    if (!_state.BeginCorrection(correction)) {
+        return Result::Nothing;
+    }
+    const KeystrokeInfo* keystrokes = correction.keystrokes;
+    size_t count = correction.count;
+
+    uint64_t start = LatencyClock::Now();
+    uint64_t ticks = start;
+
+    HWND window = _backend.ForegroundWindow();
+    HKL currentLayout = _backend.WindowLayout(window);
+    HKL targetLayout = _backend.NextLayout(currentLayout);
+
+    // Repeated presses rank the same keys against the layout they were
+    // typed in, not the one the last correction switched to
+    if (correction.isFirst || !correction.typedLayout) {
+        correction.typedLayout = reinterpret_cast<uintptr_t>(currentLayout);
+    }
+    HKL typedLayout = reinterpret_cast<HKL>(correction.typedLayout);
+
+    // Pause right after an auto-correction puts back what was typed, and
+    // the word is left alone from then on
+    bool accepted = true;
+    if (correction.undo) {
+        targetLayout = typedLayout;
+        _userWords->Learn(UserDictionary::Key(keystrokes, count - 1, typedLayout), UserDictionary::VERDICT_REJECTED,
+                          typedLayout);
+        ++_autoStats.undos;
+    } else {
+        accepted = ChooseTargetLayout(correction, typedLayout, targetLayout);
+    }
+    ticks = _latency.Get(LatencyMetrics::CORRECTION_DETECT).RecordSince(ticks);
+    if (!accepted) {
+        _state.RefuseCorrection();
+        _latency.Get(LatencyMetrics::CORRECTION_TOTAL).RecordSince(start);
+        return Result::Refused;
+    }
+    Result result = Apply(correction, window, currentLayout, targetLayout, start, ticks);
+
+    // Another press that walks back to the typed layout says the word was
+    // right as typed; any other layout is what it meant until the next one
+    if (!correction.undo) {
+        _userWords->Learn(UserDictionary::Key(keystrokes, count, typedLayout),
+                          targetLayout == typedLayout ? UserDictionary::VERDICT_REJECTED
+                                                      : UserDictionary::VERDICT_ACCEPTED,
+                          targetLayout);
+    }
+    return result;
+}
+
+CorrectionEngine::Result CorrectionEngine::CorrectPhrase() {
+    InputStateMachine::Correction correction;
+    if (!_state.BeginPhraseCorrection(_phraseWords, correction)) {
+        return Result::Nothing;
+    }
+
+    uint64_t start = LatencyClock::Now();
+    HWND window = _backend.ForegroundWindow();
+    HKL currentLayout = _backend.WindowLayout(window);
+    HKL targetLayout = ChoosePhraseLayout(correction, currentLayout);
+    uint64_t ticks = _latency.Get(LatencyMetrics::PHRASE_DETECT).RecordSince(start);
+    return Apply(correction, window, currentLayout, targetLayout, start, ticks);
+}
+
+CorrectionEngine::Result CorrectionEngine::Apply(const InputStateMachine::Correction& correction, HWND window,
+                                                 HKL currentLayout, HKL targetLayout, uint64_t start,
+                                                 uint64_t ticks) {
+    const KeystrokeInfo* keystrokes = correction.keystrokes;
+    size_t count = correction.count;
+    const LayoutTable* targetTable = _backend.Table(targetLayout);
+    Result result;
+
+    if (_injection == AppPolicy::INJECTION_AUTO && targetTable &&
+        CorrectionPlanner::BuildUnicodePlan(keystrokes, count, *targetTable, _plan)) {
+        // The corrected text is known up front, so the whole fix goes out
+        // in one batch and does not depend on when the switch lands. The
+        // batch both deletes and retypes; it is timed as the replay.
+        _backend.Send(_plan.inputs.data(), _plan.inputs.size());
+        ticks = _latency.Get(LatencyMetrics::CORRECTION_REPLAY).RecordSince(ticks);
+        _backend.RequestLayout(window, targetLayout);
+        _latency.Get(LatencyMetrics::CORRECTION_SWITCH).RecordSince(ticks);
+        result = Result::Unicode;
+    } else {
+        // Dead keys, unknown layouts, or an application that ignores
+        // Unicode input: replay the keys under the new layout
+        CorrectionPlanner::BuildPlan(keystrokes, count, _plan);
+
+        // Delete the typed text
+        _backend.Send(_plan.DeleteInputs(), _plan.deleteCount);
+        ticks = _latency.Get(LatencyMetrics::CORRECTION_DELETE).RecordSince(ticks);
+
+        // Switch keyboard layout and wait until the target thread applied it,
+        // instead of sleeping a fixed amount
+        _backend.RequestLayout(window, targetLayout);
+        _backend.WaitForLayout(window, currentLayout);
+        ticks = _latency.Get(LatencyMetrics::CORRECTION_SWITCH).RecordSince(ticks);
+
+        // Replay keystrokes
+        _backend.Send(_plan.ReplayInputs(), _plan.ReplayCount());
+        _latency.Get(LatencyMetrics::CORRECTION_REPLAY).RecordSince(ticks);
+        result = Result::KeyReplay;
+    }
+
+    _state.CompleteCorrection(correction);
+    _latency.Get(LatencyMetrics::CORRECTION_TOTAL).RecordSince(start);
+    return result;
+}
+
+bool CorrectionEngine::ChooseTargetLayout(const InputStateMachine::Correction& correction, HKL typedLayout,
+                                          HKL& targetLayout) {
+    HKL layouts[PlatformBackend::MAX_LAYOUTS];
+    size_t layoutCount = _backend.LayoutList(layouts, PlatformBackend::MAX_LAYOUTS);
+
+    // A word the user settled before needs no ranking the first time round
+    if (correction.isFirst) {
+        const UserDictionary::Entry* learned =
+            _userWords->Lookup(UserDictionary::Key(correction.keystrokes, correction.count, typedLayout));
+        if (learned && learned->verdict == UserDictionary::VERDICT_REJECTED && correction.mayRefuse) {
+            return false;
+        }
+        HKL learnedLayout = learned ? LearnedLayout(*learned, layouts, layoutCount) : nullptr;
+        if (learnedLayout && learnedLayout != typedLayout) {
+            targetLayout = learnedLayout;
+            return true;
+        }
+    }
+
+    LayoutCandidate candidates[PlatformBackend::MAX_LAYOUTS];
+    size_t typedCandidate = layoutCount;
+    for (size_t i = 0; i < layoutCount; ++i) {
+        candidates[i].table = _backend.Table(layouts[i]);
+        candidates[i].dictionary = _backend.Dictionary(layouts[i]);
+        candidates[i].trigrams = _backend.Trigrams(layouts[i]);
+        if (layouts[i] == typedLayout) {
+            typedCandidate = i;
+        }
+    }
+    _ranker.SetCandidates(candidates, layoutCount);
+
+    LayoutRanker::Ranking rankings[LayoutRanker::MAX_LAYOUTS];
+    size_t ranked = _ranker.Rank(correction.keystrokes, correction.count, typedCandidate, rankings);
+
+    // The other layouts best first, then the typed one: repeated presses
+    // walk this ring, so they still come back to what was typed
+    HKL order[LayoutRanker::MAX_LAYOUTS];
+    size_t orderCount = 0;
+    bool typedIsWord = false;
+    bool typedRanked = false;
+    bool otherIsWord = false;
+    for (size_t i = 0; i < ranked; ++i) {
+        if (rankings[i].candidate == typedCandidate) {
+            typedIsWord = rankings[i].isWord;
+            typedRanked = true;
+        } else {
+            otherIsWord = otherIsWord || rankings[i].isWord;
+            order[orderCount++] = layouts[rankings[i].candidate];
+        }
+    }
+
+    // Nothing else reads the keys: keep the next layout
+    if (orderCount == 0) {
+        return true;
+    }
+
+    // The typed word and another reading are both real words
+    if (correction.mayRefuse && typedIsWord && otherIsWord) {
+        return false;
+    }
+
+    if (typedRanked) {
+        order[orderCount++] = typedLayout;
+    }
+    targetLayout = order[static_cast<size_t>(correction.attempt - 1) % orderCount];
+    return true;
+}
+
+HKL CorrectionEngine::ChoosePhraseLayout(const InputStateMachine::Correction& correction, HKL currentLayout) {
+    HKL layouts[PlatformBackend::MAX_LAYOUTS];
+    size_t layoutCount = _backend.LayoutList(layouts, PlatformBackend::MAX_LAYOUTS);
+    if (layoutCount > LayoutRanker::MAX_LAYOUTS) {
+        layoutCount = LayoutRanker::MAX_LAYOUTS;
+    }
+
+    LayoutCandidate candidates[LayoutRanker::MAX_LAYOUTS];
+    size_t currentCandidate = layoutCount;
+    for (size_t i = 0; i < layoutCount; ++i) {
+        candidates[i].table = _backend.Table(layouts[i]);
+        candidates[i].dictionary = _backend.Dictionary(layouts[i]);
+        candidates[i].trigrams = _backend.Trigrams(layouts[i]);
+        if (layouts[i] == currentLayout) {
+            currentCandidate = i;
+        }
+    }
+    _ranker.SetCandidates(candidates, layoutCount);
+
+    // Each word is ranked on its own, so the dictionaries see whole words;
+    // a layout has to read every one of them. Words longer than the ranker
+    // takes are ranked in pieces.
+    long long scores[LayoutRanker::MAX_LAYOUTS] = {};
+    size_t dictionaryWords[LayoutRanker::MAX_LAYOUTS] = {};
+    size_t reads[LayoutRanker::MAX_LAYOUTS] = {};
+    size_t pieces = 0;
+    const KeystrokeInfo* keystrokes = correction.keystrokes;
+    size_t start = 0;
+    for (size_t i = 1; i <= correction.count; ++i) {
+        bool wordEnds = i == correction.count ||
+                        (keystrokes[i].VirtualKey() != VK_SPACE && keystrokes[i - 1].VirtualKey() == VK_SPACE);
+        if (!wordEnds && i - start < LayoutRanker::MAX_WORD_LENGTH) continue;
+
+        LayoutRanker::Ranking rankings[LayoutRanker::MAX_LAYOUTS];
+        size_t ranked = _ranker.Rank(keystrokes + start, i - start, currentCandidate, rankings);
+        for (size_t r = 0; r < ranked; ++r) {
+            size_t candidate = rankings[r].candidate;
+            scores[candidate] += rankings[r].score;
+            dictionaryWords[candidate] += rankings[r].isWord ? 1 : 0;
+            ++reads[candidate];
+        }
+        ++pieces;
+        start = i;
+    }
+
+    // Most dictionary words first, then the best score. Ties go to the
+    // layouts after the current one in the order the system cycles them,
+    // the current one last, so without models the phrase goes to the next
+    // layout as a word would.
+    size_t order[LayoutRanker::MAX_LAYOUTS];
+    size_t orderCount = 0;
+    for (size_t i = 0; i < layoutCount; ++i) {
+        if (reads[i] == pieces) {
+            order[orderCount++] = i;
+        }
+    }
+    if (orderCount == 0) {
+        return _backend.NextLayout(currentLayout);
+    }
+    auto distance = [&](size_t candidate) {
+        return currentCandidate == layoutCount ? candidate
+                                               : (candidate + layoutCount - currentCandidate - 1) % layoutCount;
+    };
+    std::sort(order, order + orderCount, [&](size_t a, size_t b) {
+        if (dictionaryWords[a] != dictionaryWords[b]) return dictionaryWords[a] > dictionaryWords[b];
+        if (scores[a] != scores[b]) return scores[a] > scores[b];
+        return distance(a) < distance(b);
+    });
+    return layouts[order[static_cast<size_t>(correction.attempt - 1) % orderCount]];
+}
+
+bool CorrectionEngine::ConvertSelection() {
+    uint64_t start = LatencyClock::Now();
+    HWND window = _backend.ForegroundWindow();
+    if (!_backend.CopySelection(window, _selection)) {
+        return false;
+    }
+
+    HKL sourceLayout = nullptr;
+    HKL targetLayout = nullptr;
+    const LayoutTable* sourceTable = nullptr;
+    const LayoutTable* targetTable = nullptr;
+    if (ChooseConversion(_selection, _backend.WindowLayout(window), sourceLayout, targetLayout)) {
+        sourceTable = _backend.Table(sourceLayout);
+        targetTable = _backend.Table(targetLayout);
+    }
+    if (!sourceTable || !targetTable) {
+        _latency.Get(LatencyMetrics::SELECTION_TOTAL).RecordSince(start);
+        return true;
+    }
+
+    // Selections usually go back and forth between the same two layouts
+    if (_transcoder.SourceLayoutId() != sourceTable->GetLayoutId() ||
+        _transcoder.TargetLayoutId() != targetTable->GetLayoutId()) {
+        _transcoder.Build(*sourceTable, *targetTable);
+    }
+    uint64_t ticks = LatencyClock::Now();
+    _transcoder.Transcode(_selection.data(), _selection.size(), _selection.data());
+    _latency.Get(LatencyMetrics::SELECTION_TRANSCODE).RecordSince(ticks);
+
+    _backend.PasteText(window, _selection);
+    _backend.RequestLayout(window, targetLayout);
+
+    // Whatever the buffer held was typed somewhere else in the text
+    _state.ClearBuffer();
+    _latency.Get(LatencyMetrics::SELECTION_TOTAL).RecordSince(start);
+    return true;
+}
+
+bool CorrectionEngine::ChooseConversion(const std::u16string& text, HKL currentLayout, HKL& sourceLayout,
+                                        HKL& targetLayout) {
+    HKL layouts[PlatformBackend::MAX_LAYOUTS];
+    size_t layoutCount = _backend.LayoutList(layouts, PlatformBackend::MAX_LAYOUTS);
+    size_t sampleLength = text.size() < CONVERSION_SAMPLE ? text.size() : CONVERSION_SAMPLE;
+
+    // The selection was typed in the layout that can type most of its
+    // letters; the current one wins ties
+    size_t sourceCandidate = layoutCount;
+    size_t bestCount = 0;
+    for (size_t i = 0; i < layoutCount; ++i) {
+        const LayoutTable* table = _backend.Table(layouts[i]);
+        if (!table) continue;
+
+        size_t typeable = 0;
+        for (size_t c = 0; c < sampleLength; ++c) {
+            int virtualKey;
+            bool shift;
+            typeable += IsLetterChar(text[c]) && table->FindKey(text[c], virtualKey, shift) ? 1 : 0;
+        }
+        bool better = sourceCandidate == layoutCount || typeable > bestCount ||
+                      (typeable == bestCount && layouts[i] == currentLayout);
+        if (better) {
+            sourceCandidate = i;
+            bestCount = typeable;
+        }
+    }
+    if (sourceCandidate == layoutCount || bestCount == 0) {
+        return false;
+    }
+    sourceLayout = layouts[sourceCandidate];
+    targetLayout = _backend.NextLayout(sourceLayout);
+    const LayoutTable& sourceTable = *_backend.Table(sourceLayout);
+
+    // The keys that typed the sample then pick the layout they were meant
+    // for, as for a word; characters the source cannot type are skipped
+    KeystrokeInfo keystrokes[CONVERSION_SAMPLE];
+    size_t keystrokeCount = 0;
+    for (size_t c = 0; c < sampleLength; ++c) {
+        int virtualKey;
+        bool shift;
+        if (sourceTable.FindKey(text[c], virtualKey, shift)) {
+            keystrokes[keystrokeCount++] = KeystrokeInfo::Make(virtualKey, shift, false);
+        }
+    }
+
+    LayoutCandidate candidates[PlatformBackend::MAX_LAYOUTS];
+    for (size_t i = 0; i < layoutCount; ++i) {
+        candidates[i].table = _backend.Table(layouts[i]);
+        candidates[i].dictionary = _backend.Dictionary(layouts[i]);
+        candidates[i].trigrams = _backend.Trigrams(layouts[i]);
+    }
+    _ranker.SetCandidates(candidates, layoutCount);
+
+    LayoutRanker::Ranking rankings[LayoutRanker::MAX_LAYOUTS];
+    size_t ranked = _ranker.Rank(keystrokes, keystrokeCount, sourceCandidate, rankings);
+    for (size_t i = 0; i < ranked; ++i) {
+        if (rankings[i].candidate != sourceCandidate) {
+            targetLayout = layouts[rankings[i].candidate];
+            break;
+        }
+    }
+    return targetLayout != nullptr;
+}
+
+void CorrectionEngine::OnRecorded(InputStateMachine::Recorded recorded) {
+    switch (recorded) {
+        case InputStateMachine::Recorded::Nothing:
+            return;
+        case InputStateMachine::Recorded::Cleared:
+            _scorer.Reset();
+            return;
+        case InputStateMachine::Recorded::Popped:
+            _scorer.Pop();
+            return;
+        case InputStateMachine::Recorded::Pushed:
+        case InputStateMachine::Recorded::Restarted:
+            break;
+    }
+
+    const KeystrokeRing& typing = _state.Current().Typing();
+    if (typing.Size() == 1) {
+        StartWord();
+    }
+    _scorer.Push(typing.Back());
+    if (_scorer.EndsWord()) {
+        AutoCorrect();
+    }
+}
+
+void CorrectionEngine::StartWord() {
+    // The layouts are read once per word, not per key
+    _wordLayout = _backend.WindowLayout(_backend.ForegroundWindow());
+    _wordLayoutCount = _backend.LayoutList(_wordLayouts, PlatformBackend::MAX_LAYOUTS);
+
+    LayoutCandidate candidates[PlatformBackend::MAX_LAYOUTS];
+    for (size_t i = 0; i < _wordLayoutCount; ++i) {
+        candidates[i].table = _backend.Table(_wordLayouts[i]);
+        candidates[i].dictionary = _backend.Dictionary(_wordLayouts[i]);
+        candidates[i].trigrams = _backend.Trigrams(_wordLayouts[i]);
+    }
+    _scorer.SetCandidates(candidates, _wordLayoutCount);
+}
+
+void CorrectionEngine::AutoCorrect() {
+    uint64_t start = LatencyClock::Now();
+    ++_autoStats.words;
+
+    HWND window = _backend.ForegroundWindow();
+    HKL targetLayout = ChooseAutoCorrection(window);
+    uint64_t ticks = _latency.Get(LatencyMetrics::AUTOCORRECT_DECIDE).RecordSince(start);
+    if (!targetLayout) {
+        return;
+    }
+
+    InputStateMachine::Correction correction;
+    if (!_state.BeginCorrection(correction)) {
+        return;
+    }
+    correction.automatic = true;
+    correction.typedLayout = reinterpret_cast<uintptr_t>(_wordLayout);
+    Apply(correction, window, _wordLayout, targetLayout, start, ticks);
+    ++_autoStats.corrections;
+}
+
+HKL CorrectionEngine::ChooseAutoCorrection(HWND window) {
+    // The scores must be for exactly the keys in the buffer, typed in one
+    // layout
+    const KeystrokeRing& typing = _state.Current().Typing();
+    size_t length = typing.Size();
+    if (!_scorer.IsValid() || _scorer.Length() != length || _backend.WindowLayout(window) != _wordLayout) {
+        return nullptr;
+    }
+
+    size_t typedLane = _scorer.CandidateCount();
+    for (size_t i = 0; i < _scorer.CandidateCount(); ++i) {
+        if (_wordLayouts[i] == _wordLayout) typedLane = i;
+    }
+    size_t letters = length - 1;
+    if (typedLane == _scorer.CandidateCount() || letters < static_cast<size_t>(_autoCorrect.minLetters)) {
+        return nullptr;
+    }
+
+    // Words the user corrected or took back before are settled without the
+    // scores
+    const UserDictionary::Entry* learned =
+        _userWords->Lookup(UserDictionary::Key(typing.Data(), letters, _wordLayout));
+    if (learned) {
+        HKL learnedLayout = LearnedLayout(*learned, _wordLayouts, _wordLayoutCount);
+        for (size_t i = 0; i < _scorer.CandidateCount(); ++i) {
+            const WordScorer::Lane& lane = _scorer.GetLane(i);
+            if (_wordLayouts[i] == learnedLayout && i != typedLane && !lane.missing && lane.letters == letters) {
+                return learnedLayout;
+            }
+        }
+        return nullptr;
+    }
+
+    // The best other layout that reads every key before the boundary as a
+    // letter: one whole word, nothing around it to retype
+    size_t bestLane = typedLane;
+    for (size_t i = 0; i < _scorer.CandidateCount(); ++i) {
+        const WordScorer::Lane& lane = _scorer.GetLane(i);
+        if (i == typedLane || lane.missing || lane.letters != letters) continue;
+        if (bestLane == typedLane || lane.score > _scorer.GetLane(bestLane).score) {
+            bestLane = i;
+        }
+    }
+    if (bestLane == typedLane) {
+        return nullptr;
+    }
+
+    const WordScorer::Lane& typed = _scorer.GetLane(typedLane);
+    long long lead = static_cast<long long>(_scorer.GetLane(bestLane).score) - typed.score;
+    if (lead < static_cast<long long>(_autoCorrect.margin) * static_cast<long long>(letters)) {
+        return nullptr;
+    }
+
+    // Words the dictionary knows were typed as meant
+    if (typed.letters == letters && IsDictionaryWord(typedLane, typing.Data(), letters)) {
+        return nullptr;
+    }
+    return _wordLayouts[bestLane];
+}
+
+bool CorrectionEngine::IsDictionaryWord(size_t lane, const KeystrokeInfo* keystrokes, size_t count) {
+    const LayoutTable* table = _backend.Table(_wordLayouts[lane]);
+    const Dawg* dictionary = _backend.Dictionary(_wordLayouts[lane]);
+    if (!table || !dictionary || count > LayoutRanker::MAX_WORD_LENGTH) {
+        return false;
+    }
+
+    char16_t word[LayoutRanker::MAX_WORD_LENGTH];
+    for (size_t i = 0; i < count; ++i) {
+        word[i] = ToLowerChar(table->Translate(keystrokes[i].VirtualKey(), keystrokes[i].Shift(),
+                                               keystrokes[i].CapsLock()));
+    }
+    return dictionary->Contains(word, count);
+}
+
+HKL CorrectionEngine::LearnedLayout(const UserDictionary::Entry& learned, const HKL* layouts, size_t count) const {
+    if (learned.verdict != UserDictionary::VERDICT_ACCEPTED) return nullptr;
+    for (size_t i = 0; i < count; ++i) {
+        if (UserDictionary::LayoutId(layouts[i]) == learned.layout) return layouts[i];
+    }
+    return nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,133 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include "Win32Compat.h"
+#include "AppRules.h"
+#include "CorrectionPlanner.h"
+#include "InputStateMachine.h"
+#include "LatencyMetrics.h"
+#include "LayoutRanker.h"
+#include "PlatformBackend.h"
+#include "TextTranscoder.h"
+#include "UserDictionary.h"
+#include "WordScorer.h"
+
+// Automatic correction when a word ends. Off unless the settings ask for it.
+struct AutoCorrectOptions {
+    bool enabled = false;
+    int minLetters = 4;     // Shorter words are never corrected automatically
+
+    // Lead the best other layout needs over the typed one, per letter, in
+    // NgramTable units (thousandths of a nat)
+    int margin = 1500;
+};
+
+// Worker side of the interceptor: keeps the per-window buffers up to date
+// and carries out corrections through a PlatformBackend. With Win32Backend
+// this is the app; with FakeBackend the same code runs on any host.
+// Not thread-safe, owned by the correction worker.
+class CorrectionEngine {
+public:
+    enum class Result {
+        Nothing,        // Empty buffer
+        Refused,        // The dictionaries say the word was typed as meant
+        Unicode,        // Corrected text injected as characters in one batch
+        KeyReplay       // Deleted, switched, and replayed the keys
+    };
+
+    struct AutoCorrectStats {
+        size_t words = 0;           // Word ends looked at
+        size_t corrections = 0;
+        size_t undos = 0;           // Taken back with Pause
+    };
+
+    CorrectionEngine(PlatformBackend& backend, LatencyMetrics& latency, size_t keystrokeCapacity);
+
+    void SetAutoCorrect(const AutoCorrectOptions& options);
+    const AutoCorrectStats& GetAutoCorrectStats() const { return _autoStats; }
+
+    // How corrections type into the foreground application, from its rule
+    void SetInjection(AppPolicy::Injection injection) { _injection = injection; }
+
+    // Where corrections the user kept or took back are learned and looked
+    // up; null for a dictionary of this engine's own that lasts the session
+    void SetUserDictionary(UserDictionary* dictionary) { _userWords = dictionary ? dictionary : &_sessionWords; }
+    const UserDictionary& GetUserDictionary() const { return *_userWords; }
+
+    // Words Shift+Pause corrects, 0 for everything typed since focus moved
+    void SetPhraseWords(size_t words) { _phraseWords = words; }
+
+    // Swaps in the foreground window's buffer. Returns true when focus moved.
+    bool UpdateFocus();
+
+    // The same for a window the caller saw come to the front, for focus
+    // changes that travel in the event stream with the keys around them
+    bool SetFocus(HWND window);
+
+    // Click, keystroke or correction request from the hook. With
+    // auto-correct on, a keystroke also updates the word's scores and may
+    // correct the word it ends.
+    void Process(const KeyEvent& event);
+
+    // Pause. Right after an auto-correction it takes the correction back
+    // and keeps that word from being auto-corrected again. Where the user
+    // leaves a word goes to the user dictionary.
+    Result Correct();
+
+    // Shift+Pause. Retypes the last words under the layout the whole phrase
+    // reads best in, in one batch; another press tries the next best. Words
+    // already in that layout come out unchanged.
+    Result CorrectPhrase();
+
+    // Rewrites the foreground window's selection as typed under the layout
+    // it reads best in, through the clipboard. Returns false when nothing
+    // was selected.
+    bool ConvertSelection();
+
+    void ClearBuffer() { _state.ClearBuffer(); }
+    void Reset();
+
+    const InputStateMachine& State() const { return _state; }
+    const CorrectionPlan& LastPlan() const { return _plan; }
+
+private:
+    Result Apply(const InputStateMachine::Correction& correction, HWND window, HKL currentLayout,
+                 HKL targetLayout, uint64_t start, uint64_t ticks);
+    bool ChooseTargetLayout(const InputStateMachine::Correction& correction, HKL typedLayout,
+                            HKL& targetLayout);
+    bool ChooseConversion(const std::u16string& text, HKL currentLayout, HKL& sourceLayout, HKL& targetLayout);
+    HKL ChoosePhraseLayout(const InputStateMachine::Correction& correction, HKL currentLayout);
+
+    // Characters of a selection looked at to pick its layouts
+    static const size_t CONVERSION_SAMPLE = LayoutRanker::MAX_WORD_LENGTH;
+
+    void OnRecorded(InputStateMachine::Recorded recorded);
+    void StartWord();
+    void AutoCorrect();
+    HKL ChooseAutoCorrection(HWND window);
+    bool IsDictionaryWord(size_t lane, const KeystrokeInfo* keystrokes, size_t count);
+    HKL LearnedLayout(const UserDictionary::Entry& learned, const HKL* layouts, size_t count) const;
+
+    PlatformBackend& _backend;
+    LatencyMetrics& _latency;
+    InputStateMachine _state;
+    CorrectionPlan _plan;
+    LayoutRanker _ranker;
+    TextTranscoder _transcoder;
+    std::u16string _selection;
+    AppPolicy::Injection _injection;
+    size_t _phraseWords;
+    HWND _window;
+
+    // Auto-correct: scores of the word being typed, the layouts it is
+    // scored against, and the one it is being typed in
+    AutoCorrectOptions _autoCorrect;
+    AutoCorrectStats _autoStats;
+    WordScorer _scorer;
+    HKL _wordLayouts[PlatformBackend::MAX_LAYOUTS];
+    size_t _wordLayoutCount;
+    HKL _wordLayout;
+
+    UserDictionary _sessionWords;
+    UserDictionary* _userWords;
+};
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "CorrectionPlanner.h"
+#include "InjectedInput.h"
+
+void CorrectionPlanner::BuildPlan(const KeystrokeInfo* keystrokes, size_t count, CorrectionPlan& plan) {
+    std::vector<INPUT>& inputs = plan.inputs;
+    inputs.clear();
+    inputs.reserve(MaxInputCount(count));
+
+    AppendBackspaces(inputs, count);
+    plan.deleteCount = inputs.size();
+
+    // Replay keystrokes, holding Shift across runs of shifted keys
+    bool shiftDown = false;
+    for (size_t i = 0; i < count; ++i) {
+        KeystrokeInfo keystroke = keystrokes[i];
+
+        if (keystroke.Shift() != shiftDown) {
+            AppendKey(inputs, VK_SHIFT, shiftDown);
+            shiftDown = keystroke.Shift();
+        }
+
+        WORD virtualKey = static_cast<WORD>(keystroke.VirtualKey());
+        AppendKey(inputs, virtualKey, false, keystroke.Extended());
+        AppendKey(inputs, virtualKey, true, keystroke.Extended());
+    }
+
+    if (shiftDown) {
+        AppendKey(inputs, VK_SHIFT, true);
+    }
+}
+
+bool CorrectionPlanner::BuildUnicodePlan(const KeystrokeInfo* keystrokes, size_t count,
+                                         const LayoutTable& targetLayout, CorrectionPlan& plan) {
+    std::vector<INPUT>& inputs = plan.inputs;
+    inputs.clear();
+    inputs.reserve(count * 4);
+
+    AppendBackspaces(inputs, count);
+    plan.deleteCount = inputs.size();
+
+    for (size_t i = 0; i < count; ++i) {
+        KeystrokeInfo keystroke = keystrokes[i];
+        char16_t ch = targetLayout.Translate(keystroke.VirtualKey(), keystroke.Shift(), keystroke.CapsLock());
+        if (ch == 0) {
+            inputs.clear();
+            plan.deleteCount = 0;
+            return false;
+        }
+
+        AppendChar(inputs, ch, false);
+        AppendChar(inputs, ch, true);
+    }
+
+    return true;
+}
+
+void CorrectionPlanner::AppendBackspaces(std::vector<INPUT>& inputs, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        AppendKey(inputs, VK_BACK, false);
+        AppendKey(inputs, VK_BACK, true);
+    }
+}
+
+void CorrectionPlanner::AppendKey(std::vector<INPUT>& inputs, WORD virtualKey, bool keyUp, bool extended) {
+    INPUT input = {};
+    input.type = INPUT_KEYBOARD;
+    input.ki.wVk = virtualKey;
+    input.ki.dwFlags = (keyUp ? KEYEVENTF_KEYUP : 0) | (extended ? KEYEVENTF_EXTENDEDKEY : 0);
+    InjectedInput::Stamp(input);
+    inputs.push_back(input);
+}
+
+void CorrectionPlanner::AppendChar(std::vector<INPUT>& inputs, char16_t ch, bool keyUp) {
+    INPUT input = {};
+    input.type = INPUT_KEYBOARD;
+    input.ki.wScan = static_cast<WORD>(ch);
+    input.ki.dwFlags = KEYEVENTF_UNICODE | (keyUp ? KEYEVENTF_KEYUP : 0);
+    InjectedInput::Stamp(input);
+    inputs.push_back(input);
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "Win32Compat.h"
+#include "Keystroke.h"
+#include "LayoutTable.h"
+
+// Every input needed to correct one word, laid out in injection order.
+// A key replay plan depends on the layout switch landing between its two
+// segments, so it is sent as two SendInput batches. A Unicode plan carries
+// the final characters and is sent in one batch. Every input carries
+// InjectedInput's signature.
+struct CorrectionPlan {
+    std::vector<INPUT> inputs;
+    size_t deleteCount = 0;     // inputs[0, deleteCount) erase the typed word
+
+    const INPUT* DeleteInputs() const { return inputs.data(); }
+    const INPUT* ReplayInputs() const { return inputs.data() + deleteCount; }
+    size_t ReplayCount() const { return inputs.size() - deleteCount; }
+};
+
+class CorrectionPlanner {
+public:
+    // Fills plan with backspaces for every keystroke followed by the replayed
+    // keystrokes. Consecutive shifted keys share one Shift press, and keys
+    // recorded as extended are replayed as extended. The plan's
+    // storage is reused, so steady-state corrections do not allocate.
+    static void BuildPlan(const KeystrokeInfo* keystrokes, size_t count, CorrectionPlan& plan);
+
+    // Fills plan with backspaces followed by the text the keystrokes produce
+    // under the target layout, injected as KEYEVENTF_UNICODE characters.
+    // Returns false if some keystroke has no character in that layout.
+    static bool BuildUnicodePlan(const KeystrokeInfo* keystrokes, size_t count,
+                                 const LayoutTable& targetLayout, CorrectionPlan& plan);
+
+    // Upper bound on the inputs BuildPlan emits for count keystrokes
+    static size_t MaxInputCount(size_t count) { return count * 5 + 1; }
+
+private:
+    static void AppendBackspaces(std::vector<INPUT>& inputs, size_t count);
+    static void AppendKey(std::vector<INPUT>& inputs, WORD virtualKey, bool keyUp, bool extended = false);
+    static void AppendChar(std::vector<INPUT>& inputs, char16_t ch, bool keyUp);
+};
\ No newline at end of file
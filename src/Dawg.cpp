@@ -0,0 +1,58 @@
+#include "Dawg.h"
+#include <cstring>
+
+static_assert(sizeof(DawgHeader) == 24, "DawgHeader layout is part of the file format");
+static_assert(sizeof(DawgEdge) == 8, "DawgEdge layout is part of the file format");
+
+Dawg::Dawg() : _edges(nullptr), _edgeCount(0), _rootIndex(0), _wordCount(0) {
+}
+
+bool Dawg::Attach(const uint8_t* data, size_t size) {
+    Detach();
+
+    if (!data || size < sizeof(DawgHeader)) return false;
+    if (reinterpret_cast<uintptr_t>(data) % alignof(DawgEdge) != 0) return false;
+
+    DawgHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != MAGIC || header.version != VERSION) return false;
+    if (header.edgeCount == 0 || header.rootIndex >= header.edgeCount) return false;
+    if (size < sizeof(DawgHeader) + static_cast<size_t>(header.edgeCount) * sizeof(DawgEdge)) return false;
+
+    _edges = reinterpret_cast<const DawgEdge*>(data + sizeof(DawgHeader));
+    _edgeCount = header.edgeCount;
+    _rootIndex = header.rootIndex;
+    _wordCount = header.wordCount;
+    return true;
+}
+
+void Dawg::Detach() {
+    _edges = nullptr;
+    _edgeCount = 0;
+    _rootIndex = 0;
+    _wordCount = 0;
+}
+
+uint32_t Dawg::FindEdge(uint32_t node, char16_t label) const {
+    if (node == 0 || node >= _edgeCount) return 0;
+
+    for (uint32_t index = node; index < _edgeCount; ++index) {
+        const DawgEdge& edge = _edges[index];
+        if (edge.label == label) return index;
+        if (edge.label > label || (edge.flags & DAWG_LAST_EDGE)) return 0;
+    }
+    return 0;
+}
+
+bool Dawg::Contains(const char16_t* word, size_t length) const {
+    if (!_edges || length == 0) return false;
+
+    uint32_t node = _rootIndex;
+    uint32_t edge = 0;
+    for (size_t i = 0; i < length; ++i) {
+        edge = FindEdge(node, word[i]);
+        if (!edge) return false;
+        node = _edges[edge].target;
+    }
+    return (_edges[edge].flags & DAWG_FINAL) != 0;
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Read-only view of a minimized DAWG (directed acyclic word graph) stored as
+// a flat edge array. The view points straight into the buffer it is attached
+// to, typically a memory-mapped file, so lookups never allocate.
+//
+// Layout (little-endian):
+//   DawgHeader
+//   DawgEdge[edgeCount]   edge 0 is a sentinel, a node is a run of edges
+//                         sorted by label and terminated by DAWG_LAST_EDGE
+struct DawgHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t edgeCount;
+    uint32_t rootIndex;     // First edge of the root node
+    uint32_t wordCount;
+    uint32_t padding;
+};
+
+struct DawgEdge {
+    uint16_t label;
+    uint16_t flags;
+    uint32_t target;        // First edge of the child node, 0 for none
+};
+
+const uint16_t DAWG_LAST_EDGE = 0x0001;    // Last sibling of its node
+const uint16_t DAWG_FINAL = 0x0002;        // A word ends after this edge
+
+class Dawg {
+public:
+    static const uint32_t MAGIC = 0x5744534B;   // "KSDW"
+    static const uint16_t VERSION = 1;
+
+    Dawg();
+
+    // Validates the header and points the view at data without copying
+    bool Attach(const uint8_t* data, size_t size);
+    void Detach();
+
+    bool IsValid() const { return _edges != nullptr; }
+    uint32_t WordCount() const { return _wordCount; }
+    size_t SizeInBytes() const { return sizeof(DawgHeader) + _edgeCount * sizeof(DawgEdge); }
+
+    bool Contains(const char16_t* word, size_t length) const;
+
+    // Walks one character from the node starting at edge index node.
+    // Returns the matching edge index or 0 if there is none.
+    uint32_t FindEdge(uint32_t node, char16_t label) const;
+    uint32_t Root() const { return _rootIndex; }
+    const DawgEdge& Edge(uint32_t index) const { return _edges[index]; }
+
+private:
+    const DawgEdge* _edges;
+    uint32_t _edgeCount;
+    uint32_t _rootIndex;
+    uint32_t _wordCount;
+};
\ No newline at end of file
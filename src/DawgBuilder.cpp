@@ -0,0 +1,132 @@
+#include "DawgBuilder.h"
+#include <cstring>
+#include "Dawg.h"
+
+DawgBuilder::DawgBuilder() : _wordCount(0) {
+    _nodes.emplace_back();  // Root
+}
+
+uint32_t DawgBuilder::NewNode() {
+    if (!_freeNodes.empty()) {
+        uint32_t id = _freeNodes.back();
+        _freeNodes.pop_back();
+        _nodes[id] = Node();
+        return id;
+    }
+    _nodes.emplace_back();
+    return static_cast<uint32_t>(_nodes.size() - 1);
+}
+
+bool DawgBuilder::Add(const std::u16string& word) {
+    if (word.empty()) return false;
+    if (_wordCount > 0 && word <= _previousWord) return false;
+
+    size_t prefix = 0;
+    while (prefix < word.size() && prefix < _previousWord.size() && word[prefix] == _previousWord[prefix]) {
+        ++prefix;
+    }
+
+    // Everything below the shared prefix is final now and can be merged
+    Minimize(prefix);
+
+    uint32_t node = _uncheckedNodes.empty() ? 0 : _uncheckedNodes.back().child;
+    for (size_t i = prefix; i < word.size(); ++i) {
+        uint32_t child = NewNode();
+        _nodes[node].edges.emplace_back(word[i], child);
+        _uncheckedNodes.push_back({ node, child });
+        node = child;
+    }
+
+    _nodes[node].final = true;
+    _previousWord = word;
+    ++_wordCount;
+    return true;
+}
+
+void DawgBuilder::Minimize(size_t downTo) {
+    while (_uncheckedNodes.size() > downTo) {
+        UncheckedNode unchecked = _uncheckedNodes.back();
+        _uncheckedNodes.pop_back();
+
+        std::string signature = Signature(_nodes[unchecked.child]);
+        auto found = _register.find(signature);
+        if (found != _register.end()) {
+            // Children are added in order, so the edge to redirect is the last one
+            _nodes[unchecked.parent].edges.back().second = found->second;
+            _nodes[unchecked.child] = Node();
+            _freeNodes.push_back(unchecked.child);
+        } else {
+            _register.emplace(std::move(signature), unchecked.child);
+        }
+    }
+}
+
+std::string DawgBuilder::Signature(const Node& node) const {
+    // Children are already minimized, so their ids identify them
+    std::string signature;
+    signature.reserve(1 + node.edges.size() * 6);
+    signature.push_back(node.final ? 1 : 0);
+    for (const auto& edge : node.edges) {
+        char bytes[6];
+        memcpy(bytes, &edge.first, 2);
+        memcpy(bytes + 2, &edge.second, 4);
+        signature.append(bytes, sizeof(bytes));
+    }
+    return signature;
+}
+
+std::vector<uint8_t> DawgBuilder::Serialize() {
+    Minimize(0);
+
+    // Lay nodes out children first so every target is known when its parent
+    // is written; nodes without edges need no block at all
+    std::vector<DawgEdge> edges;
+    edges.push_back({ 0, DAWG_LAST_EDGE, 0 });  // Sentinel
+    std::vector<uint32_t> placed(_nodes.size(), 0);
+    std::vector<std::pair<uint32_t, size_t>> stack;
+
+    auto place = [&](uint32_t id) {
+        const Node& node = _nodes[id];
+        uint32_t first = static_cast<uint32_t>(edges.size());
+        for (size_t i = 0; i < node.edges.size(); ++i) {
+            const Node& child = _nodes[node.edges[i].second];
+            DawgEdge edge;
+            edge.label = static_cast<uint16_t>(node.edges[i].first);
+            edge.flags = (i + 1 == node.edges.size() ? DAWG_LAST_EDGE : 0) | (child.final ? DAWG_FINAL : 0);
+            edge.target = placed[node.edges[i].second];
+            edges.push_back(edge);
+        }
+        placed[id] = first;
+    };
+
+    stack.push_back({ 0, 0 });
+    std::vector<bool> visited(_nodes.size(), false);
+    visited[0] = true;
+    while (!stack.empty()) {
+        auto& top = stack.back();
+        const Node& node = _nodes[top.first];
+        if (top.second < node.edges.size()) {
+            uint32_t child = node.edges[top.second++].second;
+            if (!visited[child]) {
+                visited[child] = true;
+                if (_nodes[child].edges.empty()) continue;
+                stack.push_back({ child, 0 });
+            }
+        } else {
+            place(top.first);
+            stack.pop_back();
+        }
+    }
+
+    DawgHeader header = {};
+    header.magic = Dawg::MAGIC;
+    header.version = Dawg::VERSION;
+    header.edgeCount = static_cast<uint32_t>(edges.size());
+    header.rootIndex = _nodes[0].edges.empty() ? 0 : placed[0];
+    header.wordCount = static_cast<uint32_t>(_wordCount);
+
+    std::vector<uint8_t> out(sizeof(header) + edges.size() * sizeof(DawgEdge));
+    memcpy(out.data(), &header, sizeof(header));
+    memcpy(out.data() + sizeof(header), edges.data(), edges.size() * sizeof(DawgEdge));
+    return out;
+}
\ No newline at end of file
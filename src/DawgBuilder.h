@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Builds a minimized DAWG from words added in strictly ascending order,
+// merging equivalent suffixes as it goes so memory stays proportional to the
+// minimized graph rather than to the input. Serialize() produces the flat
+// form read by Dawg.
+class DawgBuilder {
+public:
+    DawgBuilder();
+
+    // Returns false for empty, duplicate or out-of-order words
+    bool Add(const std::u16string& word);
+
+    std::vector<uint8_t> Serialize();
+
+    size_t WordCount() const { return _wordCount; }
+    size_t NodeCount() const { return _register.size() + _uncheckedNodes.size() + 1; }
+
+private:
+    struct Node {
+        std::vector<std::pair<char16_t, uint32_t>> edges;
+        bool final = false;
+    };
+
+    struct UncheckedNode {
+        uint32_t parent;
+        uint32_t child;
+    };
+
+    void Minimize(size_t downTo);
+    std::string Signature(const Node& node) const;
+    uint32_t NewNode();
+
+    std::vector<Node> _nodes;
+    std::vector<uint32_t> _freeNodes;
+    std::vector<UncheckedNode> _uncheckedNodes;
+    std::unordered_map<std::string, uint32_t> _register;
+    std::u16string _previousWord;
+    size_t _wordCount;
+};
\ No newline at end of file
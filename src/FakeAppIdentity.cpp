@@ -0,0 +1,41 @@
+#include "FakeAppIdentity.h"
+
+FakeAppIdentity::FakeAppIdentity() : _windowQueries(0), _imageQueries(0) {
+}
+
+void FakeAppIdentity::AddWindow(HWND window, uint32_t processId, uint32_t threadId,
+                                const std::u16string& className) {
+    _windows[window] = Window{ processId, threadId, className };
+}
+
+void FakeAppIdentity::SetImageName(uint32_t processId, const std::u16string& name) {
+    _images[processId] = name;
+}
+
+void FakeAppIdentity::Clear() {
+    _windows.clear();
+    _images.clear();
+}
+
+bool FakeAppIdentity::QueryWindow(HWND window, uint32_t& processId, uint32_t& threadId,
+                                  char16_t* className, size_t capacity, size_t& length) {
+    ++_windowQueries;
+    auto found = _windows.find(window);
+    if (found == _windows.end()) return false;
+
+    processId = found->second.processId;
+    threadId = found->second.threadId;
+    return Copy(found->second.className, className, capacity, length);
+}
+
+bool FakeAppIdentity::QueryImageName(uint32_t processId, char16_t* name, size_t capacity, size_t& length) {
+    ++_imageQueries;
+    auto found = _images.find(processId);
+    return found != _images.end() && Copy(found->second, name, capacity, length);
+}
+
+bool FakeAppIdentity::Copy(const std::u16string& text, char16_t* out, size_t capacity, size_t& length) {
+    length = text.size() < capacity ? text.size() : capacity;
+    text.copy(out, length);
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include "AppRuleMatcher.h"
+
+// AppIdentitySource with windows and processes set up by the caller. Counts
+// queries, so host tools can see what the matcher's cache saves.
+class FakeAppIdentity : public AppIdentitySource {
+public:
+    FakeAppIdentity();
+
+    void AddWindow(HWND window, uint32_t processId, uint32_t threadId, const std::u16string& className);
+    void SetImageName(uint32_t processId, const std::u16string& name);
+    void Clear();
+
+    size_t WindowQueries() const { return _windowQueries; }
+    size_t ImageQueries() const { return _imageQueries; }
+
+    bool QueryWindow(HWND window, uint32_t& processId, uint32_t& threadId,
+                     char16_t* className, size_t capacity, size_t& length) override;
+    bool QueryImageName(uint32_t processId, char16_t* name, size_t capacity, size_t& length) override;
+
+private:
+    struct Window {
+        uint32_t processId;
+        uint32_t threadId;
+        std::u16string className;
+    };
+
+    static bool Copy(const std::u16string& text, char16_t* out, size_t capacity, size_t& length);
+
+    std::unordered_map<HWND, Window> _windows;
+    std::unordered_map<uint32_t, std::u16string> _images;
+    size_t _windowQueries;
+    size_t _imageQueries;
+};
\ No newline at end of file
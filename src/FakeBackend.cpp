@@ -0,0 +1,94 @@
+#include "FakeBackend.h"
+
+FakeBackend::FakeBackend() : _count(0), _active(nullptr), _foreground(nullptr), _layoutRequests(0) {
+}
+
+HKL FakeBackend::AddLayout(const LayoutTable& table, const Dawg* dictionary, const NgramTable* trigrams) {
+    if (_count >= MAX_LAYOUTS) return nullptr;
+
+    _layouts[_count].table = table;
+    _layouts[_count].dictionary = dictionary;
+    _layouts[_count].trigrams = trigrams;
+    HKL handle = Handle(_count++);
+    if (!_active) _active = handle;
+    return handle;
+}
+
+void FakeBackend::SetDictionary(HKL layout, const Dawg* dictionary) {
+    Layout* entry = Find(layout);
+    if (entry) entry->dictionary = dictionary;
+}
+
+void FakeBackend::SetTrigrams(HKL layout, const NgramTable* trigrams) {
+    Layout* entry = Find(layout);
+    if (entry) entry->trigrams = trigrams;
+}
+
+void FakeBackend::ClearHistory() {
+    _sent.clear();
+    _pasted.clear();
+    _layoutRequests = 0;
+}
+
+FakeBackend::Layout* FakeBackend::Find(HKL layout) {
+    size_t index = reinterpret_cast<uintptr_t>(layout);
+    return index >= 1 && index <= _count ? &_layouts[index - 1] : nullptr;
+}
+
+HKL FakeBackend::NextLayout(HKL current) {
+    if (_count <= 1) return nullptr;
+
+    size_t index = reinterpret_cast<uintptr_t>(current);
+    return Handle(index >= 1 && index <= _count ? index % _count : 0);
+}
+
+size_t FakeBackend::LayoutList(HKL* layouts, size_t capacity) {
+    size_t count = _count < capacity ? _count : capacity;
+    for (size_t i = 0; i < count; ++i) {
+        layouts[i] = Handle(i);
+    }
+    return count;
+}
+
+const LayoutTable* FakeBackend::Table(HKL layout) {
+    Layout* entry = Find(layout);
+    return entry ? &entry->table : nullptr;
+}
+
+const Dawg* FakeBackend::Dictionary(HKL layout) {
+    Layout* entry = Find(layout);
+    return entry ? entry->dictionary : nullptr;
+}
+
+const NgramTable* FakeBackend::Trigrams(HKL layout) {
+    Layout* entry = Find(layout);
+    return entry ? entry->trigrams : nullptr;
+}
+
+void FakeBackend::Send(const INPUT* inputs, size_t count) {
+    _sent.insert(_sent.end(), inputs, inputs + count);
+}
+
+void FakeBackend::RequestLayout(HWND window, HKL layout) {
+    // Same rule as WM_INPUTLANGCHANGEREQUEST: nothing happens without a window
+    if (!window) return;
+
+    ++_layoutRequests;
+    if (!layout) layout = NextLayout(_active);
+    if (Find(layout)) _active = layout;
+}
+
+bool FakeBackend::CopySelection(HWND window, std::u16string& text) {
+    if (!window || _selection.empty()) return false;
+
+    text = _selection;
+    return true;
+}
+
+void FakeBackend::PasteText(HWND window, const std::u16string& text) {
+    if (!window) return;
+
+    // The pasted text replaces the selection
+    _pasted = text;
+    _selection = text;
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "PlatformBackend.h"
+
+// In-memory PlatformBackend for host tools. Layouts are registered up front
+// and one layout is shared by every window. Injected input is kept in a
+// vector instead of reaching any application, and layout switches apply at
+// once, so WaitForLayout never waits.
+class FakeBackend : public PlatformBackend {
+public:
+    FakeBackend();
+
+    // Registers a layout and returns its handle. The first one becomes active.
+    HKL AddLayout(const LayoutTable& table, const Dawg* dictionary = nullptr,
+                  const NgramTable* trigrams = nullptr);
+    void SetDictionary(HKL layout, const Dawg* dictionary);
+    void SetTrigrams(HKL layout, const NgramTable* trigrams);
+
+    void SetForegroundWindow(HWND window) { _foreground = window; }
+    HKL ActiveLayout() const { return _active; }
+    void SetActiveLayout(HKL layout) { _active = layout; }
+
+    // What CopySelection returns, and the text PasteText last put in
+    void SetSelection(const std::u16string& text) { _selection = text; }
+    const std::u16string& PastedText() const { return _pasted; }
+
+    const std::vector<INPUT>& SentInputs() const { return _sent; }
+    size_t LayoutRequests() const { return _layoutRequests; }
+    void ClearHistory();
+
+    HWND ForegroundWindow() override { return _foreground; }
+    HKL WindowLayout(HWND) override { return _active; }
+    HKL NextLayout(HKL current) override;
+    size_t LayoutList(HKL* layouts, size_t capacity) override;
+    const LayoutTable* Table(HKL layout) override;
+    const Dawg* Dictionary(HKL layout) override;
+    const NgramTable* Trigrams(HKL layout) override;
+    void Send(const INPUT* inputs, size_t count) override;
+    void RequestLayout(HWND window, HKL layout) override;
+    void WaitForLayout(HWND, HKL) override {}
+    bool CopySelection(HWND window, std::u16string& text) override;
+    void PasteText(HWND window, const std::u16string& text) override;
+
+private:
+    struct Layout {
+        LayoutTable table;
+        const Dawg* dictionary = nullptr;
+        const NgramTable* trigrams = nullptr;
+    };
+
+    // Handles are 1-based indices, so null stays "no layout"
+    static HKL Handle(size_t index) { return reinterpret_cast<HKL>(index + 1); }
+    Layout* Find(HKL layout);
+
+    Layout _layouts[MAX_LAYOUTS];
+    size_t _count;
+    HKL _active;
+    HWND _foreground;
+    std::vector<INPUT> _sent;
+    std::u16string _selection;
+    std::u16string _pasted;
+    size_t _layoutRequests;
+};
\ No newline at end of file
@@ -0,0 +1,27 @@
+#include "FakeForegroundSource.h"
+
+FakeForegroundSource::FakeForegroundSource(FakeBackend& backend)
+    : _backend(backend), _tracker(nullptr), _available(true), _queries(0) {
+}
+
+void FakeForegroundSource::SetForeground(HWND window, bool deliverEvent) {
+    _backend.SetForegroundWindow(window);
+    if (_tracker && deliverEvent) {
+        _tracker->OnForegroundChange(window);
+    }
+}
+
+bool FakeForegroundSource::Subscribe(ForegroundTracker& tracker) {
+    if (!_available) return false;
+    _tracker = &tracker;
+    return true;
+}
+
+void FakeForegroundSource::Unsubscribe() {
+    _tracker = nullptr;
+}
+
+HWND FakeForegroundSource::QueryForeground() {
+    ++_queries;
+    return _backend.ForegroundWindow();
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+#include "FakeBackend.h"
+#include "ForegroundTracker.h"
+
+// ForegroundSource over a FakeBackend: SetForeground moves the backend's
+// foreground window and, unless told to drop it, delivers the change event
+// the way the system would. Counts queries, so host tools can see how often
+// the tracker still reaches the system.
+class FakeForegroundSource : public ForegroundSource {
+public:
+    explicit FakeForegroundSource(FakeBackend& backend);
+
+    void SetForeground(HWND window, bool deliverEvent = true);
+    void SetAvailable(bool available) { _available = available; }
+    size_t Queries() const { return _queries; }
+
+    bool Subscribe(ForegroundTracker& tracker) override;
+    void Unsubscribe() override;
+    HWND QueryForeground() override;
+
+private:
+    FakeBackend& _backend;
+    ForegroundTracker* _tracker;
+    bool _available;
+    size_t _queries;
+};
\ No newline at end of file
@@ -0,0 +1,25 @@
+#include "FakeSystemState.h"
+
+FakeSystemState::FakeSystemState(FakeBackend& backend)
+    : _backend(backend), _darkTheme(false), _dpi(96), _queries(0) {
+}
+
+bool FakeSystemState::QueryDarkTheme() {
+    ++_queries;
+    return _darkTheme;
+}
+
+int FakeSystemState::QueryDpi() {
+    ++_queries;
+    return _dpi;
+}
+
+size_t FakeSystemState::QueryLayouts(HKL* layouts, size_t capacity) {
+    ++_queries;
+    return _backend.LayoutList(layouts, capacity);
+}
+
+HKL FakeSystemState::QueryForegroundLayout() {
+    ++_queries;
+    return _backend.WindowLayout(_backend.ForegroundWindow());
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+#include "FakeBackend.h"
+#include "SystemStateCache.h"
+
+// SystemStateSource over a FakeBackend: layouts and the foreground layout
+// come from the backend, theme and DPI are set directly. Counts queries, so
+// host tools can check how often the cache really reaches the system.
+class FakeSystemState : public SystemStateSource {
+public:
+    explicit FakeSystemState(FakeBackend& backend);
+
+    void SetDarkTheme(bool dark) { _darkTheme = dark; }
+    void SetDpi(int dpi) { _dpi = dpi; }
+    size_t Queries() const { return _queries; }
+
+    bool QueryDarkTheme() override;
+    int QueryDpi() override;
+    size_t QueryLayouts(HKL* layouts, size_t capacity) override;
+    HKL QueryForegroundLayout() override;
+
+private:
+    FakeBackend& _backend;
+    bool _darkTheme;
+    int _dpi;
+    size_t _queries;
+};
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include "ForegroundTracker.h"
+#include <cstdio>
+
+ForegroundTracker::ForegroundTracker(ForegroundSource& source)
+    : _source(source), _window(nullptr), _subscribed(false), _handler(nullptr), _handlerContext(nullptr) {
+}
+
+ForegroundTracker::~ForegroundTracker() {
+    Stop();
+}
+
+bool ForegroundTracker::Start() {
+    if (IsSubscribed()) return true;
+    if (!_source.Subscribe(*this)) return false;
+
+    // Events only report changes from here on
+    _window.store(_source.QueryForeground(), std::memory_order_relaxed);
+    _subscribed.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void ForegroundTracker::Stop() {
+    if (!IsSubscribed()) return;
+    _subscribed.store(false, std::memory_order_relaxed);
+    _source.Unsubscribe();
+}
+
+void ForegroundTracker::SetChangeHandler(ChangeHandler handler, void* context) {
+    _handler = handler;
+    _handlerContext = context;
+}
+
+void ForegroundTracker::OnForegroundChange(HWND window) {
+    ++_counters.events;
+    if (window != _window.load(std::memory_order_relaxed)) {
+        Store(window);
+    }
+}
+
+bool ForegroundTracker::Refresh() {
+    ++_counters.refreshes;
+    HWND window = _source.QueryForeground();
+    if (window == _window.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    if (IsSubscribed()) ++_counters.missed;
+    Store(window);
+    return true;
+}
+
+void ForegroundTracker::Store(HWND window) {
+    _window.store(window, std::memory_order_relaxed);
+    ++_counters.changes;
+    if (_handler) _handler(_handlerContext, window);
+}
+
+std::string ForegroundTracker::Format() const {
+    char line[160];
+    snprintf(line, sizeof(line), "foreground window: %llu events, %llu changes, %llu refreshes, %llu missed%s\n",
+             static_cast<unsigned long long>(_counters.events),
+             static_cast<unsigned long long>(_counters.changes),
+             static_cast<unsigned long long>(_counters.refreshes),
+             static_cast<unsigned long long>(_counters.missed),
+             IsSubscribed() ? "" : " (not subscribed, every read asks)");
+    return line;
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "Win32Compat.h"
+
+class ForegroundTracker;
+
+// Where ForegroundTracker hears about the foreground window.
+// Win32ForegroundSource is the real one, subscribed to
+// EVENT_SYSTEM_FOREGROUND; FakeForegroundSource is the host-side one.
+class ForegroundSource {
+public:
+    virtual ~ForegroundSource() {}
+
+    // Starts calling tracker.OnForegroundChange, on the thread that
+    // subscribed, whenever another window comes to the front. False when no
+    // such events can be had.
+    virtual bool Subscribe(ForegroundTracker& tracker) = 0;
+    virtual void Unsubscribe() = 0;
+
+    // The foreground window right now; may be a syscall
+    virtual HWND QueryForeground() = 0;
+};
+
+// The foreground window, kept current by change events so the hooks and the
+// worker read it with a load instead of asking the system per keystroke.
+// Events, refreshes and the change handler run on the owning thread, the UI
+// thread that also runs the hooks; Window may be called from any thread.
+//
+// A change event can arrive just after the first key typed in the new
+// window, and a few transitions send none, so the layout poll also calls
+// Refresh: a read is at most one poll out of date. Until Start succeeds
+// every read asks the source.
+class ForegroundTracker {
+public:
+    typedef void (*ChangeHandler)(void* context, HWND window);
+
+    struct Counters {
+        uint64_t events = 0;        // Change events delivered
+        uint64_t changes = 0;       // Events and refreshes that moved the window
+        uint64_t refreshes = 0;
+        uint64_t missed = 0;        // Refreshes that found a change no event reported
+    };
+
+    explicit ForegroundTracker(ForegroundSource& source);
+    ~ForegroundTracker();
+
+    // Subscribes and reads the current window. Returns false, and keeps
+    // asking the source on every read, when the source has no events.
+    bool Start();
+    void Stop();
+    bool IsSubscribed() const { return _subscribed.load(std::memory_order_relaxed); }
+
+    // Called after each change is stored, on the owning thread
+    void SetChangeHandler(ChangeHandler handler, void* context);
+
+    HWND Window() const {
+        if (!_subscribed.load(std::memory_order_relaxed)) {
+            return _source.QueryForeground();
+        }
+        return _window.load(std::memory_order_relaxed);
+    }
+
+    // From the source's event
+    void OnForegroundChange(HWND window);
+
+    // Asks the source now; true when the window had changed without an event
+    bool Refresh();
+
+    const Counters& GetCounters() const { return _counters; }
+    void ResetCounters() { _counters = Counters(); }
+
+    // One line: events, changes, refreshes and missed changes
+    std::string Format() const;
+
+private:
+    void Store(HWND window);
+
+    ForegroundSource& _source;
+    std::atomic<HWND> _window;
+    std::atomic<bool> _subscribed;
+    ChangeHandler _handler;
+    void* _handlerContext;
+    Counters _counters;
+};
\ No newline at end of file
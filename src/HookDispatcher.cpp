@@ -0,0 +1,32 @@
+#include "HookDispatcher.h"
+
+HookDispatcher::HookDispatcher() : _enabledMask(0), _suspendedMask(0) {
+    for (auto& entry : _handlers) {
+        entry.handler = NoOpHandler;
+        entry.context = nullptr;
+    }
+}
+
+void HookDispatcher::SetHandler(HandlerId id, HandlerFn handler, void* context) {
+    // Handlers are registered before the hook is installed, only the enabled
+    // mask changes while events are flowing
+    _handlers[id].handler = handler ? handler : NoOpHandler;
+    _handlers[id].context = context;
+}
+
+void HookDispatcher::SetEnabled(HandlerId id, bool enabled) {
+    uint32_t bit = 1u << id;
+    if (enabled) {
+        _enabledMask.fetch_or(bit, std::memory_order_relaxed);
+    } else {
+        _enabledMask.fetch_and(~bit, std::memory_order_relaxed);
+    }
+}
+
+bool HookDispatcher::IsEnabled(HandlerId id) const {
+    return (_enabledMask.load(std::memory_order_relaxed) & (1u << id)) != 0;
+}
+
+bool HookDispatcher::NoOpHandler(void*, UINT, const KBDLLHOOKSTRUCT&) {
+    return false;
+}
\ No newline at end of file
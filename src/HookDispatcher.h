@@ -0,0 +1,102 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include "Win32Compat.h"
+#include "InjectedInput.h"
+#include "LatencyMetrics.h"
+#include "ModifierState.h"
+
+// Routes every low-level keyboard event through a fixed table of handlers.
+// The table is filled once at startup; features are switched on and off by
+// flipping bits in the enabled mask, so the single system hook never has to
+// be reinstalled. Handlers run in table order and the first one that
+// returns true suppresses the key. Handlers can also be suspended while an
+// application whose rule turns them off is in front; a handler runs only
+// when enabled and not suspended. Modifier state is updated before any
+// handler runs, so handlers see the state including the current event.
+// Input the app injected itself comes back through the hook too; it is
+// dropped before anything else, so no handler and not even the modifier
+// state ever sees it.
+// Every handler call is timed into the shared latency metrics.
+class HookDispatcher {
+public:
+    enum HandlerId {
+        HANDLER_TRACE = 0,          // Input trace recording, sees every event
+        HANDLER_LAYOUT_SWITCH,      // Alt+Shift layout switching
+        HANDLER_CORRECTION,         // Pause text correction
+        HANDLER_RECORDING,          // Keystroke buffer recording
+        HANDLER_COUNT
+    };
+
+    static_assert(LatencyMetrics::HANDLER_RECORDING - LatencyMetrics::HANDLER_FIRST == HANDLER_RECORDING,
+                  "latency metrics must list handlers in dispatch order");
+
+    using HandlerFn = bool(*)(void* context, UINT message, const KBDLLHOOKSTRUCT& event);
+
+    HookDispatcher();
+
+    void SetHandler(HandlerId id, HandlerFn handler, void* context);
+    void SetEnabled(HandlerId id, bool enabled);
+    bool IsEnabled(HandlerId id) const;
+
+    // Handlers, as a mask of 1 << HandlerId, the foreground application's
+    // rule switches off
+    void SetSuspended(uint32_t mask) { _suspendedMask.store(mask, std::memory_order_relaxed); }
+    uint32_t GetSuspended() const { return _suspendedMask.load(std::memory_order_relaxed); }
+
+    ModifierState& GetModifiers() { return _modifiers; }
+    const ModifierState& GetModifiers() const { return _modifiers; }
+
+    LatencyMetrics& GetLatency() { return _latency; }
+    const LatencyMetrics& GetLatency() const { return _latency; }
+
+    // Returns true if the event should be suppressed
+    bool Dispatch(UINT message, const KBDLLHOOKSTRUCT& event) {
+        if (InjectedInput::IsOwn(event)) {
+            return false;
+        }
+        _modifiers.Update(message, event);
+
+        // Each handler's end time is the next one's start, one clock read per handler
+        uint64_t ticks = LatencyClock::Now();
+        uint32_t mask = _enabledMask.load(std::memory_order_relaxed) & ~_suspendedMask.load(std::memory_order_relaxed);
+        while (mask) {
+            int id = LowestBit(mask);
+            mask &= mask - 1;
+            const Entry& entry = _handlers[id];
+            bool suppress = entry.handler(entry.context, message, event);
+            ticks = _latency.Get(HandlerMetric(id)).RecordSince(ticks);
+            if (suppress) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    struct Entry {
+        HandlerFn handler;
+        void* context;
+    };
+
+    static int LowestBit(uint32_t mask) {
+        int index = 0;
+        while (!(mask & 1)) {
+            mask >>= 1;
+            ++index;
+        }
+        return index;
+    }
+
+    static LatencyMetrics::MetricId HandlerMetric(int id) {
+        return static_cast<LatencyMetrics::MetricId>(LatencyMetrics::HANDLER_FIRST + id);
+    }
+
+    static bool NoOpHandler(void* context, UINT message, const KBDLLHOOKSTRUCT& event);
+
+    Entry _handlers[HANDLER_COUNT];
+    std::atomic<uint32_t> _enabledMask;
+    std::atomic<uint32_t> _suspendedMask;
+    ModifierState _modifiers;
+    LatencyMetrics _latency;
+};
\ No newline at end of file
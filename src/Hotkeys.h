@@ -0,0 +1,35 @@
+#pragma once
+#include "Win32Compat.h"
+#include "ModifierState.h"
+
+// Hotkey tests shared by the app's dispatcher handlers and kswitcher-replay,
+// so both react to exactly the same key sequences.
+class Hotkeys {
+public:
+    static bool IsKeyDown(UINT message) {
+        return message == WM_KEYDOWN || message == WM_SYSKEYDOWN;
+    }
+
+    // Alt+Shift becomes held. Only a press that completes the combination
+    // counts, auto-repeat changes nothing.
+    static bool IsLayoutSwitch(UINT message, ModifierState::Snapshot modifiers) {
+        return IsKeyDown(message) && modifiers.Any(ModifierState::ALT) && modifiers.Any(ModifierState::SHIFT) &&
+               modifiers.Changed(ModifierState::ALT | ModifierState::SHIFT);
+    }
+
+    // Any Pause event belongs to the correction handler; only presses
+    // start a correction
+    static bool IsCorrectionKey(const KBDLLHOOKSTRUCT& event) {
+        return event.vkCode == VK_PAUSE;
+    }
+
+    // With Alt held, Pause converts the selection instead of the last word
+    static bool IsSelectionConversion(ModifierState::Snapshot modifiers) {
+        return modifiers.Any(ModifierState::ALT);
+    }
+
+    // With Shift held, and not Alt, Pause corrects the last phrase
+    static bool IsPhraseCorrection(ModifierState::Snapshot modifiers) {
+        return modifiers.Any(ModifierState::SHIFT) && !modifiers.Any(ModifierState::ALT);
+    }
+};
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+#include "Win32Compat.h"
+
+// Marks the input kSwitcher injects. Windows hands injected input to the
+// low-level hooks asynchronously, often after the correction that sent it
+// has returned, so a flag held around SendInput cannot tell it from the
+// user's typing. Every INPUT the app sends carries SIGNATURE in
+// dwExtraInfo, and the hooks drop events that come back with it.
+class InjectedInput {
+public:
+    static const ULONG_PTR SIGNATURE = 0x4B535749;     // "KSWI"
+
+    static void Stamp(INPUT& input) {
+        input.ki.dwExtraInfo = SIGNATURE;
+    }
+
+    // Input other programs inject, remappers and on-screen keyboards, has
+    // LLKHF_INJECTED too and is still the user's typing
+    static bool IsOwn(const KBDLLHOOKSTRUCT& event) {
+        return (event.flags & LLKHF_INJECTED) != 0 && event.dwExtraInfo == SIGNATURE;
+    }
+};
\ No newline at end of file
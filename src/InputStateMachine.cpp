@@ -0,0 +1,191 @@
+#include "InputStateMachine.h"
+
+InputStateMachine::InputStateMachine(size_t keystrokeCapacity)
+    : _windows(WindowBufferCache::DEFAULT_CAPACITY, keystrokeCapacity), _buffer(&_windows.Acquire(0)),
+      _phraseCount(0) {
+}
+
+bool InputStateMachine::MakeKeyEvent(UINT message, const KBDLLHOOKSTRUCT& event,
+                                     ModifierState::Snapshot modifiers, KeyEvent& keyEvent) {
+    if (message != WM_KEYDOWN && message != WM_SYSKEYDOWN) return false;
+
+    int vkCode = static_cast<int>(event.vkCode);
+    keyEvent = {};
+    keyEvent.virtualKey = static_cast<uint16_t>(vkCode);
+    keyEvent.flags = KeyEvent::KeyDown;
+    keyEvent.time = event.time;
+    if (event.flags & LLKHF_EXTENDED) keyEvent.flags |= KeyEvent::Extended;
+
+    // Tab and Escape need modifiers too, to tell Alt+Tab and Alt+Esc window
+    // switching from navigation
+    if (IsCharacterKey(vkCode) || vkCode == VK_TAB || vkCode == VK_ESCAPE) {
+        if (modifiers.Any(ModifierState::SHIFT)) keyEvent.flags |= KeyEvent::Shift;
+        if (modifiers.Any(ModifierState::CAPS_LOCK)) keyEvent.flags |= KeyEvent::CapsLock;
+        if (modifiers.Any(ModifierState::CTRL)) keyEvent.flags |= KeyEvent::Ctrl;
+        if (modifiers.Any(ModifierState::ALT | ModifierState::ALT_GR)) keyEvent.flags |= KeyEvent::Alt;
+    }
+    return true;
+}
+
+void InputStateMachine::SetWindow(uintptr_t window) {
+    _buffer = &_windows.Acquire(window);
+    _phrase.Clear();
+    _phraseCount = 0;
+}
+
+void InputStateMachine::Reset() {
+    _windows.Clear();
+    _buffer = &_windows.Acquire(0);
+    _phrase.Clear();
+    _phraseCount = 0;
+}
+
+InputStateMachine::Recorded InputStateMachine::RecordKeystroke(const KeyEvent& event) {
+    int vkCode = event.virtualKey;
+    WindowBuffer& buffer = *_buffer;
+    KeystrokeRing& typing = buffer.Typing();
+
+    // Alt+Tab and Alt+Esc leave the window; its buffer is kept for when the
+    // user comes back
+    if ((vkCode == VK_TAB || vkCode == VK_ESCAPE) && (event.flags & KeyEvent::Alt)) {
+        return Recorded::Nothing;
+    }
+
+    // Clear buffer on navigation keys (excluding space)
+    if (vkCode == VK_RETURN || vkCode == VK_TAB ||
+        vkCode == VK_LEFT || vkCode == VK_RIGHT || vkCode == VK_UP || vkCode == VK_DOWN ||
+        vkCode == VK_HOME || vkCode == VK_END || vkCode == VK_PRIOR || vkCode == VK_NEXT ||
+        vkCode == VK_ESCAPE) {
+        ClearBuffer();
+        return Recorded::Cleared;
+    }
+
+    // Deleting past the word leaves nothing an undo could line up with
+    if (vkCode == VK_BACK && typing.IsEmpty()) {
+        buffer.autoCorrected = false;
+        _phrase.PopBack();
+        _phraseCount = 0;
+        return Recorded::Nothing;
+    }
+
+    // Handle backspace
+    if (vkCode == VK_BACK) {
+        typing.PopBack();
+        _phrase.PopBack();
+        _phraseCount = 0;
+        buffer.correctionRefused = false;
+        buffer.autoCorrected = false;
+        // Update space flag based on the last character in buffer
+        buffer.lastCharWasSpace = !typing.IsEmpty() && typing.Back().VirtualKey() == VK_SPACE;
+        return Recorded::Popped;
+    }
+
+    // Record character keys
+    if (IsCharacterKey(vkCode)) {
+        bool shift = (event.flags & KeyEvent::Shift) != 0;
+        bool capsLock = (event.flags & KeyEvent::CapsLock) != 0;
+        bool ctrl = (event.flags & KeyEvent::Ctrl) != 0;
+        bool alt = (event.flags & KeyEvent::Alt) != 0;
+        bool extended = (event.flags & KeyEvent::Extended) != 0;
+
+        if (!ctrl && !alt) {
+            // If last character was space and current is not space, clear
+            // the window's buffer; the phrase history keeps the word
+            bool restarted = buffer.lastCharWasSpace && vkCode != VK_SPACE;
+            if (restarted) {
+                buffer.Clear();
+            }
+
+            // A full ring drops the oldest keystroke, so only the tail of
+            // an overly long run gets corrected
+            KeystrokeInfo keystroke = KeystrokeInfo::Make(vkCode, shift, capsLock, extended);
+            typing.Push(keystroke);
+            _phrase.Push(keystroke);
+            _phraseCount = 0;
+            buffer.correctionRefused = false;
+            buffer.autoCorrected = false;
+
+            // Track if current character is space
+            buffer.lastCharWasSpace = (vkCode == VK_SPACE);
+            return restarted ? Recorded::Restarted : Recorded::Pushed;
+        }
+        ClearBuffer();
+        return Recorded::Cleared;
+    }
+    return Recorded::Nothing;
+}
+
+void InputStateMachine::ClearBuffer() {
+    _buffer->Clear();
+    _phrase.Clear();
+    _phraseCount = 0;
+}
+
+bool InputStateMachine::BeginCorrection(Correction& correction) {
+    WindowBuffer& buffer = *_buffer;
+    correction.isFirst = !buffer.Typing().IsEmpty();
+
+    // Both rings are read in place; nothing is pushed until the correction
+    // is done
+    const KeystrokeRing& ring = correction.isFirst ? buffer.Typing() : buffer.LastCorrected();
+    correction.keystrokes = ring.Data();
+    correction.count = ring.Size();
+    if (correction.count == 0) return false;
+
+    // Repeated presses move down the ranking. A refused word is corrected
+    // anyway if Pause is pressed again.
+    correction.mayRefuse = correction.isFirst && !buffer.correctionRefused;
+    buffer.correctionCount = correction.isFirst ? 1 : buffer.correctionCount + 1;
+    correction.attempt = buffer.correctionCount;
+    correction.typedLayout = correction.isFirst ? 0 : buffer.typedLayout;
+    correction.automatic = false;
+    correction.undo = !correction.isFirst && buffer.autoCorrected;
+    correction.phrase = false;
+    return true;
+}
+
+bool InputStateMachine::BeginPhraseCorrection(size_t words, Correction& correction) {
+    correction.keystrokes = _phrase.Last(words, correction.count);
+    if (correction.count == 0) return false;
+
+    // The phrase may mix words typed in different layouts, so there is no
+    // typed layout to rank against or refuse in favour of
+    correction.isFirst = _phraseCount == 0;
+    correction.mayRefuse = false;
+    correction.attempt = ++_phraseCount;
+    correction.typedLayout = 0;
+    correction.automatic = false;
+    correction.undo = false;
+    correction.phrase = true;
+    return true;
+}
+
+void InputStateMachine::RefuseCorrection() {
+    _buffer->correctionRefused = true;
+    _buffer->correctionCount = 0;
+}
+
+void InputStateMachine::CompleteCorrection(const Correction& correction) {
+    // The phrase took the window's word with it; what the rings held no
+    // longer matches what a single Pause would fix
+    if (correction.phrase) {
+        _buffer->Clear();
+        return;
+    }
+    _phraseCount = 0;
+    _buffer->correctionRefused = false;
+    _buffer->autoCorrected = correction.automatic;
+    if (correction.isFirst) {
+        _buffer->typedLayout = correction.typedLayout;
+        _buffer->SwapAfterCorrection();
+    }
+}
+
+bool InputStateMachine::IsCharacterKey(int vkCode) {
+    return (vkCode >= 'A' && vkCode <= 'Z') ||
+           (vkCode >= '0' && vkCode <= '9') ||
+           (vkCode >= VK_NUMPAD0 && vkCode <= VK_NUMPAD9) ||
+           (vkCode >= VK_OEM_1 && vkCode <= VK_OEM_3) ||
+           (vkCode >= VK_OEM_4 && vkCode <= VK_OEM_8) ||
+           vkCode == VK_SPACE;
+}
\ No newline at end of file
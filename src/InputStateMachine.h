@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "Win32Compat.h"
+#include "KeyEventRing.h"
+#include "ModifierState.h"
+#include "PhraseHistory.h"
+#include "WindowBufferCache.h"
+
+// The part of the interceptor that turns key events into per-window
+// keystroke buffers and decides what a correction works on. It has no OS
+// dependencies, so kswitcher-replay drives exactly the code the app runs.
+// Not thread-safe: MakeKeyEvent runs on the hook thread, everything else on
+// the correction worker.
+class InputStateMachine {
+public:
+    // What a Pause press corrects. keystrokes points into the window's rings,
+    // or the phrase history for Shift+Pause, and stays valid until the next
+    // recorded keystroke.
+    struct Correction {
+        const KeystrokeInfo* keystrokes;
+        size_t count;
+        bool isFirst;       // Freshly typed keys, not a repeated press
+        bool mayRefuse;     // The ranking may still decide to keep the word
+        int attempt;        // 1 for the first press, 2 for the next...
+        uintptr_t typedLayout;  // Layout the keys were typed in, 0 if unknown;
+                                // the engine fills it in on the first press
+        bool automatic;     // Made by auto-correct at a word boundary
+        bool undo;          // Pause right after an auto-correction
+        bool phrase;        // Shift+Pause: words, not just the last one
+    };
+
+    // What RecordKeystroke did to the typing ring
+    enum class Recorded {
+        Nothing,
+        Pushed,
+        Popped,
+        Cleared,
+        Restarted           // Cleared, then the key pushed as the first
+    };
+
+    explicit InputStateMachine(size_t keystrokeCapacity = KeystrokeRing::DEFAULT_CAPACITY);
+
+    // Builds the event the worker consumes from a hook event. Modifier state
+    // is captured now, it is stale by the time the worker runs. Returns false
+    // for events that are not recorded (key releases).
+    static bool MakeKeyEvent(UINT message, const KBDLLHOOKSTRUCT& event,
+                             ModifierState::Snapshot modifiers, KeyEvent& keyEvent);
+
+    // Switches to window's buffer, restoring whatever was typed there. The
+    // phrase history starts over.
+    void SetWindow(uintptr_t window);
+
+    // Forgets every window
+    void Reset();
+
+    Recorded RecordKeystroke(const KeyEvent& event);
+
+    // Forgets the window's word and the phrase history
+    void ClearBuffer();
+
+    // Returns false when there is nothing to correct
+    bool BeginCorrection(Correction& correction);
+
+    // The last words words of the phrase history, all of them for 0.
+    // Repeated presses with nothing typed in between correct the same keys
+    // again, one attempt further.
+    bool BeginPhraseCorrection(size_t words, Correction& correction);
+    void RefuseCorrection();
+    void CompleteCorrection(const Correction& correction);
+
+    const WindowBuffer& Current() const { return *_buffer; }
+    const WindowBufferCache& Windows() const { return _windows; }
+    const PhraseHistory& Phrase() const { return _phrase; }
+
+    static bool IsCharacterKey(int vkCode);
+
+private:
+    WindowBufferCache _windows;
+    WindowBuffer* _buffer;
+
+    // One history for the focused window, since focus moves it starts over
+    PhraseHistory _phrase;
+    int _phraseCount;       // Shift+Pause presses on the same keys
+};
\ No newline at end of file
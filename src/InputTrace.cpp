@@ -0,0 +1,50 @@
+#include "InputTrace.h"
+#include <cstring>
+
+static_assert(sizeof(TraceHeader) == 16, "TraceHeader layout is part of the file format");
+static_assert(sizeof(TraceRecord) == 12, "TraceRecord layout is part of the file format");
+
+InputTrace::InputTrace() : _records(nullptr), _count(0) {
+}
+
+bool InputTrace::Attach(const uint8_t* data, size_t size) {
+    _records = nullptr;
+    _count = 0;
+
+    if (!data || size < sizeof(TraceHeader)) return false;
+    if (reinterpret_cast<uintptr_t>(data) % alignof(TraceRecord) != 0) return false;
+
+    TraceHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != MAGIC || header.version != VERSION) return false;
+    if (header.recordSize != sizeof(TraceRecord)) return false;
+    if ((size - sizeof(TraceHeader)) / sizeof(TraceRecord) < header.recordCount) return false;
+
+    _records = reinterpret_cast<const TraceRecord*>(data + sizeof(TraceHeader));
+    _count = header.recordCount;
+    return true;
+}
+
+InputTraceWriter::InputTraceWriter(size_t capacity) : _droppedCount(0) {
+    _records.reserve(capacity);
+}
+
+void InputTraceWriter::Clear() {
+    _records.clear();
+    _droppedCount = 0;
+}
+
+std::vector<uint8_t> InputTraceWriter::Serialize() const {
+    TraceHeader header = {};
+    header.magic = InputTrace::MAGIC;
+    header.version = InputTrace::VERSION;
+    header.recordSize = sizeof(TraceRecord);
+    header.recordCount = static_cast<uint32_t>(_records.size());
+
+    std::vector<uint8_t> out(sizeof(header) + _records.size() * sizeof(TraceRecord));
+    memcpy(out.data(), &header, sizeof(header));
+    if (!_records.empty()) {
+        memcpy(out.data() + sizeof(header), _records.data(), _records.size() * sizeof(TraceRecord));
+    }
+    return out;
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Win32Compat.h"
+
+// Binary trace of low-level input events, recorded from the hooks and
+// replayed by kswitcher-replay to reproduce corrections off the machine they
+// happened on.
+//
+// Layout (little-endian):
+//   TraceHeader
+//   TraceRecord[recordCount]
+//
+// Keyboard records carry the KBDLLHOOKSTRUCT fields as the hook saw them.
+// Mouse button presses use VK_LBUTTON, VK_RBUTTON or VK_MBUTTON, which the
+// keyboard hook never reports.
+struct TraceHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t recordCount;
+    uint32_t reserved;
+};
+
+struct TraceRecord {
+    uint32_t time;          // Hook timestamp, milliseconds
+    uint32_t window;        // Foreground window when the event arrived
+    uint16_t scanCode;
+    uint8_t virtualKey;
+    uint8_t flags;          // LLKHF_* bits
+};
+
+class InputTrace {
+public:
+    static const uint32_t MAGIC = 0x5254534B;   // "KSTR"
+    static const uint16_t VERSION = 1;
+
+    InputTrace();
+
+    // Validates the header and points the view at data without copying
+    bool Attach(const uint8_t* data, size_t size);
+
+    size_t Count() const { return _count; }
+    const TraceRecord* Records() const { return _records; }
+
+    static bool IsMouseButton(const TraceRecord& record) {
+        return record.virtualKey == VK_LBUTTON || record.virtualKey == VK_RBUTTON ||
+               record.virtualKey == VK_MBUTTON;
+    }
+
+private:
+    const TraceRecord* _records;
+    size_t _count;
+};
+
+// Collects records into storage reserved up front, so appending from the
+// hook never allocates. Appends past the capacity are counted and dropped.
+class InputTraceWriter {
+public:
+    explicit InputTraceWriter(size_t capacity);
+
+    bool Append(const TraceRecord& record) {
+        if (_records.size() == _records.capacity()) {
+            ++_droppedCount;
+            return false;
+        }
+        _records.push_back(record);
+        return true;
+    }
+
+    void Clear();
+
+    size_t Count() const { return _records.size(); }
+    size_t DroppedCount() const { return _droppedCount; }
+
+    std::vector<uint8_t> Serialize() const;
+
+private:
+    std::vector<TraceRecord> _records;
+    size_t _droppedCount;
+};
\ No newline at end of file
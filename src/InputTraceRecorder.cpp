@@ -0,0 +1,78 @@
+#include "InputTraceRecorder.h"
+#include <fstream>
+
+InputTraceRecorder* InputTraceRecorder::_instance = nullptr;
+
+InputTraceRecorder::InputTraceRecorder(HookDispatcher& dispatcher, const ForegroundTracker& foreground)
+    : _dispatcher(dispatcher), _foreground(foreground), _mouseHook(nullptr), _writer(0), _recording(false) {
+    _instance = this;
+    _dispatcher.SetHandler(HookDispatcher::HANDLER_TRACE, OnTraceKey, this);
+}
+
+InputTraceRecorder::~InputTraceRecorder() {
+    _dispatcher.SetEnabled(HookDispatcher::HANDLER_TRACE, false);
+    if (_mouseHook) {
+        UnhookWindowsHookEx(_mouseHook);
+    }
+    _instance = nullptr;
+}
+
+void InputTraceRecorder::Start() {
+    if (_recording) return;
+    
+    // Hooks run on this thread, so nothing is appending while storage is set up
+    _writer = InputTraceWriter(MAX_RECORDS);
+    _recording = true;
+    
+    _mouseHook = SetWindowsHookEx(WH_MOUSE_LL, MouseHookProc, GetModuleHandle(nullptr), 0);
+    _dispatcher.SetEnabled(HookDispatcher::HANDLER_TRACE, true);
+}
+
+bool InputTraceRecorder::Stop(const std::wstring& path) {
+    if (!_recording) return false;
+    
+    _dispatcher.SetEnabled(HookDispatcher::HANDLER_TRACE, false);
+    if (_mouseHook) {
+        UnhookWindowsHookEx(_mouseHook);
+        _mouseHook = nullptr;
+    }
+    _recording = false;
+    
+    std::vector<uint8_t> data = _writer.Serialize();
+    _writer = InputTraceWriter(0);
+    
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    return file.is_open() && file.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+void InputTraceRecorder::Append(uint8_t virtualKey, uint16_t scanCode, uint8_t flags, DWORD time) {
+    TraceRecord record;
+    record.time = time;
+    record.window = static_cast<uint32_t>(reinterpret_cast<ULONG_PTR>(_foreground.Window()));
+    record.scanCode = scanCode;
+    record.virtualKey = virtualKey;
+    record.flags = flags;
+    _writer.Append(record);
+}
+
+bool InputTraceRecorder::OnTraceKey(void* context, UINT, const KBDLLHOOKSTRUCT& event) {
+    auto* self = static_cast<InputTraceRecorder*>(context);
+    self->Append(static_cast<uint8_t>(event.vkCode), static_cast<uint16_t>(event.scanCode),
+                 static_cast<uint8_t>(event.flags), event.time);
+    return false;
+}
+
+LRESULT CALLBACK InputTraceRecorder::MouseHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
+    if (nCode >= 0 && _instance && _instance->_recording) {
+        uint8_t button = 0;
+        if (wParam == WM_LBUTTONDOWN) button = VK_LBUTTON;
+        else if (wParam == WM_RBUTTONDOWN) button = VK_RBUTTON;
+        else if (wParam == WM_MBUTTONDOWN) button = VK_MBUTTON;
+        
+        if (button) {
+            _instance->Append(button, 0, 0, reinterpret_cast<MSLLHOOKSTRUCT*>(lParam)->time);
+        }
+    }
+    
+    return CallNextHookEx(nullptr, nCode, wParam, lParam);
+}
\ No newline at end of file
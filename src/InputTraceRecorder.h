@@ -0,0 +1,42 @@
+#pragma once
+#include <windows.h>
+#include <string>
+#include "ForegroundTracker.h"
+#include "HookDispatcher.h"
+#include "InputTrace.h"
+
+// Records raw keyboard and mouse-button events into an InputTrace while
+// switched on from the tray menu. Keyboard events come through the shared
+// hook's dispatcher table; a mouse hook is installed only while recording.
+// Storage is reserved when recording starts, so the hooks never allocate.
+class InputTraceRecorder {
+public:
+    // About two hours of continuous typing
+    static const size_t MAX_RECORDS = 1 << 18;
+
+    InputTraceRecorder(HookDispatcher& dispatcher, const ForegroundTracker& foreground);
+    ~InputTraceRecorder();
+
+    void Start();
+
+    // Stops recording and writes the trace to path
+    bool Stop(const std::wstring& path);
+
+    bool IsRecording() const { return _recording; }
+    size_t RecordCount() const { return _writer.Count(); }
+    size_t DroppedCount() const { return _writer.DroppedCount(); }
+
+private:
+    static bool OnTraceKey(void* context, UINT message, const KBDLLHOOKSTRUCT& event);
+    static LRESULT CALLBACK MouseHookProc(int nCode, WPARAM wParam, LPARAM lParam);
+
+    void Append(uint8_t virtualKey, uint16_t scanCode, uint8_t flags, DWORD time);
+
+    HookDispatcher& _dispatcher;
+    const ForegroundTracker& _foreground;
+    HHOOK _mouseHook;
+    InputTraceWriter _writer;
+    bool _recording;
+
+    static InputTraceRecorder* _instance;
+};
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Compact record pushed by the low-level hooks. Everything the worker needs
+// to update the keystroke buffer travels in these 8 bytes.
+struct KeyEvent {
+    enum Flags : uint16_t {
+        KeyDown    = 0x0001,
+        Shift      = 0x0002,
+        CapsLock   = 0x0004,
+        Ctrl       = 0x0008,
+        Alt        = 0x0010,
+        Correction = 0x0020,  // Pause pressed, run layout correction
+        MouseClick = 0x0040,  // Mouse button pressed, caret may have moved
+        Extended   = 0x0080,  // LLKHF_EXTENDED was set
+        Selection  = 0x0100,  // Alt+Pause pressed, convert the selection
+        Phrase     = 0x0200,  // Shift+Pause pressed, correct the last phrase
+        Focus      = 0x0400   // Foreground window changed; time holds its handle
+    };
+
+    uint16_t virtualKey;
+    uint16_t flags;
+    uint32_t time;
+};
+
+// Fixed-size lock-free single-producer/single-consumer ring.
+// The producer is the hook thread (keyboard and mouse hooks are both called
+// on the thread that installed them), the consumer is the analysis worker.
+// Producer and consumer indices live on separate cache lines so the two
+// threads never write to the same line.
+class KeyEventRing {
+public:
+    static const size_t CAPACITY = 1024;
+    static const size_t CACHE_LINE_SIZE = 64;
+
+    KeyEventRing() = default;
+    KeyEventRing(const KeyEventRing&) = delete;
+    KeyEventRing& operator=(const KeyEventRing&) = delete;
+
+    // Producer side. Never blocks or allocates; returns false and counts an
+    // overflow when the consumer has fallen a full ring behind.
+    bool Push(const KeyEvent& event) {
+        size_t head = _head.load(std::memory_order_relaxed);
+        if (head - _cachedTail >= CAPACITY) {
+            _cachedTail = _tail.load(std::memory_order_acquire);
+            if (head - _cachedTail >= CAPACITY) {
+                _overflowCount.store(_overflowCount.load(std::memory_order_relaxed) + 1,
+                                     std::memory_order_relaxed);
+                return false;
+            }
+        }
+
+        _events[head & MASK] = event;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Copies up to maxCount events into out and returns how
+    // many were taken.
+    size_t PopBatch(KeyEvent* out, size_t maxCount) {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        size_t available = _head.load(std::memory_order_acquire) - tail;
+
+        // Depth only grows between drains, so the peak seen here is the peak
+        if (available > _highWaterMark.load(std::memory_order_relaxed)) {
+            _highWaterMark.store(available, std::memory_order_relaxed);
+        }
+
+        size_t count = available < maxCount ? available : maxCount;
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = _events[(tail + i) & MASK];
+        }
+
+        _tail.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    bool IsEmpty() const {
+        return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+    }
+
+    // Counters are safe to read from any thread
+    size_t OverflowCount() const { return _overflowCount.load(std::memory_order_relaxed); }
+    size_t HighWaterMark() const { return _highWaterMark.load(std::memory_order_relaxed); }
+
+private:
+    static const size_t MASK = CAPACITY - 1;
+    static_assert((CAPACITY & MASK) == 0, "Ring capacity must be a power of two");
+
+    // Producer-owned line
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> _head{0};
+    size_t _cachedTail = 0;
+    std::atomic<size_t> _overflowCount{0};
+
+    // Consumer-owned line
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> _tail{0};
+    std::atomic<size_t> _highWaterMark{0};
+
+    alignas(CACHE_LINE_SIZE) KeyEvent _events[CAPACITY];
+};
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include "KeyboardHook.h"
+
+KeyboardHook* KeyboardHook::_instance = nullptr;
+
+KeyboardHook::KeyboardHook() : _hook(nullptr) {
+    _instance = this;
+}
+
+KeyboardHook::~KeyboardHook() {
+    Uninstall();
+    _instance = nullptr;
+}
+
+bool KeyboardHook::Install() {
+    if (!_hook) {
+        // Modifiers pressed before the hook went in were never seen
+        ResyncModifiers(_dispatcher.GetModifiers());
+        _hook = SetWindowsHookEx(WH_KEYBOARD_LL, HookProc, GetModuleHandle(nullptr), 0);
+    }
+    return _hook != nullptr;
+}
+
+void KeyboardHook::Uninstall() {
+    if (_hook) {
+        UnhookWindowsHookEx(_hook);
+        _hook = nullptr;
+    }
+}
+
+LRESULT CALLBACK KeyboardHook::HookProc(int nCode, WPARAM wParam, LPARAM lParam) {
+    if (nCode == HC_ACTION && _instance) {
+        uint64_t start = LatencyClock::Now();
+        const KBDLLHOOKSTRUCT* pKbdStruct = reinterpret_cast<KBDLLHOOKSTRUCT*>(lParam);
+        ModifierState& modifiers = _instance->_dispatcher.GetModifiers();
+        if (modifiers.TakeResyncRequest()) {
+            ResyncModifiers(modifiers);
+        }
+        
+        bool suppress = _instance->_dispatcher.Dispatch(static_cast<UINT>(wParam), *pKbdStruct);
+        _instance->_dispatcher.GetLatency().Get(LatencyMetrics::HOOK_KEYBOARD).RecordSince(start);
+        if (suppress) {
+            return 1; // Suppress the key
+        }
+    }
+
+    return CallNextHookEx(nullptr, nCode, wParam, lParam);
+}
+
+void KeyboardHook::ResyncModifiers(ModifierState& modifiers) {
+    static const int keys[] = {
+        VK_LSHIFT, VK_RSHIFT, VK_LCONTROL, VK_RCONTROL, VK_LMENU, VK_RMENU,
+        VK_LWIN, VK_RWIN, VK_CAPITAL, VK_NUMLOCK
+    };
+    
+    // Only the keys ModifierState reads; GetKeyboardState would report this
+    // thread's queue state rather than the physical keyboard
+    uint8_t keyState[256] = {};
+    for (int vk : keys) {
+        if (GetAsyncKeyState(vk) & 0x8000) keyState[vk] |= 0x80;
+    }
+    if (GetKeyState(VK_CAPITAL) & 0x0001) keyState[VK_CAPITAL] |= 0x01;
+    if (GetKeyState(VK_NUMLOCK) & 0x0001) keyState[VK_NUMLOCK] |= 0x01;
+    
+    modifiers.Resync(keyState);
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#pragma once
+#include <windows.h>
+#include "HookDispatcher.h"
+
+// Owns the application's only WH_KEYBOARD_LL hook and forwards each event to
+// the dispatcher table.
+class KeyboardHook {
+public:
+    KeyboardHook();
+    ~KeyboardHook();
+
+    bool Install();
+    void Uninstall();
+
+    HookDispatcher& GetDispatcher() { return _dispatcher; }
+
+private:
+    static LRESULT CALLBACK HookProc(int nCode, WPARAM wParam, LPARAM lParam);
+    static void ResyncModifiers(ModifierState& modifiers);
+
+    HHOOK _hook;
+    HookDispatcher _dispatcher;
+
+    static KeyboardHook* _instance;
+};
\ No newline at end of file
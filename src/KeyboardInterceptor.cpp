@@ -1,12 +1,24 @@
 #include "KeyboardInterceptor.h"
 #include <algorithm>
+#include "Hotkeys.h"
+#include "InjectedInput.h"
 
 KeyboardInterceptor* KeyboardInterceptor::_instance = nullptr;
 
-KeyboardInterceptor::KeyboardInterceptor() 
-    : _keyboardHook(nullptr), _mouseHook(nullptr), _lastActiveWindow(nullptr),
-      _isProcessingCorrection(false), _lastCharWasSpace(false), _correctionCount(0) {
+KeyboardInterceptor::KeyboardInterceptor(HookDispatcher& dispatcher, const ForegroundTracker& foreground,
+                                         size_t keystrokeCapacity, const AutoCorrectOptions& autoCorrect,
+                                         UserDictionary& userWords, const NativePath& userWordsDirectory)
+    : _dispatcher(dispatcher), _foreground(foreground), _mouseHook(nullptr), _workerThread(nullptr),
+      _wakeEvent(nullptr), _stopWorker(false), _workerWaiting(false), _lastOverflowCount(0), _postedWindow(nullptr),
+      _backend(foreground), _engine(_backend, dispatcher.GetLatency(), keystrokeCapacity),
+      _userWords(userWords), _userWordsDirectory(userWordsDirectory),
+      _injection(AppPolicy::INJECTION_AUTO), _phraseWords(0) {
     _instance = this;
+    _engine.SetAutoCorrect(autoCorrect);
+    _engine.SetUserDictionary(&userWords);
+    
+    _dispatcher.SetHandler(HookDispatcher::HANDLER_CORRECTION, OnCorrectionKey, this);
+    _dispatcher.SetHandler(HookDispatcher::HANDLER_RECORDING, OnRecordKey, this);
 }
 
 KeyboardInterceptor::~KeyboardInterceptor() {
@@ -15,10 +27,10 @@ KeyboardInterceptor::~KeyboardInterceptor() {
 }
 
 void KeyboardInterceptor::StartIntercepting() {
-    if (!_keyboardHook) {
-        _keyboardHook = SetWindowsHookEx(WH_KEYBOARD_LL, KeyboardHookProc, 
-                                       GetModuleHandle(nullptr), 0);
-    }
+    StartWorker();
+    
+    _dispatcher.SetEnabled(HookDispatcher::HANDLER_CORRECTION, true);
+    _dispatcher.SetEnabled(HookDispatcher::HANDLER_RECORDING, true);
     
     if (!_mouseHook) {
         _mouseHook = SetWindowsHookEx(WH_MOUSE_LL, MouseHookProc, 
@@ -27,196 +39,252 @@ void KeyboardInterceptor::StartIntercepting() {
 }
 
 void KeyboardInterceptor::StopIntercepting() {
-    if (_keyboardHook) {
-        UnhookWindowsHookEx(_keyboardHook);
-        _keyboardHook = nullptr;
-    }
+    _dispatcher.SetEnabled(HookDispatcher::HANDLER_CORRECTION, false);
+    _dispatcher.SetEnabled(HookDispatcher::HANDLER_RECORDING, false);
     
     if (_mouseHook) {
         UnhookWindowsHookEx(_mouseHook);
         _mouseHook = nullptr;
     }
+    
+    StopWorker();
 }
 
-LRESULT CALLBACK KeyboardInterceptor::KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
-    if (nCode >= 0 && _instance && !_instance->_isProcessingCorrection) {
-        int vkCode = reinterpret_cast<KBDLLHOOKSTRUCT*>(lParam)->vkCode;
-        bool isKeyDown = (wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN);
-        
-        HWND currentWindow = GetForegroundWindow();
-        if (currentWindow != _instance->_lastActiveWindow) {
-            _instance->ClearBuffer();
-            _instance->_lastActiveWindow = currentWindow;
-        }
-        
-        if (vkCode == VK_PAUSE && isKeyDown) {
-            _instance->PerformLayoutCorrection();
-            return 1; // Suppress the key
+void KeyboardInterceptor::StartWorker() {
+    if (_workerThread) return;
+    
+    // Hooks are not installed yet, so nothing can be pushing; drop events
+    // left over from a previous session along with the buffer they built
+    KeyEvent stale[WORKER_BATCH_SIZE];
+    while (_eventRing.PopBatch(stale, WORKER_BATCH_SIZE) > 0) {}
+    _lastOverflowCount = _eventRing.OverflowCount();
+    _postedWindow = nullptr;
+    _engine.Reset();
+    
+    _stopWorker = false;
+    _workerWaiting = false;
+    _wakeEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    if (!_wakeEvent) return;
+    
+    _workerThread = CreateThread(nullptr, 0, WorkerThreadProc, this, 0, nullptr);
+    if (!_workerThread) {
+        CloseHandle(_wakeEvent);
+        _wakeEvent = nullptr;
+    }
+}
+
+void KeyboardInterceptor::StopWorker() {
+    if (_workerThread) {
+        _stopWorker = true;
+        SetEvent(_wakeEvent);
+        WaitForSingleObject(_workerThread, INFINITE);
+        CloseHandle(_workerThread);
+        _workerThread = nullptr;
+    }
+    
+    if (_wakeEvent) {
+        CloseHandle(_wakeEvent);
+        _wakeEvent = nullptr;
+    }
+}
+
+DWORD WINAPI KeyboardInterceptor::WorkerThreadProc(LPVOID param) {
+    auto* self = static_cast<KeyboardInterceptor*>(param);
+    KeyEvent batch[WORKER_BATCH_SIZE];
+    
+    // Loading the learned words maps files and replays journals, so it
+    // happens here rather than before the hooks go live. Keys typed
+    // meanwhile wait in the ring; nothing looks a word up before it is done.
+    if (!self->_userWordsDirectory.empty() && !self->_userWords.IsOpen()) {
+        CreateDirectoryW(self->_userWordsDirectory.c_str(), nullptr);
+        self->_userWords.Open(self->_userWordsDirectory);
+    }
+    
+    while (!self->_stopWorker) {
+        size_t count;
+        while (!self->_stopWorker &&
+               (count = self->_eventRing.PopBatch(batch, WORKER_BATCH_SIZE)) > 0) {
+            self->ProcessEvents(batch, count);
         }
         
-        if (isKeyDown) {
-            _instance->RecordKeystroke(vkCode);
+        // Announce the sleep, then look once more: either this sees an event
+        // pushed meanwhile or the hook sees the flag, the fences on both
+        // sides rule out missing both. A wake left over from a race only
+        // costs an empty pass.
+        self->_workerWaiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (self->_eventRing.IsEmpty() && !self->_stopWorker) {
+            WaitForSingleObject(self->_wakeEvent, INFINITE);
         }
+        self->_workerWaiting.store(false, std::memory_order_relaxed);
     }
     
-    return CallNextHookEx(nullptr, nCode, wParam, lParam);
+    return 0;
 }
 
-LRESULT CALLBACK KeyboardInterceptor::MouseHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
-    if (nCode >= 0 && _instance && !_instance->_isProcessingCorrection) {
-        if (wParam == WM_LBUTTONDOWN || wParam == WM_RBUTTONDOWN || wParam == WM_MBUTTONDOWN) {
-            _instance->ClearBuffer();
-        }
+void KeyboardInterceptor::PostEvent(const KeyEvent& event) {
+    // A focus change goes into the stream ahead of the first event after
+    // it, so keys still queued for the old window land in its buffer even
+    // when the worker drains both in one batch
+    HWND window = _foreground.Window();
+    if (window != _postedWindow) {
+        KeyEvent focus = {};
+        focus.flags = KeyEvent::Focus;
+        focus.time = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(window));
+        if (!_eventRing.Push(focus)) return;
+        _postedWindow = window;
     }
+    if (!_eventRing.Push(event)) return;
     
-    return CallNextHookEx(nullptr, nCode, wParam, lParam);
+    // Only an idle worker needs waking; one that is draining will find this
+    // event before it sleeps
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_workerWaiting.load(std::memory_order_relaxed) &&
+        _workerWaiting.exchange(false, std::memory_order_relaxed)) {
+        SetEvent(_wakeEvent);
+    }
 }
 
-void KeyboardInterceptor::RecordKeystroke(int vkCode) {
-    // Clear buffer on navigation keys (excluding space)
-    if (vkCode == VK_RETURN || vkCode == VK_TAB ||
-        vkCode == VK_LEFT || vkCode == VK_RIGHT || vkCode == VK_UP || vkCode == VK_DOWN ||
-        vkCode == VK_HOME || vkCode == VK_END || vkCode == VK_PRIOR || vkCode == VK_NEXT ||
-        vkCode == VK_ESCAPE) {
-        ClearBuffer();
-        return;
-    }
-    
-    // Handle backspace
-    if (vkCode == VK_BACK && !_keystrokeBuffer.empty()) {
-        _keystrokeBuffer.pop_back();
-        // Update space flag based on the last character in buffer
-        _lastCharWasSpace = !_keystrokeBuffer.empty() && 
-                           _keystrokeBuffer.back().virtualKey == VK_SPACE;
-        return;
-    }
-    
-    // Record character keys
-    if (IsCharacterKey(vkCode)) {
-        bool shift = (GetKeyState(VK_SHIFT) & 0x8000) != 0;
-        bool capsLock = (GetKeyState(VK_CAPITAL) & 0x0001) != 0;
-        bool ctrl = (GetKeyState(VK_CONTROL) & 0x8000) != 0;
-        bool alt = (GetKeyState(VK_MENU) & 0x8000) != 0;
-        
-        if (!ctrl && !alt) {
-            // If last character was space and current is not space, clear buffer
-            if (_lastCharWasSpace && vkCode != VK_SPACE) {
-                ClearBuffer();
-                _lastCharWasSpace = false;
+void KeyboardInterceptor::ProcessEvents(const KeyEvent* events, size_t count) {
+    _engine.SetInjection(static_cast<AppPolicy::Injection>(_injection.load(std::memory_order_relaxed)));
+    _engine.SetPhraseWords(_phraseWords.load(std::memory_order_relaxed));
+    
+    // Dropped events leave holes in the buffer, so it can no longer be trusted
+    size_t overflowCount = _eventRing.OverflowCount();
+    if (overflowCount != _lastOverflowCount) {
+        _engine.ClearBuffer();
+        _lastOverflowCount = overflowCount;
+    }
+    
+    for (size_t i = 0; i < count; ++i) {
+        if (events[i].flags & KeyEvent::Focus) {
+            // Switching windows swaps in that window's buffer rather than
+            // clearing, and has the hook re-read modifiers that may have
+            // changed elsewhere. Window handles keep to 32 bits, sign
+            // extended, so 32- and 64-bit processes can share them.
+            HWND window = reinterpret_cast<HWND>(static_cast<intptr_t>(static_cast<int32_t>(events[i].time)));
+            if (_engine.SetFocus(window)) {
+                _dispatcher.GetModifiers().RequestResync();
             }
-            
-            KeystrokeInfo keystroke;
-            keystroke.virtualKey = vkCode;
-            keystroke.shift = shift;
-            keystroke.capsLock = capsLock;
-            _keystrokeBuffer.push_back(keystroke);
-            
-            // Track if current character is space
-            _lastCharWasSpace = (vkCode == VK_SPACE);
+        } else if (events[i].flags & KeyEvent::Correction) {
+            PerformLayoutCorrection();
+        } else if (events[i].flags & KeyEvent::Selection) {
+            PerformSelectionConversion();
+        } else if (events[i].flags & KeyEvent::Phrase) {
+            PerformPhraseCorrection();
         } else {
-            ClearBuffer();
-            _lastCharWasSpace = false;
+            _engine.Process(events[i]);
         }
     }
 }
 
-void KeyboardInterceptor::PerformLayoutCorrection() {
-    _isProcessingCorrection = true;
-    
-    try {
-        std::vector<KeystrokeInfo> bufferToCorrect;
-        
-        if (!_keystrokeBuffer.empty()) {
-            bufferToCorrect = _keystrokeBuffer;
-            _correctionCount = 1;
-        } else if (!_lastCorrectedBuffer.empty()) {
-            bufferToCorrect = _lastCorrectedBuffer;
-            _correctionCount++;
-        } else {
-            _isProcessingCorrection = false;
-            return;
-        }
-        
-        // Delete the typed text
-        for (size_t i = 0; i < bufferToCorrect.size(); ++i) {
-            keybd_event(VK_BACK, 0, 0, 0);
-            keybd_event(VK_BACK, 0, KEYEVENTF_KEYUP, 0);
-        }
-        
-        // Switch keyboard layout
-        SwitchKeyboardLayout();
-        
-        Sleep(50);
-        
-        // Replay keystrokes
-        for (const auto& keystroke : bufferToCorrect) {
-            ReplayKeystroke(keystroke);
-        }
-        
-        _lastCorrectedBuffer = bufferToCorrect;
-        _keystrokeBuffer.clear();
+bool KeyboardInterceptor::OnCorrectionKey(void* context, UINT message, const KBDLLHOOKSTRUCT& event) {
+    auto* self = static_cast<KeyboardInterceptor*>(context);
+    if (!Hotkeys::IsCorrectionKey(event)) {
+        return false;
     }
-    catch (...) {
-        // Handle any errors
+    
+    if (Hotkeys::IsKeyDown(message)) {
+        KeyEvent keyEvent = {};
+        keyEvent.virtualKey = VK_PAUSE;
+        ModifierState::Snapshot modifiers = self->_dispatcher.GetModifiers().Load();
+        uint16_t request = Hotkeys::IsSelectionConversion(modifiers) ? KeyEvent::Selection
+                         : Hotkeys::IsPhraseCorrection(modifiers)    ? KeyEvent::Phrase
+                                                                     : KeyEvent::Correction;
+        keyEvent.flags = KeyEvent::KeyDown | request;
+        keyEvent.time = event.time;
+        self->PostEvent(keyEvent);
+        return true; // Suppress the key
     }
     
-    _isProcessingCorrection = false;
+    return false;
 }
 
-void KeyboardInterceptor::SwitchKeyboardLayout() {
-    HWND hWnd = GetForegroundWindow();
-    if (hWnd) {
-        PostMessage(hWnd, WM_INPUTLANGCHANGEREQUEST, 0x02, 0);
+bool KeyboardInterceptor::OnRecordKey(void* context, UINT message, const KBDLLHOOKSTRUCT& event) {
+    // Only capture what is needed and hand it to the worker; anything slow
+    // here delays every keystroke on the machine. Keys a correction injects
+    // never get here, the dispatcher drops them by their signature.
+    auto* self = static_cast<KeyboardInterceptor*>(context);
+    KeyEvent keyEvent;
+    if (InputStateMachine::MakeKeyEvent(message, event, self->_dispatcher.GetModifiers().Load(), keyEvent)) {
+        self->PostEvent(keyEvent);
     }
+    
+    return false;
 }
 
-void KeyboardInterceptor::ReplayKeystroke(const KeystrokeInfo& keystroke) {
-    INPUT inputs[4] = {}; // Max: shift down, key down, key up, shift up
-    int inputCount = 0;
-    
-    // Press shift if needed
-    if (keystroke.shift) {
-        inputs[inputCount].type = INPUT_KEYBOARD;
-        inputs[inputCount].ki.wVk = VK_SHIFT;
-        inputs[inputCount].ki.dwFlags = 0;
-        inputCount++;
+LRESULT CALLBACK KeyboardInterceptor::MouseHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
+    if (nCode >= 0 && _instance) {
+        uint64_t start = LatencyClock::Now();
+        if (wParam == WM_LBUTTONDOWN || wParam == WM_RBUTTONDOWN || wParam == WM_MBUTTONDOWN) {
+            KeyEvent event = {};
+            event.flags = KeyEvent::MouseClick;
+            event.time = reinterpret_cast<MSLLHOOKSTRUCT*>(lParam)->time;
+            _instance->PostEvent(event);
+        }
+        _instance->_dispatcher.GetLatency().Get(LatencyMetrics::HOOK_MOUSE).RecordSince(start);
     }
     
-    // Press key
-    inputs[inputCount].type = INPUT_KEYBOARD;
-    inputs[inputCount].ki.wVk = static_cast<WORD>(keystroke.virtualKey);
-    inputs[inputCount].ki.dwFlags = 0;
-    inputCount++;
-    
-    // Release key
-    inputs[inputCount].type = INPUT_KEYBOARD;
-    inputs[inputCount].ki.wVk = static_cast<WORD>(keystroke.virtualKey);
-    inputs[inputCount].ki.dwFlags = KEYEVENTF_KEYUP;
-    inputCount++;
-    
-    // Release shift if needed
-    if (keystroke.shift) {
-        inputs[inputCount].type = INPUT_KEYBOARD;
-        inputs[inputCount].ki.wVk = VK_SHIFT;
-        inputs[inputCount].ki.dwFlags = KEYEVENTF_KEYUP;
-        inputCount++;
+    return CallNextHookEx(nullptr, nCode, wParam, lParam);
+}
+
+void KeyboardInterceptor::PerformLayoutCorrection() {
+    uint64_t start = LatencyClock::Now();
+    try {
+        _engine.Correct();
+    }
+    catch (...) {
+        // The next key goes on as usual; the count shows in Diagnostics
+        _dispatcher.GetLatency().Get(LatencyMetrics::CORRECTION_FAILED).RecordSince(start);
+    }
+}
+
+void KeyboardInterceptor::PerformPhraseCorrection() {
+    // Shift is still down from Shift+Pause; replayed keys and backspaces
+    // would go out shifted
+    if (WaitForModifierRelease()) {
+        uint64_t start = LatencyClock::Now();
+        try {
+            _engine.CorrectPhrase();
+        }
+        catch (...) {
+            _dispatcher.GetLatency().Get(LatencyMetrics::CORRECTION_FAILED).RecordSince(start);
+        }
     }
-    
-    SendInput(inputCount, inputs, sizeof(INPUT));
 }
 
-bool KeyboardInterceptor::IsCharacterKey(int vkCode) const {
-    return (vkCode >= 'A' && vkCode <= 'Z') ||
-           (vkCode >= '0' && vkCode <= '9') ||
-           (vkCode >= VK_NUMPAD0 && vkCode <= VK_NUMPAD9) ||
-           (vkCode >= VK_OEM_1 && vkCode <= VK_OEM_3) ||
-           (vkCode >= VK_OEM_4 && vkCode <= VK_OEM_8) ||
-           vkCode == VK_SPACE;
+void KeyboardInterceptor::PerformSelectionConversion() {
+    // Alt is still down from Alt+Pause; a key seen before its release stops
+    // the window from treating the release as a menu shortcut
+    INPUT mask[2] = {};
+    for (int i = 0; i < 2; ++i) {
+        mask[i].type = INPUT_KEYBOARD;
+        mask[i].ki.wVk = MENU_MASK_KEY;
+        mask[i].ki.dwFlags = i == 0 ? 0 : KEYEVENTF_KEYUP;
+        InjectedInput::Stamp(mask[i]);
+    }
+    _backend.Send(mask, 2);
+    
+    // Ctrl+C with Alt still held would be a different shortcut
+    if (WaitForModifierRelease()) {
+        uint64_t start = LatencyClock::Now();
+        try {
+            _engine.ConvertSelection();
+        }
+        catch (...) {
+            _dispatcher.GetLatency().Get(LatencyMetrics::SELECTION_FAILED).RecordSince(start);
+        }
+    }
 }
 
-void KeyboardInterceptor::ClearBuffer() {
-    _keystrokeBuffer.clear();
-    _lastCorrectedBuffer.clear();
-    _correctionCount = 0;
-    _lastCharWasSpace = false;
+bool KeyboardInterceptor::WaitForModifierRelease() {
+    const uint16_t held = ModifierState::SHIFT | ModifierState::CTRL | ModifierState::ALT | ModifierState::WIN;
+    ULONGLONG deadline = GetTickCount64() + MODIFIER_RELEASE_TIMEOUT_MS;
+    while (_dispatcher.GetModifiers().Load().Any(held)) {
+        if (GetTickCount64() >= deadline) {
+            return false;
+        }
+        Sleep(10);
+    }
+    return true;
 }
\ No newline at end of file
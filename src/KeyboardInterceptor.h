@@ -2,40 +2,81 @@
 #include <windows.h>
 #include <vector>
 #include <memory>
+#include <atomic>
+#include "KeyEventRing.h"
+#include "HookDispatcher.h"
+#include "CorrectionEngine.h"
+#include "Win32Backend.h"
 
 class KeyboardInterceptor {
 public:
-    KeyboardInterceptor();
+    // userWords is used by the worker only, and must outlive the
+    // interceptor. The worker opens it on userWordsDirectory, unless that
+    // is empty or it is already open.
+    KeyboardInterceptor(HookDispatcher& dispatcher, const ForegroundTracker& foreground, size_t keystrokeCapacity,
+                        const AutoCorrectOptions& autoCorrect, UserDictionary& userWords,
+                        const NativePath& userWordsDirectory);
     ~KeyboardInterceptor();
-    
+
     void StartIntercepting();
     void StopIntercepting();
 
+    // From the UI thread when the foreground application's rule changes;
+    // the worker picks it up with its next batch
+    void SetInjection(AppPolicy::Injection injection) { _injection.store(injection, std::memory_order_relaxed); }
+
+    // Words Shift+Pause corrects, 0 for the whole phrase; picked up the same
+    // way
+    void SetPhraseWords(size_t words) { _phraseWords.store(words, std::memory_order_relaxed); }
+
 private:
-    struct KeystrokeInfo {
-        int virtualKey;
-        bool shift;
-        bool capsLock;
-    };
-    
-    static LRESULT CALLBACK KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam);
+    static const size_t WORKER_BATCH_SIZE = 64;
+
+    // Alt+Pause: how long the worker waits for the modifiers to go up
+    // before copying, and the unassigned key that keeps Alt's release from
+    // opening the window menu
+    static const DWORD MODIFIER_RELEASE_TIMEOUT_MS = 2000;
+    static const WORD MENU_MASK_KEY = 0xE8;
+
+    static bool OnCorrectionKey(void* context, UINT message, const KBDLLHOOKSTRUCT& event);
+    static bool OnRecordKey(void* context, UINT message, const KBDLLHOOKSTRUCT& event);
     static LRESULT CALLBACK MouseHookProc(int nCode, WPARAM wParam, LPARAM lParam);
-    
-    void RecordKeystroke(int vkCode);
+    static DWORD WINAPI WorkerThreadProc(LPVOID param);
+
+    void PostEvent(const KeyEvent& event);
+    void ProcessEvents(const KeyEvent* events, size_t count);
+    void StartWorker();
+    void StopWorker();
     void PerformLayoutCorrection();
-    void SwitchKeyboardLayout();
-    void ReplayKeystroke(const KeystrokeInfo& keystroke);
-    bool IsCharacterKey(int vkCode) const;
-    void ClearBuffer();
-    
-    HHOOK _keyboardHook;
+    void PerformPhraseCorrection();
+    void PerformSelectionConversion();
+    bool WaitForModifierRelease();
+
+    HookDispatcher& _dispatcher;
+    const ForegroundTracker& _foreground;
     HHOOK _mouseHook;
-    std::vector<KeystrokeInfo> _keystrokeBuffer;
-    std::vector<KeystrokeInfo> _lastCorrectedBuffer;
-    HWND _lastActiveWindow;
-    bool _isProcessingCorrection;
-    bool _lastCharWasSpace;
-    int _correctionCount;
-    
+
+    // Hook thread -> worker thread hand-off
+    KeyEventRing _eventRing;
+    HANDLE _workerThread;
+    HANDLE _wakeEvent;
+    std::atomic<bool> _stopWorker;
+    // Set by the worker before it sleeps; the hook signals only then, so
+    // typing into a busy worker costs no SetEvent per key
+    std::atomic<bool> _workerWaiting;
+    size_t _lastOverflowCount;
+
+    // Hook thread only: the window the last posted event was typed in
+    HWND _postedWindow;
+
+    // Worker-owned buffer state. Each window keeps its own buffer, so a word
+    // survives switching away from its window and back.
+    Win32Backend _backend;
+    CorrectionEngine _engine;
+    UserDictionary& _userWords;
+    NativePath _userWordsDirectory;
+    std::atomic<uint8_t> _injection;
+    std::atomic<size_t> _phraseWords;
+
     static KeyboardInterceptor* _instance;
 };
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include "KeyboardLayouts.h"
+#include <algorithm>
+
+KeyboardLayouts::KeyboardLayouts() : _count(0) {
+}
+
+KeyboardLayouts::Entry* KeyboardLayouts::GetEntry(HKL layout) {
+    if (!layout) return nullptr;
+    
+    for (int i = 0; i < _count; ++i) {
+        if (_entries[i].layout == layout) {
+            return &_entries[i];
+        }
+    }
+    
+    // More than MAX_LAYOUTS distinct layouts in a session means some were
+    // removed since; only their slots are reused. A layout that still finds
+    // no slot is treated as one without a table or model.
+    Entry* entry = _count < MAX_LAYOUTS ? &_entries[_count++] : FindRemovedEntry();
+    if (!entry) return nullptr;
+    
+    entry->layout = layout;
+    entry->modelLoaded = false;
+    entry->model.Close();
+    BuildTable(layout, entry->table);
+    return entry;
+}
+
+// Closing the model unmaps it, so an entry whose layout is still installed
+// may have pointers out in a ranking and is never reused
+KeyboardLayouts::Entry* KeyboardLayouts::FindRemovedEntry() {
+    HKL installed[MAX_LAYOUTS];
+    int count = GetKeyboardLayoutList(MAX_LAYOUTS, installed);
+    if (count <= 0) return nullptr;
+    
+    for (int i = 0; i < _count; ++i) {
+        if (std::find(installed, installed + count, _entries[i].layout) == installed + count) {
+            return &_entries[i];
+        }
+    }
+    return nullptr;
+}
+
+const LayoutTable* KeyboardLayouts::GetTable(HKL layout) {
+    Entry* entry = GetEntry(layout);
+    return entry ? &entry->table : nullptr;
+}
+
+const LanguageModel* KeyboardLayouts::GetModel(HKL layout) {
+    Entry* entry = GetEntry(layout);
+    if (!entry) return nullptr;
+    
+    if (!entry->modelLoaded) {
+        LoadModel(layout, *entry);
+        entry->modelLoaded = true;
+    }
+    return entry->model.IsValid() ? &entry->model : nullptr;
+}
+
+const Dawg* KeyboardLayouts::GetDictionary(HKL layout) {
+    const LanguageModel* model = GetModel(layout);
+    return model ? model->Dictionary() : nullptr;
+}
+
+const NgramTable* KeyboardLayouts::GetTrigrams(HKL layout) {
+    const LanguageModel* model = GetModel(layout);
+    return model ? model->Trigrams() : nullptr;
+}
+
+HKL KeyboardLayouts::GetNextLayout(HKL current) {
+    HKL layouts[MAX_LAYOUTS];
+    int count = GetKeyboardLayoutList(MAX_LAYOUTS, layouts);
+    if (count <= 1) return nullptr;
+    
+    for (int i = 0; i < count; ++i) {
+        if (layouts[i] == current) {
+            return layouts[(i + 1) % count];
+        }
+    }
+    return layouts[0];
+}
+
+void KeyboardLayouts::BuildTable(HKL layout, LayoutTable& table) {
+    table = LayoutTable(static_cast<uint32_t>(reinterpret_cast<ULONG_PTR>(layout)));
+    
+    // Flag 0x4 keeps ToUnicodeEx from touching the kernel dead-key state,
+    // which would otherwise corrupt what the user is typing
+    const UINT NO_STATE_CHANGE = 0x4;
+    BYTE keyState[256] = {};
+    wchar_t chars[4];
+    
+    for (int vk = 0; vk < LayoutTable::KEY_COUNT; ++vk) {
+        UINT scanCode = MapVirtualKeyEx(vk, MAPVK_VK_TO_VSC, layout);
+        if (!scanCode) continue;
+        
+        keyState[VK_SHIFT] = 0;
+        keyState[VK_CAPITAL] = 0;
+        int count = ToUnicodeEx(vk, scanCode, keyState, chars, 4, NO_STATE_CHANGE, layout);
+        wchar_t normal = (count == 1 && chars[0] >= 0x20) ? chars[0] : 0;
+        
+        keyState[VK_SHIFT] = 0x80;
+        count = ToUnicodeEx(vk, scanCode, keyState, chars, 4, NO_STATE_CHANGE, layout);
+        wchar_t shifted = (count == 1 && chars[0] >= 0x20) ? chars[0] : 0;
+        
+        if (!normal && !shifted) continue;
+        
+        // A key is a letter for Caps Lock purposes if Caps alone yields
+        // the shifted character
+        keyState[VK_SHIFT] = 0;
+        keyState[VK_CAPITAL] = 0x01;
+        count = ToUnicodeEx(vk, scanCode, keyState, chars, 4, NO_STATE_CHANGE, layout);
+        bool capsAffected = count == 1 && normal != shifted && chars[0] == shifted;
+        
+        table.SetKey(vk, static_cast<char16_t>(normal), static_cast<char16_t>(shifted), capsAffected);
+    }
+}
+
+void KeyboardLayouts::LoadModel(HKL layout, Entry& entry) {
+    wchar_t localeName[LOCALE_NAME_MAX_LENGTH];
+    LCID lcid = MAKELCID(LOWORD(reinterpret_cast<ULONG_PTR>(layout)), SORT_DEFAULT);
+    if (LCIDToLocaleName(lcid, localeName, LOCALE_NAME_MAX_LENGTH, 0) == 0) {
+        return;
+    }
+    
+    // The checksum pass reads the file once per layout and catches truncated
+    // or partially copied models before the ranking trusts them
+    entry.model.Open(GetModelDirectory() + localeName + L".kslm");
+}
+
+std::wstring KeyboardLayouts::GetModelDirectory() {
+    wchar_t exePath[MAX_PATH];
+    DWORD length = GetModuleFileName(nullptr, exePath, MAX_PATH);
+    std::wstring directory(exePath, length);
+    
+    size_t lastSlash = directory.find_last_of(L'\\');
+    directory.erase(lastSlash == std::wstring::npos ? 0 : lastSlash + 1);
+    return directory + L"models\\";
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+#include <windows.h>
+#include <string>
+#include "LayoutTable.h"
+#include "LanguageModel.h"
+
+// Per-layout data for the installed keyboard layouts: the translation table,
+// built from the live layout the first time it is needed, and the language
+// model of the layout's language, memory-mapped from
+// <exe dir>\models\<locale name>.kslm when present (see kswitcher-modelc).
+// Entries stay put while their layout is installed, so pointers handed out
+// for one remain valid across lookups of others; a full cache only recycles
+// layouts the user has removed. Not thread-safe, owned by the correction
+// worker.
+class KeyboardLayouts {
+public:
+    static const int MAX_LAYOUTS = 16;
+
+    KeyboardLayouts();
+
+    const LayoutTable* GetTable(HKL layout);
+    const LanguageModel* GetModel(HKL layout);
+    const Dawg* GetDictionary(HKL layout);
+    const NgramTable* GetTrigrams(HKL layout);
+
+    // Layout that follows current in the system's layout list
+    static HKL GetNextLayout(HKL current);
+
+private:
+    struct Entry {
+        HKL layout = nullptr;
+        LayoutTable table;
+        bool modelLoaded = false;
+        LanguageModel model;
+    };
+
+    Entry* GetEntry(HKL layout);
+    Entry* FindRemovedEntry();
+    static void BuildTable(HKL layout, LayoutTable& table);
+    static void LoadModel(HKL layout, Entry& entry);
+    static std::wstring GetModelDirectory();
+
+    Entry _entries[MAX_LAYOUTS];
+    int _count;
+};
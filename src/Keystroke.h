@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+
+// One recorded character key together with the modifier state it was typed
+// with, packed into 16 bits:
+//   bits 0-7    virtual key
+//   bit  8      Shift
+//   bit  9      Caps Lock
+//   bit  10     extended key (LLKHF_EXTENDED)
+//   bits 11-15  reserved for further scan-code flags
+struct KeystrokeInfo {
+    enum Bits : uint16_t {
+        VIRTUAL_KEY_MASK = 0x00FF,
+        SHIFT            = 0x0100,
+        CAPS_LOCK        = 0x0200,
+        EXTENDED         = 0x0400
+    };
+
+    uint16_t bits;
+
+    static KeystrokeInfo Make(int virtualKey, bool shift, bool capsLock, bool extended = false) {
+        KeystrokeInfo keystroke;
+        keystroke.bits = static_cast<uint16_t>((virtualKey & VIRTUAL_KEY_MASK) |
+                                               (shift ? SHIFT : 0) |
+                                               (capsLock ? CAPS_LOCK : 0) |
+                                               (extended ? EXTENDED : 0));
+        return keystroke;
+    }
+
+    int VirtualKey() const { return bits & VIRTUAL_KEY_MASK; }
+    bool Shift() const { return (bits & SHIFT) != 0; }
+    bool CapsLock() const { return (bits & CAPS_LOCK) != 0; }
+    bool Extended() const { return (bits & EXTENDED) != 0; }
+};
+
+static_assert(sizeof(KeystrokeInfo) == 2, "KeystrokeInfo must stay packed");
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include "Keystroke.h"
+
+// Fixed-capacity ring of the most recent keystrokes of one window. When full,
+// a new keystroke overwrites the oldest, so long runs without spaces (pasted
+// identifiers, URLs) keep their tail instead of growing without limit.
+// Every slot is written twice, at i and i + capacity, which keeps the live
+// keystrokes contiguous in storage: Data() is a plain pointer the planner and
+// ranker read in place, however far the ring has wrapped.
+class KeystrokeRing {
+public:
+    static const size_t MAX_CAPACITY = 256;
+    static const size_t DEFAULT_CAPACITY = 64;
+
+    KeystrokeRing() : _capacity(DEFAULT_CAPACITY), _head(0), _count(0) {}
+
+    // Clamped to [1, MAX_CAPACITY]; drops the current contents
+    void SetCapacity(size_t capacity) {
+        if (capacity < 1) capacity = 1;
+        if (capacity > MAX_CAPACITY) capacity = MAX_CAPACITY;
+        _capacity = capacity;
+        Clear();
+    }
+
+    void Push(KeystrokeInfo keystroke) {
+        _storage[_head] = keystroke;
+        _storage[_head + _capacity] = keystroke;
+        if (++_head == _capacity) _head = 0;
+        if (_count < _capacity) ++_count;
+    }
+
+    void PopBack() {
+        if (_count == 0) return;
+        _head = (_head == 0 ? _capacity : _head) - 1;
+        --_count;
+    }
+
+    void Clear() {
+        _head = 0;
+        _count = 0;
+    }
+
+    // Oldest to newest, valid until the next Push
+    const KeystrokeInfo* Data() const {
+        size_t start = _head >= _count ? _head - _count : _head + _capacity - _count;
+        return _storage + start;
+    }
+
+    const KeystrokeInfo& Back() const { return Data()[_count - 1]; }
+
+    size_t Size() const { return _count; }
+    size_t Capacity() const { return _capacity; }
+    bool IsEmpty() const { return _count == 0; }
+
+private:
+    KeystrokeInfo _storage[MAX_CAPACITY * 2];
+    size_t _capacity;
+    size_t _head;       // Next slot to write, in [0, _capacity)
+    size_t _count;
+};
\ No newline at end of file
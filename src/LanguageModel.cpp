@@ -0,0 +1,155 @@
+#include "LanguageModel.h"
+#include <cstring>
+
+static_assert(sizeof(ModelHeader) == 32, "ModelHeader layout is part of the file format");
+static_assert(sizeof(ModelSection) == 16, "ModelSection layout is part of the file format");
+
+namespace {
+
+const size_t SECTION_ALIGNMENT = 8;
+
+size_t AlignUp(size_t value) {
+    return (value + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+}
+
+struct Crc32Table {
+    uint32_t values[256];
+
+    Crc32Table() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value & 1) ? (0xEDB88320u ^ (value >> 1)) : (value >> 1);
+            }
+            values[i] = value;
+        }
+    }
+};
+
+} // namespace
+
+LanguageModel::LanguageModel() : _data(nullptr), _size(0) {
+    _locale[0] = 0;
+}
+
+bool LanguageModel::Open(const NativePath& path, bool verifyChecksum) {
+    Close();
+
+    if (!_file.Open(path)) return false;
+    if (!Attach(_file.Data(), _file.Size(), verifyChecksum)) {
+        _file.Close();
+        return false;
+    }
+    return true;
+}
+
+bool LanguageModel::Attach(const uint8_t* data, size_t size, bool verifyChecksum) {
+    _data = nullptr;
+    _size = 0;
+    _locale[0] = 0;
+    _dictionary.Detach();
+    _trigrams = NgramTable();
+
+    if (!data || size < sizeof(ModelHeader)) return false;
+
+    ModelHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != MAGIC || header.version != VERSION || header.fileSize != size) return false;
+
+    size_t tableEnd = sizeof(ModelHeader) + header.sectionCount * sizeof(ModelSection);
+    if (tableEnd > size) return false;
+
+    if (verifyChecksum && Crc32(data + sizeof(ModelHeader), size - sizeof(ModelHeader)) != header.checksum) {
+        return false;
+    }
+
+    for (uint16_t i = 0; i < header.sectionCount; ++i) {
+        ModelSection section;
+        memcpy(&section, data + sizeof(ModelHeader) + i * sizeof(ModelSection), sizeof(section));
+        if (section.offset < tableEnd || section.offset > size || section.size > size - section.offset) {
+            return false;
+        }
+
+        const uint8_t* sectionData = data + section.offset;
+        bool attached = true;
+        switch (section.type) {
+            case SECTION_DICTIONARY:
+                attached = _dictionary.Attach(sectionData, section.size);
+                break;
+            case SECTION_TRIGRAMS:
+                attached = _trigrams.Attach(sectionData, section.size) != 0;
+                break;
+            default:
+                // Unknown sections come from newer compilers, skip them
+                break;
+        }
+
+        if (!attached) {
+            _dictionary.Detach();
+            _trigrams = NgramTable();
+            return false;
+        }
+    }
+
+    memcpy(_locale, header.locale, sizeof(header.locale));
+    _locale[sizeof(header.locale)] = 0;
+    _data = data;
+    _size = size;
+    return true;
+}
+
+void LanguageModel::Close() {
+    _dictionary.Detach();
+    _trigrams = NgramTable();
+    _data = nullptr;
+    _size = 0;
+    _locale[0] = 0;
+    _file.Close();
+}
+
+uint32_t LanguageModel::Crc32(const uint8_t* data, size_t size) {
+    static const Crc32Table table;
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+void LanguageModelWriter::AddSection(uint32_t type, const std::vector<uint8_t>& data) {
+    _sections.push_back({ type, data });
+}
+
+std::vector<uint8_t> LanguageModelWriter::Finish(const char* locale) const {
+    size_t offset = AlignUp(sizeof(ModelHeader) + _sections.size() * sizeof(ModelSection));
+
+    std::vector<ModelSection> entries;
+    for (const auto& section : _sections) {
+        ModelSection entry = {};
+        entry.type = section.type;
+        entry.offset = static_cast<uint32_t>(offset);
+        entry.size = static_cast<uint32_t>(section.data.size());
+        entries.push_back(entry);
+        offset = AlignUp(offset + section.data.size());
+    }
+
+    std::vector<uint8_t> out(offset, 0);
+    for (size_t i = 0; i < _sections.size(); ++i) {
+        memcpy(out.data() + sizeof(ModelHeader) + i * sizeof(ModelSection), &entries[i], sizeof(ModelSection));
+        memcpy(out.data() + entries[i].offset, _sections[i].data.data(), _sections[i].data.size());
+    }
+
+    ModelHeader header = {};
+    header.magic = LanguageModel::MAGIC;
+    header.version = LanguageModel::VERSION;
+    header.sectionCount = static_cast<uint16_t>(_sections.size());
+    header.fileSize = static_cast<uint32_t>(out.size());
+    if (locale) {
+        size_t length = strlen(locale);
+        memcpy(header.locale, locale, length < sizeof(header.locale) ? length : sizeof(header.locale));
+    }
+    header.checksum = LanguageModel::Crc32(out.data() + sizeof(ModelHeader), out.size() - sizeof(ModelHeader));
+    memcpy(out.data(), &header, sizeof(header));
+    return out;
+}
\ No newline at end of file
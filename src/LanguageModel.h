@@ -0,0 +1,84 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Dawg.h"
+#include "NgramTable.h"
+#include "MappedFile.h"
+
+// Versioned binary language model produced by kswitcher-modelc.
+//
+// Layout (little-endian):
+//   ModelHeader
+//   ModelSection[sectionCount]
+//   section data, each section starting on an 8-byte boundary
+//
+// The checksum is a CRC-32 of everything after the header. Sections are
+// used in place, so loading a model is a mapping plus a header check.
+struct ModelHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t sectionCount;
+    uint32_t checksum;
+    uint32_t fileSize;
+    char locale[16];        // e.g. "en-US", zero-padded
+};
+
+struct ModelSection {
+    uint32_t type;
+    uint32_t reserved;
+    uint32_t offset;        // From the start of the file
+    uint32_t size;
+};
+
+class LanguageModel {
+public:
+    static const uint32_t MAGIC = 0x4D4C534B;   // "KSLM"
+    static const uint16_t VERSION = 1;
+
+    enum SectionType : uint32_t {
+        SECTION_DICTIONARY = 1,     // Dawg
+        SECTION_TRIGRAMS = 2        // NgramTable
+    };
+
+    LanguageModel();
+
+    bool Open(const NativePath& path, bool verifyChecksum = true);
+
+    // Points the model at data without copying; data must outlive the model
+    bool Attach(const uint8_t* data, size_t size, bool verifyChecksum = true);
+    void Close();
+
+    bool IsValid() const { return _data != nullptr; }
+    const char* Locale() const { return _locale; }
+    size_t SizeInBytes() const { return _size; }
+
+    // Null when the model has no such section
+    const Dawg* Dictionary() const { return _dictionary.IsValid() ? &_dictionary : nullptr; }
+    const NgramTable* Trigrams() const { return _trigrams.IsValid() ? &_trigrams : nullptr; }
+
+    static uint32_t Crc32(const uint8_t* data, size_t size);
+
+private:
+    MappedFile _file;
+    const uint8_t* _data;
+    size_t _size;
+    char _locale[sizeof(ModelHeader::locale) + 1];
+    Dawg _dictionary;
+    NgramTable _trigrams;
+};
+
+// Assembles sections into the file format above
+class LanguageModelWriter {
+public:
+    void AddSection(uint32_t type, const std::vector<uint8_t>& data);
+    std::vector<uint8_t> Finish(const char* locale) const;
+
+private:
+    struct PendingSection {
+        uint32_t type;
+        std::vector<uint8_t> data;
+    };
+
+    std::vector<PendingSection> _sections;
+};
\ No newline at end of file
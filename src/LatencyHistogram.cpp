@@ -0,0 +1,63 @@
+#include "LatencyHistogram.h"
+
+namespace {
+
+double NanosecondsPerTick() {
+#ifdef _WIN32
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    return 1e9 / static_cast<double>(frequency.QuadPart);
+#else
+    return 1.0;
+#endif
+}
+
+} // namespace
+
+const double LatencyClock::_nanosecondsPerTick = NanosecondsPerTick();
+
+LatencyHistogram::LatencyHistogram() : _sum(0), _max(0) {
+    for (auto& bucket : _buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::Read(Snapshot& snapshot) const {
+    snapshot.count = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        snapshot.buckets[i] = _buckets[i].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.buckets[i];
+    }
+    snapshot.sum = _sum.load(std::memory_order_relaxed);
+    snapshot.max = _max.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Snapshot::Percentile(double fraction) const {
+    if (count == 0) return 0;
+
+    uint64_t rank = static_cast<uint64_t>(fraction * count + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            uint64_t upper = BucketUpperBound(i);
+            return upper < max ? upper : max;
+        }
+    }
+    return max;
+}
+
+uint64_t LatencyHistogram::BucketLowerBound(size_t index) {
+    if (index < 2 * SUB_BUCKET_COUNT) {
+        return index;
+    }
+    size_t shift = index / SUB_BUCKET_COUNT - 1;
+    return static_cast<uint64_t>(SUB_BUCKET_COUNT + index % SUB_BUCKET_COUNT) << shift;
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(size_t index) {
+    return index + 1 < BUCKET_COUNT ? BucketLowerBound(index + 1) - 1 : MAX_VALUE;
+}
\ No newline at end of file
@@ -0,0 +1,119 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "Win32Compat.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <chrono>
+#endif
+
+// Cheapest monotonic clock with sub-microsecond resolution: the performance
+// counter on Windows, steady_clock elsewhere. Ticks are only converted to
+// nanoseconds when a sample is recorded.
+class LatencyClock {
+public:
+    static uint64_t Now() {
+#ifdef _WIN32
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        return static_cast<uint64_t>(counter.QuadPart);
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    static uint64_t ToNanoseconds(uint64_t ticks) {
+        return static_cast<uint64_t>(ticks * _nanosecondsPerTick);
+    }
+
+private:
+    static const double _nanosecondsPerTick;
+};
+
+// Log-linear histogram of durations in nanoseconds. Each power of two is
+// split into SUB_BUCKET_COUNT equal buckets, so every bucket is within 12.5%
+// of its value from 16 ns up to the 4.3 s clamp. Storage is a fixed array of
+// counters; Record never allocates or locks.
+//
+// Each histogram has a single writer thread. Readers on other threads may
+// see a sample counted in one field and not yet in another, which is fine
+// for diagnostics.
+class LatencyHistogram {
+public:
+    static const size_t SUB_BUCKET_BITS = 3;
+    static const size_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static const uint64_t MAX_VALUE = 0xFFFFFFFFu;
+    static const size_t BUCKET_COUNT = (32 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    // Plain copy of the counters, taken once and then queried
+    struct Snapshot {
+        uint32_t buckets[BUCKET_COUNT];
+        uint64_t count;
+        uint64_t sum;
+        uint64_t max;
+
+        double Mean() const { return count ? static_cast<double>(sum) / count : 0; }
+
+        // Upper bound of the bucket holding the given fraction of samples,
+        // clamped to the largest sample seen
+        uint64_t Percentile(double fraction) const;
+    };
+
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void Record(uint64_t nanoseconds) {
+        if (nanoseconds > MAX_VALUE) nanoseconds = MAX_VALUE;
+
+        // Only this thread writes, so plain load/store pairs are enough and
+        // avoid a locked instruction per sample
+        std::atomic<uint32_t>& bucket = _buckets[BucketIndex(nanoseconds)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        _sum.store(_sum.load(std::memory_order_relaxed) + nanoseconds, std::memory_order_relaxed);
+        if (nanoseconds > _max.load(std::memory_order_relaxed)) {
+            _max.store(nanoseconds, std::memory_order_relaxed);
+        }
+    }
+
+    // Records the time from startTicks (a LatencyClock::Now value) to now
+    // and returns the current tick count, so phases can be timed back to back
+    uint64_t RecordSince(uint64_t startTicks) {
+        uint64_t now = LatencyClock::Now();
+        Record(LatencyClock::ToNanoseconds(now - startTicks));
+        return now;
+    }
+
+    void Read(Snapshot& snapshot) const;
+
+    static size_t BucketIndex(uint64_t value) {
+        if (value < 2 * SUB_BUCKET_COUNT) {
+            return static_cast<size_t>(value);
+        }
+        size_t shift = HighestBit(value) - SUB_BUCKET_BITS;
+        return (shift + 1) * SUB_BUCKET_COUNT + static_cast<size_t>((value >> shift) - SUB_BUCKET_COUNT);
+    }
+
+    static uint64_t BucketLowerBound(size_t index);
+    static uint64_t BucketUpperBound(size_t index);
+
+private:
+    static size_t HighestBit(uint64_t value) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return index;
+#else
+        return 63 - static_cast<size_t>(__builtin_clzll(value));
+#endif
+    }
+
+    std::atomic<uint32_t> _buckets[BUCKET_COUNT];
+    std::atomic<uint64_t> _sum;
+    std::atomic<uint64_t> _max;
+};
\ No newline at end of file
@@ -0,0 +1,52 @@
+#include "LatencyMetrics.h"
+#include <cstdio>
+
+const char* LatencyMetrics::Name(MetricId id) {
+    static const char* const names[METRIC_COUNT] = {
+        "hook.keyboard",
+        "handler.trace",
+        "handler.layout_switch",
+        "handler.correction",
+        "handler.recording",
+        "hook.mouse",
+        "correction.total",
+        "correction.detect",
+        "correction.delete",
+        "correction.switch",
+        "correction.replay",
+        "selection.total",
+        "selection.transcode",
+        "autocorrect.decide",
+        "layout.restore",
+        "phrase.detect",
+        "correction.failed",
+        "selection.failed",
+    };
+    return id < METRIC_COUNT ? names[id] : "";
+}
+
+std::string LatencyMetrics::Format() const {
+    std::string text;
+    char line[160];
+    snprintf(line, sizeof(line), "%-22s %10s %9s %9s %9s %9s %9s %9s\n",
+             "metric (us)", "count", "mean", "p50", "p90", "p99", "p99.9", "max");
+    text += line;
+
+    LatencyHistogram::Snapshot snapshot;
+    for (int i = 0; i < METRIC_COUNT; ++i) {
+        MetricId id = static_cast<MetricId>(i);
+        _histograms[id].Read(snapshot);
+        if (snapshot.count == 0) continue;
+
+        snprintf(line, sizeof(line), "%-22s %10llu %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f\n",
+                 Name(id), static_cast<unsigned long long>(snapshot.count),
+                 snapshot.Mean() / 1000.0,
+                 snapshot.Percentile(0.50) / 1000.0,
+                 snapshot.Percentile(0.90) / 1000.0,
+                 snapshot.Percentile(0.99) / 1000.0,
+                 snapshot.Percentile(0.999) / 1000.0,
+                 snapshot.max / 1000.0);
+        text += line;
+    }
+    return text;
+}
\ No newline at end of file
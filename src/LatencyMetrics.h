@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include "LatencyHistogram.h"
+
+// Always-on timing of everything that runs inside a hook callback or the
+// correction it triggers. Windows drops low-level hooks that are too slow
+// without telling the application, so these numbers are the only way to see
+// how close a machine gets to that limit.
+class LatencyMetrics {
+public:
+    enum MetricId {
+        HOOK_KEYBOARD = 0,          // Whole keyboard hook callback
+        HANDLER_TRACE,              // Dispatcher handlers, same order as HookDispatcher
+        HANDLER_LAYOUT_SWITCH,
+        HANDLER_CORRECTION,
+        HANDLER_RECORDING,
+        HOOK_MOUSE,                 // Interceptor mouse hook callback
+        CORRECTION_TOTAL,           // Worker side of one Pause press, phrase or auto-correction
+        CORRECTION_DETECT,          // Dictionary layout detection
+        CORRECTION_DELETE,          // Backspaces for the typed text
+        CORRECTION_SWITCH,          // Layout switch request and wait
+        CORRECTION_REPLAY,          // Retyping under the new layout
+        SELECTION_TOTAL,            // Worker side of one Alt+Pause press
+        SELECTION_TRANSCODE,        // Converting the copied text
+        AUTOCORRECT_DECIDE,         // Auto-correct decision when a word ends
+        LAYOUT_RESTORE,             // Focus change to the remembered layout's switch request
+        PHRASE_DETECT,              // Ranking the layouts over a Shift+Pause phrase
+        CORRECTION_FAILED,          // Pause or Shift+Pause that threw, until it did
+        SELECTION_FAILED,           // Alt+Pause that threw, until it did
+        METRIC_COUNT
+    };
+
+    static const MetricId HANDLER_FIRST = HANDLER_TRACE;
+
+    LatencyHistogram& Get(MetricId id) { return _histograms[id]; }
+    const LatencyHistogram& Get(MetricId id) const { return _histograms[id]; }
+
+    static const char* Name(MetricId id);
+
+    // One line per metric with samples: count, mean, percentiles and max
+    // in microseconds
+    std::string Format() const;
+
+private:
+    LatencyHistogram _histograms[METRIC_COUNT];
+};
\ No newline at end of file
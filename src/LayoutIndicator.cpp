@@ -0,0 +1,102 @@
+#include "LayoutIndicator.h"
+#include <cstring>
+
+LayoutIndicator::LayoutIndicator() : _count(0) {
+}
+
+LayoutIndicator::~LayoutIndicator() {
+    Clear();
+}
+
+void LayoutIndicator::SetIconSize(int size) {
+    if (size == _atlas.Size()) return;
+
+    Clear();
+    if (_atlas.Build(size)) {
+        _pixels.resize(static_cast<size_t>(size) * size);
+    }
+}
+
+HICON LayoutIndicator::GetIcon(HKL layout, bool dark) {
+    if (_atlas.Size() == 0) return nullptr;
+    BadgeAtlas::Theme theme = dark ? BadgeAtlas::THEME_DARK : BadgeAtlas::THEME_LIGHT;
+
+    Entry* entry = nullptr;
+    for (size_t i = 0; i < _count; ++i) {
+        if (_entries[i].layout == layout) {
+            entry = &_entries[i];
+            break;
+        }
+    }
+    if (entry && entry->icons[theme]) return entry->icons[theme];
+
+    char code[BadgeAtlas::MAX_CODE_LENGTH + 1];
+    if (!GetLanguageCode(layout, code)) return nullptr;
+
+    if (!entry) {
+        // Layouts come and go; start over rather than grow
+        if (_count == MAX_LAYOUTS) Clear();
+        entry = &_entries[_count++];
+        entry->layout = layout;
+        memset(entry->icons, 0, sizeof(entry->icons));
+    }
+    entry->icons[theme] = CreateBadgeIcon(code, theme);
+    return entry->icons[theme];
+}
+
+void LayoutIndicator::Clear() {
+    for (size_t i = 0; i < _count; ++i) {
+        for (HICON icon : _entries[i].icons) {
+            if (icon) DestroyIcon(icon);
+        }
+    }
+    _count = 0;
+}
+
+HICON LayoutIndicator::CreateBadgeIcon(const char* code, BadgeAtlas::Theme theme) {
+    int size = _atlas.Size();
+    _atlas.Compose(code, theme, _pixels.data());
+
+    BITMAPINFO info = {};
+    info.bmiHeader.biSize = sizeof(info.bmiHeader);
+    info.bmiHeader.biWidth = size;
+    info.bmiHeader.biHeight = -size;    // Top-down, as composed
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 32;
+    info.bmiHeader.biCompression = BI_RGB;
+
+    void* bits = nullptr;
+    HBITMAP color = CreateDIBSection(nullptr, &info, DIB_RGB_COLORS, &bits, nullptr, 0);
+    if (!color) return nullptr;
+    memcpy(bits, _pixels.data(), _pixels.size() * sizeof(uint32_t));
+
+    // With a 32-bit color bitmap the alpha channel decides transparency and
+    // the mask only has to exist
+    HBITMAP mask = CreateBitmap(size, size, 1, 1, nullptr);
+
+    ICONINFO iconInfo = {};
+    iconInfo.fIcon = TRUE;
+    iconInfo.hbmMask = mask;
+    iconInfo.hbmColor = color;
+    HICON icon = mask ? CreateIconIndirect(&iconInfo) : nullptr;
+
+    DeleteObject(color);
+    if (mask) DeleteObject(mask);
+    return icon;
+}
+
+bool LayoutIndicator::GetLanguageCode(HKL layout, char* code) {
+    LANGID language = LOWORD(reinterpret_cast<ULONG_PTR>(layout));
+    wchar_t name[9];
+    if (!GetLocaleInfoW(MAKELCID(language, SORT_DEFAULT), LOCALE_SISO639LANGNAME, name, 9)) {
+        return false;
+    }
+
+    char ascii[9];
+    size_t i = 0;
+    for (; name[i] && i < 8; ++i) {
+        ascii[i] = name[i] < 0x80 ? static_cast<char>(name[i]) : '?';
+    }
+    ascii[i] = '\0';
+    return BadgeAtlas::NormalizeCode(ascii, code) > 0;
+}
\ No newline at end of file
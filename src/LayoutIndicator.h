@@ -0,0 +1,40 @@
+#pragma once
+#include <windows.h>
+#include <vector>
+#include "BadgeAtlas.h"
+
+// Tray icons showing the language of a keyboard layout. Each layout's icon
+// is composed from the badge atlas the first time it is shown in a theme
+// and kept until the icon size changes, so a layout switch only swaps
+// handles.
+class LayoutIndicator {
+public:
+    static const size_t MAX_LAYOUTS = 16;
+
+    LayoutIndicator();
+    ~LayoutIndicator();
+
+    LayoutIndicator(const LayoutIndicator&) = delete;
+    LayoutIndicator& operator=(const LayoutIndicator&) = delete;
+
+    // Rebuilds the atlas and drops cached icons when the size changes
+    void SetIconSize(int size);
+
+    // Owned by the indicator; nullptr when the layout has no language code
+    HICON GetIcon(HKL layout, bool dark);
+
+private:
+    struct Entry {
+        HKL layout;
+        HICON icons[BadgeAtlas::THEME_COUNT];
+    };
+
+    void Clear();
+    HICON CreateBadgeIcon(const char* code, BadgeAtlas::Theme theme);
+    static bool GetLanguageCode(HKL layout, char* code);
+
+    BadgeAtlas _atlas;
+    Entry _entries[MAX_LAYOUTS];
+    size_t _count;
+    std::vector<uint32_t> _pixels;
+};
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "LayoutMemory.h"
+#include <cstdio>
+#include "PerfectHash.h"
+
+LayoutMemory::LayoutMemory() : _count(0), _generation(0) {
+    Clear();
+}
+
+void LayoutMemory::Clear() {
+    for (Entry& entry : _entries) {
+        entry.key = NO_KEY;
+    }
+    _count = 0;
+}
+
+size_t LayoutMemory::Find(uint64_t key) const {
+    // Linear probing; the table is never more than three quarters full
+    size_t index = PerfectHash::Reduce(PerfectHash::Hash(key, 0), CAPACITY);
+    while (_entries[index].key != NO_KEY && _entries[index].key != key) {
+        index = (index + 1) % CAPACITY;
+    }
+    return index;
+}
+
+void LayoutMemory::Save(uint64_t key, HKL layout) {
+    if (key == NO_KEY || !layout) return;
+    ++_counters.saves;
+
+    size_t index = Find(key);
+    if (_entries[index].key == NO_KEY) {
+        if (_count >= CAPACITY * 3 / 4) {
+            Evict();
+            index = Find(key);
+        }
+        _entries[index].key = key;
+        ++_count;
+    }
+    _entries[index].layout = layout;
+    _entries[index].generation = ++_generation;
+}
+
+HKL LayoutMemory::Recall(uint64_t key) {
+    if (key == NO_KEY) return nullptr;
+    ++_counters.recalls;
+
+    size_t index = Find(key);
+    if (_entries[index].key == NO_KEY) return nullptr;
+    ++_counters.hits;
+    _entries[index].generation = ++_generation;
+    return _entries[index].layout;
+}
+
+void LayoutMemory::Evict() {
+    // Removing from a linear-probed table would leave holes in probe
+    // chains, so the survivors are put back into an empty table
+    size_t survivors = 0;
+    for (const Entry& entry : _entries) {
+        if (entry.key != NO_KEY && _generation - entry.generation < CAPACITY / 2) {
+            _survivors[survivors++] = entry;
+        }
+    }
+    _counters.evictions += _count - survivors;
+
+    Clear();
+    for (size_t i = 0; i < survivors; ++i) {
+        _entries[Find(_survivors[i].key)] = _survivors[i];
+    }
+    _count = survivors;
+}
+
+std::string LayoutMemory::Format() const {
+    char line[160];
+    double hitRate = _counters.recalls ? 100.0 * _counters.hits / _counters.recalls : 0.0;
+    snprintf(line, sizeof(line), "layout memory: %zu windows, %llu saves, %.1f%% recalled, %llu evicted\n",
+             _count, static_cast<unsigned long long>(_counters.saves), hitRate,
+             static_cast<unsigned long long>(_counters.evictions));
+    return line;
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "Win32Compat.h"
+
+// The layout each window, or each application, had when focus last left
+// it, so it can be put back when focus returns. Windows keeps a layout per
+// thread, which UWP, console and Electron windows share or lose.
+//
+// A fixed open-addressed table: saving and recalling never allocate. Every
+// save or recall stamps the entry with a new generation. Closed windows are
+// never touched again, so when the table is three quarters full the entries
+// not touched in the last CAPACITY / 2 generations are dropped, which frees
+// at least a quarter of it.
+// Owned by the UI thread; not thread-safe.
+class LayoutMemory {
+public:
+    static const size_t CAPACITY = 512;
+    static const uint64_t NO_KEY = 0;
+
+    struct Counters {
+        uint64_t saves = 0;
+        uint64_t recalls = 0;
+        uint64_t hits = 0;          // Recalls that found a layout
+        uint64_t evictions = 0;     // Entries dropped as stale
+    };
+
+    LayoutMemory();
+
+    // A window is keyed together with its thread, so a handle value reused
+    // by another thread's window does not inherit the old layout. Never
+    // NO_KEY for a window with a thread or a process id other than 0.
+    static uint64_t WindowKey(HWND window, uint32_t threadId) {
+        return (static_cast<uint64_t>(threadId) << 32) |
+               static_cast<uint32_t>(reinterpret_cast<uintptr_t>(window));
+    }
+    static uint64_t ProcessKey(uint32_t processId) { return processId; }
+
+    // Ignored for NO_KEY or a null layout
+    void Save(uint64_t key, HKL layout);
+
+    // Null when nothing is remembered for key
+    HKL Recall(uint64_t key);
+
+    void Clear();
+    size_t Count() const { return _count; }
+    const Counters& GetCounters() const { return _counters; }
+
+    // One line: entries, saves, recall hit rate, evictions
+    std::string Format() const;
+
+private:
+    struct Entry {
+        uint64_t key;               // NO_KEY when free
+        HKL layout;
+        uint32_t generation;
+    };
+
+    // Slot holding key, or the free slot where it would go
+    size_t Find(uint64_t key) const;
+    void Evict();
+
+    Entry _entries[CAPACITY];
+    Entry _survivors[CAPACITY];     // Scratch for Evict
+    size_t _count;
+    uint32_t _generation;
+    Counters _counters;
+};
\ No newline at end of file
@@ -0,0 +1,172 @@
+#include "LayoutRanker.h"
+#include <cstring>
+#include "TextUtils.h"
+
+namespace {
+
+const uint8_t NO_LETTER = 0xFF;
+
+} // namespace
+
+LayoutRanker::LayoutRanker() : _count(0) {
+    memset(_chars, 0, sizeof(_chars));
+    memset(_capsLanes, 0, sizeof(_capsLanes));
+    memset(_first, NO_LETTER, sizeof(_first));
+    memset(_end, 0, sizeof(_end));
+}
+
+bool LayoutRanker::IsCurrent(const LayoutCandidate* candidates, size_t count) const {
+    if (count != _count) return false;
+
+    // The app's layout cache recycles table slots, so compare what is in them
+    for (size_t i = 0; i < count; ++i) {
+        const LayoutCandidate& candidate = candidates[i];
+        if (candidate.table != _candidates[i].table ||
+            candidate.dictionary != _candidates[i].dictionary ||
+            candidate.trigrams != _candidates[i].trigrams ||
+            (candidate.table ? candidate.table->GetLayoutId() : 0) != _layoutIds[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void LayoutRanker::SetCandidates(const LayoutCandidate* candidates, size_t count) {
+    if (count > MAX_LAYOUTS) count = MAX_LAYOUTS;
+    if (IsCurrent(candidates, count)) return;
+
+    // Missing tables leave their lane zero: every key untranslatable
+    memset(_chars, 0, sizeof(_chars));
+    memset(_capsLanes, 0, sizeof(_capsLanes));
+
+    for (size_t lane = 0; lane < count; ++lane) {
+        _candidates[lane] = candidates[lane];
+        const LayoutTable* table = candidates[lane].table;
+        _layoutIds[lane] = table ? table->GetLayoutId() : 0;
+        if (!table) continue;
+
+        for (int key = 0; key < LayoutTable::KEY_COUNT; ++key) {
+            _chars[key * 2][lane] = ToLowerChar(table->Translate(key, false));
+            _chars[key * 2 + 1][lane] = ToLowerChar(table->Translate(key, true));
+            _capsLanes[key][lane] = table->IsCapsAffected(key) ? 1 : 0;
+        }
+    }
+    _count = count;
+}
+
+size_t LayoutRanker::Rank(const KeystrokeInfo* keystrokes, size_t count, size_t origin, Ranking* rankings) {
+    memset(_first, NO_LETTER, sizeof(_first));
+    memset(_end, 0, sizeof(_end));
+    if (count == 0 || count > MAX_WORD_LENGTH || _count == 0) {
+        return 0;
+    }
+
+    // Lane state lives in locals: stores through the member arrays could
+    // alias _text and keep the loop below scalar
+    const char16_t boundary = NgramTable::BOUNDARY;
+    alignas(32) uint8_t missing[MAX_LAYOUTS] = {};
+    alignas(32) uint8_t first[MAX_LAYOUTS];
+    alignas(32) uint8_t end[MAX_LAYOUTS] = {};
+    alignas(32) char16_t symbols[MAX_LAYOUTS];
+    char16_t c0[MAX_LAYOUTS];
+    char16_t c1[MAX_LAYOUTS];
+    int scores[MAX_LAYOUTS] = {};
+    memset(first, NO_LETTER, sizeof(first));
+    for (size_t lane = 0; lane < MAX_LAYOUTS; ++lane) {
+        c0[lane] = boundary;
+        c1[lane] = boundary;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        KeystrokeInfo keystroke = keystrokes[i];
+        int key = keystroke.VirtualKey();
+        const char16_t* normal = _chars[key * 2 + (keystroke.Shift() ? 1 : 0)];
+        const char16_t* flipped = _chars[key * 2 + (keystroke.Shift() ? 0 : 1)];
+        uint8_t capsLock = keystroke.CapsLock() ? 1 : 0;
+        const uint8_t* caps = _capsLanes[key];
+        char16_t* text = _text[i];
+        uint8_t position = static_cast<uint8_t>(i);
+
+        // Every lane, used or not, so the trip count is a constant
+        for (size_t lane = 0; lane < MAX_LAYOUTS; ++lane) {
+            char16_t shifted = flipped[lane];
+            char16_t ch = normal[lane];
+            ch = capsLock & caps[lane] ? shifted : ch;
+            bool letter = IsLetterChar(ch);
+            text[lane] = ch;
+            missing[lane] |= ch == 0;
+
+            // Letters move the word's bounds; masks rather than selects,
+            // which GCC will not if-convert across element widths
+            uint8_t mask = static_cast<uint8_t>(-static_cast<int>(letter));
+            uint8_t start = static_cast<uint8_t>((position & mask) | ~mask);
+            uint8_t stop = static_cast<uint8_t>((position + 1) & mask);
+            first[lane] = first[lane] < start ? first[lane] : start;
+            end[lane] = end[lane] > stop ? end[lane] : stop;
+            symbols[lane] = letter ? ch : boundary;
+        }
+
+        // A run of non-letters is one boundary, as in the model's corpus
+        for (size_t lane = 0; lane < _count; ++lane) {
+            char16_t ch = symbols[lane];
+            if (ch == boundary && c1[lane] == boundary) continue;
+
+            const NgramTable* trigrams = _candidates[lane].trigrams;
+            scores[lane] += trigrams ? trigrams->LogProb(c0[lane], c1[lane], ch) : UNMODELLED_LOG_PROB;
+            c0[lane] = c1[lane];
+            c1[lane] = ch;
+        }
+    }
+
+    memcpy(_first, first, sizeof(_first));
+    memcpy(_end, end, sizeof(_end));
+
+    size_t ranked = 0;
+    char16_t word[MAX_WORD_LENGTH];
+    for (size_t lane = 0; lane < _count; ++lane) {
+        if (missing[lane]) continue;
+
+        // The word ends too
+        const NgramTable* trigrams = _candidates[lane].trigrams;
+        if (c1[lane] != boundary) {
+            scores[lane] += trigrams ? trigrams->LogProb(c0[lane], c1[lane], boundary) : UNMODELLED_LOG_PROB;
+        }
+
+        const Dawg* dictionary = _candidates[lane].dictionary;
+        size_t length = dictionary ? Word(lane, word, MAX_WORD_LENGTH) : 0;
+
+        Ranking& ranking = rankings[ranked++];
+        ranking.candidate = lane;
+        ranking.score = scores[lane];
+        ranking.isWord = length > 0 && dictionary->Contains(word, length);
+    }
+
+    // At most MAX_LAYOUTS entries: insertion sort
+    size_t start = origin < _count ? origin : 0;
+    auto before = [this, start](const Ranking& a, const Ranking& b) {
+        if (a.isWord != b.isWord) return a.isWord;
+        if (a.score != b.score) return a.score > b.score;
+        return (a.candidate + _count - start) % _count < (b.candidate + _count - start) % _count;
+    };
+    for (size_t i = 1; i < ranked; ++i) {
+        Ranking ranking = rankings[i];
+        size_t j = i;
+        for (; j > 0 && before(ranking, rankings[j - 1]); --j) {
+            rankings[j] = rankings[j - 1];
+        }
+        rankings[j] = ranking;
+    }
+    return ranked;
+}
+
+size_t LayoutRanker::Word(size_t candidate, char16_t* word, size_t capacity) const {
+    if (candidate >= _count || _first[candidate] >= _end[candidate]) return 0;
+
+    size_t length = static_cast<size_t>(_end[candidate] - _first[candidate]);
+    if (length > capacity) return 0;
+
+    for (size_t i = 0; i < length; ++i) {
+        word[i] = _text[_first[candidate] + i][candidate];
+    }
+    return length;
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "Keystroke.h"
+#include "LayoutTable.h"
+#include "Dawg.h"
+#include "NgramTable.h"
+
+// One installed layout together with the language data of its language.
+// dictionary and trigrams may be null when no model is available for it.
+struct LayoutCandidate {
+    const LayoutTable* table;
+    const Dawg* dictionary;
+    const NgramTable* trigrams;
+};
+
+// Ranks every installed layout by how plausible the keystrokes read under
+// it, so a correction can go straight to the best one instead of the next.
+//
+// The candidates' tables are kept transposed: one row per (key, shift) with
+// a lane per layout, already case-folded. Each keystroke is translated,
+// classified and trimmed for all layouts at once in fixed-width loops the
+// compiler vectorizes; the trigram probes for that keystroke follow, one per
+// lane and independent of each other. Dictionaries are asked once at the end,
+// for the trimmed reading.
+// Not thread-safe, owned by the correction worker.
+class LayoutRanker {
+public:
+    static const size_t MAX_LAYOUTS = 16;
+    static const size_t MAX_WORD_LENGTH = 64;
+
+    // Trigram score of a layout without a model: a uniform guess over a
+    // 33-letter alphabet, so a model only wins by doing better than chance
+    static const int UNMODELLED_LOG_PROB = -3500;
+
+    struct Ranking {
+        size_t candidate;
+        int score;          // Summed scaled trigram log-probabilities
+        bool isWord;        // The trimmed reading is a dictionary word
+    };
+
+    LayoutRanker();
+
+    // Rebuilds the transposed tables when the candidates changed. Only the
+    // first MAX_LAYOUTS are used.
+    void SetCandidates(const LayoutCandidate* candidates, size_t count);
+
+    // Orders the candidates best first: dictionary words, then by score,
+    // ties by distance after origin in the list, so layouts nothing is known
+    // about keep the order the system cycles them in. Candidates under which
+    // a key has no character are left out. Returns the number ranked, 0 when
+    // the keystrokes are empty or longer than MAX_WORD_LENGTH.
+    size_t Rank(const KeystrokeInfo* keystrokes, size_t count, size_t origin, Ranking* rankings);
+
+    // Lower-cased reading of the last Rank under candidate, with surrounding
+    // punctuation and spaces trimmed. Returns its length.
+    size_t Word(size_t candidate, char16_t* word, size_t capacity) const;
+
+private:
+    static const size_t ROW_COUNT = LayoutTable::KEY_COUNT * 2;
+
+    bool IsCurrent(const LayoutCandidate* candidates, size_t count) const;
+
+    // Transposed tables: _chars[virtualKey * 2 + shift][lane], and whether
+    // Caps Lock affects the key in each lane
+    alignas(32) char16_t _chars[ROW_COUNT][MAX_LAYOUTS];
+    alignas(32) uint8_t _capsLanes[LayoutTable::KEY_COUNT][MAX_LAYOUTS];
+
+    LayoutCandidate _candidates[MAX_LAYOUTS];
+    uint32_t _layoutIds[MAX_LAYOUTS];
+    size_t _count;
+
+    // Last Rank: readings by keystroke, and where each one's letters start
+    // and end
+    alignas(32) char16_t _text[MAX_WORD_LENGTH][MAX_LAYOUTS];
+    uint8_t _first[MAX_LAYOUTS];
+    uint8_t _end[MAX_LAYOUTS];
+};
\ No newline at end of file
@@ -0,0 +1,175 @@
+#include "LayoutTable.h"
+#include <cstring>
+#include "Win32Compat.h"
+
+namespace {
+
+struct KeyDefinition {
+    int virtualKey;
+    char16_t normal;
+    char16_t shifted;
+};
+
+void WriteU16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(static_cast<uint8_t>(value & 0xFF));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+void WriteU32(std::vector<uint8_t>& out, uint32_t value) {
+    WriteU16(out, static_cast<uint16_t>(value & 0xFFFF));
+    WriteU16(out, static_cast<uint16_t>(value >> 16));
+}
+
+uint16_t ReadU16(const uint8_t* data) {
+    return static_cast<uint16_t>(data[0] | (data[1] << 8));
+}
+
+uint32_t ReadU32(const uint8_t* data) {
+    return ReadU16(data) | (static_cast<uint32_t>(ReadU16(data + 2)) << 16);
+}
+
+// Keys shared by both built-in layouts: space and the numeric keypad
+void SetCommonKeys(LayoutTable& table) {
+    table.SetKey(VK_SPACE, u' ', u' ', false);
+    for (int digit = 0; digit <= 9; ++digit) {
+        char16_t ch = static_cast<char16_t>(u'0' + digit);
+        table.SetKey(VK_NUMPAD0 + digit, ch, ch, false);
+    }
+}
+
+void SetKeys(LayoutTable& table, const KeyDefinition* keys, size_t count, bool capsAffected) {
+    for (size_t i = 0; i < count; ++i) {
+        table.SetKey(keys[i].virtualKey, keys[i].normal, keys[i].shifted, capsAffected);
+    }
+}
+
+} // namespace
+
+LayoutTable::LayoutTable() : LayoutTable(0) {
+}
+
+LayoutTable::LayoutTable(uint32_t layoutId) : _layoutId(layoutId) {
+    memset(_chars, 0, sizeof(_chars));
+    memset(_capsKeys, 0, sizeof(_capsKeys));
+}
+
+bool LayoutTable::FindKey(char16_t ch, int& virtualKey, bool& shift) const {
+    if (ch == 0) return false;
+
+    for (int i = 0; i < KEY_COUNT * 2; ++i) {
+        if (_chars[i] == ch) {
+            virtualKey = i / 2;
+            shift = (i & 1) != 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+void LayoutTable::SetKey(int virtualKey, char16_t normal, char16_t shifted, bool capsAffected) {
+    if (virtualKey < 0 || virtualKey >= KEY_COUNT) return;
+
+    _chars[virtualKey * 2] = normal;
+    _chars[virtualKey * 2 + 1] = shifted;
+
+    uint32_t bit = 1u << (virtualKey & 31);
+    if (capsAffected) {
+        _capsKeys[virtualKey >> 5] |= bit;
+    } else {
+        _capsKeys[virtualKey >> 5] &= ~bit;
+    }
+}
+
+std::vector<uint8_t> LayoutTable::Serialize() const {
+    std::vector<uint8_t> out;
+    out.reserve(SERIAL_SIZE);
+
+    WriteU32(out, SERIAL_MAGIC);
+    WriteU16(out, SERIAL_VERSION);
+    WriteU16(out, 0);
+    WriteU32(out, _layoutId);
+
+    for (char16_t ch : _chars) {
+        WriteU16(out, static_cast<uint16_t>(ch));
+    }
+    for (uint32_t bits : _capsKeys) {
+        WriteU32(out, bits);
+    }
+
+    return out;
+}
+
+bool LayoutTable::Deserialize(const uint8_t* data, size_t size, LayoutTable& table) {
+    if (!data || size < SERIAL_SIZE) return false;
+    if (ReadU32(data) != SERIAL_MAGIC || ReadU16(data + 4) != SERIAL_VERSION) return false;
+
+    table._layoutId = ReadU32(data + 8);
+
+    const uint8_t* cursor = data + SERIAL_HEADER_SIZE;
+    for (char16_t& ch : table._chars) {
+        ch = static_cast<char16_t>(ReadU16(cursor));
+        cursor += 2;
+    }
+    for (uint32_t& bits : table._capsKeys) {
+        bits = ReadU32(cursor);
+        cursor += 4;
+    }
+
+    return true;
+}
+
+LayoutTable LayoutTable::EnglishUS() {
+    LayoutTable table(LAYOUT_EN_US);
+    SetCommonKeys(table);
+
+    for (int vk = 'A'; vk <= 'Z'; ++vk) {
+        table.SetKey(vk, static_cast<char16_t>(vk - 'A' + u'a'), static_cast<char16_t>(vk), true);
+    }
+
+    static const KeyDefinition symbols[] = {
+        { '1', u'1', u'!' }, { '2', u'2', u'@' }, { '3', u'3', u'#' }, { '4', u'4', u'$' },
+        { '5', u'5', u'%' }, { '6', u'6', u'^' }, { '7', u'7', u'&' }, { '8', u'8', u'*' },
+        { '9', u'9', u'(' }, { '0', u'0', u')' },
+        { VK_OEM_MINUS, u'-', u'_' }, { VK_OEM_PLUS, u'=', u'+' },
+        { VK_OEM_3, u'`', u'~' }, { VK_OEM_4, u'[', u'{' }, { VK_OEM_6, u']', u'}' },
+        { VK_OEM_5, u'\\', u'|' }, { VK_OEM_102, u'\\', u'|' },
+        { VK_OEM_1, u';', u':' }, { VK_OEM_7, u'\'', u'"' },
+        { VK_OEM_COMMA, u',', u'<' }, { VK_OEM_PERIOD, u'.', u'>' }, { VK_OEM_2, u'/', u'?' },
+    };
+    SetKeys(table, symbols, sizeof(symbols) / sizeof(symbols[0]), false);
+
+    return table;
+}
+
+LayoutTable LayoutTable::RussianRU() {
+    LayoutTable table(LAYOUT_RU_RU);
+    SetCommonKeys(table);
+
+    // JCUKEN letters, written as escapes so the source stays ASCII
+    static const KeyDefinition letters[] = {
+        { 'Q', u'\u0439', u'\u0419' }, { 'W', u'\u0446', u'\u0426' }, { 'E', u'\u0443', u'\u0423' },
+        { 'R', u'\u043A', u'\u041A' }, { 'T', u'\u0435', u'\u0415' }, { 'Y', u'\u043D', u'\u041D' },
+        { 'U', u'\u0433', u'\u0413' }, { 'I', u'\u0448', u'\u0428' }, { 'O', u'\u0449', u'\u0429' },
+        { 'P', u'\u0437', u'\u0417' }, { VK_OEM_4, u'\u0445', u'\u0425' }, { VK_OEM_6, u'\u044A', u'\u042A' },
+        { 'A', u'\u0444', u'\u0424' }, { 'S', u'\u044B', u'\u042B' }, { 'D', u'\u0432', u'\u0412' },
+        { 'F', u'\u0430', u'\u0410' }, { 'G', u'\u043F', u'\u041F' }, { 'H', u'\u0440', u'\u0420' },
+        { 'J', u'\u043E', u'\u041E' }, { 'K', u'\u043B', u'\u041B' }, { 'L', u'\u0434', u'\u0414' },
+        { VK_OEM_1, u'\u0436', u'\u0416' }, { VK_OEM_7, u'\u044D', u'\u042D' },
+        { 'Z', u'\u044F', u'\u042F' }, { 'X', u'\u0447', u'\u0427' }, { 'C', u'\u0441', u'\u0421' },
+        { 'V', u'\u043C', u'\u041C' }, { 'B', u'\u0438', u'\u0418' }, { 'N', u'\u0442', u'\u0422' },
+        { 'M', u'\u044C', u'\u042C' }, { VK_OEM_COMMA, u'\u0431', u'\u0411' },
+        { VK_OEM_PERIOD, u'\u044E', u'\u042E' }, { VK_OEM_3, u'\u0451', u'\u0401' },
+    };
+    SetKeys(table, letters, sizeof(letters) / sizeof(letters[0]), true);
+
+    static const KeyDefinition symbols[] = {
+        { '1', u'1', u'!' }, { '2', u'2', u'"' }, { '3', u'3', u'\u2116' }, { '4', u'4', u';' },
+        { '5', u'5', u'%' }, { '6', u'6', u':' }, { '7', u'7', u'?' }, { '8', u'8', u'*' },
+        { '9', u'9', u'(' }, { '0', u'0', u')' },
+        { VK_OEM_MINUS, u'-', u'_' }, { VK_OEM_PLUS, u'=', u'+' },
+        { VK_OEM_5, u'\\', u'/' }, { VK_OEM_102, u'\\', u'/' }, { VK_OEM_2, u'.', u',' },
+    };
+    SetKeys(table, symbols, sizeof(symbols) / sizeof(symbols[0]), false);
+
+    return table;
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Flat (virtual key, shift) -> character map for one keyboard layout.
+// The whole table is 1 KB of characters plus a 32-byte Caps Lock bitset, so
+// a lookup is a single indexed load. Tables are built from the live layout on
+// Windows and can be serialized so the same data is usable off Windows.
+class LayoutTable {
+public:
+    static const int KEY_COUNT = 256;
+    static const uint32_t LAYOUT_EN_US = 0x04090409;
+    static const uint32_t LAYOUT_RU_RU = 0x04190419;
+
+    LayoutTable();
+    explicit LayoutTable(uint32_t layoutId);
+
+    uint32_t GetLayoutId() const { return _layoutId; }
+
+    // Returns 0 when the key produces no single character (dead keys,
+    // non-character keys)
+    char16_t Translate(int virtualKey, bool shift) const {
+        if (virtualKey < 0 || virtualKey >= KEY_COUNT) return 0;
+        return _chars[virtualKey * 2 + (shift ? 1 : 0)];
+    }
+
+    // Caps Lock inverts Shift on keys the layout marks as letters
+    char16_t Translate(int virtualKey, bool shift, bool capsLock) const {
+        if (capsLock && IsCapsAffected(virtualKey)) shift = !shift;
+        return Translate(virtualKey, shift);
+    }
+
+    bool IsCapsAffected(int virtualKey) const {
+        if (virtualKey < 0 || virtualKey >= KEY_COUNT) return false;
+        return (_capsKeys[virtualKey >> 5] >> (virtualKey & 31)) & 1;
+    }
+
+    // Reverse lookup, used to map text back onto keys
+    bool FindKey(char16_t ch, int& virtualKey, bool& shift) const;
+
+    void SetKey(int virtualKey, char16_t normal, char16_t shifted, bool capsAffected);
+
+    // Portable little-endian form: header, characters, Caps Lock bitset
+    std::vector<uint8_t> Serialize() const;
+    static bool Deserialize(const uint8_t* data, size_t size, LayoutTable& table);
+
+    // Built-in tables for the two layouts the project ships with
+    static LayoutTable EnglishUS();
+    static LayoutTable RussianRU();
+
+private:
+    static const uint32_t SERIAL_MAGIC = 0x544C534B;  // "KSLT"
+    static const uint16_t SERIAL_VERSION = 1;
+    static const size_t SERIAL_HEADER_SIZE = 12;
+    static const size_t SERIAL_SIZE = SERIAL_HEADER_SIZE + KEY_COUNT * 2 * 2 + KEY_COUNT / 8;
+
+    uint32_t _layoutId;
+    char16_t _chars[KEY_COUNT * 2];
+    uint32_t _capsKeys[KEY_COUNT / 32];
+};
\ No newline at end of file
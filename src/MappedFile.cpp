@@ -0,0 +1,122 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+    : _data(nullptr), _size(0),
+#ifdef _WIN32
+      _file(INVALID_HANDLE_VALUE), _mapping(nullptr) {
+#else
+      _fd(-1) {
+#endif
+}
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+NativePath MappedFile::PathFromUtf8(const std::string& path) {
+#ifdef _WIN32
+    int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), static_cast<int>(path.size()), nullptr, 0);
+    std::wstring result(length, L'\0');
+    if (length > 0) {
+        MultiByteToWideChar(CP_UTF8, 0, path.c_str(), static_cast<int>(path.size()), &result[0], length);
+    }
+    return result;
+#else
+    return path;
+#endif
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const NativePath& path) {
+    Close();
+
+    _file = CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (_file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(_file, &fileSize) || fileSize.QuadPart == 0) {
+        Close();
+        return false;
+    }
+
+    _mapping = CreateFileMapping(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!_mapping) {
+        Close();
+        return false;
+    }
+
+    _data = static_cast<const uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!_data) {
+        Close();
+        return false;
+    }
+
+    _size = static_cast<size_t>(fileSize.QuadPart);
+    return true;
+}
+
+void MappedFile::Close() {
+    if (_data) {
+        UnmapViewOfFile(_data);
+        _data = nullptr;
+    }
+    if (_mapping) {
+        CloseHandle(_mapping);
+        _mapping = nullptr;
+    }
+    if (_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(_file);
+        _file = INVALID_HANDLE_VALUE;
+    }
+    _size = 0;
+}
+
+#else
+
+bool MappedFile::Open(const NativePath& path) {
+    Close();
+
+    _fd = open(path.c_str(), O_RDONLY);
+    if (_fd < 0) return false;
+
+    struct stat info;
+    if (fstat(_fd, &info) != 0 || info.st_size == 0) {
+        Close();
+        return false;
+    }
+
+    void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, _fd, 0);
+    if (data == MAP_FAILED) {
+        Close();
+        return false;
+    }
+
+    _data = static_cast<const uint8_t*>(data);
+    _size = static_cast<size_t>(info.st_size);
+    return true;
+}
+
+void MappedFile::Close() {
+    if (_data) {
+        munmap(const_cast<uint8_t*>(_data), _size);
+        _data = nullptr;
+    }
+    if (_fd >= 0) {
+        close(_fd);
+        _fd = -1;
+    }
+    _size = 0;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+using NativePath = std::wstring;
+#else
+using NativePath = std::string;
+#endif
+
+// Read-only memory mapping of a whole file. Data stays valid until Close()
+// or destruction, so structures can point straight into it.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const NativePath& path);
+    void Close();
+
+    // Command-line tools take UTF-8 paths on every platform
+    static NativePath PathFromUtf8(const std::string& path);
+
+    bool IsOpen() const { return _data != nullptr; }
+    const uint8_t* Data() const { return _data; }
+    size_t Size() const { return _size; }
+
+private:
+    const uint8_t* _data;
+    size_t _size;
+#ifdef _WIN32
+    void* _file;
+    void* _mapping;
+#else
+    int _fd;
+#endif
+};
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include "ModifierState.h"
+
+uint16_t ModifierState::KeyBit(const KBDLLHOOKSTRUCT& event) {
+    bool extended = (event.flags & LLKHF_EXTENDED) != 0;
+
+    switch (event.vkCode) {
+        case VK_LSHIFT:   return LEFT_SHIFT;
+        case VK_RSHIFT:   return RIGHT_SHIFT;
+        case VK_SHIFT:    return (event.scanCode & 0xFF) == RIGHT_SHIFT_SCAN_CODE ? RIGHT_SHIFT : LEFT_SHIFT;
+        case VK_LCONTROL: return event.scanCode == ALT_GR_CTRL_SCAN_CODE ? ALT_GR : LEFT_CTRL;
+        case VK_RCONTROL: return RIGHT_CTRL;
+        case VK_CONTROL:  return extended ? RIGHT_CTRL : LEFT_CTRL;
+        case VK_LMENU:    return LEFT_ALT;
+        case VK_RMENU:    return RIGHT_ALT;
+        case VK_MENU:     return extended ? RIGHT_ALT : LEFT_ALT;
+        case VK_LWIN:     return LEFT_WIN;
+        case VK_RWIN:     return RIGHT_WIN;
+        case VK_CAPITAL:  return CAPS_LOCK_KEY;
+        case VK_NUMLOCK:  return NUM_LOCK_KEY;
+        default:          return 0;
+    }
+}
+
+void ModifierState::Update(UINT message, const KBDLLHOOKSTRUCT& event) {
+    uint16_t previous = static_cast<uint16_t>(_word.load(std::memory_order_relaxed));
+    uint16_t bits = previous;
+    uint16_t key = KeyBit(event);
+    bool keyDown = message == WM_KEYDOWN || message == WM_SYSKEYDOWN;
+
+    if (keyDown) {
+        // Lock keys toggle on the press, not on auto-repeat
+        if (key == CAPS_LOCK_KEY && !(bits & CAPS_LOCK_KEY)) bits ^= CAPS_LOCK;
+        if (key == NUM_LOCK_KEY && !(bits & NUM_LOCK_KEY)) bits ^= NUM_LOCK;
+        bits |= key;
+    } else {
+        bits &= ~key;
+        // AltGr ends with Right Alt even if the fake Ctrl release is lost
+        if (key == RIGHT_ALT) bits &= ~ALT_GR;
+    }
+
+    Store(bits, previous);
+}
+
+void ModifierState::Resync(const uint8_t keyState[256]) {
+    uint16_t previous = static_cast<uint16_t>(_word.load(std::memory_order_relaxed));
+    uint16_t bits = 0;
+
+    struct KeyMapping {
+        uint8_t virtualKey;
+        uint16_t bit;
+    };
+    static const KeyMapping heldKeys[] = {
+        { VK_LSHIFT, LEFT_SHIFT }, { VK_RSHIFT, RIGHT_SHIFT },
+        { VK_LCONTROL, LEFT_CTRL }, { VK_RCONTROL, RIGHT_CTRL },
+        { VK_LMENU, LEFT_ALT }, { VK_RMENU, RIGHT_ALT },
+        { VK_LWIN, LEFT_WIN }, { VK_RWIN, RIGHT_WIN },
+        { VK_CAPITAL, CAPS_LOCK_KEY }, { VK_NUMLOCK, NUM_LOCK_KEY },
+    };
+    for (const auto& mapping : heldKeys) {
+        if (keyState[mapping.virtualKey] & 0x80) bits |= mapping.bit;
+    }
+    if (keyState[VK_CAPITAL] & 0x01) bits |= CAPS_LOCK;
+    if (keyState[VK_NUMLOCK] & 0x01) bits |= NUM_LOCK;
+
+    // The OS reports AltGr as Left Ctrl + Right Alt. Keep AltGr if it was
+    // already known, the two cannot be told apart from key state alone.
+    if ((previous & ALT_GR) && (bits & RIGHT_ALT) && (bits & LEFT_CTRL)) {
+        bits = static_cast<uint16_t>((bits & ~LEFT_CTRL) | ALT_GR);
+    }
+
+    Store(bits, previous);
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include "Win32Compat.h"
+
+// Modifier keys as seen by the low-level hook, tracked from the event stream
+// instead of asking GetKeyState for each key. The state and the bits the
+// latest event changed share one 32-bit word, so a handler reads everything
+// it needs with a single load.
+//
+// Update and Resync run on the hook thread only; other threads may Load.
+class ModifierState {
+public:
+    enum Bits : uint16_t {
+        LEFT_SHIFT     = 0x0001,
+        RIGHT_SHIFT    = 0x0002,
+        LEFT_CTRL      = 0x0004,
+        RIGHT_CTRL     = 0x0008,
+        LEFT_ALT       = 0x0010,
+        RIGHT_ALT      = 0x0020,
+        LEFT_WIN       = 0x0040,
+        RIGHT_WIN      = 0x0080,
+        ALT_GR         = 0x0100,    // Right Alt on layouts where it means AltGr
+        CAPS_LOCK      = 0x0200,    // Toggle states
+        NUM_LOCK       = 0x0400,
+        CAPS_LOCK_KEY  = 0x0800,    // Lock keys held, so auto-repeat does not
+        NUM_LOCK_KEY   = 0x1000,    // toggle them again
+
+        SHIFT = LEFT_SHIFT | RIGHT_SHIFT,
+        CTRL  = LEFT_CTRL | RIGHT_CTRL,
+        ALT   = LEFT_ALT | RIGHT_ALT,
+        WIN   = LEFT_WIN | RIGHT_WIN
+    };
+
+    struct Snapshot {
+        uint16_t bits;
+        uint16_t changed;   // Bits flipped by the most recent event
+
+        bool Any(uint16_t mask) const { return (bits & mask) != 0; }
+        bool Changed(uint16_t mask) const { return (changed & mask) != 0; }
+    };
+
+    ModifierState() : _word(0), _resyncRequested(false) {}
+
+    Snapshot Load() const {
+        uint32_t word = _word.load(std::memory_order_relaxed);
+        return { static_cast<uint16_t>(word), static_cast<uint16_t>(word >> 16) };
+    }
+
+    // Feeds one WH_KEYBOARD_LL event; non-modifier keys only clear changed
+    void Update(UINT message, const KBDLLHOOKSTRUCT& event);
+
+    // Replaces the tracked state with a GetKeyboardState-style array
+    // (0x80 = down, 0x01 = toggled). Keys released while another window had
+    // focus, or while the hook was not running, are only caught this way.
+    void Resync(const uint8_t keyState[256]);
+
+    // Asks the hook thread to resync on its next event, e.g. on focus change
+    void RequestResync() { _resyncRequested.store(true, std::memory_order_relaxed); }
+    bool TakeResyncRequest() {
+        // Plain load first, the exchange is only paid when a request is pending
+        return _resyncRequested.load(std::memory_order_relaxed) &&
+               _resyncRequested.exchange(false, std::memory_order_relaxed);
+    }
+
+    // Bit for a modifier key event, 0 for other keys. Generic VK_SHIFT,
+    // VK_CONTROL and VK_MENU are resolved to a side from the scan code and
+    // extended flag.
+    static uint16_t KeyBit(const KBDLLHOOKSTRUCT& event);
+
+private:
+    static const DWORD RIGHT_SHIFT_SCAN_CODE = 0x36;
+    static const DWORD ALT_GR_CTRL_SCAN_CODE = 0x21D;   // Fake Left Ctrl sent with AltGr
+
+    void Store(uint16_t bits, uint16_t previous) {
+        _word.store(bits | (static_cast<uint32_t>(bits ^ previous) << 16), std::memory_order_relaxed);
+    }
+
+    std::atomic<uint32_t> _word;
+    std::atomic<bool> _resyncRequested;
+};
\ No newline at end of file
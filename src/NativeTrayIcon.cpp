@@ -4,9 +4,6 @@
 NativeTrayIcon::NativeTrayIcon(HWND hWnd, HICON hIcon, const std::wstring& tooltip, MenuItemCallback callback)
     : _hWnd(hWnd), _menuItemCallback(callback) {
     
-    // Enable dark mode support
-    EnableDarkMode();
-    
     // Create popup menu
     _hMenu = CreatePopupMenu();
     
@@ -53,6 +50,18 @@ void NativeTrayIcon::UpdateMenuItem(int id, bool isChecked) {
     CheckMenuItem(_hMenu, id, isChecked ? MF_CHECKED : MF_UNCHECKED);
 }
 
+void NativeTrayIcon::SetIcon(HICON hIcon) {
+    NOTIFYICONDATA nid = {};
+    nid.cbSize = sizeof(nid);
+    nid.hWnd = _hWnd;
+    nid.uID = _notifyIconData.uID;
+    nid.uFlags = NIF_ICON;
+    nid.hIcon = hIcon;
+    
+    Shell_NotifyIcon(NIM_MODIFY, &nid);
+    _notifyIconData.hIcon = hIcon;
+}
+
 void NativeTrayIcon::ShowContextMenu() {
     POINT pt;
     GetCursorPos(&pt);
@@ -96,59 +105,30 @@ void NativeTrayIcon::ProcessWindowMessage(UINT message, WPARAM wParam, LPARAM lP
 
 void NativeTrayIcon::EnableDarkMode() {
     try {
-        if (IsSystemInDarkMode()) {
-            // Load uxtheme.dll and get function pointers
-            HMODULE hUxtheme = LoadLibrary(L"uxtheme.dll");
-            if (hUxtheme) {
-                // Use ordinal numbers for undocumented functions
-                _setPreferredAppMode = reinterpret_cast<fnSetPreferredAppMode>(
-                    GetProcAddress(hUxtheme, MAKEINTRESOURCEA(135)));
-                    
-                _allowDarkModeForWindow = reinterpret_cast<fnAllowDarkModeForWindow>(
-                    GetProcAddress(hUxtheme, MAKEINTRESOURCEA(133)));
-                    
-                _flushMenuThemes = reinterpret_cast<fnFlushMenuThemes>(
-                    GetProcAddress(hUxtheme, MAKEINTRESOURCEA(136)));
+        // Load uxtheme.dll and get function pointers
+        HMODULE hUxtheme = LoadLibrary(L"uxtheme.dll");
+        if (hUxtheme) {
+            // Use ordinal numbers for undocumented functions
+            _setPreferredAppMode = reinterpret_cast<fnSetPreferredAppMode>(
+                GetProcAddress(hUxtheme, MAKEINTRESOURCEA(135)));
                 
-                // Enable dark mode
-                if (_setPreferredAppMode) {
-                    _setPreferredAppMode(PreferredAppMode::AllowDark);
-                }
+            _allowDarkModeForWindow = reinterpret_cast<fnAllowDarkModeForWindow>(
+                GetProcAddress(hUxtheme, MAKEINTRESOURCEA(133)));
                 
-                if (_allowDarkModeForWindow) {
-                    _allowDarkModeForWindow(_hWnd, true);
-                }
-            }
-        }
-    }
-    catch (...) {
-        // Ignore errors - fallback to default appearance
-    }
-}
-
-bool NativeTrayIcon::IsSystemInDarkMode() const {
-    try {
-        HKEY hKey;
-        if (RegOpenKeyEx(HKEY_CURRENT_USER, 
-                        L"Software\\Microsoft\\Windows\\CurrentVersion\\Themes\\Personalize",
-                        0, KEY_READ, &hKey) == ERROR_SUCCESS) {
-            
-            DWORD value = 0;
-            DWORD valueSize = sizeof(value);
-            DWORD type;
+            _flushMenuThemes = reinterpret_cast<fnFlushMenuThemes>(
+                GetProcAddress(hUxtheme, MAKEINTRESOURCEA(136)));
             
-            LONG result = RegQueryValueEx(hKey, L"AppsUseLightTheme", nullptr, 
-                                        &type, reinterpret_cast<BYTE*>(&value), &valueSize);
-            
-            RegCloseKey(hKey);
+            // Enable dark mode
+            if (_setPreferredAppMode) {
+                _setPreferredAppMode(PreferredAppMode::AllowDark);
+            }
             
-            // Dark mode is enabled when AppsUseLightTheme is 0
-            return (result == ERROR_SUCCESS && type == REG_DWORD && value == 0);
+            if (_allowDarkModeForWindow) {
+                _allowDarkModeForWindow(_hWnd, true);
+            }
         }
     }
     catch (...) {
-        // Default to light mode on error
+        // Ignore errors - fallback to default appearance
     }
-    
-    return false;
 }
\ No newline at end of file
@@ -14,19 +14,23 @@ public:
     void AddMenuItem(int id, const std::wstring& text, bool isChecked = false, bool isEnabled = true);
     void AddSeparator();
     void UpdateMenuItem(int id, bool isChecked);
+    void SetIcon(HICON hIcon);
     void ShowContextMenu();
     void ProcessWindowMessage(UINT message, WPARAM wParam, LPARAM lParam);
     
+    // Lets popup menus follow a dark system theme. Loads uxtheme.dll, so
+    // callers check the theme first and do it after startup.
+    void EnableDarkMode();
+    
     // Constants for menu IDs
     static const int MENU_TEXT_CORRECTION = 1;
     static const int MENU_LAYOUT_SWITCH = 2;
     static const int MENU_AUTO_START = 3;
     static const int MENU_EXIT = 4;
+    static const int MENU_RECORD_TRACE = 5;
+    static const int MENU_DIAGNOSTICS = 6;
 
 private:
-    void EnableDarkMode();
-    bool IsSystemInDarkMode() const;
-    
     // Dark mode function types
     enum class PreferredAppMode {
         Default = 0,
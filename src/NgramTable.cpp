@@ -0,0 +1,118 @@
+#include "NgramTable.h"
+#include <cmath>
+#include <cstring>
+#include "TextUtils.h"
+
+static_assert(sizeof(NgramHeader) == 16, "NgramHeader layout is part of the file format");
+
+NgramTable::NgramTable()
+    : _fingerprints(nullptr), _logProbs(nullptr), _ngramCount(0), _unknownLogProb(0) {
+}
+
+size_t NgramTable::Attach(const uint8_t* data, size_t size) {
+    _logProbs = nullptr;
+    if (!data || size < sizeof(NgramHeader)) return 0;
+
+    NgramHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.order != ORDER) return 0;
+
+    size_t offset = sizeof(NgramHeader);
+    size_t hashSize = _hash.Attach(data + offset, size - offset);
+    if (hashSize == 0) return 0;
+    offset += hashSize;
+
+    size_t slotCount = _hash.SlotCount();
+    size_t tablesSize = slotCount * sizeof(uint32_t) + ((slotCount * sizeof(int16_t) + 7) & ~static_cast<size_t>(7));
+    if (size - offset < tablesSize) return 0;
+
+    _fingerprints = reinterpret_cast<const uint32_t*>(data + offset);
+    _logProbs = reinterpret_cast<const int16_t*>(data + offset + slotCount * sizeof(uint32_t));
+    _ngramCount = header.ngramCount;
+    _unknownLogProb = header.unknownLogProb;
+    return offset + tablesSize;
+}
+
+char16_t NgramTable::Normalize(char16_t ch) {
+    return IsLetterChar(ch) ? ToLowerChar(ch) : BOUNDARY;
+}
+
+NgramTableBuilder::NgramTableBuilder() {
+}
+
+void NgramTableBuilder::AddText(const char16_t* text, size_t length, uint64_t weight) {
+    const char16_t boundary = NgramTable::BOUNDARY;
+    char16_t c0 = boundary;
+    char16_t c1 = boundary;
+
+    for (size_t i = 0; i < length; ++i) {
+        char16_t ch = NgramTable::Normalize(text[i]);
+        if (ch == boundary && c1 == boundary) continue;
+
+        AddTrigram(c0, c1, ch, weight);
+        c0 = c1;
+        c1 = ch;
+    }
+
+    if (c1 != boundary) {
+        AddTrigram(c0, c1, boundary, weight);
+    }
+}
+
+void NgramTableBuilder::AddTrigram(char16_t c0, char16_t c1, char16_t c2, uint64_t weight) {
+    _trigrams[NgramTable::Key(c0, c1, c2)] += weight;
+    _contexts[NgramTable::Key(c0, c1, 0)] += weight;
+}
+
+std::vector<uint8_t> NgramTableBuilder::Serialize() const {
+    std::vector<uint64_t> keys;
+    std::vector<int16_t> values;
+    keys.reserve(_trigrams.size());
+    values.reserve(_trigrams.size());
+
+    int lowest = 0;
+    for (const auto& trigram : _trigrams) {
+        uint64_t context = _contexts.at(trigram.first & 0xFFFFFFFFull);
+        double logProb = std::log(static_cast<double>(trigram.second) / static_cast<double>(context));
+        int scaled = static_cast<int>(std::lround(logProb * NgramTable::LOG_PROB_SCALE));
+        if (scaled < -32000) scaled = -32000;
+        keys.push_back(trigram.first);
+        values.push_back(static_cast<int16_t>(scaled));
+        if (scaled < lowest) lowest = scaled;
+    }
+
+    // Unseen trigrams score one nat below the rarest seen one
+    int unknown = lowest - NgramTable::LOG_PROB_SCALE;
+    if (unknown < -32000) unknown = -32000;
+
+    std::vector<uint8_t> hashBlock;
+    std::vector<uint32_t> slots;
+    PerfectHashBuilder::Build(keys, hashBlock, slots);
+    uint32_t slotCount;
+    memcpy(&slotCount, hashBlock.data() + 4, sizeof(slotCount));
+
+    // Free slots keep the unknown score, so a stray fingerprint match there is harmless
+    std::vector<uint32_t> fingerprints(slotCount, 0);
+    std::vector<int16_t> logProbs(slotCount, static_cast<int16_t>(unknown));
+    for (size_t i = 0; i < keys.size(); ++i) {
+        fingerprints[slots[i]] = NgramTable::Fingerprint(keys[i]);
+        logProbs[slots[i]] = values[i];
+    }
+
+    NgramHeader header = {};
+    header.order = NgramTable::ORDER;
+    header.ngramCount = static_cast<uint32_t>(keys.size());
+    header.unknownLogProb = static_cast<int16_t>(unknown);
+
+    size_t probBytes = (slotCount * sizeof(int16_t) + 7) & ~static_cast<size_t>(7);
+    std::vector<uint8_t> out(sizeof(header) + hashBlock.size() + slotCount * sizeof(uint32_t) + probBytes, 0);
+    uint8_t* cursor = out.data();
+    memcpy(cursor, &header, sizeof(header));
+    cursor += sizeof(header);
+    memcpy(cursor, hashBlock.data(), hashBlock.size());
+    cursor += hashBlock.size();
+    memcpy(cursor, fingerprints.data(), slotCount * sizeof(uint32_t));
+    cursor += slotCount * sizeof(uint32_t);
+    memcpy(cursor, logProbs.data(), slotCount * sizeof(int16_t));
+    return out;
+}
\ No newline at end of file
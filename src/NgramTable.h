@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "PerfectHash.h"
+
+// Character trigram log-probabilities, log P(c2 | c0 c1), indexed by a
+// perfect hash. Text is lower-cased and every run of non-letters collapses
+// to a single BOUNDARY character, so word starts and ends are modelled too.
+//
+// Layout (little-endian):
+//   NgramHeader
+//   PerfectHash block
+//   uint32 fingerprints[slotCount]
+//   int16  logProbs[slotCount], padded to a multiple of 8 bytes
+struct NgramHeader {
+    uint16_t order;
+    uint16_t reserved;
+    uint32_t ngramCount;
+    int16_t unknownLogProb;
+    int16_t reserved2;
+    uint32_t padding;
+};
+
+class NgramTable {
+public:
+    static const int ORDER = 3;
+    static const int LOG_PROB_SCALE = 1000;     // Stored values are nats * 1000
+    static const char16_t BOUNDARY = u' ';
+
+    NgramTable();
+
+    // Returns the number of bytes used, 0 on error
+    size_t Attach(const uint8_t* data, size_t size);
+
+    bool IsValid() const { return _logProbs != nullptr; }
+    uint32_t NgramCount() const { return _ngramCount; }
+    int UnknownLogProb() const { return _unknownLogProb; }
+
+    // Scaled log-probability of c2 following c0 c1
+    int LogProb(char16_t c0, char16_t c1, char16_t c2) const {
+        uint64_t key = Key(c0, c1, c2);
+        uint32_t slot = _hash.Slot(key);
+        if (_fingerprints[slot] != Fingerprint(key)) return _unknownLogProb;
+        return _logProbs[slot];
+    }
+
+    static uint64_t Key(char16_t c0, char16_t c1, char16_t c2) {
+        return static_cast<uint64_t>(c0) | (static_cast<uint64_t>(c1) << 16) | (static_cast<uint64_t>(c2) << 32);
+    }
+
+    static uint32_t Fingerprint(uint64_t key) {
+        return PerfectHash::Hash(key, FINGERPRINT_SEED);
+    }
+
+    // Folds a character into the model alphabet: lower-case letter or BOUNDARY
+    static char16_t Normalize(char16_t ch);
+
+private:
+    static const uint32_t FINGERPRINT_SEED = 0x5EED;
+
+    PerfectHash _hash;
+    const uint32_t* _fingerprints;
+    const int16_t* _logProbs;
+    uint32_t _ngramCount;
+    int _unknownLogProb;
+};
+
+class NgramTableBuilder {
+public:
+    NgramTableBuilder();
+
+    // Counts every trigram in text, each occurrence weighted by weight
+    void AddText(const char16_t* text, size_t length, uint64_t weight = 1);
+
+    size_t NgramCount() const { return _trigrams.size(); }
+    std::vector<uint8_t> Serialize() const;
+
+private:
+    void AddTrigram(char16_t c0, char16_t c1, char16_t c2, uint64_t weight);
+
+    std::unordered_map<uint64_t, uint64_t> _trigrams;
+    std::unordered_map<uint64_t, uint64_t> _contexts;
+};
\ No newline at end of file
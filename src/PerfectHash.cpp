@@ -0,0 +1,99 @@
+#include "PerfectHash.h"
+#include <algorithm>
+#include <cstring>
+
+PerfectHash::PerfectHash() : _seeds(nullptr), _bucketCount(0), _slotCount(0) {
+}
+
+size_t PerfectHash::Attach(const uint8_t* data, size_t size) {
+    _seeds = nullptr;
+    if (!data || size < 8 || reinterpret_cast<uintptr_t>(data) % 4 != 0) return 0;
+
+    uint32_t header[2];
+    memcpy(header, data, sizeof(header));
+    if (header[0] == 0 || header[1] == 0) return 0;
+
+    size_t used = 8 + ((static_cast<size_t>(header[0]) * 2 + 3) & ~static_cast<size_t>(3));
+    if (size < used) return 0;
+
+    _bucketCount = header[0];
+    _slotCount = header[1];
+    _seeds = reinterpret_cast<const uint16_t*>(data + 8);
+    return used;
+}
+
+bool PerfectHashBuilder::Build(const std::vector<uint64_t>& keys, std::vector<uint8_t>& out,
+                               std::vector<uint32_t>& slots) {
+    std::vector<uint64_t> sorted(keys);
+    std::sort(sorted.begin(), sorted.end());
+    if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) return false;
+
+    // Average bucket of four keys in slots 80% full; each failed attempt
+    // adds headroom
+    uint32_t count = static_cast<uint32_t>(keys.size());
+    uint32_t bucketCount = std::max<uint32_t>(1, count / 4);
+    uint32_t slotCount = std::max<uint32_t>(1, count + count / 4);
+    std::vector<uint16_t> seeds;
+
+    while (!TryBuild(keys, bucketCount, slotCount, seeds, slots)) {
+        slotCount += slotCount / 8 + 1;
+    }
+
+    out.clear();
+    uint32_t header[2] = { bucketCount, slotCount };
+    out.resize(8 + ((bucketCount * 2 + 3) & ~3u), 0);
+    memcpy(out.data(), header, sizeof(header));
+    memcpy(out.data() + 8, seeds.data(), seeds.size() * sizeof(uint16_t));
+    return true;
+}
+
+bool PerfectHashBuilder::TryBuild(const std::vector<uint64_t>& keys, uint32_t bucketCount, uint32_t slotCount,
+                                  std::vector<uint16_t>& seeds, std::vector<uint32_t>& slots) {
+    std::vector<std::vector<uint32_t>> buckets(bucketCount);
+    for (uint32_t i = 0; i < keys.size(); ++i) {
+        buckets[PerfectHash::Reduce(PerfectHash::Hash(keys[i], PerfectHash::BUCKET_SEED), bucketCount)].push_back(i);
+    }
+
+    // Place the largest buckets first while the table is still empty
+    std::vector<uint32_t> order(bucketCount);
+    for (uint32_t i = 0; i < bucketCount; ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return buckets[a].size() > buckets[b].size();
+    });
+
+    seeds.assign(bucketCount, 0);
+    slots.assign(keys.size(), 0);
+    std::vector<bool> used(slotCount, false);
+    std::vector<uint32_t> candidate;
+
+    for (uint32_t bucket : order) {
+        const std::vector<uint32_t>& members = buckets[bucket];
+        if (members.empty()) break;
+
+        bool placed = false;
+        for (uint32_t seed = 0; seed <= 0xFFFF && !placed; ++seed) {
+            candidate.clear();
+            placed = true;
+            for (uint32_t key : members) {
+                uint32_t slot = PerfectHash::Reduce(PerfectHash::Hash(keys[key], seed), slotCount);
+                if (used[slot] || std::find(candidate.begin(), candidate.end(), slot) != candidate.end()) {
+                    placed = false;
+                    break;
+                }
+                candidate.push_back(slot);
+            }
+
+            if (placed) {
+                seeds[bucket] = static_cast<uint16_t>(seed);
+                for (size_t i = 0; i < members.size(); ++i) {
+                    used[candidate[i]] = true;
+                    slots[members[i]] = candidate[i];
+                }
+            }
+        }
+
+        if (!placed) return false;
+    }
+
+    return true;
+}
\ No newline at end of file
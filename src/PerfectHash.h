@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Minimal perfect hash over 64-bit keys using hash-and-displace: keys are
+// split into small buckets, and each bucket stores the seed that sends all of
+// its keys to free slots. A lookup is two hashes and one 16-bit load.
+// Keys outside the build set map to an arbitrary slot, so owners keep a
+// fingerprint per slot to reject them.
+//
+// Layout (little-endian):
+//   uint32 bucketCount, uint32 slotCount
+//   uint16 seeds[bucketCount], padded to a multiple of 4 bytes
+class PerfectHash {
+public:
+    PerfectHash();
+
+    // Points the view at data. Returns the number of bytes used, 0 on error.
+    size_t Attach(const uint8_t* data, size_t size);
+
+    bool IsValid() const { return _seeds != nullptr; }
+    uint32_t SlotCount() const { return _slotCount; }
+
+    uint32_t Slot(uint64_t key) const {
+        uint32_t bucket = Reduce(Hash(key, BUCKET_SEED), _bucketCount);
+        return Reduce(Hash(key, _seeds[bucket]), _slotCount);
+    }
+
+    static uint32_t Hash(uint64_t key, uint32_t seed) {
+        uint64_t x = key ^ (0x9E3779B97F4A7C15ull * (seed + 1));
+        x ^= x >> 30;
+        x *= 0xBF58476D1CE4E5B9ull;
+        x ^= x >> 27;
+        x *= 0x94D049BB133111EBull;
+        x ^= x >> 31;
+        return static_cast<uint32_t>(x >> 32);
+    }
+
+    // Maps a 32-bit hash onto [0, range) without a division
+    static uint32_t Reduce(uint32_t hash, uint32_t range) {
+        return static_cast<uint32_t>((static_cast<uint64_t>(hash) * range) >> 32);
+    }
+
+    static const uint32_t BUCKET_SEED = 0xFFFFFFFF;
+
+private:
+    const uint16_t* _seeds;
+    uint32_t _bucketCount;
+    uint32_t _slotCount;
+};
+
+class PerfectHashBuilder {
+public:
+    // Builds the index for unique keys. slots receives the slot of each key
+    // in input order. Returns false if keys contain duplicates.
+    static bool Build(const std::vector<uint64_t>& keys, std::vector<uint8_t>& out,
+                      std::vector<uint32_t>& slots);
+
+private:
+    static bool TryBuild(const std::vector<uint64_t>& keys, uint32_t bucketCount, uint32_t slotCount,
+                         std::vector<uint16_t>& seeds, std::vector<uint32_t>& slots);
+};
\ No newline at end of file
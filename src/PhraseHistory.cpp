@@ -0,0 +1,62 @@
+#include "PhraseHistory.h"
+#include "Win32Compat.h"
+
+PhraseHistory::PhraseHistory() {
+    Clear();
+}
+
+void PhraseHistory::Push(KeystrokeInfo keystroke) {
+    bool space = keystroke.VirtualKey() == VK_SPACE;
+    bool startsWord = _wordCount == 0 || (!space && _keys[(_end - 1) % MAX_KEYS].VirtualKey() == VK_SPACE);
+    if (startsWord) {
+        if (_wordCount == MAX_WORDS) {
+            DropOldestWord();
+        }
+        _wordStarts[(_firstWord + _wordCount) % MAX_WORDS] = _end;
+        ++_wordCount;
+    }
+
+    // Room for the key: the oldest word goes, unless it is the only one
+    if (Size() == MAX_KEYS) {
+        if (_wordCount > 1) {
+            DropOldestWord();
+        } else {
+            _wordStarts[_firstWord] = ++_begin;
+        }
+    }
+
+    size_t slot = _end % MAX_KEYS;
+    _keys[slot] = keystroke;
+    _keys[slot + MAX_KEYS] = keystroke;
+    ++_end;
+}
+
+void PhraseHistory::PopBack() {
+    if (IsEmpty()) return;
+    --_end;
+    if (_wordStarts[(_firstWord + _wordCount - 1) % MAX_WORDS] == _end) {
+        --_wordCount;
+    }
+}
+
+void PhraseHistory::Clear() {
+    _begin = 0;
+    _end = 0;
+    _firstWord = 0;
+    _wordCount = 0;
+}
+
+void PhraseHistory::DropOldestWord() {
+    _firstWord = (_firstWord + 1) % MAX_WORDS;
+    --_wordCount;
+    _begin = _wordCount > 0 ? _wordStarts[_firstWord] : _end;
+}
+
+const KeystrokeInfo* PhraseHistory::Last(size_t words, size_t& count) const {
+    if (words == 0 || words > _wordCount) {
+        words = _wordCount;
+    }
+    size_t start = words > 0 ? _wordStarts[(_firstWord + _wordCount - words) % MAX_WORDS] : _end;
+    count = _end - start;
+    return _keys + start % MAX_KEYS;
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include "Keystroke.h"
+#include "KeystrokeRing.h"
+
+// The words typed into the focused window since focus last moved, each with
+// the spaces after it, for Shift+Pause to correct as one phrase. Keystrokes
+// live in one preallocated ring written twice like KeystrokeRing's, so the
+// last few words are always one contiguous run; a second ring holds where
+// each word starts. A word starts with a key that is not a space right
+// after one that is.
+// When either ring is full the oldest word goes as a whole, so a phrase
+// never starts halfway into a word; only a single word longer than the
+// whole history loses its head.
+// Not thread-safe, owned by the correction worker.
+class PhraseHistory {
+public:
+    static const size_t MAX_KEYS = KeystrokeRing::MAX_CAPACITY;
+    static const size_t MAX_WORDS = 32;
+
+    PhraseHistory();
+
+    void Push(KeystrokeInfo keystroke);
+    void PopBack();
+    void Clear();
+
+    // The keys of the last words words, oldest first; all of them when
+    // words is 0 or more than are kept. Valid until the next Push.
+    const KeystrokeInfo* Last(size_t words, size_t& count) const;
+
+    size_t Size() const { return _end - _begin; }
+    size_t WordCount() const { return _wordCount; }
+    bool IsEmpty() const { return _end == _begin; }
+
+private:
+    void DropOldestWord();
+
+    // Keys are addressed by position, counted from the first key ever
+    // pushed; a position's slot is position % MAX_KEYS
+    KeystrokeInfo _keys[MAX_KEYS * 2];
+    size_t _wordStarts[MAX_WORDS];     // Positions, the oldest at _firstWord
+    size_t _begin;
+    size_t _end;
+    size_t _firstWord;
+    size_t _wordCount;
+};
\ No newline at end of file
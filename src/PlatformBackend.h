@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include "Win32Compat.h"
+#include "Dawg.h"
+#include "LayoutTable.h"
+#include "NgramTable.h"
+
+// Everything the correction engine needs from the OS, kept narrow so the
+// engine builds without user32. Input arrives through HookDispatcher, which
+// is already portable; this is the query and output side. Win32Backend is
+// the real implementation, FakeBackend an in-memory one for host tools.
+// Called from the correction worker only.
+class PlatformBackend {
+public:
+    static const size_t MAX_LAYOUTS = 16;
+
+    virtual ~PlatformBackend() {}
+
+    virtual HWND ForegroundWindow() = 0;
+    virtual HKL WindowLayout(HWND window) = 0;
+
+    // Layout that follows current in the installed list, null if there is
+    // only one
+    virtual HKL NextLayout(HKL current) = 0;
+    virtual size_t LayoutList(HKL* layouts, size_t capacity) = 0;
+
+    // Translation table, dictionary and trigram model of a layout, null
+    // when unavailable
+    virtual const LayoutTable* Table(HKL layout) = 0;
+    virtual const Dawg* Dictionary(HKL layout) = 0;
+    virtual const NgramTable* Trigrams(HKL layout) = 0;
+
+    // Injects keyboard input, all of it or as much as the system accepts
+    virtual void Send(const INPUT* inputs, size_t count) = 0;
+
+    // Asks window to switch to layout, or to the next one when layout is
+    // null. The switch happens asynchronously in the window's thread.
+    virtual void RequestLayout(HWND window, HKL layout) = 0;
+
+    // Waits until window's layout is no longer previous, or a short timeout
+    virtual void WaitForLayout(HWND window, HKL previous) = 0;
+
+    // Copies window's selection as text, leaving the clipboard text as it
+    // was. Returns false when nothing is selected or the copy timed out.
+    virtual bool CopySelection(HWND window, std::u16string& text) = 0;
+
+    // Replaces window's selection with text by pasting it
+    virtual void PasteText(HWND window, const std::u16string& text) = 0;
+};
\ No newline at end of file
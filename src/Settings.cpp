@@ -1,8 +1,7 @@
 #include "Settings.h"
+#include <windows.h>
 #include <shlobj.h>
-#include <fstream>
-#include <sstream>
-#include <map>
+#include "MappedFile.h"
 
 const wchar_t* Settings::APP_NAME = L"LayoutSwitcher";
 const wchar_t* Settings::SETTINGS_FILENAME = L"settings.yml";
@@ -48,97 +47,52 @@ std::wstring StringToWString(const std::string& str) {
     return wstr;
 }
 
-// Simple YAML parser for key: value pairs
-std::map<std::string, std::string> ParseSimpleYAML(const std::string& content) {
-    std::map<std::string, std::string> result;
-    std::istringstream stream(content);
-    std::string line;
-    
-    while (std::getline(stream, line)) {
-        // Remove leading/trailing whitespace
-        size_t start = line.find_first_not_of(" \t\r\n");
-        if (start == std::string::npos || line[start] == '#') continue;
-        
-        size_t end = line.find_last_not_of(" \t\r\n");
-        line = line.substr(start, end - start + 1);
-        
-        // Find colon separator
-        size_t colonPos = line.find(':');
-        if (colonPos != std::string::npos) {
-            std::string key = line.substr(0, colonPos);
-            std::string value = line.substr(colonPos + 1);
-            
-            // Trim key and value
-            key.erase(0, key.find_first_not_of(" \t"));
-            key.erase(key.find_last_not_of(" \t") + 1);
-            value.erase(0, value.find_first_not_of(" \t"));
-            value.erase(value.find_last_not_of(" \t") + 1);
-            
-            result[key] = value;
-        }
-    }
-    
-    return result;
-}
-
-bool ParseBool(const std::string& value) {
-    return value == "true" || value == "True" || value == "TRUE" || value == "1";
-}
-
 Settings Settings::Load() {
     Settings settings;
     
     try {
+        // An empty or missing file maps to nothing and keeps the defaults
+        MappedFile file;
         auto settingsPath = GetSettingsPath();
-        if (!settingsPath.empty() && GetFileAttributes(settingsPath.c_str()) != INVALID_FILE_ATTRIBUTES) {
-            std::ifstream file(settingsPath);
-            if (file.is_open()) {
-                std::string content((std::istreambuf_iterator<char>(file)),
-                                  std::istreambuf_iterator<char>());
-                
-                auto config = ParseSimpleYAML(content);
-                
-                if (config.find("textCorrectionEnabled") != config.end()) {
-                    settings.textCorrectionEnabled = ParseBool(config["textCorrectionEnabled"]);
-                }
-                if (config.find("layoutSwitchEnabled") != config.end()) {
-                    settings.layoutSwitchEnabled = ParseBool(config["layoutSwitchEnabled"]);
-                }
-                if (config.find("autoStartWithWindows") != config.end()) {
-                    settings.autoStartWithWindows = ParseBool(config["autoStartWithWindows"]);
-                }
-            }
+        if (!settingsPath.empty() && file.Open(settingsPath)) {
+            settings = Parse(reinterpret_cast<const char*>(file.Data()), file.Size());
         }
     }
     catch (...) {
         // Use default settings on any error
     }
     
-    settings.SyncAutoStartRegistry();
     return settings;
 }
 
-void Settings::Save() const {
+bool Settings::Save() const {
+    bool saved = false;
+    
     try {
         auto settingsDir = GetSettingsDirectory();
-        if (settingsDir.empty()) return;
+        if (settingsDir.empty()) return false;
         
         // Create directory if it doesn't exist
         CreateDirectoryW(settingsDir.c_str(), nullptr);
         
         auto settingsPath = GetSettingsPath();
-        if (settingsPath.empty()) return;
-        
-        // Create YAML content manually
-        std::ostringstream yaml;
-        yaml << "textCorrectionEnabled: " << (textCorrectionEnabled ? "true" : "false") << "\n";
-        yaml << "layoutSwitchEnabled: " << (layoutSwitchEnabled ? "true" : "false") << "\n";
-        yaml << "autoStartWithWindows: " << (autoStartWithWindows ? "true" : "false") << "\n";
+        std::wstring tempPath = settingsPath + L".tmp";
+        std::string content = Serialize();
         
-        // Write to file
-        std::ofstream file(settingsPath);
-        if (file.is_open()) {
-            file << yaml.str();
+        // Write the whole file next to the real one, then swap it in
+        HANDLE file = CreateFileW(tempPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                                  FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file != INVALID_HANDLE_VALUE) {
+            DWORD written = 0;
+            bool complete = WriteFile(file, content.data(), static_cast<DWORD>(content.size()), &written, nullptr) &&
+                            written == content.size() && FlushFileBuffers(file);
+            CloseHandle(file);
+            
+            saved = complete && MoveFileExW(tempPath.c_str(), settingsPath.c_str(),
+                                            MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+            if (!saved) {
+                DeleteFileW(tempPath.c_str());
+            }
         }
         
         UpdateAutoStartRegistry();
@@ -146,6 +100,8 @@ void Settings::Save() const {
     catch (...) {
         // Ignore save errors
     }
+    
+    return saved;
 }
 
 void Settings::SyncAutoStartRegistry() {
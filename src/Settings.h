@@ -1,6 +1,9 @@
 #pragma once
-#include <windows.h>
+#include <cstddef>
 #include <string>
+#include <vector>
+#include "AppRules.h"
+#include "SettingsReader.h"
 
 class Settings {
 public:
@@ -8,15 +11,43 @@ public:
     bool textCorrectionEnabled = true;
     bool layoutSwitchEnabled = true;
     bool autoStartWithWindows = false;
+    int keystrokeBufferSize = 64;       // Keys remembered per window, 1..256
+    bool showLayoutInTray = true;       // Tray icon shows the active layout's language
+    bool autoCorrectEnabled = false;    // Correct words as they end, without Pause
+    int autoCorrectMinLetters = 4;      // 1..64
+    int autoCorrectMargin = 1500;       // Per-letter lead in thousandths of a nat, 0..20000
+    bool layoutMemoryEnabled = false;   // Put back each window's layout when it regains focus
+    bool layoutMemoryPerApplication = false;    // One layout per process instead of per window
+    int phraseCorrectionWords = 0;      // Words Shift+Pause corrects, 0 for the whole phrase, 0..32
+    std::vector<AppRule> appRules;      // Sections under rules:, in file order
+
+    struct ParseStats {
+        SettingsReader::Result read;
+        size_t unknownKeys = 0;
+        size_t invalidValues = 0;
+    };
 
     // Static methods
+    // File values only; autoStartWithWindows is corrected by
+    // SyncAutoStartRegistry, which the app runs after startup
     static Settings Load();
-    void Save() const;
+    void SyncAutoStartRegistry();
 
-private:
-    static std::wstring GetSettingsPath();
+    // Replaces settings.yml through a temporary file, so readers never see
+    // a half-written file. Blocks on disk I/O; the app saves through
+    // SettingsStore instead of calling this on the UI thread.
+    bool Save() const;
+
+    // settings.yml contents; portable, see SettingsFormat.cpp. Unknown or
+    // malformed entries keep their defaults.
+    static Settings Parse(const char* data, size_t size, ParseStats* stats = nullptr);
+    std::string Serialize() const;
+
+    // %APPDATA%\LayoutSwitcher, also home to traces and diagnostics
     static std::wstring GetSettingsDirectory();
-    void SyncAutoStartRegistry();
+    static std::wstring GetSettingsPath();
+
+private:
     void UpdateAutoStartRegistry() const;
     static const wchar_t* APP_NAME;
     static const wchar_t* SETTINGS_FILENAME;
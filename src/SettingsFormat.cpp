@@ -0,0 +1,240 @@
+#include "Settings.h"
+#include <cstdio>
+#include <cstring>
+
+// Reading and writing settings.yml, kept free of Win32 so the format can be
+// exercised on any host. Every setting is one row of the schema below; its
+// dotted path decides the section it is written under. Application rules
+// follow in a rules: section, one subsection per rule:
+//
+//   rules:
+//     remoteDesktop:
+//       process: "mstsc.exe"
+//       hotkeys: false
+//       injection: keys
+
+namespace {
+
+struct Field {
+    const char* path;
+    bool Settings::* flag;
+    int Settings::* number;
+    int minValue;
+    int maxValue;
+};
+
+const Field FIELDS[] = {
+    { "textCorrectionEnabled", &Settings::textCorrectionEnabled, nullptr, 0, 0 },
+    { "layoutSwitchEnabled", &Settings::layoutSwitchEnabled, nullptr, 0, 0 },
+    { "autoStartWithWindows", &Settings::autoStartWithWindows, nullptr, 0, 0 },
+    { "keystrokeBufferSize", nullptr, &Settings::keystrokeBufferSize, 1, 256 },
+    { "trayIcon.showLayout", &Settings::showLayoutInTray, nullptr, 0, 0 },
+    { "autoCorrect.enabled", &Settings::autoCorrectEnabled, nullptr, 0, 0 },
+    { "autoCorrect.minLetters", nullptr, &Settings::autoCorrectMinLetters, 1, 64 },
+    { "autoCorrect.margin", nullptr, &Settings::autoCorrectMargin, 0, 20000 },
+    { "layoutMemory.enabled", &Settings::layoutMemoryEnabled, nullptr, 0, 0 },
+    { "layoutMemory.perApplication", &Settings::layoutMemoryPerApplication, nullptr, 0, 0 },
+    { "phraseCorrection.words", nullptr, &Settings::phraseCorrectionWords, 0, 32 },
+};
+
+const char RULES_PREFIX[] = "rules.";
+const size_t RULES_PREFIX_LENGTH = sizeof(RULES_PREFIX) - 1;
+
+struct ParseContext {
+    Settings* settings;
+    size_t unknown;
+    size_t invalid;
+};
+
+// rules.<name>.<field>. Rules are often named after their executable, so
+// the name may hold dots; field names never do.
+void OnRuleEntry(ParseContext* parse, const SettingsReader::Entry& entry) {
+    const char* name = entry.path + RULES_PREFIX_LENGTH;
+    const char* dot = entry.path + entry.pathLength;
+    while (dot > name && *--dot != '.') {}
+    if (dot == name) {
+        ++parse->unknown;
+        return;
+    }
+    const char* field = dot + 1;
+    size_t fieldLength = entry.path + entry.pathLength - field;
+    size_t nameLength = dot - name;
+
+    // A rule's entries arrive together, so only the last rule can be theirs
+    std::vector<AppRule>& rules = parse->settings->appRules;
+    if (rules.empty() || rules.back().name.compare(0, std::string::npos, name, nameLength) != 0) {
+        rules.emplace_back();
+        rules.back().name.assign(name, nameLength);
+    }
+    AppRule& rule = rules.back();
+
+    bool enabled;
+    if (SettingsReader::Equals(field, fieldLength, "process")) {
+        rule.process.assign(entry.value, entry.valueLength);
+    } else if (SettingsReader::Equals(field, fieldLength, "windowClass")) {
+        rule.windowClass.assign(entry.value, entry.valueLength);
+    } else if (SettingsReader::Equals(field, fieldLength, "buffering")) {
+        if (!SettingsReader::ParseBool(entry.value, entry.valueLength, enabled)) {
+            ++parse->invalid;
+            return;
+        }
+        rule.policy.flags = enabled ? rule.policy.flags & ~AppPolicy::NO_BUFFERING
+                                    : rule.policy.flags | AppPolicy::NO_BUFFERING;
+    } else if (SettingsReader::Equals(field, fieldLength, "hotkeys")) {
+        if (!SettingsReader::ParseBool(entry.value, entry.valueLength, enabled)) {
+            ++parse->invalid;
+            return;
+        }
+        rule.policy.flags = enabled ? rule.policy.flags & ~AppPolicy::NO_HOTKEYS
+                                    : rule.policy.flags | AppPolicy::NO_HOTKEYS;
+    } else if (SettingsReader::Equals(field, fieldLength, "layout")) {
+        if (!SettingsReader::ParseUnsigned(entry.value, entry.valueLength, rule.policy.layout)) {
+            ++parse->invalid;
+        }
+    } else if (SettingsReader::Equals(field, fieldLength, "injection")) {
+        if (SettingsReader::Equals(entry.value, entry.valueLength, "auto")) {
+            rule.policy.injection = AppPolicy::INJECTION_AUTO;
+        } else if (SettingsReader::Equals(entry.value, entry.valueLength, "keys")) {
+            rule.policy.injection = AppPolicy::INJECTION_KEYS;
+        } else {
+            ++parse->invalid;
+        }
+    } else {
+        ++parse->unknown;
+    }
+}
+
+void OnEntry(void* context, const SettingsReader::Entry& entry) {
+    auto* parse = static_cast<ParseContext*>(context);
+    if (entry.pathLength > RULES_PREFIX_LENGTH && memcmp(entry.path, RULES_PREFIX, RULES_PREFIX_LENGTH) == 0) {
+        OnRuleEntry(parse, entry);
+        return;
+    }
+
+    for (const Field& field : FIELDS) {
+        if (!SettingsReader::Equals(entry.path, entry.pathLength, field.path)) continue;
+
+        if (field.flag) {
+            bool value;
+            if (SettingsReader::ParseBool(entry.value, entry.valueLength, value)) {
+                parse->settings->*field.flag = value;
+                return;
+            }
+        } else {
+            int value;
+            if (SettingsReader::ParseInt(entry.value, entry.valueLength, value)) {
+                if (value < field.minValue) value = field.minValue;
+                if (value > field.maxValue) value = field.maxValue;
+                parse->settings->*field.number = value;
+                return;
+            }
+        }
+        ++parse->invalid;
+        return;
+    }
+    ++parse->unknown;
+}
+
+size_t SectionLength(const char* path) {
+    const char* dot = strrchr(path, '.');
+    return dot ? dot - path : 0;
+}
+
+size_t Depth(const char* path, size_t length) {
+    if (length == 0) return 0;
+    size_t depth = 1;
+    for (size_t i = 0; i < length; ++i) {
+        if (path[i] == '.') ++depth;
+    }
+    return depth;
+}
+
+} // namespace
+
+Settings Settings::Parse(const char* data, size_t size, ParseStats* stats) {
+    Settings settings;
+    ParseContext context = { &settings, 0, 0 };
+    SettingsReader::Result result = SettingsReader::Read(data, size, OnEntry, &context);
+
+    if (stats) {
+        stats->read = result;
+        stats->unknownKeys = context.unknown;
+        stats->invalidValues = context.invalid;
+    }
+    return settings;
+}
+
+std::string Settings::Serialize() const {
+    std::string yaml;
+    yaml.reserve(256);
+
+    const char* previous = "";
+    size_t previousSection = 0;
+    for (const Field& field : FIELDS) {
+        size_t section = SectionLength(field.path);
+
+        // Sections shared with the previous field are already open
+        size_t common = 0;
+        for (size_t i = 0; i < previousSection && i < section && previous[i] == field.path[i];) {
+            ++i;
+            if ((i == previousSection || previous[i] == '.') && (i == section || field.path[i] == '.')) {
+                common = i;
+            }
+        }
+
+        size_t start = common > 0 ? common + 1 : 0;
+        size_t depth = Depth(field.path, common);
+        while (start < section) {
+            const char* dot = static_cast<const char*>(memchr(field.path + start, '.', section - start));
+            size_t componentEnd = dot ? dot - field.path : section;
+            yaml.append(depth * 2, ' ');
+            yaml.append(field.path + start, componentEnd - start);
+            yaml += ":\n";
+            ++depth;
+            start = componentEnd + 1;
+        }
+
+        yaml.append(depth * 2, ' ');
+        yaml += field.path + (section > 0 ? section + 1 : 0);
+        yaml += ": ";
+        if (field.flag) {
+            yaml += this->*field.flag ? "true" : "false";
+        } else {
+            yaml += std::to_string(this->*field.number);
+        }
+        yaml += '\n';
+
+        previous = field.path;
+        previousSection = section;
+    }
+
+    if (!appRules.empty()) {
+        yaml += "rules:\n";
+    }
+    for (const AppRule& rule : appRules) {
+        yaml += "  " + rule.name + ":\n";
+        if (!rule.process.empty()) {
+            yaml += "    process: \"" + rule.process + "\"\n";
+        }
+        if (!rule.windowClass.empty()) {
+            yaml += "    windowClass: \"" + rule.windowClass + "\"\n";
+        }
+        if (rule.policy.flags & AppPolicy::NO_BUFFERING) {
+            yaml += "    buffering: false\n";
+        }
+        if (rule.policy.flags & AppPolicy::NO_HOTKEYS) {
+            yaml += "    hotkeys: false\n";
+        }
+        if (rule.policy.layout) {
+            char layout[16];
+            snprintf(layout, sizeof(layout), rule.policy.layout <= 0xFFFF ? "0x%04x" : "0x%08x", rule.policy.layout);
+            yaml += "    layout: ";
+            yaml += layout;
+            yaml += '\n';
+        }
+        if (rule.policy.injection == AppPolicy::INJECTION_KEYS) {
+            yaml += "    injection: keys\n";
+        }
+    }
+    return yaml;
+}
\ No newline at end of file
@@ -0,0 +1,176 @@
+#include "SettingsReader.h"
+#include <cstring>
+
+namespace {
+
+bool IsBlank(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\r';
+}
+
+} // namespace
+
+SettingsReader::Result SettingsReader::Read(const char* data, size_t size, Callback callback, void* context) {
+    struct Section {
+        size_t indent;
+        size_t pathLength;      // Path up to and including this section's key
+    };
+
+    Result result;
+    Section sections[MAX_DEPTH];
+    size_t depth = 0;
+    char path[MAX_PATH_LENGTH + 1];
+
+    auto fail = [&result](size_t line) {
+        if (result.errors++ == 0) result.firstErrorLine = line;
+    };
+
+    const char* end = data + size;
+    const char* lineStart = data;
+
+    // Byte order mark left by Notepad
+    if (size >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0) {
+        lineStart += 3;
+    }
+
+    while (lineStart < end) {
+        const char* lineEnd = static_cast<const char*>(memchr(lineStart, '\n', end - lineStart));
+        if (!lineEnd) lineEnd = end;
+        size_t line = ++result.lines;
+
+        const char* key = lineStart;
+        while (key < lineEnd && (*key == ' ' || *key == '\t')) ++key;
+        size_t indent = key - lineStart;
+
+        const char* last = lineEnd;
+        while (last > key && IsBlank(last[-1])) --last;
+        lineStart = lineEnd + 1;
+
+        if (key == last || *key == '#') continue;
+
+        const char* colon = static_cast<const char*>(memchr(key, ':', last - key));
+        const char* keyEnd = colon;
+        while (keyEnd && keyEnd > key && IsBlank(keyEnd[-1])) --keyEnd;
+        if (!colon || keyEnd == key) {
+            fail(line);
+            continue;
+        }
+
+        const char* value = colon + 1;
+        while (value < last && IsBlank(*value)) ++value;
+        const char* valueEnd = last;
+
+        bool quoted = false;
+        if (value < valueEnd && (*value == '"' || *value == '\'')) {
+            const char* close = static_cast<const char*>(memchr(value + 1, *value, valueEnd - value - 1));
+            if (close) {
+                quoted = true;
+                ++value;
+                valueEnd = close;
+            }
+        }
+        if (!quoted) {
+            // A '#' starts a comment only at the start or after whitespace
+            for (const char* ch = value; ch < valueEnd; ++ch) {
+                if (*ch == '#' && (ch == value || IsBlank(ch[-1]))) {
+                    valueEnd = ch;
+                    break;
+                }
+            }
+            while (valueEnd > value && IsBlank(valueEnd[-1])) --valueEnd;
+        }
+
+        // Close the sections this line is not indented under
+        while (depth > 0 && sections[depth - 1].indent >= indent) --depth;
+
+        size_t prefix = depth > 0 ? sections[depth - 1].pathLength : 0;
+        size_t keyStart = prefix > 0 ? prefix + 1 : 0;
+        size_t keyLength = keyEnd - key;
+        if (keyStart + keyLength > MAX_PATH_LENGTH) {
+            fail(line);
+            continue;
+        }
+        if (prefix > 0) path[prefix] = '.';
+        memcpy(path + keyStart, key, keyLength);
+        size_t pathLength = keyStart + keyLength;
+        path[pathLength] = '\0';
+
+        if (!quoted && value == valueEnd) {
+            if (depth == MAX_DEPTH) {
+                fail(line);
+                continue;
+            }
+            sections[depth].indent = indent;
+            sections[depth].pathLength = pathLength;
+            ++depth;
+            continue;
+        }
+
+        Entry entry;
+        entry.path = path;
+        entry.pathLength = pathLength;
+        entry.value = value;
+        entry.valueLength = valueEnd - value;
+        entry.line = line;
+        callback(context, entry);
+        ++result.entries;
+    }
+
+    return result;
+}
+
+bool SettingsReader::Equals(const char* text, size_t length, const char* literal) {
+    return strlen(literal) == length && memcmp(text, literal, length) == 0;
+}
+
+bool SettingsReader::ParseBool(const char* text, size_t length, bool& value) {
+    if (Equals(text, length, "true") || Equals(text, length, "True") || Equals(text, length, "TRUE") ||
+        Equals(text, length, "yes") || Equals(text, length, "1")) {
+        value = true;
+        return true;
+    }
+    if (Equals(text, length, "false") || Equals(text, length, "False") || Equals(text, length, "FALSE") ||
+        Equals(text, length, "no") || Equals(text, length, "0")) {
+        value = false;
+        return true;
+    }
+    return false;
+}
+
+bool SettingsReader::ParseInt(const char* text, size_t length, int& value) {
+    size_t i = 0;
+    bool negative = length > 0 && text[0] == '-';
+    if (negative || (length > 0 && text[0] == '+')) ++i;
+    if (i == length) return false;
+
+    long long result = 0;
+    for (; i < length; ++i) {
+        if (text[i] < '0' || text[i] > '9') return false;
+        result = result * 10 + (text[i] - '0');
+        if (result > 0x7FFFFFFF) return false;
+    }
+    value = static_cast<int>(negative ? -result : result);
+    return true;
+}
+
+bool SettingsReader::ParseUnsigned(const char* text, size_t length, uint32_t& value) {
+    bool hex = length > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X');
+    size_t i = hex ? 2 : 0;
+    if (i == length) return false;
+
+    uint64_t result = 0;
+    for (; i < length; ++i) {
+        char ch = text[i];
+        int digit;
+        if (ch >= '0' && ch <= '9') {
+            digit = ch - '0';
+        } else if (hex && (ch | 0x20) >= 'a' && (ch | 0x20) <= 'f') {
+            digit = (ch | 0x20) - 'a' + 10;
+        } else {
+            return false;
+        }
+        result = result * (hex ? 16 : 10) + digit;
+        if (result > 0xFFFFFFFF) return false;
+    }
+    value = static_cast<uint32_t>(result);
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Single pass over settings.yml text: the YAML subset of "key: value" lines,
+// '#' comments and sections nested by indentation. A key with nothing after
+// the colon opens a section; deeper-indented lines belong to it. Each value
+// is reported with its dotted path ("section.key"), pointing into the input
+// buffer, so reading allocates nothing.
+class SettingsReader {
+public:
+    static const size_t MAX_DEPTH = 8;
+    static const size_t MAX_PATH_LENGTH = 256;
+
+    struct Entry {
+        const char* path;           // Dotted, null-terminated, valid during the callback
+        size_t pathLength;
+        const char* value;          // Unquoted, not terminated
+        size_t valueLength;
+        size_t line;                // 1-based
+    };
+
+    struct Result {
+        size_t lines = 0;
+        size_t entries = 0;
+        size_t errors = 0;          // Lines that are not "key: value" or nest too deep
+        size_t firstErrorLine = 0;
+    };
+
+    using Callback = void(*)(void* context, const Entry& entry);
+
+    static Result Read(const char* data, size_t size, Callback callback, void* context);
+
+    // Value comparison helpers for callbacks
+    static bool Equals(const char* text, size_t length, const char* literal);
+    static bool ParseBool(const char* text, size_t length, bool& value);
+    static bool ParseInt(const char* text, size_t length, int& value);
+
+    // Decimal, or hexadecimal after 0x; up to 32 bits
+    static bool ParseUnsigned(const char* text, size_t length, uint32_t& value);
+};
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include "SettingsStore.h"
+#include "MappedFile.h"
+
+SettingsStore::SettingsStore(HWND notifyWindow)
+    : _notifyWindow(notifyWindow), _thread(nullptr), _saveEvent(nullptr), _stopEvent(nullptr),
+      _hasPending(false), _hasReloaded(false) {
+    InitializeCriticalSection(&_lock);
+}
+
+SettingsStore::~SettingsStore() {
+    Stop();
+    DeleteCriticalSection(&_lock);
+}
+
+void SettingsStore::Start(const Settings& loaded) {
+    if (_thread) return;
+
+    _lastContent = loaded.Serialize();
+    _saveEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    _stopEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    if (_saveEvent && _stopEvent) {
+        _thread = CreateThread(nullptr, 0, ThreadProc, this, 0, nullptr);
+    }
+}
+
+void SettingsStore::Stop() {
+    if (_thread) {
+        SetEvent(_stopEvent);
+        WaitForSingleObject(_thread, INFINITE);
+        CloseHandle(_thread);
+        _thread = nullptr;
+    }
+
+    if (_saveEvent) {
+        CloseHandle(_saveEvent);
+        _saveEvent = nullptr;
+    }
+    if (_stopEvent) {
+        CloseHandle(_stopEvent);
+        _stopEvent = nullptr;
+    }
+}
+
+void SettingsStore::Save(const Settings& settings) {
+    EnterCriticalSection(&_lock);
+    _pending = settings;
+    _hasPending = true;
+    LeaveCriticalSection(&_lock);
+
+    if (_thread) {
+        SetEvent(_saveEvent);
+    } else {
+        // No store thread (startup failed): fall back to saving in place
+        WritePending();
+    }
+}
+
+bool SettingsStore::TakeReloaded(Settings& settings) {
+    EnterCriticalSection(&_lock);
+    bool hasReloaded = _hasReloaded;
+    if (hasReloaded) {
+        settings = _reloaded;
+        _hasReloaded = false;
+    }
+    LeaveCriticalSection(&_lock);
+    return hasReloaded;
+}
+
+DWORD WINAPI SettingsStore::ThreadProc(LPVOID param) {
+    static_cast<SettingsStore*>(param)->Run();
+    return 0;
+}
+
+namespace {
+
+const DWORD WATCH_FILTER = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+
+bool Watch(HANDLE directory, DWORD* buffer, DWORD size, OVERLAPPED& overlapped) {
+    ResetEvent(overlapped.hEvent);
+    return ReadDirectoryChangesW(directory, buffer, size, FALSE, WATCH_FILTER, nullptr, &overlapped, nullptr) != 0;
+}
+
+// True if a batch of directory changes touches fileName. An empty batch
+// means the system dropped what did not fit, which may include it.
+bool ChangesFile(const DWORD* buffer, DWORD bytes, const std::wstring& fileName) {
+    if (bytes == 0) return true;
+
+    const BYTE* entry = reinterpret_cast<const BYTE*>(buffer);
+    for (;;) {
+        const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(entry);
+        int length = static_cast<int>(info->FileNameLength / sizeof(WCHAR));
+        if (CompareStringOrdinal(info->FileName, length, fileName.c_str(), static_cast<int>(fileName.size()), TRUE) ==
+            CSTR_EQUAL) {
+            return true;
+        }
+        if (info->NextEntryOffset == 0) return false;
+        entry += info->NextEntryOffset;
+    }
+}
+
+} // namespace
+
+void SettingsStore::Run() {
+    std::wstring directory = Settings::GetSettingsDirectory();
+    std::wstring path = Settings::GetSettingsPath();
+    std::wstring fileName = path.substr(path.rfind(L'\\') + 1);
+
+    // The directory also holds the learned-words journal, traces and
+    // diagnostics; only changes to settings.yml itself schedule a reload
+    HANDLE watch = INVALID_HANDLE_VALUE;
+    OVERLAPPED overlapped = {};
+    DWORD changes[1024];
+    if (!directory.empty()) {
+        CreateDirectoryW(directory.c_str(), nullptr);
+        overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+        if (overlapped.hEvent) {
+            watch = CreateFileW(directory.c_str(), FILE_LIST_DIRECTORY,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                                FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+        }
+        if (watch != INVALID_HANDLE_VALUE && !Watch(watch, changes, sizeof(changes), overlapped)) {
+            CloseHandle(watch);
+            watch = INVALID_HANDLE_VALUE;
+        }
+    }
+
+    // Zero means nothing is due
+    ULONGLONG saveDue = 0;
+    ULONGLONG reloadDue = 0;
+
+    for (;;) {
+        ULONGLONG now = GetTickCount64();
+        ULONGLONG nextDue = saveDue && (!reloadDue || saveDue < reloadDue) ? saveDue : reloadDue;
+        DWORD timeout = INFINITE;
+        if (nextDue) {
+            timeout = nextDue > now ? static_cast<DWORD>(nextDue - now) : 0;
+        }
+
+        HANDLE handles[] = { _stopEvent, _saveEvent, overlapped.hEvent };
+        DWORD handleCount = watch != INVALID_HANDLE_VALUE ? 3 : 2;
+        DWORD result = WaitForMultipleObjects(handleCount, handles, FALSE, timeout);
+        now = GetTickCount64();
+
+        if (result == WAIT_OBJECT_0) {
+            break;
+        } else if (result == WAIT_OBJECT_0 + 1) {
+            // The first request of a burst sets the deadline, so a stream of
+            // toggles still gets written within SAVE_DELAY_MS
+            if (!saveDue) saveDue = now + SAVE_DELAY_MS;
+        } else if (result == WAIT_OBJECT_0 + 2) {
+            // Editors save in several steps; wait until they have been quiet
+            DWORD bytes = 0;
+            bool completed = GetOverlappedResult(watch, &overlapped, &bytes, FALSE) != 0;
+            if (completed && ChangesFile(changes, bytes, fileName)) {
+                reloadDue = now + RELOAD_DELAY_MS;
+            }
+            if (!completed || !Watch(watch, changes, sizeof(changes), overlapped)) {
+                CloseHandle(watch);
+                watch = INVALID_HANDLE_VALUE;
+            }
+        } else if (result == WAIT_FAILED) {
+            break;
+        }
+
+        if (saveDue && now >= saveDue) {
+            saveDue = 0;
+            WritePending();
+        }
+        if (reloadDue && now >= reloadDue) {
+            reloadDue = 0;
+            ReloadIfChanged();
+        }
+    }
+
+    WritePending();
+    if (watch != INVALID_HANDLE_VALUE) {
+        // The read still targets changes; let it finish before the stack goes
+        DWORD bytes = 0;
+        CancelIoEx(watch, &overlapped);
+        GetOverlappedResult(watch, &overlapped, &bytes, TRUE);
+        CloseHandle(watch);
+    }
+    if (overlapped.hEvent) {
+        CloseHandle(overlapped.hEvent);
+    }
+}
+
+void SettingsStore::WritePending() {
+    EnterCriticalSection(&_lock);
+    bool hasPending = _hasPending;
+    Settings settings = _pending;
+    _hasPending = false;
+    LeaveCriticalSection(&_lock);
+
+    if (hasPending && settings.Save()) {
+        _lastContent = settings.Serialize();
+    }
+}
+
+void SettingsStore::ReloadIfChanged() {
+    MappedFile file;
+    if (!file.Open(Settings::GetSettingsPath())) return;
+
+    Settings settings = Settings::Parse(reinterpret_cast<const char*>(file.Data()), file.Size());
+    file.Close();
+
+    // Our own saves come back through the same notification
+    std::string content = settings.Serialize();
+    if (content == _lastContent) return;
+    _lastContent = content;
+
+    EnterCriticalSection(&_lock);
+    _reloaded = settings;
+    _hasReloaded = true;
+    LeaveCriticalSection(&_lock);
+
+    PostMessage(_notifyWindow, WM_SETTINGS_RELOADED, 0, 0);
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+#include <windows.h>
+#include <string>
+#include "Settings.h"
+
+// Keeps settings.yml in sync with the running app from a background thread.
+// Saves requested by the UI are coalesced and written atomically after a
+// short delay, so toggling menu items never waits on the disk. Edits made to
+// the file by anything else are picked up through directory change
+// notifications filtered on its name, debounced, parsed and handed to the UI
+// thread with WM_SETTINGS_RELOADED.
+class SettingsStore {
+public:
+    // Posted to the notify window; call TakeReloaded from its handler
+    static const UINT WM_SETTINGS_RELOADED = WM_APP + 1;
+
+    explicit SettingsStore(HWND notifyWindow);
+    ~SettingsStore();
+
+    SettingsStore(const SettingsStore&) = delete;
+    SettingsStore& operator=(const SettingsStore&) = delete;
+
+    // loaded is what Settings::Load returned; a file that still parses to
+    // the same values is not reported as an outside edit
+    void Start(const Settings& loaded);
+
+    // Pending saves are written before the thread exits
+    void Stop();
+
+    void Save(const Settings& settings);
+    bool TakeReloaded(Settings& settings);
+
+private:
+    static const DWORD SAVE_DELAY_MS = 200;
+    static const DWORD RELOAD_DELAY_MS = 250;
+
+    static DWORD WINAPI ThreadProc(LPVOID param);
+    void Run();
+    void WritePending();
+    void ReloadIfChanged();
+
+    HWND _notifyWindow;
+    HANDLE _thread;
+    HANDLE _saveEvent;
+    HANDLE _stopEvent;
+
+    // Shared with the UI thread
+    CRITICAL_SECTION _lock;
+    Settings _pending;
+    bool _hasPending;
+    Settings _reloaded;
+    bool _hasReloaded;
+
+    // Store thread only: serialized form of what the app last wrote or read
+    std::string _lastContent;
+};
\ No newline at end of file
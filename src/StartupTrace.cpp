@@ -0,0 +1,56 @@
+#include "StartupTrace.h"
+#include <cstdio>
+#include "LatencyHistogram.h"
+
+StartupTrace::StartupTrace(MemoryProbe probe)
+    : _probe(probe), _start(LatencyClock::Now()), _hooksActive(0), _count(0) {
+}
+
+void StartupTrace::Mark(const char* phase) {
+    // Probe first so its own cost is charged to the phase it measures
+    size_t workingSet = _probe ? _probe() : 0;
+    if (_count == MAX_PHASES) return;
+
+    Phase& entry = _phases[_count++];
+    entry.name = phase;
+    entry.end = LatencyClock::Now();
+    entry.workingSet = workingSet;
+}
+
+void StartupTrace::MarkHooksActive() {
+    if (_count > 0) _hooksActive = _phases[_count - 1].end;
+}
+
+uint64_t StartupTrace::ElapsedNanoseconds() const {
+    return _count > 0 ? LatencyClock::ToNanoseconds(_phases[_count - 1].end - _start) : 0;
+}
+
+uint64_t StartupTrace::HooksActiveNanoseconds() const {
+    return _hooksActive ? LatencyClock::ToNanoseconds(_hooksActive - _start) : 0;
+}
+
+std::string StartupTrace::Format() const {
+    std::string text;
+    char line[128];
+    snprintf(line, sizeof(line), "%-26s %9s %9s %12s\n", "startup phase (ms)", "took", "at", "ws (KB)");
+    text += line;
+
+    uint64_t previous = _start;
+    for (size_t i = 0; i < _count; ++i) {
+        const Phase& phase = _phases[i];
+        double took = LatencyClock::ToNanoseconds(phase.end - previous) / 1e6;
+        double at = LatencyClock::ToNanoseconds(phase.end - _start) / 1e6;
+        if (phase.workingSet > 0) {
+            snprintf(line, sizeof(line), "%-26s %9.2f %9.2f %12zu\n", phase.name, took, at, phase.workingSet / 1024);
+        } else {
+            snprintf(line, sizeof(line), "%-26s %9.2f %9.2f %12s\n", phase.name, took, at, "-");
+        }
+        text += line;
+        previous = phase.end;
+    }
+
+    snprintf(line, sizeof(line), "hooks active after %.2f ms, startup done after %.2f ms\n",
+             HooksActiveNanoseconds() / 1e6, ElapsedNanoseconds() / 1e6);
+    text += line;
+    return text;
+}
\ No newline at end of file
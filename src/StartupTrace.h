@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Timestamps of the steps between process entry and an idle message loop.
+// At login the app starts together with everything else in the Run key, so
+// the interesting number is how long it takes until the hooks are live; the
+// report shows where that time goes and how the working set grows with it.
+class StartupTrace {
+public:
+    static const size_t MAX_PHASES = 32;
+
+    // Returns the current working set in bytes, 0 when unknown
+    using MemoryProbe = size_t(*)();
+
+    // The trace starts when it is constructed
+    explicit StartupTrace(MemoryProbe probe = nullptr);
+
+    // Ends the phase that started at the previous mark. phase must outlive
+    // the trace; string literals are expected.
+    void Mark(const char* phase);
+
+    // Keystrokes are handled from the previous mark on
+    void MarkHooksActive();
+
+    uint64_t ElapsedNanoseconds() const;
+    uint64_t HooksActiveNanoseconds() const;
+
+    // One line per phase in milliseconds, with the working set after it
+    std::string Format() const;
+
+private:
+    struct Phase {
+        const char* name;
+        uint64_t end;
+        size_t workingSet;
+    };
+
+    MemoryProbe _probe;
+    uint64_t _start;
+    uint64_t _hooksActive;
+    Phase _phases[MAX_PHASES];
+    size_t _count;
+};
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "SystemStateCache.h"
+#include <cstdio>
+
+namespace {
+
+// Items each event makes stale
+const unsigned EVENT_ITEMS[SystemStateCache::EVENT_COUNT] = {
+    (1u << SystemStateCache::ITEM_THEME) | (1u << SystemStateCache::ITEM_LAYOUT_LIST),
+    (1u << SystemStateCache::ITEM_DPI),
+    (1u << SystemStateCache::ITEM_FOREGROUND_LAYOUT) | (1u << SystemStateCache::ITEM_LAYOUT_LIST),
+    (1u << SystemStateCache::ITEM_FOREGROUND_LAYOUT),
+};
+
+} // namespace
+
+SystemStateCache::SystemStateCache(SystemStateSource& source)
+    : _source(source), _darkTheme(false), _dpi(96), _layoutCount(0), _foregroundLayout(nullptr) {
+    for (bool& valid : _valid) valid = false;
+}
+
+bool SystemStateCache::Lookup(Item item) {
+    Counters& counters = _counters[item];
+    ++counters.reads;
+    if (_valid[item]) {
+        ++counters.hits;
+        return true;
+    }
+    ++counters.refreshes;
+    _valid[item] = true;
+    return false;
+}
+
+bool SystemStateCache::IsDarkTheme() {
+    if (!Lookup(ITEM_THEME)) _darkTheme = _source.QueryDarkTheme();
+    return _darkTheme;
+}
+
+int SystemStateCache::Dpi() {
+    if (!Lookup(ITEM_DPI)) _dpi = _source.QueryDpi();
+    return _dpi;
+}
+
+const HKL* SystemStateCache::Layouts(size_t& count) {
+    if (!Lookup(ITEM_LAYOUT_LIST)) _layoutCount = _source.QueryLayouts(_layouts, PlatformBackend::MAX_LAYOUTS);
+    count = _layoutCount;
+    return _layouts;
+}
+
+HKL SystemStateCache::ForegroundLayout() {
+    if (!Lookup(ITEM_FOREGROUND_LAYOUT)) _foregroundLayout = _source.QueryForegroundLayout();
+    return _foregroundLayout;
+}
+
+void SystemStateCache::OnEvent(Event event) {
+    if (event >= EVENT_COUNT) return;
+    for (int item = 0; item < ITEM_COUNT; ++item) {
+        if (!(EVENT_ITEMS[event] & (1u << item))) continue;
+        ++_counters[item].invalidations;
+        _valid[item] = false;
+    }
+}
+
+void SystemStateCache::Reset() {
+    for (int item = 0; item < ITEM_COUNT; ++item) {
+        _valid[item] = false;
+        _counters[item] = Counters();
+    }
+}
+
+bool SystemStateCache::RefreshForegroundLayout() {
+    HKL layout = _source.QueryForegroundLayout();
+    ++_counters[ITEM_FOREGROUND_LAYOUT].refreshes;
+
+    bool changed = !_valid[ITEM_FOREGROUND_LAYOUT] || layout != _foregroundLayout;
+    _foregroundLayout = layout;
+    _valid[ITEM_FOREGROUND_LAYOUT] = true;
+    return changed;
+}
+
+const char* SystemStateCache::Name(Item item) {
+    static const char* const names[ITEM_COUNT] = {
+        "state.theme",
+        "state.dpi",
+        "state.layout_list",
+        "state.foreground_layout",
+    };
+    return item < ITEM_COUNT ? names[item] : "";
+}
+
+std::string SystemStateCache::Format() const {
+    std::string text;
+    char line[160];
+    snprintf(line, sizeof(line), "%-24s %10s %8s %10s %13s\n",
+             "cached state", "reads", "hits %", "refreshes", "invalidations");
+    text += line;
+
+    for (int i = 0; i < ITEM_COUNT; ++i) {
+        const Counters& counters = _counters[i];
+        double hitRate = counters.reads ? 100.0 * counters.hits / counters.reads : 0.0;
+        snprintf(line, sizeof(line), "%-24s %10llu %8.1f %10llu %13llu\n",
+                 Name(static_cast<Item>(i)),
+                 static_cast<unsigned long long>(counters.reads), hitRate,
+                 static_cast<unsigned long long>(counters.refreshes),
+                 static_cast<unsigned long long>(counters.invalidations));
+        text += line;
+    }
+    return text;
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "PlatformBackend.h"
+
+// Where SystemStateCache gets its values from. Every call may be a syscall
+// or a registry read; Win32SystemState is the real one, FakeSystemState the
+// host-side one.
+class SystemStateSource {
+public:
+    virtual ~SystemStateSource() {}
+
+    virtual bool QueryDarkTheme() = 0;
+    virtual int QueryDpi() = 0;
+    virtual size_t QueryLayouts(HKL* layouts, size_t capacity) = 0;
+    virtual HKL QueryForegroundLayout() = 0;
+};
+
+// System state the app reads often and that changes rarely: theme, DPI,
+// installed layouts and the foreground window's layout. Each value is
+// fetched on the first read after the event that can change it, so reads in
+// between are a field load. Other processes switch layouts without telling
+// us, so the foreground layout is also refreshed by a poll.
+// Owned by the UI thread, which also runs the hooks; not thread-safe.
+class SystemStateCache {
+public:
+    enum Item {
+        ITEM_THEME = 0,
+        ITEM_DPI,
+        ITEM_LAYOUT_LIST,
+        ITEM_FOREGROUND_LAYOUT,
+        ITEM_COUNT
+    };
+
+    enum Event {
+        EVENT_SETTING_CHANGE = 0,   // WM_SETTINGCHANGE: theme, installed layouts
+        EVENT_DPI_CHANGE,           // WM_DPICHANGED, WM_DISPLAYCHANGE
+        EVENT_INPUT_LANG_CHANGE,    // WM_INPUTLANGCHANGE, or a switch we requested
+        EVENT_FOREGROUND_CHANGE,    // Another window came to the front
+        EVENT_COUNT
+    };
+
+    struct Counters {
+        uint64_t reads = 0;
+        uint64_t hits = 0;
+        uint64_t refreshes = 0;     // Source queries, from reads and polls
+        uint64_t invalidations = 0;
+    };
+
+    explicit SystemStateCache(SystemStateSource& source);
+
+    bool IsDarkTheme();
+    int Dpi();
+    const HKL* Layouts(size_t& count);
+    HKL ForegroundLayout();
+
+    void OnEvent(Event event);
+
+    // Forgets every value and zeroes the counters
+    void Reset();
+
+    // Queries the foreground layout now; true when it differs from the
+    // cached value
+    bool RefreshForegroundLayout();
+
+    const Counters& GetCounters(Item item) const { return _counters[item]; }
+    static const char* Name(Item item);
+
+    // One line per item: reads, hit rate, refreshes and invalidations
+    std::string Format() const;
+
+private:
+    bool Lookup(Item item);
+
+    SystemStateSource& _source;
+    bool _valid[ITEM_COUNT];
+    Counters _counters[ITEM_COUNT];
+
+    bool _darkTheme;
+    int _dpi;
+    HKL _layouts[PlatformBackend::MAX_LAYOUTS];
+    size_t _layoutCount;
+    HKL _foregroundLayout;
+};
\ No newline at end of file
@@ -0,0 +1,311 @@
+#include "TextTranscoder.h"
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define KSWITCHER_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC compiles SSSE3 and AVX2 intrinsics anywhere; GCC and Clang only in
+// functions marked for them, which then run only after the CPU check
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSSE3
+#define TARGET_AVX2
+#endif
+
+namespace {
+
+#if KSWITCHER_X86
+TextTranscoder::SimdLevel DetectSimd() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    bool ssse3 = (info[2] & (1 << 9)) != 0;
+
+    // AVX2 also needs the OS to save the upper register halves
+    bool avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    bool avx2 = avx && (info[1] & (1 << 5)) != 0;
+#else
+    bool ssse3 = __builtin_cpu_supports("ssse3") != 0;
+    bool avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+    return avx2 ? TextTranscoder::SIMD_AVX2 : ssse3 ? TextTranscoder::SIMD_SSSE3 : TextTranscoder::SIMD_NONE;
+}
+
+inline int LowestBit(uint32_t bits) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, bits);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(bits);
+#endif
+}
+
+// Looks up 16 indexes below 128 in a low and a high byte plane. PSHUFB
+// reads one 16-entry row and zeroes lanes whose index has bit 7 set, so each
+// row gets indexes with bit 7 set everywhere but in its own lanes: XOR with
+// the row number clears bits 4-6 only there, and adding 0x70 carries into
+// bit 7 wherever they are left.
+TARGET_SSSE3 inline void LookupPlanes(const uint8_t* lowPlane, const uint8_t* highPlane, __m128i index,
+                                      __m128i& low, __m128i& high) {
+    const __m128i carry = _mm_set1_epi8(0x70);
+    low = _mm_setzero_si128();
+    high = _mm_setzero_si128();
+    for (int r = 0; r < 8; ++r) {
+        __m128i rowIndex = _mm_add_epi8(_mm_xor_si128(index, _mm_set1_epi8(static_cast<char>(r << 4))), carry);
+        __m128i lowRow = _mm_load_si128(reinterpret_cast<const __m128i*>(lowPlane + r * 16));
+        __m128i highRow = _mm_load_si128(reinterpret_cast<const __m128i*>(highPlane + r * 16));
+        low = _mm_or_si128(low, _mm_shuffle_epi8(lowRow, rowIndex));
+        high = _mm_or_si128(high, _mm_shuffle_epi8(highRow, rowIndex));
+    }
+}
+
+// The same for 32 indexes; VPSHUFB shuffles each 128-bit half on its own,
+// so every row is loaded into both
+TARGET_AVX2 inline void LookupPlanes(const uint8_t* lowPlane, const uint8_t* highPlane, __m256i index,
+                                     __m256i& low, __m256i& high) {
+    const __m256i carry = _mm256_set1_epi8(0x70);
+    low = _mm256_setzero_si256();
+    high = _mm256_setzero_si256();
+    for (int r = 0; r < 8; ++r) {
+        __m256i rowIndex = _mm256_add_epi8(_mm256_xor_si256(index, _mm256_set1_epi8(static_cast<char>(r << 4))),
+                                           carry);
+        __m256i lowRow = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(lowPlane + r * 16)));
+        __m256i highRow = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(highPlane + r * 16)));
+        low = _mm256_or_si256(low, _mm256_shuffle_epi8(lowRow, rowIndex));
+        high = _mm256_or_si256(high, _mm256_shuffle_epi8(highRow, rowIndex));
+    }
+}
+#endif
+
+} // namespace
+
+TextTranscoder::TextTranscoder() : _sourceId(0), _targetId(0) {
+    for (size_t i = 0; i < RANGE_SIZE; ++i) {
+        _ascii[i] = static_cast<char16_t>(i);
+        _cyrillic[i] = static_cast<char16_t>(CYRILLIC_FIRST + i);
+    }
+    FillPlanes();
+}
+
+void TextTranscoder::Build(const LayoutTable& source, const LayoutTable& target) {
+    *this = TextTranscoder();
+    _sourceId = source.GetLayoutId();
+    _targetId = target.GetLayoutId();
+
+    // A character keeps the first key that produces it
+    std::vector<uint8_t> assigned(0x10000);
+    for (int key = 0; key < LayoutTable::KEY_COUNT; ++key) {
+        for (int shift = 0; shift < 2; ++shift) {
+            char16_t from = source.Translate(key, shift != 0);
+            if (!from || assigned[from]) continue;
+            assigned[from] = 1;
+
+            char16_t to = target.Translate(key, shift != 0);
+            if (to) Set(from, to);
+        }
+    }
+
+    // Then what only the target layout types goes back to the source
+    for (int key = 0; key < LayoutTable::KEY_COUNT; ++key) {
+        for (int shift = 0; shift < 2; ++shift) {
+            char16_t from = target.Translate(key, shift != 0);
+            char16_t to = source.Translate(key, shift != 0);
+            if (!from || !to || assigned[from]) continue;
+            assigned[from] = 1;
+            Set(from, to);
+        }
+    }
+
+    std::sort(_others.begin(), _others.end());
+    FillPlanes();
+}
+
+void TextTranscoder::FillPlanes() {
+    for (size_t i = 0; i < RANGE_SIZE; ++i) {
+        _planes[0][i] = static_cast<uint8_t>(_ascii[i]);
+        _planes[1][i] = static_cast<uint8_t>(_ascii[i] >> 8);
+        _planes[2][i] = static_cast<uint8_t>(_cyrillic[i]);
+        _planes[3][i] = static_cast<uint8_t>(_cyrillic[i] >> 8);
+    }
+}
+
+void TextTranscoder::Set(char16_t from, char16_t to) {
+    if (from < RANGE_SIZE) {
+        _ascii[from] = to;
+    } else if (static_cast<uint16_t>(from - CYRILLIC_FIRST) < RANGE_SIZE) {
+        _cyrillic[from - CYRILLIC_FIRST] = to;
+    } else if (from != to) {
+        _others.emplace_back(from, to);
+    }
+}
+
+char16_t TextTranscoder::MapOther(char16_t ch) const {
+    if (_others.empty()) return ch;
+
+    auto it = std::lower_bound(_others.begin(), _others.end(), std::make_pair(ch, char16_t(0)));
+    return it != _others.end() && it->first == ch ? it->second : ch;
+}
+
+TextTranscoder::SimdLevel TextTranscoder::Simd() {
+#if KSWITCHER_X86
+    static const SimdLevel level = DetectSimd();
+    return level;
+#else
+    return SIMD_NONE;
+#endif
+}
+
+void TextTranscoder::Transcode(const char16_t* input, size_t count, char16_t* output, SimdLevel level) const {
+    switch (level < Simd() ? level : Simd()) {
+        case SIMD_AVX2:
+            TranscodeAvx2(input, count, output);
+            break;
+        case SIMD_SSSE3:
+            TranscodeSsse3(input, count, output);
+            break;
+        default:
+            TranscodeScalar(input, count, output);
+            break;
+    }
+}
+
+void TextTranscoder::TranscodeScalar(const char16_t* input, size_t count, char16_t* output) const {
+    for (size_t i = 0; i < count; ++i) {
+        output[i] = Map(input[i]);
+    }
+}
+
+#if KSWITCHER_X86
+TARGET_SSSE3 void TextTranscoder::TranscodeSsse3(const char16_t* input, size_t count, char16_t* output) const {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rangeMask = _mm_set1_epi16(static_cast<short>(0xFF80));
+    const __m128i cyrillicFirst = _mm_set1_epi16(static_cast<short>(CYRILLIC_FIRST));
+    const __m128i indexMask = _mm_set1_epi16(0x007F);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        // Both halves are loaded before anything is stored, so in place works
+        __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 8));
+
+        __m128i ascii = _mm_packs_epi16(_mm_cmpeq_epi16(_mm_and_si128(first, rangeMask), zero),
+                                        _mm_cmpeq_epi16(_mm_and_si128(second, rangeMask), zero));
+        __m128i cyrillic = _mm_packs_epi16(
+            _mm_cmpeq_epi16(_mm_and_si128(_mm_sub_epi16(first, cyrillicFirst), rangeMask), zero),
+            _mm_cmpeq_epi16(_mm_and_si128(_mm_sub_epi16(second, cyrillicFirst), rangeMask), zero));
+        uint32_t asciiBits = static_cast<uint32_t>(_mm_movemask_epi8(ascii));
+        uint32_t cyrillicBits = static_cast<uint32_t>(_mm_movemask_epi8(cyrillic));
+        uint32_t outside = ~(asciiBits | cyrillicBits) & 0xFFFF;
+        if (outside == 0xFFFF) {
+            TranscodeScalar(input + i, 16, output + i);
+            continue;
+        }
+
+        __m128i index = _mm_packus_epi16(_mm_and_si128(first, indexMask), _mm_and_si128(second, indexMask));
+        __m128i low, high;
+        if (cyrillicBits == 0) {
+            LookupPlanes(_planes[0], _planes[1], index, low, high);
+        } else if (asciiBits == 0) {
+            LookupPlanes(_planes[2], _planes[3], index, low, high);
+        } else {
+            __m128i cyrillicLow, cyrillicHigh;
+            LookupPlanes(_planes[0], _planes[1], index, low, high);
+            LookupPlanes(_planes[2], _planes[3], index, cyrillicLow, cyrillicHigh);
+            low = _mm_or_si128(_mm_and_si128(cyrillic, cyrillicLow), _mm_andnot_si128(cyrillic, low));
+            high = _mm_or_si128(_mm_and_si128(cyrillic, cyrillicHigh), _mm_andnot_si128(cyrillic, high));
+        }
+
+        // A dash or quote among the letters is mapped on its own, read
+        // before the store since output may be input
+        char16_t others[16];
+        for (uint32_t bits = outside; bits; bits &= bits - 1) {
+            int lane = LowestBit(bits);
+            others[lane] = MapOther(input[i + lane]);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_unpacklo_epi8(low, high));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i + 8), _mm_unpackhi_epi8(low, high));
+        for (uint32_t bits = outside; bits; bits &= bits - 1) {
+            int lane = LowestBit(bits);
+            output[i + lane] = others[lane];
+        }
+    }
+    TranscodeScalar(input + i, count - i, output + i);
+}
+
+// The SSSE3 loop on 32 characters per step. Packing works within 128-bit
+// halves, so the indexes come out as characters 0-7, 16-23, 8-15, 24-31;
+// unpacking the results undoes that.
+TARGET_AVX2 void TextTranscoder::TranscodeAvx2(const char16_t* input, size_t count, char16_t* output) const {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i rangeMask = _mm256_set1_epi16(static_cast<short>(0xFF80));
+    const __m256i cyrillicFirst = _mm256_set1_epi16(static_cast<short>(CYRILLIC_FIRST));
+    const __m256i indexMask = _mm256_set1_epi16(0x007F);
+
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+        __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i + 16));
+
+        __m256i ascii = _mm256_packs_epi16(_mm256_cmpeq_epi16(_mm256_and_si256(first, rangeMask), zero),
+                                           _mm256_cmpeq_epi16(_mm256_and_si256(second, rangeMask), zero));
+        __m256i cyrillic = _mm256_packs_epi16(
+            _mm256_cmpeq_epi16(_mm256_and_si256(_mm256_sub_epi16(first, cyrillicFirst), rangeMask), zero),
+            _mm256_cmpeq_epi16(_mm256_and_si256(_mm256_sub_epi16(second, cyrillicFirst), rangeMask), zero));
+        uint32_t asciiBits = static_cast<uint32_t>(_mm256_movemask_epi8(ascii));
+        uint32_t cyrillicBits = static_cast<uint32_t>(_mm256_movemask_epi8(cyrillic));
+        uint32_t outside = ~(asciiBits | cyrillicBits);
+        if (outside == 0xFFFFFFFFu) {
+            TranscodeScalar(input + i, 32, output + i);
+            continue;
+        }
+
+        __m256i index = _mm256_packus_epi16(_mm256_and_si256(first, indexMask), _mm256_and_si256(second, indexMask));
+        __m256i low, high;
+        if (cyrillicBits == 0) {
+            LookupPlanes(_planes[0], _planes[1], index, low, high);
+        } else if (asciiBits == 0) {
+            LookupPlanes(_planes[2], _planes[3], index, low, high);
+        } else {
+            __m256i cyrillicLow, cyrillicHigh;
+            LookupPlanes(_planes[0], _planes[1], index, low, high);
+            LookupPlanes(_planes[2], _planes[3], index, cyrillicLow, cyrillicHigh);
+            low = _mm256_blendv_epi8(low, cyrillicLow, cyrillic);
+            high = _mm256_blendv_epi8(high, cyrillicHigh, cyrillic);
+        }
+
+        // Mask bits are in packed order: swapping bits 3 and 4 gives the
+        // character
+        char16_t others[32];
+        for (uint32_t bits = outside; bits; bits &= bits - 1) {
+            int lane = LowestBit(bits);
+            lane = (lane & ~0x18) | ((lane & 0x08) << 1) | ((lane & 0x10) >> 1);
+            others[lane] = MapOther(input[i + lane]);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), _mm256_unpacklo_epi8(low, high));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i + 16), _mm256_unpackhi_epi8(low, high));
+        for (uint32_t bits = outside; bits; bits &= bits - 1) {
+            int lane = LowestBit(bits);
+            lane = (lane & ~0x18) | ((lane & 0x08) << 1) | ((lane & 0x10) >> 1);
+            output[i + lane] = others[lane];
+        }
+    }
+    TranscodeSsse3(input + i, count - i, output + i);
+}
+#else
+void TextTranscoder::TranscodeSsse3(const char16_t* input, size_t count, char16_t* output) const {
+    TranscodeScalar(input, count, output);
+}
+
+void TextTranscoder::TranscodeAvx2(const char16_t* input, size_t count, char16_t* output) const {
+    TranscodeScalar(input, count, output);
+}
+#endif
\ No newline at end of file
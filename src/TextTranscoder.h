@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "LayoutTable.h"
+
+// Rewrites text typed under one layout as if it had been typed under
+// another: every character the source layout produces becomes what the
+// target layout produces on the same key and Shift state. Characters only
+// the target layout produces map back the other way, so text with both
+// scripts swaps each part. Everything else, surrogates included, passes
+// through unchanged.
+//
+// ASCII and the Cyrillic block, where nearly all layout text lives, sit in
+// two 128-entry tables. With SSSE3 the tables are split into byte planes
+// and looked up 16 characters at a time with PSHUFB, 32 with AVX2; blocks
+// holding other characters, and CPUs with neither, take the scalar path.
+class TextTranscoder {
+public:
+    static const size_t RANGE_SIZE = 128;
+    static const char16_t CYRILLIC_FIRST = 0x0400;
+
+    TextTranscoder();
+
+    void Build(const LayoutTable& source, const LayoutTable& target);
+
+    uint32_t SourceLayoutId() const { return _sourceId; }
+    uint32_t TargetLayoutId() const { return _targetId; }
+
+    // Vector paths, widest last
+    enum SimdLevel { SIMD_NONE, SIMD_SSSE3, SIMD_AVX2 };
+
+    // Streams over input, a vector of characters per step where it can.
+    // output may be input for an in-place conversion; otherwise they must
+    // not overlap.
+    void Transcode(const char16_t* input, size_t count, char16_t* output) const {
+        Transcode(input, count, output, Simd());
+    }
+
+    // The same on a path no wider than level, to compare them
+    void Transcode(const char16_t* input, size_t count, char16_t* output, SimdLevel level) const;
+    void TranscodeScalar(const char16_t* input, size_t count, char16_t* output) const;
+
+    char16_t Map(char16_t ch) const {
+        if (ch < RANGE_SIZE) return _ascii[ch];
+        if (static_cast<uint16_t>(ch - CYRILLIC_FIRST) < RANGE_SIZE) return _cyrillic[ch - CYRILLIC_FIRST];
+        return MapOther(ch);
+    }
+
+    // Widest path this CPU supports
+    static SimdLevel Simd();
+
+private:
+    char16_t MapOther(char16_t ch) const;
+    void Set(char16_t from, char16_t to);
+    void FillPlanes();
+    void TranscodeSsse3(const char16_t* input, size_t count, char16_t* output) const;
+    void TranscodeAvx2(const char16_t* input, size_t count, char16_t* output) const;
+
+    uint32_t _sourceId;
+    uint32_t _targetId;
+    char16_t _ascii[RANGE_SIZE];
+    char16_t _cyrillic[RANGE_SIZE];
+
+    // Same two tables as byte planes for PSHUFB: low and high bytes of the
+    // ASCII and Cyrillic results, 16-entry rows
+    alignas(16) uint8_t _planes[4][RANGE_SIZE];
+
+    // Sorted pairs for characters outside both ranges
+    std::vector<std::pair<char16_t, char16_t>> _others;
+};
\ No newline at end of file
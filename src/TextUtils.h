@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+
+// Case folding and letter tests for the scripts the layouts produce.
+// Deliberately locale-independent so results match on every platform.
+
+// 16-bit range checks joined with | rather than ||, so loops over many
+// characters at once compile to branch-free vector code
+inline bool IsLetterChar(char16_t ch) {
+    return (static_cast<uint16_t>((ch | 0x20) - u'a') < 26) |
+           ((static_cast<uint16_t>(ch - 0x00C0) < 0x0190) & (ch != 0x00D7) & (ch != 0x00F7)) |
+           (static_cast<uint16_t>(ch - 0x0400) < 0x0100);
+}
+
+inline char16_t ToLowerChar(char16_t ch) {
+    if (ch >= u'A' && ch <= u'Z') return static_cast<char16_t>(ch + 0x20);
+    if (ch >= 0x0410 && ch <= 0x042F) return static_cast<char16_t>(ch + 0x20);
+    if (ch >= 0x0400 && ch <= 0x040F) return static_cast<char16_t>(ch + 0x50);
+    if (ch >= 0x0490 && ch <= 0x04BF && !(ch & 1)) return static_cast<char16_t>(ch + 1);
+    if (ch >= 0x00C0 && ch <= 0x00DE && ch != 0x00D7) return static_cast<char16_t>(ch + 0x20);
+    return ch;
+}
\ No newline at end of file
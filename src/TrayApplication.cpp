@@ -1,19 +1,33 @@
 #include "TrayApplication.h"
 #include "resource.h"
+#include "Hotkeys.h"
 #include <algorithm>
+#include <fstream>
 #include <shellapi.h>
 
 TrayApplication* TrayApplication::_instance = nullptr;
 const wchar_t* TrayApplication::WINDOW_CLASS_NAME = L"kSwitcherWindow";
 
-TrayApplication::TrayApplication() 
-    : _hWnd(nullptr), _hIcon(nullptr), _layoutSwitchHook(nullptr), 
-      _altPressed(false), _shiftPressed(false) {
+TrayApplication::TrayApplication(StartupTrace& startup) 
+    : _startup(startup), _hWnd(nullptr), _hIcon(nullptr), _foreground(_foregroundSource),
+      _systemSource(_foreground), _systemState(_systemSource), _shownLayout(nullptr),
+      _appRules(_appIdentity), _focusKey(LayoutMemory::NO_KEY), _focusThread(0) {
     _instance = this;
 }
 
 TrayApplication::~TrayApplication() {
-    CleanupLayoutSwitchHook();
+    // Unhook before the handlers' owners go away, and destroy the owners
+    // before the dispatcher they are registered with
+    if (_keyboardHook) {
+        _keyboardHook->Uninstall();
+    }
+    _foreground.Stop();
+    _traceRecorder.reset();
+    _keyboardInterceptor.reset();
+    _keyboardHook.reset();
+    
+    // Writes any save still waiting for its delay
+    _settingsStore.reset();
     
     if (_hIcon) {
         DestroyIcon(_hIcon);
@@ -30,42 +44,42 @@ int TrayApplication::Run() {
     try {
         // Load settings
         _settings = std::make_unique<Settings>(Settings::Load());
+        _appRules.SetRules(_settings->appRules);
+        _startup.Mark("app.settings_load");
         
         // Create hidden window
         CreateHiddenWindow();
+        _startup.Mark("app.window");
+        
+        // Saves and outside edits of settings.yml are handled off this thread
+        _settingsStore = std::make_unique<SettingsStore>(_hWnd);
+        _settingsStore->Start(*_settings);
+        _startup.Mark("app.settings_store");
         
-        // Create tray icon
+        // Create tray icon; the theme read here stays cached for the menus
+        // once startup completes
         _hIcon = CreateTrayIcon();
         
-        // Initialize tray icon
+        // Initialize tray icon, the menu is filled in by CompleteStartup
         _trayIcon = std::make_unique<NativeTrayIcon>(
             _hWnd, _hIcon,
             L"kSwitcher - Alt+Shift to switch, Pause to correct text",
             [this](int menuId) { OnMenuItemSelected(menuId); }
         );
+        _startup.Mark("app.tray_icon");
         
-        // Build menu
-        _trayIcon->AddMenuItem(NativeTrayIcon::MENU_TEXT_CORRECTION, 
-                             L"Text Correction (Pause key)", 
-                             _settings->textCorrectionEnabled);
-        _trayIcon->AddMenuItem(NativeTrayIcon::MENU_LAYOUT_SWITCH, 
-                             L"Layout Switch (Alt+Shift)", 
-                             _settings->layoutSwitchEnabled);
-        _trayIcon->AddSeparator();
-        _trayIcon->AddMenuItem(NativeTrayIcon::MENU_AUTO_START, 
-                             L"Start with Windows", 
-                             Installation::IsInAutoStart());
-        _trayIcon->AddSeparator();
-        _trayIcon->AddMenuItem(NativeTrayIcon::MENU_EXIT, L"Exit");
+        // Initialize keyboard interceptor and the shared keyboard hook
+        _keyboardHook = std::make_unique<KeyboardHook>();
+        CreateKeyboardInterceptor();
+        _traceRecorder = std::make_unique<InputTraceRecorder>(_keyboardHook->GetDispatcher(), _foreground);
+        _startup.Mark("app.interceptor");
         
-        // Initialize keyboard interceptor
-        _keyboardInterceptor = std::make_unique<KeyboardInterceptor>();
-        if (_settings->textCorrectionEnabled) {
-            _keyboardInterceptor->StartIntercepting();
-        }
+        InitializeKeyboardHook();
+        _startup.Mark("app.hook_install");
+        _startup.MarkHooksActive();
         
-        // Initialize layout switch hook
-        InitializeLayoutSwitchHook();
+        // Handled by the first iteration of the loop below
+        PostMessage(_hWnd, WM_DEFERRED_INIT, 0, 0);
         
         // Message loop
         MSG msg;
@@ -81,6 +95,55 @@ int TrayApplication::Run() {
     }
 }
 
+void TrayApplication::CompleteStartup() {
+    if (_systemState.IsDarkTheme()) {
+        _trayIcon->EnableDarkMode();
+    }
+    _startup.Mark("deferred.dark_menus");
+    
+    BuildMenu();
+    _startup.Mark("deferred.menu");
+    
+    // Nothing saves settings before the menu exists, so the registry is
+    // read before any save could write the stale file value back
+    _settings->SyncAutoStartRegistry();
+    _startup.Mark("deferred.autostart_sync");
+    
+    SetTimer(_hWnd, TIMER_LAYOUT_POLL, LAYOUT_POLL_MS, nullptr);
+    ApplyLayoutIndicator();
+    _startup.Mark("deferred.layout_indicator");
+    
+    SaveStartupReport();
+}
+
+void TrayApplication::BuildMenu() {
+    _trayIcon->AddMenuItem(NativeTrayIcon::MENU_TEXT_CORRECTION, 
+                         L"Text Correction (Pause key)", 
+                         _settings->textCorrectionEnabled);
+    _trayIcon->AddMenuItem(NativeTrayIcon::MENU_LAYOUT_SWITCH, 
+                         L"Layout Switch (Alt+Shift)", 
+                         _settings->layoutSwitchEnabled);
+    _trayIcon->AddSeparator();
+    _trayIcon->AddMenuItem(NativeTrayIcon::MENU_AUTO_START, 
+                         L"Start with Windows", 
+                         Installation::IsInAutoStart());
+    _trayIcon->AddSeparator();
+    _trayIcon->AddMenuItem(NativeTrayIcon::MENU_RECORD_TRACE, L"Record Input Trace", false);
+    _trayIcon->AddMenuItem(NativeTrayIcon::MENU_DIAGNOSTICS, L"Diagnostics...");
+    _trayIcon->AddSeparator();
+    _trayIcon->AddMenuItem(NativeTrayIcon::MENU_EXIT, L"Exit");
+}
+
+void TrayApplication::SaveStartupReport() {
+    std::wstring directory = Settings::GetSettingsDirectory();
+    if (directory.empty()) return;
+    CreateDirectoryW(directory.c_str(), nullptr);
+    
+    std::string report = _startup.Format();
+    std::ofstream file(directory + L"\\startup.txt", std::ios::binary | std::ios::trunc);
+    file.write(report.data(), report.size());
+}
+
 void TrayApplication::CreateHiddenWindow() {
     WNDCLASSEX wcex = {};
     wcex.cbSize = sizeof(wcex);
@@ -99,31 +162,23 @@ void TrayApplication::CreateHiddenWindow() {
 }
 
 HICON TrayApplication::CreateTrayIcon() {
-    // Decide light/dark based on system setting
-    auto isSystemDark = []() -> bool {
-        try {
-            HKEY hKey;
-            if (RegOpenKeyEx(HKEY_CURRENT_USER,
-                             L"Software\\Microsoft\\Windows\\CurrentVersion\\Themes\\Personalize",
-                             0, KEY_READ, &hKey) == ERROR_SUCCESS) {
-                DWORD value = 0, size = sizeof(value), type = 0;
-                LONG res = RegQueryValueEx(hKey, L"AppsUseLightTheme", nullptr, &type,
-                                           reinterpret_cast<BYTE*>(&value), &size);
-                RegCloseKey(hKey);
-                return (res == ERROR_SUCCESS && type == REG_DWORD && value == 0);
-            }
-        } catch (...) {}
-        return false;
-    }();
+    HICON hIcon = LoadTrayIcon(_systemState.IsDarkTheme());
+    if (!hIcon) hIcon = LoadIcon(nullptr, IDI_APPLICATION);
+    return hIcon;
+}
 
-    // Get DPI-aware icon size
-    HDC hdc = GetDC(nullptr);
-    int dpi = GetDeviceCaps(hdc, LOGPIXELSX);
-    ReleaseDC(nullptr, hdc);
-    
+HICON TrayApplication::LoadTrayIcon(bool dark) {
+    int iconSize = GetTrayIconSize();
+    int resId = dark ? IDI_TRAYICON_DARK : IDI_TRAYICON_LIGHT;
+    return static_cast<HICON>(
+        LoadImage(GetModuleHandle(nullptr), MAKEINTRESOURCE(resId),
+                  IMAGE_ICON, iconSize, iconSize, LR_DEFAULTCOLOR));
+}
+
+int TrayApplication::GetTrayIconSize() {
     // Calculate proper icon size based on DPI
     // Standard is 16px at 96 DPI, scale accordingly
-    int iconSize = MulDiv(16, dpi, 96);
+    int iconSize = MulDiv(16, _systemState.Dpi(), 96);
     
     // Round to nearest standard size for better quality
     if (iconSize <= 16) iconSize = 16;
@@ -132,72 +187,134 @@ HICON TrayApplication::CreateTrayIcon() {
     else if (iconSize <= 48) iconSize = 48;
     else if (iconSize <= 64) iconSize = 64;
     else iconSize = 128;
+    return iconSize;
+}
 
-    int resId = isSystemDark ? IDI_TRAYICON_DARK : IDI_TRAYICON_LIGHT;
-    HICON hIcon = static_cast<HICON>(
-        LoadImage(GetModuleHandle(nullptr), MAKEINTRESOURCE(resId),
-                  IMAGE_ICON, iconSize, iconSize, LR_DEFAULTCOLOR));
-    if (!hIcon) hIcon = LoadIcon(nullptr, IDI_APPLICATION);
-    return hIcon;
+void TrayApplication::UpdateTrayIcon() {
+    if (!_trayIcon || !_hWnd) return;
+    
+    HICON newIcon = LoadTrayIcon(_systemState.IsDarkTheme());
+    if (!newIcon) return;
+    
+    HICON oldIcon = _hIcon;
+    _hIcon = newIcon;
+    if (_settings->showLayoutInTray) {
+        // Badges follow the theme and the DPI as well
+        _layoutIndicator.SetIconSize(GetTrayIconSize());
+        UpdateLayoutIndicator(true);
+    } else {
+        _trayIcon->SetIcon(_hIcon);
+    }
+    
+    // Clean up old icon once the tray no longer shows it
+    if (oldIcon && oldIcon != newIcon) {
+        DestroyIcon(oldIcon);
+    }
 }
 
-bool TrayApplication::IsSystemInDarkMode() {
-    try {
-        HKEY hKey;
-        if (RegOpenKeyEx(HKEY_CURRENT_USER,
-                         L"Software\\Microsoft\\Windows\\CurrentVersion\\Themes\\Personalize",
-                         0, KEY_READ, &hKey) == ERROR_SUCCESS) {
-            DWORD value = 0, size = sizeof(value), type = 0;
-            LONG res = RegQueryValueEx(hKey, L"AppsUseLightTheme", nullptr, &type,
-                                       reinterpret_cast<BYTE*>(&value), &size);
-            RegCloseKey(hKey);
-            return (res == ERROR_SUCCESS && type == REG_DWORD && value == 0);
-        }
-    } catch (...) {}
-    return false;
+void TrayApplication::ApplyLayoutIndicator() {
+    if (_settings->showLayoutInTray) {
+        _layoutIndicator.SetIconSize(GetTrayIconSize());
+        UpdateLayoutIndicator(true);
+    } else {
+        _shownLayout = nullptr;
+        _trayIcon->SetIcon(_hIcon);
+    }
 }
 
-void TrayApplication::UpdateTrayIcon() {
-    if (!_trayIcon || !_hWnd) return;
+void TrayApplication::PollForegroundLayout() {
+    // Our own window is in front while the tray menu is open
+    _foreground.Refresh();
+    if (_foreground.Window() == _hWnd) return;
     
-    // Get DPI-aware icon size
-    HDC hdc = GetDC(nullptr);
-    int dpi = GetDeviceCaps(hdc, LOGPIXELSX);
-    ReleaseDC(nullptr, hdc);
+    _systemState.RefreshForegroundLayout();
+    if (_settings->showLayoutInTray) {
+        UpdateLayoutIndicator(false);
+    }
+}
+
+void TrayApplication::OnForegroundChange(void* context, HWND window) {
+    auto* self = static_cast<TrayApplication*>(context);
+    self->_systemState.OnEvent(SystemStateCache::EVENT_FOREGROUND_CHANGE);
     
-    // Calculate proper icon size based on DPI
-    int iconSize = MulDiv(16, dpi, 96);
+    // The tray menu is ours, not the application's; its rule stays
+    if (window != self->_hWnd) {
+        self->ApplyAppPolicy(window);
+        self->SwitchLayoutMemory(window);
+    }
     
-    // Round to nearest standard size for better quality
-    if (iconSize <= 16) iconSize = 16;
-    else if (iconSize <= 24) iconSize = 24;
-    else if (iconSize <= 32) iconSize = 32;
-    else if (iconSize <= 48) iconSize = 48;
-    else if (iconSize <= 64) iconSize = 64;
-    else iconSize = 128;
+    // The new window's layout shows at once instead of on the next poll;
+    // nothing is shown before startup completes or while our menu is up
+    if (self->_settings->showLayoutInTray && self->_shownLayout && window != self->_hWnd) {
+        self->UpdateLayoutIndicator(false);
+    }
+}
+
+void TrayApplication::ApplyAppPolicy(HWND window) {
+    // Resolved once per focus change; the hooks only read the mask it sets
+    AppPolicy policy = _appRules.Resolve(window);
+    _appPolicy = policy;
     
-    int resId = IsSystemInDarkMode() ? IDI_TRAYICON_DARK : IDI_TRAYICON_LIGHT;
-    HICON newIcon = static_cast<HICON>(
-        LoadImage(GetModuleHandle(nullptr), MAKEINTRESOURCE(resId),
-                  IMAGE_ICON, iconSize, iconSize, LR_DEFAULTCOLOR));
+    uint32_t suspended = 0;
+    if (policy.flags & AppPolicy::NO_BUFFERING) {
+        suspended |= 1u << HookDispatcher::HANDLER_RECORDING;
+    }
+    if (policy.flags & AppPolicy::NO_HOTKEYS) {
+        suspended |= (1u << HookDispatcher::HANDLER_LAYOUT_SWITCH) | (1u << HookDispatcher::HANDLER_CORRECTION);
+    }
+    _keyboardHook->GetDispatcher().SetSuspended(suspended);
+    _keyboardInterceptor->SetInjection(static_cast<AppPolicy::Injection>(policy.injection));
     
-    if (newIcon) {
-        // Update the tray icon
-        NOTIFYICONDATA nid = {};
-        nid.cbSize = sizeof(nid);
-        nid.hWnd = _hWnd;
-        nid.uID = 1;
-        nid.uFlags = NIF_ICON;
-        nid.hIcon = newIcon;
-        
-        Shell_NotifyIcon(NIM_MODIFY, &nid);
-        
-        // Clean up old icon if it exists
-        if (_hIcon && _hIcon != newIcon) {
-            DestroyIcon(_hIcon);
+    // Every time the application comes to the front, as a user switching
+    // back would expect
+    if (!policy.layout || !window) return;
+    size_t count = 0;
+    const HKL* layouts = _systemState.Layouts(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (!AppPolicy::MatchesLayout(policy.layout, layouts[i])) continue;
+        if (layouts[i] != _systemState.ForegroundLayout()) {
+            PostMessage(window, WM_INPUTLANGCHANGEREQUEST, 0, reinterpret_cast<LPARAM>(layouts[i]));
         }
-        _hIcon = newIcon;
+        break;
+    }
+}
+
+void TrayApplication::SwitchLayoutMemory(HWND window) {
+    if (!_settings->layoutMemoryEnabled) return;
+    uint64_t start = LatencyClock::Now();
+    
+    // The layout the previous window leaves with; its thread may be gone
+    if (_focusKey != LayoutMemory::NO_KEY) {
+        _layoutMemory.Save(_focusKey, GetKeyboardLayout(_focusThread));
     }
+    
+    DWORD processId = 0;
+    _focusThread = window ? GetWindowThreadProcessId(window, &processId) : 0;
+    if (!_focusThread) {
+        _focusKey = LayoutMemory::NO_KEY;
+    } else if (_settings->layoutMemoryPerApplication) {
+        _focusKey = LayoutMemory::ProcessKey(processId);
+    } else {
+        _focusKey = LayoutMemory::WindowKey(window, _focusThread);
+    }
+    
+    // A rule's layout wins over the remembered one
+    if (_focusKey == LayoutMemory::NO_KEY || _appPolicy.layout) return;
+    HKL layout = _layoutMemory.Recall(_focusKey);
+    if (layout && layout != GetKeyboardLayout(_focusThread)) {
+        PostMessage(window, WM_INPUTLANGCHANGEREQUEST, 0, reinterpret_cast<LPARAM>(layout));
+        _keyboardHook->GetDispatcher().GetLatency().Get(LatencyMetrics::LAYOUT_RESTORE).RecordSince(start);
+    }
+}
+
+void TrayApplication::UpdateLayoutIndicator(bool force) {
+    HKL layout = _systemState.ForegroundLayout();
+    if (!layout || (layout == _shownLayout && !force)) return;
+    _shownLayout = layout;
+    
+    // Layouts without a language code show the app icon
+    HICON icon = _layoutIndicator.GetIcon(layout, _systemState.IsDarkTheme());
+    _trayIcon->SetIcon(icon ? icon : _hIcon);
 }
 
 void TrayApplication::OnMenuItemSelected(int menuId) {
@@ -213,14 +330,16 @@ void TrayApplication::OnMenuItemSelected(int menuId) {
                 _keyboardInterceptor->StopIntercepting();
             }
             
-            _settings->Save();
+            _settingsStore->Save(*_settings);
             break;
             
         case NativeTrayIcon::MENU_LAYOUT_SWITCH:
             _settings->layoutSwitchEnabled = !_settings->layoutSwitchEnabled;
             _trayIcon->UpdateMenuItem(NativeTrayIcon::MENU_LAYOUT_SWITCH, 
                                     _settings->layoutSwitchEnabled);
-            _settings->Save();
+            _keyboardHook->GetDispatcher().SetEnabled(HookDispatcher::HANDLER_LAYOUT_SWITCH,
+                                                      _settings->layoutSwitchEnabled);
+            _settingsStore->Save(*_settings);
             break;
             
         case NativeTrayIcon::MENU_AUTO_START: {
@@ -247,22 +366,166 @@ void TrayApplication::OnMenuItemSelected(int menuId) {
             break;
         }
             
+        case NativeTrayIcon::MENU_RECORD_TRACE:
+            ToggleTraceRecording();
+            break;
+            
+        case NativeTrayIcon::MENU_DIAGNOSTICS:
+            ShowDiagnostics();
+            break;
+            
         case NativeTrayIcon::MENU_EXIT:
             PostQuitMessage(0);
             break;
     }
 }
 
-void TrayApplication::InitializeLayoutSwitchHook() {
-    _layoutSwitchHook = SetWindowsHookEx(WH_KEYBOARD_LL, KeyboardHookProc,
-                                       GetModuleHandle(nullptr), 0);
+void TrayApplication::ToggleTraceRecording() {
+    if (!_traceRecorder->IsRecording()) {
+        _traceRecorder->Start();
+        _trayIcon->UpdateMenuItem(NativeTrayIcon::MENU_RECORD_TRACE, true);
+        return;
+    }
+    
+    _trayIcon->UpdateMenuItem(NativeTrayIcon::MENU_RECORD_TRACE, false);
+    
+    std::wstring directory = Settings::GetSettingsDirectory();
+    if (directory.empty()) return;
+    CreateDirectoryW(directory.c_str(), nullptr);
+    directory += L"\\traces";
+    CreateDirectoryW(directory.c_str(), nullptr);
+    
+    SYSTEMTIME now;
+    GetLocalTime(&now);
+    wchar_t fileName[64];
+    swprintf_s(fileName, L"\\trace-%04u%02u%02u-%02u%02u%02u.kstr",
+               now.wYear, now.wMonth, now.wDay, now.wHour, now.wMinute, now.wSecond);
+    std::wstring path = directory + fileName;
+    
+    size_t recordCount = _traceRecorder->RecordCount();
+    size_t droppedCount = _traceRecorder->DroppedCount();
+    if (_traceRecorder->Stop(path)) {
+        std::wstring message = L"Recorded " + std::to_wstring(recordCount) + L" events to\n" + path;
+        if (droppedCount > 0) {
+            message += L"\n\n" + std::to_wstring(droppedCount) + L" events did not fit and were dropped.";
+        }
+        MessageBox(nullptr, message.c_str(), L"Input Trace", MB_OK | MB_ICONINFORMATION);
+    } else {
+        MessageBox(nullptr, (L"Failed to write " + path).c_str(), L"Input Trace", MB_OK | MB_ICONERROR);
+    }
+}
+
+void TrayApplication::ShowDiagnostics() {
+    std::string report = _keyboardHook->GetDispatcher().GetLatency().Format() + "\n" +
+                         _startup.Format() + "\n" + _systemState.Format() + _foreground.Format() +
+                         _appRules.Format() + _layoutMemory.Format() + _userWords.Format();
+    std::wstring message(report.begin(), report.end());
+    
+    // Saved next to settings.yml so it can be attached to a bug report
+    std::wstring directory = Settings::GetSettingsDirectory();
+    if (!directory.empty()) {
+        CreateDirectoryW(directory.c_str(), nullptr);
+        std::wstring path = directory + L"\\diagnostics.txt";
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (file.is_open() && file.write(report.data(), report.size())) {
+            message += L"\nSaved to " + path;
+        }
+    }
+    
+    MessageBox(nullptr, message.c_str(), L"Diagnostics", MB_OK | MB_ICONINFORMATION);
 }
 
-void TrayApplication::CleanupLayoutSwitchHook() {
-    if (_layoutSwitchHook) {
-        UnhookWindowsHookEx(_layoutSwitchHook);
-        _layoutSwitchHook = nullptr;
+void TrayApplication::CreateKeyboardInterceptor() {
+    // The old interceptor, if any, disables its handlers before the new one
+    // registers; hooks run on this thread, so none is mid-call
+    _keyboardInterceptor.reset();
+    
+    AutoCorrectOptions autoCorrect;
+    autoCorrect.enabled = _settings->autoCorrectEnabled;
+    autoCorrect.minLetters = _settings->autoCorrectMinLetters;
+    autoCorrect.margin = _settings->autoCorrectMargin;
+    _keyboardInterceptor = std::make_unique<KeyboardInterceptor>(
+        _keyboardHook->GetDispatcher(), _foreground,
+        static_cast<size_t>(std::max(_settings->keystrokeBufferSize, 1)), autoCorrect, _userWords,
+        Settings::GetSettingsDirectory());
+    _keyboardInterceptor->SetInjection(static_cast<AppPolicy::Injection>(_appPolicy.injection));
+    _keyboardInterceptor->SetPhraseWords(static_cast<size_t>(_settings->phraseCorrectionWords));
+    if (_settings->textCorrectionEnabled) {
+        _keyboardInterceptor->StartIntercepting();
+    }
+}
+
+void TrayApplication::ApplyReloadedSettings() {
+    Settings reloaded;
+    if (!_settingsStore->TakeReloaded(reloaded)) return;
+    
+    // Auto-start is owned by the registry and the menu, not the file
+    reloaded.autoStartWithWindows = _settings->autoStartWithWindows;
+    
+    bool correctionChanged = reloaded.textCorrectionEnabled != _settings->textCorrectionEnabled;
+    // The worker takes the buffer size and auto-correct options when it is
+    // created
+    bool workerChanged = reloaded.keystrokeBufferSize != _settings->keystrokeBufferSize ||
+                         reloaded.autoCorrectEnabled != _settings->autoCorrectEnabled ||
+                         reloaded.autoCorrectMinLetters != _settings->autoCorrectMinLetters ||
+                         reloaded.autoCorrectMargin != _settings->autoCorrectMargin;
+    bool layoutSwitchChanged = reloaded.layoutSwitchEnabled != _settings->layoutSwitchEnabled;
+    bool indicatorChanged = reloaded.showLayoutInTray != _settings->showLayoutInTray;
+    bool rulesChanged = reloaded.appRules != _settings->appRules;
+    bool layoutMemoryChanged = reloaded.layoutMemoryEnabled != _settings->layoutMemoryEnabled ||
+                               reloaded.layoutMemoryPerApplication != _settings->layoutMemoryPerApplication;
+    *_settings = reloaded;
+    
+    if (workerChanged) {
+        CreateKeyboardInterceptor();
+    } else if (correctionChanged) {
+        if (_settings->textCorrectionEnabled) {
+            _keyboardInterceptor->StartIntercepting();
+        } else {
+            _keyboardInterceptor->StopIntercepting();
+        }
+    }
+    _keyboardInterceptor->SetPhraseWords(static_cast<size_t>(_settings->phraseCorrectionWords));
+    if (correctionChanged) {
+        _trayIcon->UpdateMenuItem(NativeTrayIcon::MENU_TEXT_CORRECTION, _settings->textCorrectionEnabled);
+    }
+    
+    if (layoutSwitchChanged) {
+        _trayIcon->UpdateMenuItem(NativeTrayIcon::MENU_LAYOUT_SWITCH, _settings->layoutSwitchEnabled);
+        _keyboardHook->GetDispatcher().SetEnabled(HookDispatcher::HANDLER_LAYOUT_SWITCH,
+                                                  _settings->layoutSwitchEnabled);
+    }
+    
+    if (indicatorChanged) {
+        ApplyLayoutIndicator();
+    }
+    
+    if (rulesChanged) {
+        _appRules.SetRules(_settings->appRules);
+        ApplyAppPolicy(_foreground.Window());
     }
+    
+    // Keys of one mode mean nothing in the other
+    if (layoutMemoryChanged) {
+        _layoutMemory.Clear();
+        _focusKey = LayoutMemory::NO_KEY;
+        SwitchLayoutMemory(_foreground.Window());
+    }
+}
+
+void TrayApplication::InitializeKeyboardHook() {
+    HookDispatcher& dispatcher = _keyboardHook->GetDispatcher();
+    dispatcher.SetHandler(HookDispatcher::HANDLER_LAYOUT_SWITCH, OnLayoutSwitchKey, this);
+    dispatcher.SetEnabled(HookDispatcher::HANDLER_LAYOUT_SWITCH, _settings->layoutSwitchEnabled);
+    
+    // Before the hooks, so their first key already reads a tracked window;
+    // without the WinEvent hook every read asks user32 as before
+    _foreground.SetChangeHandler(OnForegroundChange, this);
+    _foreground.Start();
+    ApplyAppPolicy(_foreground.Window());
+    SwitchLayoutMemory(_foreground.Window());
+    
+    _keyboardHook->Install();
 }
 
 LRESULT CALLBACK TrayApplication::WindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
@@ -272,13 +535,42 @@ LRESULT CALLBACK TrayApplication::WindowProc(HWND hWnd, UINT message, WPARAM wPa
     
     switch (message) {
         case WM_SETTINGCHANGE:
-            // Check if theme changed
-            if (lParam && wcscmp(reinterpret_cast<LPCWSTR>(lParam), L"ImmersiveColorSet") == 0) {
-                if (_instance) {
+            if (_instance) {
+                _instance->_systemState.OnEvent(SystemStateCache::EVENT_SETTING_CHANGE);
+                
+                // Check if theme changed
+                if (lParam && wcscmp(reinterpret_cast<LPCWSTR>(lParam), L"ImmersiveColorSet") == 0) {
                     _instance->UpdateTrayIcon();
                 }
             }
             break;
+        case WM_TIMER:
+            if (wParam == TIMER_LAYOUT_POLL && _instance) {
+                _instance->PollForegroundLayout();
+            }
+            break;
+        case WM_DPICHANGED:
+        case WM_DISPLAYCHANGE:
+            if (_instance) {
+                _instance->_systemState.OnEvent(SystemStateCache::EVENT_DPI_CHANGE);
+                _instance->UpdateTrayIcon();
+            }
+            break;
+        case WM_INPUTLANGCHANGE:
+            if (_instance) {
+                _instance->_systemState.OnEvent(SystemStateCache::EVENT_INPUT_LANG_CHANGE);
+            }
+            return DefWindowProc(hWnd, message, wParam, lParam);
+        case WM_DEFERRED_INIT:
+            if (_instance) {
+                _instance->CompleteStartup();
+            }
+            break;
+        case SettingsStore::WM_SETTINGS_RELOADED:
+            if (_instance) {
+                _instance->ApplyReloadedSettings();
+            }
+            break;
         case WM_DESTROY:
             PostQuitMessage(0);
             break;
@@ -289,34 +581,18 @@ LRESULT CALLBACK TrayApplication::WindowProc(HWND hWnd, UINT message, WPARAM wPa
     return 0;
 }
 
-LRESULT CALLBACK TrayApplication::KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
-    if (nCode >= 0 && _instance && _instance->_settings->layoutSwitchEnabled) {
-        KBDLLHOOKSTRUCT* pKbdStruct = reinterpret_cast<KBDLLHOOKSTRUCT*>(lParam);
-        int vkCode = pKbdStruct->vkCode;
-        bool isKeyDown = (wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN);
-        bool isKeyUp = (wParam == WM_KEYUP || wParam == WM_SYSKEYUP);
-        
-        bool isAlt = (vkCode == VK_MENU || vkCode == VK_LMENU || vkCode == VK_RMENU);
-        bool isShift = (vkCode == VK_SHIFT || vkCode == VK_LSHIFT || vkCode == VK_RSHIFT);
-        
-        if (isAlt) {
-            _instance->_altPressed = isKeyDown;
-        } else if (isShift) {
-            _instance->_shiftPressed = isKeyDown;
-        }
-        
-        // Trigger layout switch on Alt+Shift
-        if (isKeyDown && _instance->_altPressed && _instance->_shiftPressed) {
-            HWND hWnd = GetForegroundWindow();
-            if (hWnd) {
-                PostMessage(hWnd, WM_INPUTLANGCHANGEREQUEST, 0x02, 0);
-            }
-            
-            _instance->_altPressed = false;
-            _instance->_shiftPressed = false;
-            return 1; // Suppress the key
+bool TrayApplication::OnLayoutSwitchKey(void* context, UINT message, const KBDLLHOOKSTRUCT& event) {
+    auto* self = static_cast<TrayApplication*>(context);
+    
+    // Trigger layout switch when Alt+Shift becomes held
+    ModifierState::Snapshot modifiers = self->_keyboardHook->GetDispatcher().GetModifiers().Load();
+    if (Hotkeys::IsLayoutSwitch(message, modifiers)) {
+        HWND hWnd = self->_foreground.Window();
+        if (hWnd) {
+            PostMessage(hWnd, WM_INPUTLANGCHANGEREQUEST, 0x02, 0);
         }
+        return true; // Suppress the key
     }
     
-    return CallNextHookEx(nullptr, nCode, wParam, lParam);
-}
+    return false;
+}
\ No newline at end of file
@@ -2,39 +2,85 @@
 #include <windows.h>
 #include <memory>
 #include "Settings.h"
+#include "SettingsStore.h"
 #include "NativeTrayIcon.h"
 #include "KeyboardInterceptor.h"
+#include "KeyboardHook.h"
+#include "InputTraceRecorder.h"
 #include "Installation.h"
+#include "StartupTrace.h"
+#include "LayoutIndicator.h"
+#include "Win32SystemState.h"
+#include "Win32ForegroundSource.h"
+#include "Win32AppIdentity.h"
+#include "AppRuleMatcher.h"
+#include "LayoutMemory.h"
 
 class TrayApplication {
 public:
-    TrayApplication();
+    explicit TrayApplication(StartupTrace& startup);
     ~TrayApplication();
     
     int Run();
 
 private:
     static LRESULT CALLBACK WindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
-    static LRESULT CALLBACK KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam);
+    static bool OnLayoutSwitchKey(void* context, UINT message, const KBDLLHOOKSTRUCT& event);
+    static void OnForegroundChange(void* context, HWND window);
     
     void CreateHiddenWindow();
     HICON CreateTrayIcon();
+    HICON LoadTrayIcon(bool dark);
+    int GetTrayIconSize();
+    void ApplyLayoutIndicator();
+    void PollForegroundLayout();
+    void UpdateLayoutIndicator(bool force);
+    void BuildMenu();
+    void CompleteStartup();
+    void SaveStartupReport();
     void OnMenuItemSelected(int menuId);
-    void InitializeLayoutSwitchHook();
-    void CleanupLayoutSwitchHook();
+    void InitializeKeyboardHook();
+    void ToggleTraceRecording();
+    void ShowDiagnostics();
+    void ApplyReloadedSettings();
+    void CreateKeyboardInterceptor();
+    void ApplyAppPolicy(HWND window);
+    void SwitchLayoutMemory(HWND window);
     void UpdateTrayIcon();
-    bool IsSystemInDarkMode();
     
+    // Posted before the message loop starts; work that does not have to
+    // happen before the hooks are live runs from its handler
+    static const UINT WM_DEFERRED_INIT = WM_APP + 2;
+    
+    // Other processes switch layouts without telling us, so the foreground
+    // window's layout is polled into the state cache; a poll that finds no
+    // change costs three user32 calls. It also catches foreground changes
+    // the WinEvent hook did not report.
+    static const UINT_PTR TIMER_LAYOUT_POLL = 1;
+    static const UINT LAYOUT_POLL_MS = 150;
+    
+    StartupTrace& _startup;
     HWND _hWnd;
     HICON _hIcon;
+    Win32ForegroundSource _foregroundSource;
+    ForegroundTracker _foreground;
+    Win32SystemState _systemSource;
+    SystemStateCache _systemState;
+    LayoutIndicator _layoutIndicator;
+    HKL _shownLayout;
+    Win32AppIdentity _appIdentity;
+    AppRuleMatcher _appRules;
+    AppPolicy _appPolicy;
+    LayoutMemory _layoutMemory;
+    uint64_t _focusKey;             // Layout memory key of the window in front
+    DWORD _focusThread;
+    UserDictionary _userWords;      // Opened by the interceptor's worker
     std::unique_ptr<Settings> _settings;
+    std::unique_ptr<SettingsStore> _settingsStore;
     std::unique_ptr<NativeTrayIcon> _trayIcon;
+    std::unique_ptr<KeyboardHook> _keyboardHook;
     std::unique_ptr<KeyboardInterceptor> _keyboardInterceptor;
-    
-    // Layout switch hook data
-    HHOOK _layoutSwitchHook;
-    bool _altPressed;
-    bool _shiftPressed;
+    std::unique_ptr<InputTraceRecorder> _traceRecorder;
     
     static TrayApplication* _instance;
     static const wchar_t* WINDOW_CLASS_NAME;
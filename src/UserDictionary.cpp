@@ -0,0 +1,290 @@
+#include "UserDictionary.h"
+#include <cstdio>
+#include <cstring>
+
+const char* const UserDictionary::SNAPSHOT_NAME = "userwords.bin";
+const char* const UserDictionary::JOURNAL_NAME = "userwords.journal";
+const char* const UserDictionary::ROTATED_JOURNAL_NAME = "userwords.journal.old";
+
+namespace {
+
+const size_t INITIAL_CAPACITY = 256;
+
+void Store32(uint8_t* out, uint32_t value) {
+    for (size_t i = 0; i < 4; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (i * 8));
+    }
+}
+
+void Store64(uint8_t* out, uint64_t value) {
+    for (size_t i = 0; i < 8; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (i * 8));
+    }
+}
+
+uint32_t Load32(const uint8_t* in) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(in[i]) << (i * 8);
+    }
+    return value;
+}
+
+uint64_t Load64(const uint8_t* in) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        value |= static_cast<uint64_t>(in[i]) << (i * 8);
+    }
+    return value;
+}
+
+// Last byte of a record: catches a record torn by a crash mid-append
+uint8_t Check(const uint8_t* record, size_t size) {
+    uint8_t check = 0xA5;
+    for (size_t i = 0; i < size; ++i) {
+        check = static_cast<uint8_t>((check << 1 | check >> 7) ^ record[i]);
+    }
+    return check;
+}
+
+} // namespace
+
+UserDictionary::UserDictionary() : _entries(INITIAL_CAPACITY), _count(0), _journalRecords(0) {
+}
+
+UserDictionary::~UserDictionary() {
+    Close();
+}
+
+uint64_t UserDictionary::Key(const KeystrokeInfo* keystrokes, size_t count, HKL layout) {
+    while (count > 0 && keystrokes[count - 1].VirtualKey() == VK_SPACE) {
+        --count;
+    }
+
+    // FNV-1a over the virtual keys, then the layout
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < count; ++i) {
+        hash = (hash ^ static_cast<uint64_t>(keystrokes[i].VirtualKey())) * 0x100000001B3ull;
+    }
+    hash = (hash ^ LayoutId(layout)) * 0x100000001B3ull;
+    return hash != 0 ? hash : 1;
+}
+
+NativePath UserDictionary::Path(const char* name) const {
+    NativePath path = _directory;
+#ifdef _WIN32
+    path += L'\\';
+#else
+    path += '/';
+#endif
+    for (const char* c = name; *c; ++c) {
+        path += static_cast<NativePath::value_type>(*c);
+    }
+    return path;
+}
+
+bool UserDictionary::Open(const NativePath& directory) {
+    Close();
+    _directory = directory;
+
+    // Oldest first: the snapshot, a journal set aside by a compaction that
+    // did not finish, then the journal
+    MappedFile file;
+    if (file.Open(Path(SNAPSHOT_NAME))) {
+        Replay(file, SNAPSHOT_MAGIC);
+    }
+    bool rotated = file.Open(Path(ROTATED_JOURNAL_NAME));
+    if (rotated) {
+        Replay(file, JOURNAL_MAGIC);
+    }
+    _journalRecords = 0;
+    bool valid = file.Open(Path(JOURNAL_NAME)) && Replay(file, JOURNAL_MAGIC);
+    if (valid) {
+        _journalRecords = (file.Size() - HEADER_SIZE + RECORD_SIZE - 1) / RECORD_SIZE;
+    }
+    file.Close();
+
+    if (!OpenJournal(valid)) {
+        return false;
+    }
+    if (rotated || _journalRecords >= COMPACT_RECORDS || _counters.badRecords > 0) {
+        Compact();
+    }
+    return true;
+}
+
+bool UserDictionary::OpenJournal(bool valid) {
+    // A missing journal, or one whose header is wrong and whose records
+    // were therefore not loaded, is started over
+    NativePath path = Path(JOURNAL_NAME);
+    if (!valid) {
+        uint8_t header[HEADER_SIZE];
+        EncodeHeader(header, JOURNAL_MAGIC, 0);
+        if (!AppendFile::WriteAtomically(path, header, sizeof(header))) {
+            ++_counters.writeErrors;
+            return false;
+        }
+    }
+    if (!_journal.Open(path)) {
+        ++_counters.writeErrors;
+        return false;
+    }
+
+    // A record torn by a crash is padded out, so the next one starts on a
+    // record boundary again
+    size_t torn = static_cast<size_t>((_journal.Size() - HEADER_SIZE) % RECORD_SIZE);
+    if (torn > 0) {
+        uint8_t padding[RECORD_SIZE] = {};
+        _journal.Append(padding, RECORD_SIZE - torn);
+    }
+    return true;
+}
+
+void UserDictionary::Close() {
+    WaitForCompaction();
+    _journal.Close();
+}
+
+bool UserDictionary::Replay(const MappedFile& file, uint32_t magic) {
+    const uint8_t* data = file.Data();
+    size_t size = file.Size();
+    if (size < HEADER_SIZE || Load32(data) != magic || Load32(data + 4) != FORMAT_VERSION) {
+        return false;
+    }
+
+    for (size_t offset = HEADER_SIZE; offset + RECORD_SIZE <= size; offset += RECORD_SIZE) {
+        Entry entry;
+        if (!DecodeRecord(data + offset, entry)) {
+            ++_counters.badRecords;
+            continue;
+        }
+        Set(entry.key, entry.verdict, entry.layout);
+        ++_counters.loadedRecords;
+    }
+    if ((size - HEADER_SIZE) % RECORD_SIZE != 0) {
+        ++_counters.badRecords;
+    }
+    return true;
+}
+
+void UserDictionary::Set(uint64_t key, uint8_t verdict, uint32_t layout) {
+    size_t index = Find(key);
+    if (_entries[index].key == 0) {
+        if ((_count + 1) * 2 > _entries.size()) {
+            Grow();
+            index = Find(key);
+        }
+        _entries[index].key = key;
+        ++_count;
+    }
+    _entries[index].verdict = verdict;
+    _entries[index].layout = layout;
+}
+
+void UserDictionary::Grow() {
+    std::vector<Entry> old(_entries.size() * 2);
+    old.swap(_entries);
+    for (const Entry& entry : old) {
+        if (entry.key != 0) {
+            _entries[Find(entry.key)] = entry;
+        }
+    }
+}
+
+void UserDictionary::Learn(uint64_t key, Verdict verdict, HKL layout) {
+    if (key == 0 || verdict == VERDICT_NONE) return;
+
+    uint32_t layoutId = LayoutId(layout);
+    const Entry& current = _entries[Find(key)];
+    if (current.key == key && current.verdict == verdict && current.layout == layoutId) return;
+
+    Set(key, verdict, layoutId);
+    ++_counters.learned;
+    if (!_journal.IsOpen()) return;
+
+    Entry entry = { key, layoutId, static_cast<uint8_t>(verdict) };
+    uint8_t record[RECORD_SIZE];
+    EncodeRecord(record, entry);
+    if (!_journal.Append(record, RECORD_SIZE)) {
+        ++_counters.writeErrors;
+    }
+    if (++_journalRecords >= COMPACT_RECORDS) {
+        Compact();
+    }
+}
+
+bool UserDictionary::Compact() {
+    if (_directory.empty()) return false;
+    WaitForCompaction();
+
+    // Records from here on go to a fresh journal. A journal still set aside
+    // from a compaction that failed stays; this one writes everything in it
+    // too, and the current journal keeps growing until the next one.
+    NativePath rotatedPath = Path(ROTATED_JOURNAL_NAME);
+    _journal.Close();
+    bool rotated = !AppendFile::Exists(rotatedPath) && AppendFile::Move(Path(JOURNAL_NAME), rotatedPath);
+    if (rotated) {
+        _journalRecords = 0;
+    }
+    OpenJournal(!rotated);
+
+    // Encoded here, so the table is never read by the other thread
+    std::vector<uint8_t> snapshot(HEADER_SIZE + _count * RECORD_SIZE);
+    EncodeHeader(snapshot.data(), SNAPSHOT_MAGIC, _count);
+    uint8_t* out = snapshot.data() + HEADER_SIZE;
+    for (const Entry& entry : _entries) {
+        if (entry.key != 0) {
+            EncodeRecord(out, entry);
+            out += RECORD_SIZE;
+        }
+    }
+    ++_counters.compactions;
+
+    NativePath snapshotPath = Path(SNAPSHOT_NAME);
+    _compactor = std::thread([snapshot = std::move(snapshot), snapshotPath, rotatedPath]() {
+        if (AppendFile::WriteAtomically(snapshotPath, snapshot.data(), snapshot.size())) {
+            AppendFile::Remove(rotatedPath);
+        }
+    });
+    return true;
+}
+
+void UserDictionary::WaitForCompaction() {
+    if (_compactor.joinable()) {
+        _compactor.join();
+    }
+}
+
+void UserDictionary::EncodeHeader(uint8_t* out, uint32_t magic, uint64_t count) {
+    Store32(out, magic);
+    Store32(out + 4, FORMAT_VERSION);
+    Store64(out + 8, count);
+}
+
+void UserDictionary::EncodeRecord(uint8_t* out, const Entry& entry) {
+    Store64(out, entry.key);
+    Store32(out + 8, entry.layout);
+    out[12] = entry.verdict;
+    out[13] = 0;
+    out[14] = 0;
+    out[15] = Check(out, RECORD_SIZE - 1);
+}
+
+bool UserDictionary::DecodeRecord(const uint8_t* in, Entry& entry) {
+    if (in[15] != Check(in, RECORD_SIZE - 1)) return false;
+    entry.key = Load64(in);
+    entry.layout = Load32(in + 8);
+    entry.verdict = in[12];
+    return entry.key != 0 && (entry.verdict == VERDICT_ACCEPTED || entry.verdict == VERDICT_REJECTED);
+}
+
+std::string UserDictionary::Format() const {
+    char line[200];
+    double hitRate = _counters.lookups ? 100.0 * _counters.hits / _counters.lookups : 0.0;
+    snprintf(line, sizeof(line),
+             "user words: %zu, %.1f%% of lookups known, %llu journal records, %llu compactions, %llu bad records\n",
+             _count, hitRate, static_cast<unsigned long long>(_journalRecords),
+             static_cast<unsigned long long>(_counters.compactions),
+             static_cast<unsigned long long>(_counters.badRecords));
+    return line;
+}
\ No newline at end of file
@@ -0,0 +1,149 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Win32Compat.h"
+#include "AppendFile.h"
+#include "Keystroke.h"
+#include "MappedFile.h"
+
+// What the user did with corrections before: keys typed in a layout that
+// were corrected and kept (accepted, meant in another layout), or taken
+// back with another Pause (rejected, right as typed). The correction code
+// asks it before ranking, so a word the user has settled costs one hash
+// probe.
+//
+// Words live in an open-addressed table in memory. Once opened on a
+// directory, every change is appended to a journal as one fixed-size
+// record; when the journal grows long it is set aside and the whole table
+// is written as a snapshot on a background thread. Opening maps the
+// snapshot, then replays the set-aside journal and the journal. A record
+// only ever sets a word, so replaying records the snapshot already has
+// changes nothing, and a compaction cut short loses nothing.
+//
+// Owned by the correction worker; not thread-safe. Open and Close may be
+// called before and after the worker runs.
+class UserDictionary {
+public:
+    enum Verdict : uint8_t {
+        VERDICT_NONE = 0,
+        VERDICT_ACCEPTED,       // Meant in layout
+        VERDICT_REJECTED        // Right as typed
+    };
+
+    struct Entry {
+        uint64_t key;           // 0 when free
+        uint32_t layout;        // LayoutId of the layout meant
+        uint8_t verdict;
+    };
+
+    struct Counters {
+        uint64_t lookups = 0;
+        uint64_t hits = 0;
+        uint64_t learned = 0;           // Changes, each one journal record
+        uint64_t loadedRecords = 0;     // Snapshot and journal records read by Open
+        uint64_t badRecords = 0;        // Torn or corrupt records skipped
+        uint64_t writeErrors = 0;
+        uint64_t compactions = 0;
+    };
+
+    // Journal records that start a compaction
+    static const size_t COMPACT_RECORDS = 4096;
+
+    // On-disk record and file header; both files are little-endian
+    static const size_t RECORD_SIZE = 16;
+    static const size_t HEADER_SIZE = 16;
+
+    UserDictionary();
+    ~UserDictionary();
+
+    UserDictionary(const UserDictionary&) = delete;
+    UserDictionary& operator=(const UserDictionary&) = delete;
+
+    // Keys of a word typed in layout, Shift and trailing spaces ignored.
+    // Never 0.
+    static uint64_t Key(const KeystrokeInfo* keystrokes, size_t count, HKL layout);
+
+    // The part of an HKL that stays the same across sessions
+    static uint32_t LayoutId(HKL layout) {
+        return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(layout));
+    }
+
+    // Loads the words kept in directory and journals changes there from
+    // now on. Until then the dictionary lives for the session only. False
+    // when the journal cannot be opened; the loaded words stay either way.
+    bool Open(const NativePath& directory);
+
+    // Waits for a running compaction
+    void Close();
+
+    // Open was called, whether or not the journal could be opened
+    bool IsOpen() const { return !_directory.empty(); }
+
+    // Null when the user has not settled key
+    const Entry* Lookup(uint64_t key) {
+        ++_counters.lookups;
+        if (_count == 0) return nullptr;
+        const Entry& entry = _entries[Find(key)];
+        if (entry.key == 0) return nullptr;
+        ++_counters.hits;
+        return &entry;
+    }
+
+    // Sets key's verdict; layout is the one meant. Journals only changes.
+    void Learn(uint64_t key, Verdict verdict, HKL layout);
+
+    // Sets the journal aside and writes the snapshot in the background
+    bool Compact();
+    void WaitForCompaction();
+
+    size_t Count() const { return _count; }
+    uint64_t JournalRecords() const { return _journalRecords; }
+    const Counters& GetCounters() const { return _counters; }
+
+    // One line: words, lookup hit rate, journal length, compactions
+    std::string Format() const;
+
+    // File names inside the directory
+    static const char* const SNAPSHOT_NAME;
+    static const char* const JOURNAL_NAME;
+    static const char* const ROTATED_JOURNAL_NAME;
+
+private:
+    static const uint32_t SNAPSHOT_MAGIC = 0x44555343;     // "CSUD"
+    static const uint32_t JOURNAL_MAGIC = 0x4A555343;      // "CSUJ"
+    static const uint32_t FORMAT_VERSION = 1;
+
+    size_t Find(uint64_t key) const {
+        size_t mask = _entries.size() - 1;
+        size_t index = static_cast<size_t>(key ^ (key >> 29)) & mask;
+        while (_entries[index].key != 0 && _entries[index].key != key) {
+            index = (index + 1) & mask;
+        }
+        return index;
+    }
+
+    void Set(uint64_t key, uint8_t verdict, uint32_t layout);
+    void Grow();
+
+    // Replays a mapped snapshot or journal; false when its header is wrong
+    bool Replay(const MappedFile& file, uint32_t magic);
+    bool OpenJournal(bool valid);
+
+    static void EncodeHeader(uint8_t* out, uint32_t magic, uint64_t count);
+    static void EncodeRecord(uint8_t* out, const Entry& entry);
+    static bool DecodeRecord(const uint8_t* in, Entry& entry);
+
+    NativePath Path(const char* name) const;
+
+    std::vector<Entry> _entries;    // Power of two, at most half full
+    size_t _count;
+    Counters _counters;
+
+    NativePath _directory;
+    AppendFile _journal;
+    uint64_t _journalRecords;
+    std::thread _compactor;
+};
\ No newline at end of file
@@ -0,0 +1,25 @@
+#include "Win32AppIdentity.h"
+
+bool Win32AppIdentity::QueryWindow(HWND window, uint32_t& processId, uint32_t& threadId,
+                                   char16_t* className, size_t capacity, size_t& length) {
+    DWORD process = 0;
+    DWORD thread = GetWindowThreadProcessId(window, &process);
+    if (!thread) return false;
+    
+    processId = process;
+    threadId = thread;
+    int copied = GetClassName(window, reinterpret_cast<LPWSTR>(className), static_cast<int>(capacity));
+    length = copied > 0 ? static_cast<size_t>(copied) : 0;
+    return true;
+}
+
+bool Win32AppIdentity::QueryImageName(uint32_t processId, char16_t* name, size_t capacity, size_t& length) {
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+    if (!process) return false;
+    
+    DWORD size = static_cast<DWORD>(capacity);
+    BOOL queried = QueryFullProcessImageName(process, 0, reinterpret_cast<LPWSTR>(name), &size);
+    CloseHandle(process);
+    length = queried ? size : 0;
+    return queried != FALSE;
+}
\ No newline at end of file
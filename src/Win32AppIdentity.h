@@ -0,0 +1,13 @@
+#pragma once
+#include <windows.h>
+#include "AppRuleMatcher.h"
+
+// AppIdentitySource on user32 and QueryFullProcessImageName. Limited query
+// access is enough for the image name of most processes, elevated ones
+// included; protected ones fail and match class rules only.
+class Win32AppIdentity : public AppIdentitySource {
+public:
+    bool QueryWindow(HWND window, uint32_t& processId, uint32_t& threadId,
+                     char16_t* className, size_t capacity, size_t& length) override;
+    bool QueryImageName(uint32_t processId, char16_t* name, size_t capacity, size_t& length) override;
+};
\ No newline at end of file
@@ -0,0 +1,200 @@
+#include "Win32Backend.h"
+#include "InjectedInput.h"
+
+Win32Backend::Win32Backend(const ForegroundTracker& foreground) : _foreground(foreground) {
+}
+
+HWND Win32Backend::ForegroundWindow() {
+    return _foreground.Window();
+}
+
+HKL Win32Backend::WindowLayout(HWND window) {
+    return GetKeyboardLayout(GetWindowThreadProcessId(window, nullptr));
+}
+
+HKL Win32Backend::NextLayout(HKL current) {
+    return KeyboardLayouts::GetNextLayout(current);
+}
+
+size_t Win32Backend::LayoutList(HKL* layouts, size_t capacity) {
+    int count = GetKeyboardLayoutList(static_cast<int>(capacity), layouts);
+    return count > 0 ? static_cast<size_t>(count) : 0;
+}
+
+const LayoutTable* Win32Backend::Table(HKL layout) {
+    return _layouts.GetTable(layout);
+}
+
+const Dawg* Win32Backend::Dictionary(HKL layout) {
+    return _layouts.GetDictionary(layout);
+}
+
+const NgramTable* Win32Backend::Trigrams(HKL layout) {
+    return _layouts.GetTrigrams(layout);
+}
+
+void Win32Backend::Send(const INPUT* inputs, size_t count) {
+    // SendInput may stop early if the input desktop is busy; send the rest
+    // rather than dropping half a word
+    while (count > 0) {
+        UINT sent = SendInput(static_cast<UINT>(count), const_cast<INPUT*>(inputs), sizeof(INPUT));
+        if (sent == 0) {
+            break;
+        }
+        inputs += sent;
+        count -= sent;
+    }
+}
+
+void Win32Backend::RequestLayout(HWND window, HKL layout) {
+    if (window) {
+        if (layout) {
+            PostMessage(window, WM_INPUTLANGCHANGEREQUEST, 0, reinterpret_cast<LPARAM>(layout));
+        } else {
+            PostMessage(window, WM_INPUTLANGCHANGEREQUEST, 0x02, 0);
+        }
+    }
+}
+
+void Win32Backend::WaitForLayout(HWND window, HKL previous) {
+    DWORD threadId = GetWindowThreadProcessId(window, nullptr);
+    if (!threadId) {
+        return;
+    }
+
+    ULONGLONG deadline = GetTickCount64() + LAYOUT_SWITCH_TIMEOUT_MS;
+    while (GetKeyboardLayout(threadId) == previous && GetTickCount64() < deadline) {
+        Sleep(1);
+    }
+}
+
+bool Win32Backend::CopySelection(HWND window, std::u16string& text) {
+    text.clear();
+    if (!window) {
+        return false;
+    }
+
+    std::u16string previous;
+    bool hadText = ReadClipboardText(previous);
+    DWORD sequence = GetClipboardSequenceNumber();
+
+    // Nothing selected leaves the clipboard alone, so the copy can only be
+    // told apart from no answer by the timeout
+    SendShortcut('C');
+    ULONGLONG deadline = GetTickCount64() + COPY_TIMEOUT_MS;
+    while (GetClipboardSequenceNumber() == sequence && GetTickCount64() < deadline) {
+        Sleep(5);
+    }
+    if (GetClipboardSequenceNumber() == sequence) {
+        return false;
+    }
+
+    bool copied = ReadClipboardText(text);
+
+    // Only text is put back; other formats the user had copied are lost
+    if (hadText) {
+        WriteClipboardText(previous);
+    }
+    return copied && !text.empty();
+}
+
+void Win32Backend::PasteText(HWND window, const std::u16string& text) {
+    if (!window) {
+        return;
+    }
+
+    std::u16string previous;
+    bool hadText = ReadClipboardText(previous);
+    if (!WriteClipboardText(text)) {
+        return;
+    }
+    DWORD sequence = GetClipboardSequenceNumber();
+
+    // The window reads the clipboard whenever it gets to the keys; restore
+    // only if nobody copied anything in the meantime
+    SendShortcut('V');
+    Sleep(PASTE_SETTLE_MS);
+    if (hadText && GetClipboardSequenceNumber() == sequence) {
+        WriteClipboardText(previous);
+    }
+}
+
+void Win32Backend::SendShortcut(WORD virtualKey) {
+    INPUT inputs[4] = {};
+    WORD keys[4] = { VK_CONTROL, virtualKey, virtualKey, VK_CONTROL };
+    for (int i = 0; i < 4; ++i) {
+        inputs[i].type = INPUT_KEYBOARD;
+        inputs[i].ki.wVk = keys[i];
+        inputs[i].ki.dwFlags = i < 2 ? 0 : KEYEVENTF_KEYUP;
+        InjectedInput::Stamp(inputs[i]);
+    }
+    Send(inputs, 4);
+}
+
+bool Win32Backend::OpenClipboardRetrying(HWND owner) {
+    // Another process may hold the clipboard open for a moment
+    for (int attempt = 0; attempt < 10; ++attempt) {
+        if (OpenClipboard(owner)) {
+            return true;
+        }
+        Sleep(10);
+    }
+    return false;
+}
+
+bool Win32Backend::ReadClipboardText(std::u16string& text) {
+    text.clear();
+    if (!OpenClipboardRetrying(nullptr)) {
+        return false;
+    }
+
+    bool read = false;
+    HANDLE data = GetClipboardData(CF_UNICODETEXT);
+    const char16_t* chars = data ? static_cast<const char16_t*>(GlobalLock(data)) : nullptr;
+    if (chars) {
+        // The text is null-terminated, but never past the allocation
+        size_t capacity = GlobalSize(data) / sizeof(char16_t);
+        size_t length = 0;
+        while (length < capacity && chars[length]) {
+            ++length;
+        }
+        text.assign(chars, length);
+        GlobalUnlock(data);
+        read = true;
+    }
+    CloseClipboard();
+    return read;
+}
+
+bool Win32Backend::WriteClipboardText(const std::u16string& text) {
+    HGLOBAL data = GlobalAlloc(GMEM_MOVEABLE, (text.size() + 1) * sizeof(char16_t));
+    if (!data) {
+        return false;
+    }
+    char16_t* chars = static_cast<char16_t*>(GlobalLock(data));
+    if (!chars) {
+        GlobalFree(data);
+        return false;
+    }
+    std::char_traits<char16_t>::copy(chars, text.c_str(), text.size() + 1);
+    GlobalUnlock(data);
+
+    // SetClipboardData fails unless EmptyClipboard had an owner window. A
+    // message-only one does; the data outlives it.
+    HWND owner = CreateWindowEx(0, L"STATIC", nullptr, 0, 0, 0, 0, 0, HWND_MESSAGE, nullptr, nullptr, nullptr);
+    bool written = false;
+    if (owner && OpenClipboardRetrying(owner)) {
+        EmptyClipboard();
+        written = SetClipboardData(CF_UNICODETEXT, data) != nullptr;
+        CloseClipboard();
+    }
+    if (owner) {
+        DestroyWindow(owner);
+    }
+
+    // The clipboard owns the memory only once SetClipboardData succeeded
+    if (!written) {
+        GlobalFree(data);
+    }
+    return written;
+}
\ No newline at end of file
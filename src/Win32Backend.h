@@ -0,0 +1,44 @@
+#pragma once
+#include <windows.h>
+#include "PlatformBackend.h"
+#include "ForegroundTracker.h"
+#include "KeyboardLayouts.h"
+
+// PlatformBackend on user32: SendInput for injection,
+// WM_INPUTLANGCHANGEREQUEST for switching, and KeyboardLayouts for the
+// tables and language models of the installed layouts. Selections travel
+// through the clipboard with Ctrl+C and Ctrl+V. The foreground window is
+// the tracker's, so the worker never asks user32 for it.
+class Win32Backend : public PlatformBackend {
+public:
+    explicit Win32Backend(const ForegroundTracker& foreground);
+
+    HWND ForegroundWindow() override;
+    HKL WindowLayout(HWND window) override;
+    HKL NextLayout(HKL current) override;
+    size_t LayoutList(HKL* layouts, size_t capacity) override;
+    const LayoutTable* Table(HKL layout) override;
+    const Dawg* Dictionary(HKL layout) override;
+    const NgramTable* Trigrams(HKL layout) override;
+    void Send(const INPUT* inputs, size_t count) override;
+    void RequestLayout(HWND window, HKL layout) override;
+    void WaitForLayout(HWND window, HKL previous) override;
+    bool CopySelection(HWND window, std::u16string& text) override;
+    void PasteText(HWND window, const std::u16string& text) override;
+
+private:
+    static const DWORD LAYOUT_SWITCH_TIMEOUT_MS = 50;
+
+    // How long a window gets to answer Ctrl+C, and to read the clipboard
+    // after Ctrl+V before the previous text goes back
+    static const DWORD COPY_TIMEOUT_MS = 300;
+    static const DWORD PASTE_SETTLE_MS = 150;
+
+    void SendShortcut(WORD virtualKey);
+    static bool OpenClipboardRetrying(HWND owner);
+    static bool ReadClipboardText(std::u16string& text);
+    static bool WriteClipboardText(const std::u16string& text);
+
+    const ForegroundTracker& _foreground;
+    KeyboardLayouts _layouts;
+};
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+// Portable components (dispatcher, planners, tables) are written against the
+// Win32 input types so the Windows build uses them directly. Elsewhere this
+// header provides the small subset they need, with the same names and values,
+// so the same code can be built and profiled on Linux.
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cstdint>
+
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef unsigned int UINT;
+typedef uintptr_t ULONG_PTR;
+
+typedef struct HWND__* HWND;
+typedef struct HKL__* HKL;
+
+typedef struct tagKBDLLHOOKSTRUCT {
+    DWORD vkCode;
+    DWORD scanCode;
+    DWORD flags;
+    DWORD time;
+    ULONG_PTR dwExtraInfo;
+} KBDLLHOOKSTRUCT;
+
+typedef struct tagKEYBDINPUT {
+    WORD wVk;
+    WORD wScan;
+    DWORD dwFlags;
+    DWORD time;
+    ULONG_PTR dwExtraInfo;
+} KEYBDINPUT;
+
+typedef struct tagINPUT {
+    DWORD type;
+    union {
+        KEYBDINPUT ki;
+    };
+} INPUT;
+
+#define INPUT_KEYBOARD          1
+
+#define KEYEVENTF_EXTENDEDKEY   0x0001
+#define KEYEVENTF_KEYUP         0x0002
+#define KEYEVENTF_UNICODE       0x0004
+#define KEYEVENTF_SCANCODE      0x0008
+
+#define WM_KEYDOWN              0x0100
+#define WM_KEYUP                0x0101
+#define WM_SYSKEYDOWN           0x0104
+#define WM_SYSKEYUP             0x0105
+
+#define LLKHF_EXTENDED          0x01
+#define LLKHF_INJECTED          0x10
+#define LLKHF_ALTDOWN           0x20
+#define LLKHF_UP                0x80
+
+#define VK_LBUTTON              0x01
+#define VK_RBUTTON              0x02
+#define VK_MBUTTON              0x04
+#define VK_BACK                 0x08
+#define VK_TAB                  0x09
+#define VK_RETURN               0x0D
+#define VK_SHIFT                0x10
+#define VK_CONTROL              0x11
+#define VK_MENU                 0x12
+#define VK_PAUSE                0x13
+#define VK_CAPITAL              0x14
+#define VK_ESCAPE               0x1B
+#define VK_SPACE                0x20
+#define VK_PRIOR                0x21
+#define VK_NEXT                 0x22
+#define VK_END                  0x23
+#define VK_HOME                 0x24
+#define VK_LEFT                 0x25
+#define VK_UP                   0x26
+#define VK_RIGHT                0x27
+#define VK_DOWN                 0x28
+#define VK_INSERT               0x2D
+#define VK_DELETE               0x2E
+#define VK_LWIN                 0x5B
+#define VK_RWIN                 0x5C
+#define VK_NUMPAD0              0x60
+#define VK_NUMPAD9              0x69
+#define VK_NUMLOCK              0x90
+#define VK_LSHIFT               0xA0
+#define VK_RSHIFT               0xA1
+#define VK_LCONTROL             0xA2
+#define VK_RCONTROL             0xA3
+#define VK_LMENU                0xA4
+#define VK_RMENU                0xA5
+#define VK_OEM_1                0xBA
+#define VK_OEM_PLUS             0xBB
+#define VK_OEM_COMMA            0xBC
+#define VK_OEM_MINUS            0xBD
+#define VK_OEM_PERIOD           0xBE
+#define VK_OEM_2                0xBF
+#define VK_OEM_3                0xC0
+#define VK_OEM_4                0xDB
+#define VK_OEM_5                0xDC
+#define VK_OEM_6                0xDD
+#define VK_OEM_7                0xDE
+#define VK_OEM_8                0xDF
+#define VK_OEM_102              0xE2
+#endif
\ No newline at end of file
@@ -0,0 +1,42 @@
+#include "Win32ForegroundSource.h"
+
+ForegroundTracker* Win32ForegroundSource::_tracker = nullptr;
+
+Win32ForegroundSource::Win32ForegroundSource() : _hook(nullptr) {
+}
+
+Win32ForegroundSource::~Win32ForegroundSource() {
+    Unsubscribe();
+}
+
+bool Win32ForegroundSource::Subscribe(ForegroundTracker& tracker) {
+    if (_hook) return false;
+    
+    // Our own windows count too: the tray menu takes the foreground
+    _tracker = &tracker;
+    _hook = SetWinEventHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, nullptr, EventProc,
+                            0, 0, WINEVENT_OUTOFCONTEXT);
+    if (!_hook) {
+        _tracker = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void Win32ForegroundSource::Unsubscribe() {
+    if (_hook) {
+        UnhookWinEvent(_hook);
+        _hook = nullptr;
+    }
+    _tracker = nullptr;
+}
+
+HWND Win32ForegroundSource::QueryForeground() {
+    return GetForegroundWindow();
+}
+
+void CALLBACK Win32ForegroundSource::EventProc(HWINEVENTHOOK, DWORD event, HWND window, LONG, LONG, DWORD, DWORD) {
+    if (event == EVENT_SYSTEM_FOREGROUND && _tracker) {
+        _tracker->OnForegroundChange(window);
+    }
+}
\ No newline at end of file
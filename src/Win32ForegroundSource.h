@@ -0,0 +1,24 @@
+#pragma once
+#include <windows.h>
+#include "ForegroundTracker.h"
+
+// ForegroundSource on a WinEvent hook for EVENT_SYSTEM_FOREGROUND. The hook
+// is out of context, so events come through the subscribing thread's
+// message loop; one subscription at a time.
+class Win32ForegroundSource : public ForegroundSource {
+public:
+    Win32ForegroundSource();
+    ~Win32ForegroundSource();
+
+    bool Subscribe(ForegroundTracker& tracker) override;
+    void Unsubscribe() override;
+    HWND QueryForeground() override;
+
+private:
+    static void CALLBACK EventProc(HWINEVENTHOOK hook, DWORD event, HWND window, LONG objectId,
+                                   LONG childId, DWORD threadId, DWORD time);
+
+    HWINEVENTHOOK _hook;
+
+    static ForegroundTracker* _tracker;
+};
\ No newline at end of file
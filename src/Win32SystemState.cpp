@@ -0,0 +1,39 @@
+#include "Win32SystemState.h"
+
+Win32SystemState::Win32SystemState(const ForegroundTracker& foreground) : _foreground(foreground) {
+}
+
+bool Win32SystemState::QueryDarkTheme() {
+    try {
+        HKEY hKey;
+        if (RegOpenKeyEx(HKEY_CURRENT_USER,
+                         L"Software\\Microsoft\\Windows\\CurrentVersion\\Themes\\Personalize",
+                         0, KEY_READ, &hKey) == ERROR_SUCCESS) {
+            DWORD value = 0, size = sizeof(value), type = 0;
+            LONG res = RegQueryValueEx(hKey, L"AppsUseLightTheme", nullptr, &type,
+                                       reinterpret_cast<BYTE*>(&value), &size);
+            RegCloseKey(hKey);
+            
+            // Dark mode is enabled when AppsUseLightTheme is 0
+            return (res == ERROR_SUCCESS && type == REG_DWORD && value == 0);
+        }
+    } catch (...) {}
+    return false;
+}
+
+int Win32SystemState::QueryDpi() {
+    HDC hdc = GetDC(nullptr);
+    int dpi = GetDeviceCaps(hdc, LOGPIXELSX);
+    ReleaseDC(nullptr, hdc);
+    return dpi > 0 ? dpi : 96;
+}
+
+size_t Win32SystemState::QueryLayouts(HKL* layouts, size_t capacity) {
+    int count = GetKeyboardLayoutList(static_cast<int>(capacity), layouts);
+    return count > 0 ? static_cast<size_t>(count) : 0;
+}
+
+HKL Win32SystemState::QueryForegroundLayout() {
+    HWND window = _foreground.Window();
+    return window ? GetKeyboardLayout(GetWindowThreadProcessId(window, nullptr)) : nullptr;
+}
\ No newline at end of file
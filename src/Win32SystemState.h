@@ -0,0 +1,19 @@
+#pragma once
+#include <windows.h>
+#include "ForegroundTracker.h"
+#include "SystemStateCache.h"
+
+// SystemStateSource on the registry, GDI and user32. The foreground layout
+// is that of the tracker's window.
+class Win32SystemState : public SystemStateSource {
+public:
+    explicit Win32SystemState(const ForegroundTracker& foreground);
+
+    bool QueryDarkTheme() override;
+    int QueryDpi() override;
+    size_t QueryLayouts(HKL* layouts, size_t capacity) override;
+    HKL QueryForegroundLayout() override;
+
+private:
+    const ForegroundTracker& _foreground;
+};
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "WindowBufferCache.h"
+
+WindowBufferCache::WindowBufferCache(size_t capacity, size_t keystrokeCapacity)
+    : _capacity(capacity ? capacity : 1), _size(0), _evictionCount(0), _head(NONE), _tail(NONE) {
+    // Keep the index at most half full so probe sequences stay short
+    size_t indexSize = 1;
+    while (indexSize < _capacity * 2) indexSize <<= 1;
+    _indexMask = indexSize - 1;
+
+    _buffers.reset(new WindowBuffer[_capacity]);
+    _nodes.reset(new Node[_capacity]);
+    _index.reset(new uint32_t[indexSize]);
+    for (size_t i = 0; i < _capacity; ++i) {
+        _buffers[i].SetCapacity(keystrokeCapacity);
+    }
+    Clear();
+}
+
+WindowBuffer& WindowBufferCache::Acquire(uintptr_t window) {
+    size_t slot = FindIndexSlot(window);
+    uint32_t node = _index[slot];
+
+    if (node != NONE) {
+        if (node != _head) {
+            Unlink(node);
+            PushFront(node);
+        }
+        return _buffers[node];
+    }
+
+    if (_size < _capacity) {
+        node = static_cast<uint32_t>(_size++);
+    } else {
+        node = _tail;
+        Unlink(node);
+        EraseIndexSlot(FindIndexSlot(_nodes[node].window));
+        ++_evictionCount;
+        // The evicted key may have shifted entries around, probe again
+        slot = FindIndexSlot(window);
+    }
+
+    _nodes[node].window = window;
+    _index[slot] = node;
+    PushFront(node);
+
+    WindowBuffer& buffer = _buffers[node];
+    buffer.Clear();
+    return buffer;
+}
+
+WindowBuffer* WindowBufferCache::Find(uintptr_t window) {
+    uint32_t node = _index[FindIndexSlot(window)];
+    return node != NONE ? &_buffers[node] : nullptr;
+}
+
+void WindowBufferCache::Remove(uintptr_t window) {
+    size_t slot = FindIndexSlot(window);
+    uint32_t node = _index[slot];
+    if (node == NONE) return;
+
+    Unlink(node);
+    EraseIndexSlot(slot);
+
+    // Keep live nodes packed at [0, _size) by moving the last one into the hole
+    uint32_t last = static_cast<uint32_t>(--_size);
+    if (node != last) {
+        _buffers[node] = _buffers[last];
+        _nodes[node] = _nodes[last];
+
+        if (_nodes[node].prev != NONE) _nodes[_nodes[node].prev].next = node;
+        else _head = node;
+        if (_nodes[node].next != NONE) _nodes[_nodes[node].next].prev = node;
+        else _tail = node;
+
+        _index[FindIndexSlot(_nodes[node].window)] = node;
+    }
+}
+
+void WindowBufferCache::Clear() {
+    for (size_t i = 0; i <= _indexMask; ++i) {
+        _index[i] = NONE;
+    }
+    _size = 0;
+    _head = NONE;
+    _tail = NONE;
+}
+
+size_t WindowBufferCache::MemoryUsage() const {
+    return _capacity * (sizeof(WindowBuffer) + sizeof(Node)) + (_indexMask + 1) * sizeof(uint32_t);
+}
+
+size_t WindowBufferCache::Hash(uintptr_t window) {
+    // Handles are small, word-aligned integers; mix them before masking
+    uint64_t h = static_cast<uint64_t>(window);
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    return static_cast<size_t>(h);
+}
+
+size_t WindowBufferCache::FindIndexSlot(uintptr_t window) const {
+    size_t slot = Hash(window) & _indexMask;
+    while (_index[slot] != NONE && _nodes[_index[slot]].window != window) {
+        slot = (slot + 1) & _indexMask;
+    }
+    return slot;
+}
+
+void WindowBufferCache::EraseIndexSlot(size_t slot) {
+    // Backward-shift deletion, so the index never accumulates tombstones
+    _index[slot] = NONE;
+    size_t next = (slot + 1) & _indexMask;
+    while (_index[next] != NONE) {
+        size_t home = Hash(_nodes[_index[next]].window) & _indexMask;
+        // Move the entry into the hole if the hole lies on its probe path
+        if (((next - home) & _indexMask) >= ((next - slot) & _indexMask)) {
+            _index[slot] = _index[next];
+            _index[next] = NONE;
+            slot = next;
+        }
+        next = (next + 1) & _indexMask;
+    }
+}
+
+void WindowBufferCache::Unlink(uint32_t node) {
+    Node& n = _nodes[node];
+    if (n.prev != NONE) _nodes[n.prev].next = n.next;
+    else _head = n.next;
+    if (n.next != NONE) _nodes[n.next].prev = n.prev;
+    else _tail = n.prev;
+}
+
+void WindowBufferCache::PushFront(uint32_t node) {
+    Node& n = _nodes[node];
+    n.prev = NONE;
+    n.next = _head;
+    if (_head != NONE) _nodes[_head].prev = node;
+    _head = node;
+    if (_tail == NONE) _tail = node;
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "KeystrokeRing.h"
+
+// Keystroke state of one window. Fixed-size so every window's state can live
+// in one preallocated block and switching windows never touches the heap.
+// The word being typed and the last corrected word are two rings that trade
+// places after a correction, so neither correcting nor re-correcting copies
+// keystrokes.
+struct WindowBuffer {
+    KeystrokeRing rings[2];
+    uint8_t typingRing = 0;
+    int correctionCount = 0;
+    uintptr_t typedLayout = 0;      // Layout the last corrected word was typed in
+    bool lastCharWasSpace = false;
+    bool correctionRefused = false;
+    bool autoCorrected = false;     // The last corrected word was corrected automatically
+
+    KeystrokeRing& Typing() { return rings[typingRing]; }
+    KeystrokeRing& LastCorrected() { return rings[typingRing ^ 1]; }
+    const KeystrokeRing& Typing() const { return rings[typingRing]; }
+    const KeystrokeRing& LastCorrected() const { return rings[typingRing ^ 1]; }
+
+    // The typed word becomes the last corrected one, typing starts afresh
+    void SwapAfterCorrection() {
+        typingRing ^= 1;
+        rings[typingRing].Clear();
+    }
+
+    void SetCapacity(size_t capacity) {
+        rings[0].SetCapacity(capacity);
+        rings[1].SetCapacity(capacity);
+    }
+
+    void Clear() {
+        rings[0].Clear();
+        rings[1].Clear();
+        correctionCount = 0;
+        typedLayout = 0;
+        lastCharWasSpace = false;
+        correctionRefused = false;
+        autoCorrected = false;
+    }
+};
+
+// Fixed-capacity table of per-window buffers keyed by window handle, with
+// least-recently-used eviction. Buffers, LRU links and the hash index are
+// allocated once in the constructor; Acquire is O(1) and never allocates.
+// Not thread-safe, owned by the correction worker.
+class WindowBufferCache {
+public:
+    static const size_t DEFAULT_CAPACITY = 32;
+
+    explicit WindowBufferCache(size_t capacity = DEFAULT_CAPACITY,
+                               size_t keystrokeCapacity = KeystrokeRing::DEFAULT_CAPACITY);
+
+    WindowBufferCache(const WindowBufferCache&) = delete;
+    WindowBufferCache& operator=(const WindowBufferCache&) = delete;
+
+    // Buffer of window, which becomes the most recently used. A window seen
+    // for the first time gets an empty buffer, evicting the least recently
+    // used window when the cache is full.
+    WindowBuffer& Acquire(uintptr_t window);
+
+    // Buffer of window if cached, without changing the LRU order
+    WindowBuffer* Find(uintptr_t window);
+
+    void Remove(uintptr_t window);
+    void Clear();
+
+    size_t Size() const { return _size; }
+
+    // Cached windows in no particular order, index < Size()
+    uintptr_t WindowAt(size_t index) const { return _nodes[index].window; }
+    const WindowBuffer& BufferAt(size_t index) const { return _buffers[index]; }
+    size_t Capacity() const { return _capacity; }
+    size_t EvictionCount() const { return _evictionCount; }
+
+    // Bytes held by the arena, the LRU links and the index
+    size_t MemoryUsage() const;
+
+private:
+    static const uint32_t NONE = 0xFFFFFFFF;
+
+    struct Node {
+        uintptr_t window;
+        uint32_t prev;
+        uint32_t next;
+    };
+
+    static size_t Hash(uintptr_t window);
+    size_t FindIndexSlot(uintptr_t window) const;
+    void EraseIndexSlot(size_t slot);
+    void Unlink(uint32_t node);
+    void PushFront(uint32_t node);
+
+    size_t _capacity;
+    size_t _size;
+    size_t _indexMask;
+    size_t _evictionCount;
+    uint32_t _head;     // Most recently used
+    uint32_t _tail;     // Least recently used
+
+    std::unique_ptr<WindowBuffer[]> _buffers;
+    std::unique_ptr<Node[]> _nodes;
+    std::unique_ptr<uint32_t[]> _index;     // Linear probing, node index or NONE
+};
\ No newline at end of file
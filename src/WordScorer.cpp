@@ -0,0 +1,84 @@
+#include "WordScorer.h"
+#include "TextUtils.h"
+
+WordScorer::WordScorer() : _count(0), _length(0), _valid(true) {
+    Reset();
+}
+
+void WordScorer::SetCandidates(const LayoutCandidate* candidates, size_t count) {
+    if (count > MAX_LAYOUTS) count = MAX_LAYOUTS;
+    for (size_t i = 0; i < count; ++i) {
+        _candidates[i] = candidates[i];
+    }
+    _count = count;
+    Reset();
+}
+
+void WordScorer::Reset() {
+    for (size_t lane = 0; lane < MAX_LAYOUTS; ++lane) {
+        Lane& state = _lanes[0][lane];
+        state.score = 0;
+        state.c0 = NgramTable::BOUNDARY;
+        state.c1 = NgramTable::BOUNDARY;
+        state.letters = 0;
+        state.missing = false;
+    }
+    _boundary[0] = true;
+    _length = 0;
+    _valid = true;
+}
+
+void WordScorer::Push(KeystrokeInfo keystroke) {
+    if (!_valid) return;
+    if (_length == MAX_LENGTH) {
+        _valid = false;
+        return;
+    }
+
+    const char16_t boundary = NgramTable::BOUNDARY;
+    const Lane* previous = _lanes[_length];
+    Lane* next = _lanes[_length + 1];
+    bool anyLetter = false;
+
+    for (size_t lane = 0; lane < _count; ++lane) {
+        Lane state = previous[lane];
+        const LayoutTable* table = _candidates[lane].table;
+        char16_t ch = table ? ToLowerChar(table->Translate(keystroke.VirtualKey(), keystroke.Shift(),
+                                                           keystroke.CapsLock()))
+                            : 0;
+        bool letter = IsLetterChar(ch);
+        anyLetter = anyLetter || letter;
+        state.missing = state.missing || ch == 0;
+        state.letters = static_cast<uint8_t>(state.letters + (letter ? 1 : 0));
+
+        // A run of non-letters is one boundary, as in the model's corpus
+        char16_t symbol = letter ? ch : boundary;
+        if (symbol != boundary || state.c1 != boundary) {
+            const NgramTable* trigrams = _candidates[lane].trigrams;
+            state.score += trigrams ? trigrams->LogProb(state.c0, state.c1, symbol)
+                                    : LayoutRanker::UNMODELLED_LOG_PROB;
+            state.c0 = state.c1;
+            state.c1 = symbol;
+        }
+        next[lane] = state;
+    }
+
+    _boundary[++_length] = !anyLetter;
+}
+
+void WordScorer::Pop() {
+    if (_length > 0) --_length;
+}
+
+bool WordScorer::EndsWord() const {
+    return _length >= 2 && _boundary[_length] && !_boundary[_length - 1];
+}
+
+int WordScorer::FinalScore(size_t lane) const {
+    const Lane& state = _lanes[_length][lane];
+    if (state.c1 == NgramTable::BOUNDARY) return state.score;
+
+    const NgramTable* trigrams = _candidates[lane].trigrams;
+    return state.score + (trigrams ? trigrams->LogProb(state.c0, state.c1, NgramTable::BOUNDARY)
+                                   : LayoutRanker::UNMODELLED_LOG_PROB);
+}
\ No newline at end of file
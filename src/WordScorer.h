@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "Keystroke.h"
+#include "LayoutRanker.h"
+
+// Trigram scores of the word being typed under every installed layout,
+// kept up to date one keystroke at a time so the auto-correct decision at a
+// word boundary is a comparison rather than a rescan. A keystroke costs one
+// translation and at most one trigram probe per layout; a Backspace goes
+// back to the state before the key, which stays in a per-key history.
+//
+// Scores follow LayoutRanker::Rank exactly: case-folded readings, runs of
+// non-letters as a single boundary, UNMODELLED_LOG_PROB for layouts
+// without a model.
+// Not thread-safe, owned by the correction worker.
+class WordScorer {
+public:
+    static const size_t MAX_LAYOUTS = LayoutRanker::MAX_LAYOUTS;
+    static const size_t MAX_LENGTH = LayoutRanker::MAX_WORD_LENGTH;
+
+    struct Lane {
+        int score;          // Scaled log-probability so far
+        char16_t c0;        // Last two model symbols
+        char16_t c1;
+        uint8_t letters;    // Keys that read as letters
+        bool missing;       // A key has no character in this layout
+    };
+
+    WordScorer();
+
+    // Only the first MAX_LAYOUTS are used. Starts a new word.
+    void SetCandidates(const LayoutCandidate* candidates, size_t count);
+    size_t CandidateCount() const { return _count; }
+
+    // Starts a new word
+    void Reset();
+
+    // Stops scoring until the next Reset, for when the keys no longer
+    // follow the buffer (focus moved, a word grew past MAX_LENGTH)
+    void Invalidate() { _valid = false; }
+    bool IsValid() const { return _valid; }
+
+    void Push(KeystrokeInfo keystroke);
+    void Pop();
+
+    size_t Length() const { return _length; }
+    const Lane& GetLane(size_t lane) const { return _lanes[_length][lane]; }
+
+    // The last key reads as a non-letter in every layout, and the one
+    // before as a letter in at least one: a word has just ended
+    bool EndsWord() const;
+
+    // Score with the end of the word counted, as Rank reports it
+    int FinalScore(size_t lane) const;
+
+private:
+    LayoutCandidate _candidates[MAX_LAYOUTS];
+    size_t _count;
+
+    // _lanes[n] is the state after n keys, so Pop only steps back
+    Lane _lanes[MAX_LENGTH + 1][MAX_LAYOUTS];
+    bool _boundary[MAX_LENGTH + 1];     // Key n - 1 is a non-letter everywhere
+    size_t _length;
+    bool _valid;
+};
\ No newline at end of file
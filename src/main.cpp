@@ -1,7 +1,16 @@
 #include <windows.h>
 #include <shellscalingapi.h>
+#include <psapi.h>
 #include "TrayApplication.h"
 #include "Installation.h"
+#include "StartupTrace.h"
+
+static size_t QueryWorkingSet() {
+    PROCESS_MEMORY_COUNTERS counters = {};
+    counters.cb = sizeof(counters);
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return counters.WorkingSetSize;
+}
 
 int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, 
                    _In_ LPWSTR lpCmdLine, _In_ int nCmdShow) {
@@ -9,6 +18,8 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
     UNREFERENCED_PARAMETER(lpCmdLine);
     UNREFERENCED_PARAMETER(nCmdShow);
     
+    StartupTrace startup(QueryWorkingSet);
+    
     // Set DPI awareness programmatically
     // Try the newer API first (Windows 10 v1703+)
     HMODULE hUser32 = GetModuleHandle(L"user32.dll");
@@ -37,6 +48,7 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
             }
         }
     }
+    startup.Mark("main.dpi_awareness");
     
     // Check if app needs to be installed
     if (!Installation::IsInstalledLocation()) {
@@ -47,6 +59,7 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
         }
         // User declined installation, continue running from current location
     }
+    startup.Mark("main.install_check");
     
     // Prevent multiple instances
     HANDLE hMutex = CreateMutex(nullptr, TRUE, L"kSwitcherMutex");
@@ -54,10 +67,11 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
         CloseHandle(hMutex);
         return 0;
     }
+    startup.Mark("main.single_instance");
     
     int result = -1;
     try {
-        TrayApplication app;
+        TrayApplication app(startup);
         result = app.Run();
     }
     catch (...) {
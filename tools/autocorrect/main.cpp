@@ -0,0 +1,381 @@
+// kswitcher-autocorrect: measures automatic correction at word ends on
+// synthetic languages typed on the built-in layouts: how often a word typed
+// in the right layout gets changed anyway, how often one typed in the wrong
+// layout is caught, and what keeping the word's scores current costs per
+// keystroke next to ranking the whole word when it ends.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "CorrectionEngine.h"
+#include "DawgBuilder.h"
+#include "FakeBackend.h"
+#include "LatencyMetrics.h"
+#include "LayoutRanker.h"
+#include "TextUtils.h"
+#include "ToolSupport.h"
+#include "WordScorer.h"
+
+namespace {
+
+const size_t TRAINING_WORDS = 60000;
+const size_t TEST_WORDS = 10000;
+const int MIN_LETTERS[] = { 2, 3, 4, 5, 6 };
+const int MARGINS[] = { 0, 500, 1000, 1500, 2000, 3000 };
+const size_t LAYOUT_COUNTS[] = { 1, 2, 4, 8, 16 };
+
+// Keys that carry letters on every rotated layout
+const char LETTER_KEYS[] = "QWERTYUIOPASDFGHJKLZXCVBNM";
+const size_t LETTER_KEY_COUNT = sizeof(LETTER_KEYS) - 1;
+
+void PrintUsage() {
+    printf("Usage:\n"
+           "  kswitcher-autocorrect [--check]  detection and false positive rates\n"
+           "  kswitcher-autocorrect --bench    per-keystroke scoring cost\n");
+}
+
+uint32_t NextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// A layout with a made-up language on its letter keys: a skewed letter
+// chain, a model trained on it, and words from it the model never saw
+struct Language {
+    LayoutTable table;
+    std::vector<int> keys;                  // Keys that type a letter
+    std::vector<std::vector<uint32_t>> chain;   // Cumulative next-key weights
+    std::vector<uint8_t> trigramData;
+    std::vector<uint8_t> dictionaryData;
+    NgramTable trigrams;
+    Dawg dictionary;
+    std::vector<std::vector<int>> testWords;
+};
+
+// Latin or Cyrillic letters on the letter keys, rotated per layout so no two
+// layouts read a key the same, as kswitcher-rank builds them
+LayoutTable RotatedTable(size_t index) {
+    bool cyrillic = index % 2 == 1;
+    char16_t base = cyrillic ? u'а' : u'a';
+    size_t alphabet = cyrillic ? 32 : 26;
+
+    LayoutTable table(0x04090409 + static_cast<uint32_t>(index));
+    for (size_t i = 0; i < LETTER_KEY_COUNT; ++i) {
+        char16_t letter = static_cast<char16_t>(base + (i + index / 2) % alphabet);
+        table.SetKey(LETTER_KEYS[i], letter, static_cast<char16_t>(letter - 0x20), true);
+    }
+    table.SetKey(VK_SPACE, u' ', u' ', false);
+    return table;
+}
+
+// Each key is followed by a few keys far more often than the rest, as
+// letters are in real text
+void BuildChain(Language& language, uint32_t& state) {
+    size_t count = language.keys.size();
+    language.chain.assign(count + 1, std::vector<uint32_t>(count));
+    for (std::vector<uint32_t>& weights : language.chain) {
+        std::vector<size_t> order(count);
+        for (size_t i = 0; i < count; ++i) {
+            order[i] = i;
+        }
+        for (size_t i = count - 1; i > 0; --i) {
+            std::swap(order[i], order[NextRandom(state) % (i + 1)]);
+        }
+
+        for (size_t rank = 0; rank < count; ++rank) {
+            weights[order[rank]] = static_cast<uint32_t>(100000 / ((rank + 1) * (rank + 1)));
+        }
+        for (size_t i = 1; i < count; ++i) {
+            weights[i] += weights[i - 1];
+        }
+    }
+}
+
+std::vector<int> MakeWord(const Language& language, uint32_t& state) {
+    size_t length = 2 + NextRandom(state) % 5 + NextRandom(state) % 6;
+    std::vector<int> word;
+    size_t previous = language.keys.size();     // Start of word
+    for (size_t i = 0; i < length; ++i) {
+        const std::vector<uint32_t>& weights = language.chain[previous];
+        uint32_t pick = NextRandom(state) % weights.back();
+        previous = std::upper_bound(weights.begin(), weights.end(), pick) - weights.begin();
+        word.push_back(language.keys[previous]);
+    }
+    return word;
+}
+
+std::u16string Spell(const LayoutTable& table, const std::vector<int>& word) {
+    std::u16string text;
+    for (int key : word) {
+        text += table.Translate(key, false);
+    }
+    return text;
+}
+
+void BuildLanguage(const LayoutTable& table, uint32_t seed, Language& language) {
+    language.table = table;
+    for (int key = 0; key < LayoutTable::KEY_COUNT; ++key) {
+        if (IsLetterChar(table.Translate(key, false))) language.keys.push_back(key);
+    }
+
+    uint32_t state = seed;
+    BuildChain(language, state);
+
+    std::u16string text;
+    std::vector<std::u16string> words;
+    for (size_t i = 0; i < TRAINING_WORDS; ++i) {
+        std::u16string word = Spell(table, MakeWord(language, state));
+        text += word;
+        text += u' ';
+        words.push_back(word);
+    }
+
+    NgramTableBuilder trigrams;
+    trigrams.AddText(text.data(), text.size());
+    language.trigramData = trigrams.Serialize();
+    language.trigrams.Attach(language.trigramData.data(), language.trigramData.size());
+
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    DawgBuilder dictionary;
+    for (const std::u16string& word : words) {
+        dictionary.Add(word);
+    }
+    language.dictionaryData = dictionary.Serialize();
+    language.dictionary.Attach(language.dictionaryData.data(), language.dictionaryData.size());
+
+    for (size_t i = 0; i < TEST_WORDS; ++i) {
+        language.testWords.push_back(MakeWord(language, state));
+    }
+}
+
+// The engine and a fake with the two built-in layouts, one window
+class Typist {
+public:
+    Typist(Language* languages, const AutoCorrectOptions& options)
+        : _engine(_backend, _latency, KeystrokeRing::DEFAULT_CAPACITY), _time(0) {
+        for (size_t i = 0; i < 2; ++i) {
+            _layouts[i] = _backend.AddLayout(languages[i].table, &languages[i].dictionary, &languages[i].trigrams);
+        }
+        _backend.SetForegroundWindow(reinterpret_cast<HWND>(1));
+        _engine.UpdateFocus();
+        _engine.SetAutoCorrect(options);
+    }
+
+    // Types the word and a space in layout; true if it was corrected
+    bool Type(const std::vector<int>& word, size_t layout, bool capital) {
+        _backend.SetActiveLayout(_layouts[layout]);
+        _backend.ClearHistory();
+        size_t before = _engine.GetAutoCorrectStats().corrections;
+        for (size_t i = 0; i < word.size(); ++i) {
+            Press(word[i], capital && i == 0 ? KeyEvent::Shift : 0);
+        }
+        Press(VK_SPACE, 0);
+        return _engine.GetAutoCorrectStats().corrections != before;
+    }
+
+    void PressPause() { Press(VK_PAUSE, KeyEvent::Correction); }
+
+    size_t ActiveLayout() const { return _backend.ActiveLayout() == _layouts[0] ? 0 : 1; }
+    const CorrectionEngine::AutoCorrectStats& Stats() const { return _engine.GetAutoCorrectStats(); }
+
+private:
+    void Press(int virtualKey, uint16_t flags) {
+        KeyEvent event = {};
+        event.virtualKey = static_cast<uint16_t>(virtualKey);
+        event.flags = static_cast<uint16_t>(KeyEvent::KeyDown | flags);
+        event.time = _time += 120;
+        _engine.Process(event);
+    }
+
+    FakeBackend _backend;
+    LatencyMetrics _latency;
+    CorrectionEngine _engine;
+    HKL _layouts[2];
+    uint32_t _time;
+};
+
+struct Rates {
+    size_t words = 0;
+    size_t falsePositives = 0;  // Typed right, changed anyway
+    size_t misses = 0;          // Typed wrong, left alone or sent elsewhere
+};
+
+// Every test word of both languages, once in its own layout and once in the
+// other, with every tenth word capitalized
+Rates Evaluate(Language* languages, const AutoCorrectOptions& options) {
+    Typist typist(languages, options);
+    Rates rates;
+    for (size_t language = 0; language < 2; ++language) {
+        const std::vector<std::vector<int>>& words = languages[language].testWords;
+        for (size_t i = 0; i < words.size(); ++i) {
+            bool capital = i % 10 == 0;
+            if (typist.Type(words[i], language, capital)) ++rates.falsePositives;
+            if (!typist.Type(words[i], 1 - language, capital) || typist.ActiveLayout() != language) {
+                ++rates.misses;
+            }
+            ++rates.words;
+        }
+    }
+    return rates;
+}
+
+double Percent(size_t part, size_t whole) {
+    return whole ? 100.0 * part / whole : 0.0;
+}
+
+// Pause after each false positive must put the word back, and the same
+// word typed again must be left alone
+void CheckUndo(Language* languages) {
+    AutoCorrectOptions options;
+    options.enabled = true;
+    Typist typist(languages, options);
+    size_t undone = 0;
+    size_t restored = 0;
+    size_t again = 0;
+    for (size_t language = 0; language < 2; ++language) {
+        for (const std::vector<int>& word : languages[language].testWords) {
+            if (!typist.Type(word, language, false)) continue;
+            typist.PressPause();
+            ++undone;
+            if (typist.ActiveLayout() == language) ++restored;
+            if (typist.Type(word, language, false)) ++again;
+        }
+    }
+    printf("undo: %zu false positives taken back with Pause, %zu back in their layout, %zu corrected again\n",
+           undone, restored, again);
+    printf("      %zu undos counted by the engine\n\n", typist.Stats().undos);
+}
+
+int Report(Language* languages) {
+    AutoCorrectOptions defaults;
+    printf("false positives / misses by minimum letters and margin (per letter, thousandths of a nat)\n");
+    printf("%-8s", "letters");
+    for (int margin : MARGINS) {
+        printf(" %16d", margin);
+    }
+    printf("\n");
+
+    for (int minLetters : MIN_LETTERS) {
+        printf("%-8d", minLetters);
+        for (int margin : MARGINS) {
+            AutoCorrectOptions options;
+            options.enabled = true;
+            options.minLetters = minLetters;
+            options.margin = margin;
+            Rates rates = Evaluate(languages, options);
+            char cell[32];
+            snprintf(cell, sizeof(cell), "%.2f%% / %.1f%%%s", Percent(rates.falsePositives, rates.words),
+                     Percent(rates.misses, rates.words),
+                     minLetters == defaults.minLetters && margin == defaults.margin ? "*" : "");
+            printf(" %16s", cell);
+        }
+        printf("\n");
+    }
+    printf("(* defaults; %zu words per language, each typed in both layouts; misses include words\n"
+           " shorter than the minimum)\n\n", TEST_WORDS);
+
+    CheckUndo(languages);
+    return 0;
+}
+
+int Bench(Language* languages) {
+    LayoutCandidate candidates[LayoutRanker::MAX_LAYOUTS];
+    for (size_t i = 0; i < LayoutRanker::MAX_LAYOUTS; ++i) {
+        candidates[i] = { &languages[i].table, &languages[i].dictionary, &languages[i].trigrams };
+    }
+
+    // The first language's test words, space after each
+    std::vector<KeystrokeInfo> keystrokes;
+    std::vector<size_t> wordEnds;
+    for (const std::vector<int>& word : languages[0].testWords) {
+        for (int key : word) {
+            keystrokes.push_back(KeystrokeInfo::Make(key, false, false));
+        }
+        keystrokes.push_back(KeystrokeInfo::Make(VK_SPACE, false, false));
+        wordEnds.push_back(keystrokes.size());
+    }
+
+    WordScorer scorer;
+    LayoutRanker ranker;
+    LayoutRanker::Ranking rankings[LayoutRanker::MAX_LAYOUTS];
+    size_t mismatches = 0;
+    volatile size_t sink = 0;
+
+    printf("%-8s %14s %14s %14s\n", "layouts", "push ns/key", "rank ns/word", "rank ns/key");
+    for (size_t layoutCount : LAYOUT_COUNTS) {
+        scorer.SetCandidates(candidates, layoutCount);
+        ranker.SetCandidates(candidates, layoutCount);
+
+        // The scores at every word end are the ones Rank gives the word
+        size_t start = 0;
+        for (size_t end : wordEnds) {
+            scorer.Reset();
+            for (size_t i = start; i < end; ++i) {
+                scorer.Push(keystrokes[i]);
+            }
+            size_t ranked = ranker.Rank(&keystrokes[start], end - start, 0, rankings);
+            for (size_t i = 0; i < ranked; ++i) {
+                if (scorer.FinalScore(rankings[i].candidate) != rankings[i].score) ++mismatches;
+            }
+            if (!scorer.EndsWord()) ++mismatches;
+            start = end;
+        }
+
+        const size_t rounds = std::max<size_t>(1, 16 / layoutCount);
+        Clock::time_point begin = Clock::now();
+        for (size_t round = 0; round < rounds; ++round) {
+            scorer.Reset();
+            for (const KeystrokeInfo& keystroke : keystrokes) {
+                scorer.Push(keystroke);
+                if (scorer.EndsWord()) {
+                    sink = scorer.GetLane(0).score;
+                    scorer.Reset();
+                }
+            }
+        }
+        double pushNs = Seconds(begin) * 1e9 / (rounds * keystrokes.size());
+
+        begin = Clock::now();
+        for (size_t round = 0; round < rounds; ++round) {
+            start = 0;
+            for (size_t end : wordEnds) {
+                sink = ranker.Rank(&keystrokes[start], end - start, 0, rankings);
+                start = end;
+            }
+        }
+        double rankNs = Seconds(begin) * 1e9 / rounds;
+
+        printf("%-8zu %14.1f %14.1f %14.1f\n", layoutCount, pushNs, rankNs / wordEnds.size(),
+               rankNs / keystrokes.size());
+    }
+
+    (void)sink;
+    printf("\nword scores: %s\n", mismatches ? "MISMATCH" : "match the ranker");
+    return mismatches ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bool bench = argc == 2 && strcmp(argv[1], "--bench") == 0;
+    bool check = argc == 2 && strcmp(argv[1], "--check") == 0;
+    if (argc > 1 && !bench && !check) {
+        PrintUsage();
+        return 1;
+    }
+
+    // English and Russian first, rotated layouts to fill the ranker
+    std::vector<Language> languages(bench ? LayoutRanker::MAX_LAYOUTS : 2);
+    BuildLanguage(LayoutTable::EnglishUS(), 0x9E3779B9u, languages[0]);
+    BuildLanguage(LayoutTable::RussianRU(), 0x7F4A7C15u, languages[1]);
+    for (size_t i = 2; i < languages.size(); ++i) {
+        BuildLanguage(RotatedTable(i), 0x9E3779B9u + static_cast<uint32_t>(i), languages[i]);
+    }
+
+    return bench ? Bench(languages.data()) : Report(languages.data());
+}
\ No newline at end of file
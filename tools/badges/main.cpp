@@ -0,0 +1,245 @@
+// kswitcher-badges: renders the tray layout badges off Windows. Prints them
+// as text, writes them out as images, checks their pixels and measures how
+// many icon updates per second the compositor sustains.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "BadgeAtlas.h"
+#include "ToolSupport.h"
+
+namespace {
+
+// The sizes TrayApplication rounds the DPI-scaled icon size to
+const int ICON_SIZES[] = { 16, 24, 32, 48, 64, 128 };
+
+const char* const DEFAULT_CODES[] = { "EN", "RU", "UK", "DE", "FR", "KK", "HAW", "A" };
+
+const char* ThemeName(BadgeAtlas::Theme theme) {
+    return theme == BadgeAtlas::THEME_DARK ? "dark" : "light";
+}
+
+void PrintUsage() {
+    printf("Usage:\n"
+           "  kswitcher-badges --show <size> <code> [light|dark]\n"
+           "  kswitcher-badges --dump <directory> [code...]\n"
+           "  kswitcher-badges --check\n"
+           "  kswitcher-badges --bench\n");
+}
+
+void Show(int size, const char* code, BadgeAtlas::Theme theme) {
+    BadgeAtlas atlas;
+    if (!atlas.Build(size)) {
+        fprintf(stderr, "error: size must be %d..%d\n", BadgeAtlas::MIN_SIZE, BadgeAtlas::MAX_SIZE);
+        return;
+    }
+    std::vector<uint32_t> pixels(static_cast<size_t>(size) * size);
+    atlas.Compose(code, theme, pixels.data());
+
+    // Shade by luminance over transparent; ' ' is transparent
+    const char* ramp = " .:-=+*#%@";
+    for (int y = 0; y < size; ++y) {
+        std::string line;
+        for (int x = 0; x < size; ++x) {
+            uint32_t pixel = pixels[static_cast<size_t>(y) * size + x];
+            uint32_t alpha = pixel >> 24;
+            if (alpha == 0) {
+                line += "  ";
+                continue;
+            }
+            uint32_t luminance = ((pixel >> 16 & 0xFF) + (pixel >> 8 & 0xFF) + (pixel & 0xFF)) / 3;
+            char ch = ramp[1 + luminance * 8 / 255];
+            line += ch;
+            line += ch;
+        }
+        printf("%s\n", line.c_str());
+    }
+}
+
+bool WritePam(const std::string& path, const uint32_t* pixels, int size) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+
+    fprintf(file, "P7\nWIDTH %d\nHEIGHT %d\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n", size, size);
+    for (int i = 0; i < size * size; ++i) {
+        uint8_t rgba[4] = {
+            static_cast<uint8_t>(pixels[i] >> 16),
+            static_cast<uint8_t>(pixels[i] >> 8),
+            static_cast<uint8_t>(pixels[i]),
+            static_cast<uint8_t>(pixels[i] >> 24),
+        };
+        fwrite(rgba, 1, 4, file);
+    }
+    return fclose(file) == 0;
+}
+
+int Dump(const char* directory, const std::vector<const char*>& codes) {
+    std::vector<uint32_t> pixels;
+    for (int size : ICON_SIZES) {
+        BadgeAtlas atlas;
+        atlas.Build(size);
+        pixels.resize(static_cast<size_t>(size) * size);
+        for (const char* code : codes) {
+            for (int theme = 0; theme < BadgeAtlas::THEME_COUNT; ++theme) {
+                atlas.Compose(code, static_cast<BadgeAtlas::Theme>(theme), pixels.data());
+                char name[64];
+                snprintf(name, sizeof(name), "/%s-%d-%s.pam", code, size,
+                         ThemeName(static_cast<BadgeAtlas::Theme>(theme)));
+                if (!WritePam(directory + std::string(name), pixels.data(), size)) {
+                    fprintf(stderr, "error: cannot write %s%s\n", directory, name);
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+int Check() {
+    size_t failures = 0;
+    auto fail = [&failures](const char* what, int size, const char* code) {
+        fprintf(stderr, "FAIL %s: %d px \"%s\"\n", what, size, code);
+        ++failures;
+    };
+
+    std::vector<uint32_t> pixels, fresh, blank;
+    for (int size : ICON_SIZES) {
+        BadgeAtlas atlas;
+        atlas.Build(size);
+        size_t count = static_cast<size_t>(size) * size;
+        pixels.resize(count);
+        fresh.resize(count);
+        blank.resize(count);
+
+        for (const char* code : DEFAULT_CODES) {
+            for (int t = 0; t < BadgeAtlas::THEME_COUNT; ++t) {
+                BadgeAtlas::Theme theme = static_cast<BadgeAtlas::Theme>(t);
+                atlas.Compose(code, theme, pixels.data());
+                atlas.Compose("", theme, blank.data());
+
+                // Glyphs cached by earlier codes render the same as new ones
+                BadgeAtlas other;
+                other.Build(size);
+                other.Compose(code, theme, fresh.data());
+                if (pixels != fresh) fail("cache changes pixels", size, code);
+
+                // The badge outline is symmetric in both axes
+                bool symmetric = true;
+                for (int y = 0; y < size; ++y) {
+                    for (int x = 0; x < size; ++x) {
+                        uint32_t alpha = pixels[static_cast<size_t>(y) * size + x] >> 24;
+                        if (alpha != pixels[static_cast<size_t>(y) * size + (size - 1 - x)] >> 24 ||
+                            alpha != pixels[static_cast<size_t>(size - 1 - y) * size + x] >> 24) {
+                            symmetric = false;
+                        }
+                    }
+                }
+                if (!symmetric) fail("outline not symmetric", size, code);
+
+                if (pixels[0] >> 24 != 0 || pixels[count - 1] >> 24 != 0) {
+                    fail("corner not transparent", size, code);
+                }
+
+                // Letters change pixels only inside the badge, and alpha
+                // never changes
+                size_t changed = 0;
+                bool alphaKept = true;
+                for (size_t i = 0; i < count; ++i) {
+                    if (pixels[i] != blank[i]) ++changed;
+                    if (pixels[i] >> 24 != blank[i] >> 24) alphaKept = false;
+                }
+                if (!alphaKept) fail("text changes alpha", size, code);
+                if (changed < count / 20) fail("text too small", size, code);
+
+                // Text box centered within a pixel; every test code has ink
+                // in the outer font columns
+                int minX = size, maxX = -1;
+                for (int y = 0; y < size; ++y) {
+                    for (int x = 0; x < size; ++x) {
+                        size_t i = static_cast<size_t>(y) * size + x;
+                        if (pixels[i] == blank[i]) continue;
+                        if (x < minX) minX = x;
+                        if (x > maxX) maxX = x;
+                    }
+                }
+                double center = (minX + maxX + 1) / 2.0;
+                if (center < size / 2.0 - 1 || center > size / 2.0 + 1) fail("text not centered", size, code);
+            }
+        }
+
+        // Lower case and punctuation normalize away
+        atlas.Compose("en", BadgeAtlas::THEME_LIGHT, pixels.data());
+        atlas.Compose("E-N", BadgeAtlas::THEME_LIGHT, fresh.data());
+        atlas.Compose("EN", BadgeAtlas::THEME_LIGHT, blank.data());
+        if (pixels != blank || fresh != blank) fail("code not normalized", size, "en");
+    }
+
+    printf("%zu sizes, %zu codes, %s\n", sizeof(ICON_SIZES) / sizeof(ICON_SIZES[0]),
+           sizeof(DEFAULT_CODES) / sizeof(DEFAULT_CODES[0]), failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
+
+void Bench() {
+    printf("%-6s %14s %14s %12s\n", "size", "build (us)", "updates/s", "atlas (KB)");
+
+    std::vector<uint32_t> pixels;
+    for (int size : ICON_SIZES) {
+        const int buildRounds = 200;
+        BadgeAtlas atlas;
+        pixels.resize(static_cast<size_t>(size) * size);
+
+        // Cold: a fresh size, first badge for each layout
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < buildRounds; ++i) {
+            atlas.Build(size);
+            atlas.Compose("EN", BadgeAtlas::THEME_DARK, pixels.data());
+            atlas.Compose("RU", BadgeAtlas::THEME_DARK, pixels.data());
+        }
+        double buildSeconds = Seconds(start);
+
+        // Warm: alternating layouts as on every switch
+        size_t updates = 0;
+        volatile uint32_t sink = 0;
+        start = Clock::now();
+        double seconds = 0;
+        while (seconds < 0.2) {
+            for (int i = 0; i < 1000; ++i) {
+                atlas.Compose(i & 1 ? "RU" : "EN", BadgeAtlas::THEME_DARK, pixels.data());
+                sink = pixels[pixels.size() / 2];
+            }
+            updates += 1000;
+            seconds = Seconds(start);
+        }
+        (void)sink;
+
+        printf("%-6d %14.1f %14.0f %12.1f\n", size, buildSeconds * 1e6 / buildRounds, updates / seconds,
+               atlas.MemoryUsage() / 1024.0);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc >= 4 && strcmp(argv[1], "--show") == 0) {
+        BadgeAtlas::Theme theme = argc >= 5 && strcmp(argv[4], "dark") == 0 ?
+            BadgeAtlas::THEME_DARK : BadgeAtlas::THEME_LIGHT;
+        Show(atoi(argv[2]), argv[3], theme);
+        return 0;
+    }
+    if (argc >= 3 && strcmp(argv[1], "--dump") == 0) {
+        std::vector<const char*> codes(argv + 3, argv + argc);
+        if (codes.empty()) codes.assign(std::begin(DEFAULT_CODES), std::end(DEFAULT_CODES));
+        return Dump(argv[2], codes);
+    }
+    if (argc == 2 && strcmp(argv[1], "--check") == 0) {
+        return Check();
+    }
+    if (argc == 2 && strcmp(argv[1], "--bench") == 0) {
+        Bench();
+        return 0;
+    }
+    PrintUsage();
+    return 1;
+}
\ No newline at end of file
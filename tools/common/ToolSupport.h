@@ -0,0 +1,35 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// What every host tool needs for its checks and benchmarks: one clock, a
+// seeded generator for synthetic input, and the line a check prints.
+
+using Clock = std::chrono::steady_clock;
+
+inline double Seconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Xorshift; the same seed gives the same input on every host
+class Random {
+public:
+    explicit Random(uint64_t seed) : _state(seed) {}
+    uint64_t Next() {
+        _state ^= _state << 13;
+        _state ^= _state >> 7;
+        _state ^= _state << 17;
+        return _state;
+    }
+    uint32_t Below(uint32_t limit) { return static_cast<uint32_t>(Next() % limit); }
+
+private:
+    uint64_t _state;
+};
+
+// One check's result, aligned with the others; returns passed
+inline bool Report(const char* name, bool passed) {
+    printf("%-52s %s\n", name, passed ? "ok" : "FAIL");
+    return passed;
+}
\ No newline at end of file
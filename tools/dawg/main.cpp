@@ -0,0 +1,239 @@
+// kswitcher-dawg: checks the dictionary builder and the mapped DAWG view, and
+// measures lookups per second and resident memory for large dictionaries.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "AppendFile.h"
+#include "Dawg.h"
+#include "DawgBuilder.h"
+#include "MappedFile.h"
+#include "ToolSupport.h"
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace {
+
+void PrintUsage() {
+    printf("Usage:\n"
+           "  kswitcher-dawg --check\n"
+           "  kswitcher-dawg --bench <scratch directory>\n");
+}
+
+// Word-like strings: Cyrillic syllables, so prefixes and endings repeat the
+// way they do in a real word list. Sorted and unique, as the builder wants.
+std::vector<std::u16string> Words(size_t count, uint64_t seed) {
+    static const char16_t CONSONANTS[] = u"бвгдзклмнпрстхчш";
+    static const char16_t VOWELS[] = u"аеиоуыя";
+    static const char16_t* ENDINGS[] = { u"", u"ть", u"ся", u"ов", u"ами", u"ого", u"ему", u"ешь" };
+    Random random(seed);
+    std::vector<std::u16string> words;
+    words.reserve(count + count / 4);
+    while (words.size() < count) {
+        size_t target = count - words.size();
+        for (size_t i = 0; i < target + target / 4; ++i) {
+            std::u16string word;
+            size_t syllables = 1 + random.Below(4);
+            for (size_t j = 0; j < syllables; ++j) {
+                word += CONSONANTS[random.Below(16)];
+                word += VOWELS[random.Below(7)];
+                if (random.Below(3) == 0) word += CONSONANTS[random.Below(16)];
+            }
+            word += ENDINGS[random.Below(8)];
+            words.push_back(word);
+        }
+        std::sort(words.begin(), words.end());
+        words.erase(std::unique(words.begin(), words.end()), words.end());
+    }
+    // Keep a random sample of exactly count, back in order
+    for (size_t i = 0; i < count; ++i) {
+        std::swap(words[i], words[i + random.Below(static_cast<uint32_t>(words.size() - i))]);
+    }
+    words.resize(count);
+    std::sort(words.begin(), words.end());
+    return words;
+}
+
+// Resident set of the process, 0 where it cannot be read
+size_t ResidentBytes() {
+#ifdef __linux__
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (!file) return 0;
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    int fields = fscanf(file, "%lu %lu", &size, &resident);
+    fclose(file);
+    return fields == 2 ? resident * static_cast<size_t>(sysconf(_SC_PAGESIZE)) : 0;
+#else
+    return 0;
+#endif
+}
+
+bool Contains(const Dawg& dawg, const std::u16string& word) {
+    return dawg.Contains(word.data(), word.size());
+}
+
+int Check() {
+    bool ok = true;
+
+    {
+        DawgBuilder builder;
+        bool refused = builder.Add(u"кот") && !builder.Add(u"кот") && !builder.Add(u"кит") &&
+                       !builder.Add(u"") && builder.Add(u"кошка") && builder.WordCount() == 2;
+        ok = Report("builder refuses empty, repeated and unsorted words", refused) && ok;
+    }
+
+    std::vector<std::u16string> words = Words(20000, 0x2545F4914F6CDD1Dull);
+    DawgBuilder builder;
+    bool added = true;
+    for (const std::u16string& word : words) {
+        added = builder.Add(word) && added;
+    }
+    std::vector<uint8_t> data = builder.Serialize();
+    Dawg dawg;
+    bool attached = dawg.Attach(data.data(), data.size()) && dawg.WordCount() == words.size() &&
+                    dawg.SizeInBytes() == data.size();
+    ok = Report("dictionary attaches with every word counted", added && attached) && ok;
+
+    bool found = true;
+    for (const std::u16string& word : words) {
+        found = Contains(dawg, word) && found;
+    }
+    ok = Report("every word is found", found) && ok;
+
+    // Prefixes, extensions and edits of words are only found when listed
+    Random random(0x5851F42D4C957F2Dull);
+    bool exact = !dawg.Contains(nullptr, 0) && !Contains(dawg, u"") && !Contains(dawg, u"hello");
+    for (int i = 0; i < 20000; ++i) {
+        std::u16string word = words[random.Below(static_cast<uint32_t>(words.size()))];
+        std::u16string variants[] = { word.substr(0, 1 + random.Below(static_cast<uint32_t>(word.size()))),
+                                      word + u"ъ", word };
+        variants[2][random.Below(static_cast<uint32_t>(word.size()))] = u'ё';
+        for (const std::u16string& variant : variants) {
+            bool listed = std::binary_search(words.begin(), words.end(), variant);
+            exact = Contains(dawg, variant) == listed && exact;
+        }
+    }
+    ok = Report("prefixes and edits are found only when listed", exact) && ok;
+
+    // Suffix sharing keeps the graph well under one edge per character
+    size_t characters = 0;
+    for (const std::u16string& word : words) characters += word.size();
+    ok = Report("shared suffixes are merged",
+                (dawg.SizeInBytes() - sizeof(DawgHeader)) / sizeof(DawgEdge) < characters / 2) && ok;
+
+    {
+        Dawg rejected;
+        std::vector<uint8_t> wrongMagic = data;
+        wrongMagic[0] ^= 0xFF;
+        std::vector<uint8_t> wrongVersion = data;
+        wrongVersion[4] += 1;
+        bool refused = !rejected.Attach(data.data(), data.size() - sizeof(DawgEdge)) &&
+                       !rejected.Attach(data.data(), sizeof(DawgHeader) - 1) &&
+                       !rejected.Attach(wrongMagic.data(), wrongMagic.size()) &&
+                       !rejected.Attach(wrongVersion.data(), wrongVersion.size()) && !rejected.IsValid() &&
+                       !Contains(rejected, words[0]);
+        ok = Report("truncated or foreign data is rejected", refused) && ok;
+    }
+
+    return ok ? 0 : 1;
+}
+
+int Bench(const NativePath& directory) {
+    const size_t SIZES[] = { 100000, 1000000 };
+    const size_t LOOKUPS = 4000000;
+    NativePath path = directory;
+#ifdef _WIN32
+    path += L"\\kswitcher-dawg.ksdw";
+#else
+    path += "/kswitcher-dawg.ksdw";
+#endif
+
+    printf("%-8s %8s %10s %9s %12s %12s %11s\n", "words", "build s", "bytes", "per word", "hits/s", "misses/s",
+           "resident");
+    for (size_t size : SIZES) {
+        std::vector<std::u16string> words = Words(size, 0xBF58476D1CE4E5B9ull + size);
+
+        Clock::time_point start = Clock::now();
+        std::vector<uint8_t> data;
+        {
+            DawgBuilder builder;
+            for (const std::u16string& word : words) {
+                builder.Add(word);
+            }
+            data = builder.Serialize();
+        }
+        double buildSeconds = Seconds(start);
+
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            if (!file.write(reinterpret_cast<const char*>(data.data()), data.size())) {
+                fprintf(stderr, "error: cannot write to the scratch directory\n");
+                return 1;
+            }
+        }
+        size_t dataSize = data.size();
+        std::vector<uint8_t>().swap(data);
+
+        // Queries: listed words, and the same words with one letter changed
+        Random random(size);
+        std::vector<std::u16string> hits(4096);
+        std::vector<std::u16string> misses(4096);
+        for (size_t i = 0; i < hits.size(); ++i) {
+            hits[i] = words[random.Below(static_cast<uint32_t>(words.size()))];
+            misses[i] = hits[i];
+            misses[i][random.Below(static_cast<uint32_t>(misses[i].size()))] = u'ё';
+        }
+        std::vector<std::u16string>().swap(words);
+
+        // Mapped as the app maps its models; resident is what the mapping
+        // adds once lookups have touched it
+        size_t residentBefore = ResidentBytes();
+        MappedFile file;
+        Dawg dawg;
+        if (!file.Open(path) || !dawg.Attach(file.Data(), file.Size())) {
+            fprintf(stderr, "error: cannot map the dictionary\n");
+            return 1;
+        }
+        size_t found = 0;
+        start = Clock::now();
+        for (size_t i = 0; i < LOOKUPS; ++i) {
+            found += Contains(dawg, hits[i & (hits.size() - 1)]) ? 1 : 0;
+        }
+        double hitSeconds = Seconds(start);
+        start = Clock::now();
+        for (size_t i = 0; i < LOOKUPS; ++i) {
+            found += Contains(dawg, misses[i & (misses.size() - 1)]) ? 1 : 0;
+        }
+        double missSeconds = Seconds(start);
+        size_t residentAfter = ResidentBytes();
+        file.Close();
+        if (found < LOOKUPS) return 1;
+
+        char resident[32] = "n/a";
+        if (residentBefore && residentAfter) {
+            snprintf(resident, sizeof(resident), "%.1f KB", (residentAfter - residentBefore) / 1024.0);
+        }
+        printf("%-8zu %8.2f %10zu %9.2f %12.0f %12.0f %11s\n", size, buildSeconds, dataSize,
+               static_cast<double>(dataSize) / size, LOOKUPS / hitSeconds, LOOKUPS / missSeconds, resident);
+    }
+    AppendFile::Remove(path);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 2 && strcmp(argv[1], "--check") == 0) {
+        return Check();
+    }
+    if (argc == 3 && strcmp(argv[1], "--bench") == 0) {
+        return Bench(MappedFile::PathFromUtf8(argv[2]));
+    }
+    PrintUsage();
+    return 1;
+}
\ No newline at end of file
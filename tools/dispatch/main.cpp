@@ -0,0 +1,325 @@
+// kswitcher-dispatch: checks the hook dispatcher's handler table, its enabled
+// and suspended masks and its modifier tracking, and measures the cost per
+// event of synthetic keyboard streams under different masks.
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "HookDispatcher.h"
+#include "Hotkeys.h"
+#include "InjectedInput.h"
+#include "InputStateMachine.h"
+#include "KeyEventRing.h"
+#include "ToolSupport.h"
+
+namespace {
+
+void PrintUsage() {
+    printf("Usage:\n"
+           "  kswitcher-dispatch --check\n"
+           "  kswitcher-dispatch --bench\n");
+}
+
+struct HookEvent {
+    UINT message;
+    KBDLLHOOKSTRUCT event;
+};
+
+HookEvent Key(DWORD virtualKey, bool up, bool alt = false) {
+    HookEvent hook = {};
+    hook.message = up ? (alt ? WM_SYSKEYUP : WM_KEYUP) : (alt ? WM_SYSKEYDOWN : WM_KEYDOWN);
+    hook.event.vkCode = virtualKey;
+    hook.event.flags = up ? LLKHF_UP : 0;
+    return hook;
+}
+
+// Notes every call it gets, in order, and what the modifiers were
+class Probe {
+public:
+    Probe() : _dispatcher(nullptr), _suppress(0) {}
+
+    void Attach(HookDispatcher& dispatcher) {
+        _dispatcher = &dispatcher;
+        for (int id = 0; id < HookDispatcher::HANDLER_COUNT; ++id) {
+            _slots[id] = { this, id };
+            dispatcher.SetHandler(static_cast<HookDispatcher::HandlerId>(id), Called, &_slots[id]);
+            dispatcher.SetEnabled(static_cast<HookDispatcher::HandlerId>(id), true);
+        }
+    }
+
+    // Handlers, as a mask of 1 << HandlerId, that suppress the key
+    void SetSuppressing(uint32_t mask) { _suppress = mask; }
+
+    std::vector<int> Run(const HookEvent& hook, bool* suppressed = nullptr) {
+        _calls.clear();
+        bool result = _dispatcher->Dispatch(hook.message, hook.event);
+        if (suppressed) *suppressed = result;
+        return _calls;
+    }
+
+    ModifierState::Snapshot Seen() const { return _seen; }
+
+private:
+    struct Slot {
+        Probe* probe;
+        int id;
+    };
+
+    static bool Called(void* context, UINT, const KBDLLHOOKSTRUCT&) {
+        Slot* slot = static_cast<Slot*>(context);
+        Probe* self = slot->probe;
+        self->_calls.push_back(slot->id);
+        self->_seen = self->_dispatcher->GetModifiers().Load();
+        return (self->_suppress & (1u << slot->id)) != 0;
+    }
+
+    HookDispatcher* _dispatcher;
+    Slot _slots[HookDispatcher::HANDLER_COUNT];
+    uint32_t _suppress;
+    std::vector<int> _calls;
+    ModifierState::Snapshot _seen = {};
+};
+
+uint64_t Samples(const HookDispatcher& dispatcher, int id) {
+    std::unique_ptr<LatencyHistogram::Snapshot> snapshot(new LatencyHistogram::Snapshot());
+    dispatcher.GetLatency()
+        .Get(static_cast<LatencyMetrics::MetricId>(LatencyMetrics::HANDLER_FIRST + id))
+        .Read(*snapshot);
+    return snapshot->count;
+}
+
+int Check() {
+    bool ok = true;
+    const std::vector<int> all = { 0, 1, 2, 3 };
+    const HookEvent letter = Key('G', false);
+
+    {
+        HookDispatcher dispatcher;
+        Probe probe;
+        probe.Attach(dispatcher);
+        bool suppressed = true;
+        ok = Report("handlers run in table order", probe.Run(letter, &suppressed) == all && !suppressed) && ok;
+
+        probe.SetSuppressing(1u << HookDispatcher::HANDLER_LAYOUT_SWITCH);
+        ok = Report("the first handler to suppress stops the rest",
+                    probe.Run(letter, &suppressed) == std::vector<int>({ 0, 1 }) && suppressed) && ok;
+        probe.SetSuppressing(0);
+
+        dispatcher.SetEnabled(HookDispatcher::HANDLER_CORRECTION, false);
+        bool skipped = probe.Run(letter) == std::vector<int>({ 0, 1, 3 }) &&
+                       !dispatcher.IsEnabled(HookDispatcher::HANDLER_CORRECTION);
+        dispatcher.SetEnabled(HookDispatcher::HANDLER_CORRECTION, true);
+        ok = Report("disabled handlers are skipped", skipped && probe.Run(letter) == all) && ok;
+
+        dispatcher.SetSuspended((1u << HookDispatcher::HANDLER_LAYOUT_SWITCH) |
+                                (1u << HookDispatcher::HANDLER_RECORDING));
+        bool suspended = probe.Run(letter) == std::vector<int>({ 0, 2 });
+        dispatcher.SetEnabled(HookDispatcher::HANDLER_RECORDING, false);
+        dispatcher.SetSuspended(1u << HookDispatcher::HANDLER_LAYOUT_SWITCH);
+        suspended = probe.Run(letter) == std::vector<int>({ 0, 2 }) && suspended;
+        dispatcher.SetEnabled(HookDispatcher::HANDLER_RECORDING, true);
+        dispatcher.SetSuspended(0);
+        ok = Report("suspended handlers are skipped until resumed", suspended && probe.Run(letter) == all) && ok;
+
+        dispatcher.SetHandler(HookDispatcher::HANDLER_TRACE, nullptr, nullptr);
+        ok = Report("a cleared handler does nothing",
+                    probe.Run(letter, &suppressed) == std::vector<int>({ 1, 2, 3 }) && !suppressed) && ok;
+    }
+
+    // Modifier state includes the event being dispatched
+    {
+        HookDispatcher dispatcher;
+        Probe probe;
+        probe.Attach(dispatcher);
+        probe.Run(Key(VK_LSHIFT, false));
+        bool down = probe.Seen().Any(ModifierState::LEFT_SHIFT) && probe.Seen().Changed(ModifierState::LEFT_SHIFT);
+        probe.Run(Key(VK_LSHIFT, true));
+        bool up = !probe.Seen().Any(ModifierState::SHIFT) && probe.Seen().Changed(ModifierState::LEFT_SHIFT);
+        ok = Report("handlers see modifiers including their event", down && up) && ok;
+
+        // A key a handler suppresses still counts
+        probe.SetSuppressing(1u << HookDispatcher::HANDLER_TRACE);
+        probe.Run(Key(VK_LMENU, false));
+        probe.SetSuppressing(0);
+        bool tracked = dispatcher.GetModifiers().Load().Any(ModifierState::LEFT_ALT);
+        probe.Run(Key(VK_LMENU, true, true));
+        ok = Report("suppressed keys still update the modifiers",
+                    tracked && !dispatcher.GetModifiers().Load().Any(ModifierState::ALT)) && ok;
+
+        // The app's own input never gets this far
+        HookEvent own = Key(VK_LSHIFT, false);
+        own.event.flags |= LLKHF_INJECTED;
+        own.event.dwExtraInfo = InjectedInput::SIGNATURE;
+        bool suppressed = true;
+        bool dropped = probe.Run(own, &suppressed).empty() && !suppressed &&
+                       !dispatcher.GetModifiers().Load().Any(ModifierState::SHIFT);
+        own.event.dwExtraInfo = 0;
+        bool foreign = probe.Run(own) == all && dispatcher.GetModifiers().Load().Any(ModifierState::SHIFT);
+        ok = Report("own injected input reaches no handler", dropped && foreign) && ok;
+    }
+
+    // One latency sample per handler call
+    {
+        HookDispatcher dispatcher;
+        Probe probe;
+        probe.Attach(dispatcher);
+        for (int i = 0; i < 10; ++i) probe.Run(letter);
+        dispatcher.SetSuspended(1u << HookDispatcher::HANDLER_CORRECTION);
+        for (int i = 0; i < 5; ++i) probe.Run(letter);
+        probe.SetSuppressing(1u << HookDispatcher::HANDLER_TRACE);
+        for (int i = 0; i < 3; ++i) probe.Run(letter);
+        bool timed = Samples(dispatcher, HookDispatcher::HANDLER_TRACE) == 18 &&
+                     Samples(dispatcher, HookDispatcher::HANDLER_LAYOUT_SWITCH) == 15 &&
+                     Samples(dispatcher, HookDispatcher::HANDLER_CORRECTION) == 10 &&
+                     Samples(dispatcher, HookDispatcher::HANDLER_RECORDING) == 15;
+        ok = Report("every handler call is timed", timed) && ok;
+    }
+
+    return ok ? 0 : 1;
+}
+
+// Handlers doing what the app's do, the recorder feeding a ring the bench
+// drains as the worker would
+class AppHandlers {
+public:
+    void Attach(HookDispatcher& dispatcher) {
+        _dispatcher = &dispatcher;
+        dispatcher.SetHandler(HookDispatcher::HANDLER_TRACE, OnTrace, this);
+        dispatcher.SetHandler(HookDispatcher::HANDLER_LAYOUT_SWITCH, OnLayoutSwitch, this);
+        dispatcher.SetHandler(HookDispatcher::HANDLER_CORRECTION, OnCorrection, this);
+        dispatcher.SetHandler(HookDispatcher::HANDLER_RECORDING, OnRecord, this);
+    }
+
+    void Drain() {
+        KeyEvent batch[64];
+        while (_ring.PopBatch(batch, 64) > 0) {}
+    }
+
+    size_t Traced() const { return _traced; }
+
+private:
+    static bool OnTrace(void* context, UINT, const KBDLLHOOKSTRUCT&) {
+        ++static_cast<AppHandlers*>(context)->_traced;
+        return false;
+    }
+
+    static bool OnLayoutSwitch(void* context, UINT message, const KBDLLHOOKSTRUCT&) {
+        auto* self = static_cast<AppHandlers*>(context);
+        return Hotkeys::IsLayoutSwitch(message, self->_dispatcher->GetModifiers().Load());
+    }
+
+    static bool OnCorrection(void*, UINT, const KBDLLHOOKSTRUCT& event) {
+        return Hotkeys::IsCorrectionKey(event);
+    }
+
+    static bool OnRecord(void* context, UINT message, const KBDLLHOOKSTRUCT& event) {
+        auto* self = static_cast<AppHandlers*>(context);
+        KeyEvent keyEvent;
+        if (InputStateMachine::MakeKeyEvent(message, event, self->_dispatcher->GetModifiers().Load(), keyEvent)) {
+            self->_ring.Push(keyEvent);
+        }
+        return false;
+    }
+
+    HookDispatcher* _dispatcher = nullptr;
+    KeyEventRing _ring;
+    size_t _traced = 0;
+};
+
+// Typing: words of letters, a capital now and then, spaces, the odd
+// Backspace, Alt+Shift and Pause
+std::vector<HookEvent> Stream(size_t count) {
+    std::vector<HookEvent> stream;
+    Random random(0x2545F4914F6CDD1Dull);
+    while (stream.size() < count) {
+        size_t length = 2 + random.Below(8);
+        for (size_t i = 0; i < length; ++i) {
+            bool capital = random.Below(12) == 0;
+            if (capital) stream.push_back(Key(VK_LSHIFT, false));
+            DWORD letter = 'A' + random.Below(26);
+            stream.push_back(Key(letter, false));
+            stream.push_back(Key(letter, true));
+            if (capital) stream.push_back(Key(VK_LSHIFT, true));
+        }
+        uint32_t roll = random.Below(100);
+        if (roll < 5) {
+            stream.push_back(Key(VK_BACK, false));
+            stream.push_back(Key(VK_BACK, true));
+        } else if (roll < 7) {
+            stream.push_back(Key(VK_LMENU, false));
+            stream.push_back(Key(VK_LSHIFT, false, true));
+            stream.push_back(Key(VK_LSHIFT, true, true));
+            stream.push_back(Key(VK_LMENU, true, true));
+        } else if (roll < 8) {
+            stream.push_back(Key(VK_PAUSE, false));
+            stream.push_back(Key(VK_PAUSE, true));
+        }
+        stream.push_back(Key(VK_SPACE, false));
+        stream.push_back(Key(VK_SPACE, true));
+    }
+    stream.resize(count);
+    return stream;
+}
+
+int Bench() {
+    const size_t EVENTS = size_t(1) << 16;
+    const size_t ROUNDS = 200;
+    const uint32_t ALL = (1u << HookDispatcher::HANDLER_COUNT) - 1;
+    const uint32_t TRACE = 1u << HookDispatcher::HANDLER_TRACE;
+    const uint32_t APP = ALL & ~TRACE;
+    const uint32_t RULE = (1u << HookDispatcher::HANDLER_CORRECTION) | (1u << HookDispatcher::HANDLER_RECORDING);
+
+    struct Setup {
+        const char* name;
+        uint32_t enabled;
+        uint32_t suspended;
+    };
+    const Setup setups[] = {
+        { "nothing enabled", 0, 0 },
+        { "app handlers", APP, 0 },
+        { "app handlers and trace", ALL, 0 },
+        { "recording only", 1u << HookDispatcher::HANDLER_RECORDING, 0 },
+        { "app handlers, rule suspends two", APP, RULE },
+        { "app handlers, all suspended", APP, ALL },
+    };
+
+    std::vector<HookEvent> stream = Stream(EVENTS);
+    printf("%zu synthetic events, %zu rounds\n", EVENTS, ROUNDS);
+    printf("%-34s %10s %12s\n", "handlers", "ns/event", "suppressed");
+    for (const Setup& setup : setups) {
+        std::unique_ptr<HookDispatcher> dispatcher(new HookDispatcher());
+        std::unique_ptr<AppHandlers> handlers(new AppHandlers());
+        handlers->Attach(*dispatcher);
+        for (int id = 0; id < HookDispatcher::HANDLER_COUNT; ++id) {
+            dispatcher->SetEnabled(static_cast<HookDispatcher::HandlerId>(id), (setup.enabled & (1u << id)) != 0);
+        }
+        dispatcher->SetSuspended(setup.suspended);
+
+        size_t suppressed = 0;
+        double seconds = 0;
+        for (size_t round = 0; round < ROUNDS; ++round) {
+            Clock::time_point start = Clock::now();
+            for (const HookEvent& hook : stream) {
+                suppressed += dispatcher->Dispatch(hook.message, hook.event) ? 1 : 0;
+            }
+            seconds += Seconds(start);
+            handlers->Drain();
+        }
+        printf("%-34s %10.1f %12zu\n", setup.name, seconds * 1e9 / (EVENTS * ROUNDS), suppressed / ROUNDS);
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 2 && strcmp(argv[1], "--check") == 0) {
+        return Check();
+    }
+    if (argc == 2 && strcmp(argv[1], "--bench") == 0) {
+        return Bench();
+    }
+    PrintUsage();
+    return 1;
+}
\ No newline at end of file
@@ -0,0 +1,164 @@
+// kswitcher-focus: drives the per-window layout memory through simulated
+// focus sequences, checks every restored layout against an unbounded
+// reference map and measures what a focus change costs.
+
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+#include "LayoutMemory.h"
+#include "ToolSupport.h"
+
+namespace {
+
+const HKL LAYOUTS[] = {
+    reinterpret_cast<HKL>(static_cast<uintptr_t>(0x04090409)),
+    reinterpret_cast<HKL>(static_cast<uintptr_t>(0x04190419)),
+    reinterpret_cast<HKL>(static_cast<uintptr_t>(0x04070407)),
+};
+const size_t LAYOUT_COUNT = sizeof(LAYOUTS) / sizeof(LAYOUTS[0]);
+
+struct Scenario {
+    const char* name;
+    size_t windows;             // Open at any time
+    size_t processes;
+    size_t focusChanges;
+    unsigned closePercent;      // Chance a focus change closes the window left
+    unsigned switchPercent;     // Chance the user switches layout in a window
+    unsigned recentPercent;     // Chance focus goes back to a recent window
+    bool perApplication;
+};
+
+const Scenario SCENARIOS[] = {
+    { "alt-tab, 6 windows", 6, 4, 1000000, 0, 20, 90, false },
+    { "desktop, 40 windows", 40, 15, 1000000, 2, 10, 70, false },
+    { "churn, 2000 windows", 2000, 200, 1000000, 10, 10, 30, false },
+    { "churn, per application", 2000, 200, 1000000, 10, 10, 30, true },
+};
+
+struct Window {
+    HWND handle;
+    uint32_t threadId;
+    uint32_t processId;
+    HKL layout;                 // What the user last set in it
+};
+
+struct Result {
+    size_t restores = 0;        // Returns to a window the reference remembers
+    size_t hits = 0;            // ...that the memory restored correctly
+    size_t wrong = 0;           // Restores of a layout the window did not have
+    double nanosecondsPerChange = 0;
+};
+
+class Simulation {
+public:
+    explicit Simulation(const Scenario& scenario)
+        : _scenario(scenario), _random(2463534242u), _nextThread(1000) {
+        for (size_t i = 0; i < scenario.windows; ++i) {
+            _windows.push_back(Open());
+        }
+    }
+
+    // Closed windows are reopened with a fresh thread; handle values come
+    // from a small pool, so reuse by another thread happens as on Windows
+    Window Open() {
+        Window window;
+        window.handle = reinterpret_cast<HWND>(static_cast<uintptr_t>(0x10000 + _random.Below(
+            static_cast<uint32_t>(_scenario.windows * 2)) * 4));
+        window.threadId = _nextThread++;
+        window.processId = 100 + _random.Below(static_cast<uint32_t>(_scenario.processes));
+        window.layout = LAYOUTS[0];
+        return window;
+    }
+
+    uint64_t Key(const Window& window) const {
+        return _scenario.perApplication ? LayoutMemory::ProcessKey(window.processId)
+                                        : LayoutMemory::WindowKey(window.handle, window.threadId);
+    }
+
+    Result Run(LayoutMemory& memory, bool check) {
+        Result result;
+        std::unordered_map<uint64_t, HKL> reference;
+        std::vector<size_t> recent;
+        size_t current = 0;
+
+        Clock::time_point start = Clock::now();
+        for (size_t step = 0; step < _scenario.focusChanges; ++step) {
+            Window& leaving = _windows[current];
+            if (_random.Below(100) < _scenario.switchPercent) {
+                leaving.layout = LAYOUTS[_random.Below(LAYOUT_COUNT)];
+            }
+            memory.Save(Key(leaving), leaving.layout);
+            if (check) reference[Key(leaving)] = leaving.layout;
+
+            if (_random.Below(100) < _scenario.closePercent) {
+                // An application outlives its windows
+                if (check && !_scenario.perApplication) reference.erase(Key(leaving));
+                leaving = Open();
+            }
+            recent.push_back(current);
+            if (recent.size() > 8) recent.erase(recent.begin());
+
+            size_t next = _random.Below(100) < _scenario.recentPercent
+                              ? recent[_random.Below(static_cast<uint32_t>(recent.size()))]
+                              : _random.Below(static_cast<uint32_t>(_windows.size()));
+            current = next;
+            Window& arriving = _windows[current];
+            HKL restored = memory.Recall(Key(arriving));
+            if (restored) arriving.layout = restored;
+
+            if (!check) continue;
+            auto expected = reference.find(Key(arriving));
+            if (expected == reference.end()) continue;
+            ++result.restores;
+            if (restored == expected->second) {
+                ++result.hits;
+            } else if (restored) {
+                ++result.wrong;
+            }
+            // What the window now has, whether or not the memory knew
+            arriving.layout = expected->second;
+        }
+        result.nanosecondsPerChange = Seconds(start) * 1e9 / _scenario.focusChanges;
+        return result;
+    }
+
+private:
+    const Scenario& _scenario;
+    Random _random;
+    std::vector<Window> _windows;
+    uint32_t _nextThread;
+};
+
+bool RunScenario(const Scenario& scenario) {
+    LayoutMemory memory;
+    Result checked = Simulation(scenario).Run(memory, true);
+    const LayoutMemory::Counters& counters = memory.GetCounters();
+    uint64_t evictions = counters.evictions;
+
+    // Timed separately, without the reference map
+    LayoutMemory timed;
+    Result bench = Simulation(scenario).Run(timed, false);
+
+    printf("%-24s %7.2f%% restored %8zu missed %4zu wrong %9llu evicted %6.1f ns per change\n",
+           scenario.name, checked.restores ? 100.0 * checked.hits / checked.restores : 100.0,
+           checked.restores - checked.hits - checked.wrong, checked.wrong,
+           static_cast<unsigned long long>(evictions), bench.nanosecondsPerChange);
+    return checked.wrong == 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc > 2 || (argc == 2 && strcmp(argv[1], "--check") != 0)) {
+        printf("Usage:\n  kswitcher-focus [--check]\n");
+        return 1;
+    }
+
+    printf("layout memory, %zu entries; restores checked against an unbounded map\n\n", LayoutMemory::CAPACITY);
+    bool ok = true;
+    for (const Scenario& scenario : SCENARIOS) {
+        ok = RunScenario(scenario) && ok;
+    }
+    return ok ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,373 @@
+// kswitcher-injection: checks that input kSwitcher injects is told apart
+// from the user's typing when the hooks see it late, long after the
+// correction that sent it returned, and measures what the dispatcher spends
+// on it.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "CorrectionEngine.h"
+#include "FakeBackend.h"
+#include "HookDispatcher.h"
+#include "Hotkeys.h"
+#include "InjectedInput.h"
+#include "LayoutTable.h"
+#include "ToolSupport.h"
+
+namespace {
+
+// What the hooks see for a KEYEVENTF_UNICODE input
+const DWORD PACKET_KEY = 0xE7;
+
+void PrintUsage() {
+    printf("Usage:\n"
+           "  kswitcher-injection [--check]  late injected input checks\n"
+           "  kswitcher-injection --bench    dispatch cost of injected input\n");
+}
+
+// The hook side of the app on a FakeBackend with the two built-in layouts:
+// the dispatcher with the app's handlers in the app's slots, and the engine
+// run synchronously. What a correction sends stays in the fake until
+// Deliver feeds it back through the dispatcher, as Windows does whenever it
+// gets round to it.
+class Hook {
+public:
+    Hook() : _engine(_backend, _dispatcher.GetLatency(), KeystrokeRing::DEFAULT_CAPACITY), _delivered(0),
+             _layoutSwitches(0), _time(0) {
+        _tables[0] = LayoutTable::EnglishUS();
+        _tables[1] = LayoutTable::RussianRU();
+        for (size_t i = 0; i < 2; ++i) {
+            _layouts[i] = _backend.AddLayout(_tables[i]);
+        }
+        _backend.SetForegroundWindow(reinterpret_cast<HWND>(static_cast<uintptr_t>(1)));
+        _engine.UpdateFocus();
+
+        _dispatcher.SetHandler(HookDispatcher::HANDLER_LAYOUT_SWITCH, OnLayoutSwitchKey, this);
+        _dispatcher.SetHandler(HookDispatcher::HANDLER_CORRECTION, OnCorrectionKey, this);
+        _dispatcher.SetHandler(HookDispatcher::HANDLER_RECORDING, OnRecordKey, this);
+        _dispatcher.SetEnabled(HookDispatcher::HANDLER_LAYOUT_SWITCH, true);
+        _dispatcher.SetEnabled(HookDispatcher::HANDLER_CORRECTION, true);
+        _dispatcher.SetEnabled(HookDispatcher::HANDLER_RECORDING, true);
+    }
+
+    void SetInjection(AppPolicy::Injection injection) { _engine.SetInjection(injection); }
+
+    // A key the user presses or releases
+    void Key(DWORD virtualKey, bool up) {
+        KBDLLHOOKSTRUCT event = {};
+        event.vkCode = virtualKey;
+        event.flags = up ? LLKHF_UP : 0;
+        Dispatch(event);
+    }
+
+    void Tap(DWORD virtualKey) {
+        Key(virtualKey, false);
+        Key(virtualKey, true);
+    }
+
+    // Letters and spaces; capitals with Shift
+    void Type(const char* text) {
+        for (const char* c = text; *c; ++c) {
+            bool shift = *c >= 'A' && *c <= 'Z';
+            if (shift) Key(VK_SHIFT, false);
+            Tap(*c == ' ' ? VK_SPACE : static_cast<DWORD>(*c >= 'a' && *c <= 'z' ? *c - 'a' + 'A' : *c));
+            if (shift) Key(VK_SHIFT, true);
+        }
+    }
+
+    // Input another program injects, a remapper or an on-screen keyboard
+    void Foreign(DWORD virtualKey) {
+        for (int up = 0; up < 2; ++up) {
+            KBDLLHOOKSTRUCT event = {};
+            event.vkCode = virtualKey;
+            event.flags = LLKHF_INJECTED | (up ? LLKHF_UP : 0);
+            Dispatch(event);
+        }
+    }
+
+    // Feeds up to count of the inputs sent so far back through the hook.
+    // Unsigned, they arrive as the app injected them before it signed them.
+    void Deliver(size_t count, bool signedInput = true) {
+        const std::vector<INPUT>& sent = _backend.SentInputs();
+        for (; count > 0 && _delivered < sent.size(); --count, ++_delivered) {
+            const KEYBDINPUT& key = sent[_delivered].ki;
+            KBDLLHOOKSTRUCT event = {};
+            event.vkCode = (key.dwFlags & KEYEVENTF_UNICODE) ? PACKET_KEY : key.wVk;
+            event.scanCode = key.wScan;
+            event.flags = LLKHF_INJECTED | ((key.dwFlags & KEYEVENTF_KEYUP) ? LLKHF_UP : 0) |
+                          ((key.dwFlags & KEYEVENTF_EXTENDEDKEY) ? LLKHF_EXTENDED : 0);
+            event.dwExtraInfo = signedInput ? key.dwExtraInfo : 0;
+            Dispatch(event);
+        }
+    }
+
+    // Drops what was sent and delivered, so long runs do not keep it
+    void Forget() {
+        _backend.ClearHistory();
+        _delivered = 0;
+    }
+
+    size_t Pending() const { return _backend.SentInputs().size() - _delivered; }
+    const std::vector<INPUT>& Sent() const { return _backend.SentInputs(); }
+    size_t LayoutSwitches() const { return _layoutSwitches; }
+
+    // Everything the injected input could disturb: the word and the last
+    // corrected one, the phrase, the modifiers and the layout
+    std::vector<uintptr_t> Fingerprint() const {
+        std::vector<uintptr_t> print;
+        const WindowBuffer& buffer = _engine.State().Current();
+        for (const KeystrokeRing* ring : { &buffer.Typing(), &buffer.LastCorrected() }) {
+            print.push_back(ring->Size());
+            for (size_t i = 0; i < ring->Size(); ++i) print.push_back(ring->Data()[i].bits);
+        }
+        size_t count;
+        const KeystrokeInfo* phrase = _engine.State().Phrase().Last(0, count);
+        print.push_back(count);
+        for (size_t i = 0; i < count; ++i) print.push_back(phrase[i].bits);
+        print.push_back(_dispatcher.GetModifiers().Load().bits);
+        print.push_back(reinterpret_cast<uintptr_t>(_backend.ActiveLayout()));
+        print.push_back(_layoutSwitches);
+        return print;
+    }
+
+    bool Dispatch(const KBDLLHOOKSTRUCT& event) {
+        KBDLLHOOKSTRUCT timed = event;
+        timed.time = _time += 10;
+        bool up = (event.flags & LLKHF_UP) != 0;
+        bool alt = _dispatcher.GetModifiers().Load().Any(ModifierState::ALT) && event.vkCode != VK_MENU;
+        UINT message = up ? (alt ? WM_SYSKEYUP : WM_KEYUP) : (alt ? WM_SYSKEYDOWN : WM_KEYDOWN);
+        return _dispatcher.Dispatch(message, timed);
+    }
+
+private:
+    static bool OnLayoutSwitchKey(void* context, UINT message, const KBDLLHOOKSTRUCT&) {
+        auto* self = static_cast<Hook*>(context);
+        if (!Hotkeys::IsLayoutSwitch(message, self->_dispatcher.GetModifiers().Load())) {
+            return false;
+        }
+        self->_backend.RequestLayout(self->_backend.ForegroundWindow(), nullptr);
+        ++self->_layoutSwitches;
+        return true;
+    }
+
+    static bool OnCorrectionKey(void* context, UINT message, const KBDLLHOOKSTRUCT& event) {
+        auto* self = static_cast<Hook*>(context);
+        if (!Hotkeys::IsCorrectionKey(event)) {
+            return false;
+        }
+        if (Hotkeys::IsKeyDown(message)) {
+            if (Hotkeys::IsPhraseCorrection(self->_dispatcher.GetModifiers().Load())) {
+                self->_engine.CorrectPhrase();
+            } else {
+                self->_engine.Correct();
+            }
+        }
+        return true;
+    }
+
+    static bool OnRecordKey(void* context, UINT message, const KBDLLHOOKSTRUCT& event) {
+        auto* self = static_cast<Hook*>(context);
+        KeyEvent keyEvent;
+        if (InputStateMachine::MakeKeyEvent(message, event, self->_dispatcher.GetModifiers().Load(), keyEvent)) {
+            self->_engine.Process(keyEvent);
+        }
+        return false;
+    }
+
+    HookDispatcher _dispatcher;
+    FakeBackend _backend;
+    CorrectionEngine _engine;
+    LayoutTable _tables[2];
+    HKL _layouts[2];
+    size_t _delivered;
+    size_t _layoutSwitches;
+    DWORD _time;
+};
+
+// One way the user goes on after a correction; the injected input arrives
+// part way through it
+struct Scenario {
+    const char* name;
+    AppPolicy::Injection injection;
+    void (*correct)(Hook& hook);
+    void (*after)(Hook& hook, bool deliver, bool signedInput);
+};
+
+void Pause(Hook& hook) {
+    hook.Type("ghbdtn");
+    hook.Tap(VK_PAUSE);
+}
+
+void ShiftPause(Hook& hook) {
+    hook.Type("ghbdtn vbh ");
+    hook.Key(VK_SHIFT, false);
+    hook.Tap(VK_PAUSE);
+    hook.Key(VK_SHIFT, true);
+}
+
+void CapitalPause(Hook& hook) {
+    hook.Type("Ghbdtn");
+    hook.Tap(VK_PAUSE);
+}
+
+// The next word, with the injected input landing after its first key
+void KeepTyping(Hook& hook, bool deliver, bool signedInput) {
+    hook.Type(" v");
+    if (deliver) hook.Deliver(hook.Pending(), signedInput);
+    hook.Type("bh");
+}
+
+// Alt is down, on its way to Alt+Tab, while the replayed Shift presses land
+void HoldAlt(Hook& hook, bool deliver, bool signedInput) {
+    hook.Key(VK_MENU, false);
+    if (deliver) hook.Deliver(hook.Pending(), signedInput);
+    hook.Key(VK_MENU, true);
+    hook.Type(" vbh");
+}
+
+// Half now, a key, the rest
+void Trickle(Hook& hook, bool deliver, bool signedInput) {
+    if (deliver) hook.Deliver(hook.Pending() / 2, signedInput);
+    hook.Type("e");
+    if (deliver) hook.Deliver(hook.Pending(), signedInput);
+    hook.Tap(VK_BACK);
+}
+
+const Scenario SCENARIOS[] = {
+    { "Pause, injected text arrives mid-word", AppPolicy::INJECTION_AUTO, Pause, KeepTyping },
+    { "Pause, replayed keys arrive mid-word", AppPolicy::INJECTION_KEYS, Pause, KeepTyping },
+    { "Shift+Pause, injected text arrives in pieces", AppPolicy::INJECTION_AUTO, ShiftPause, Trickle },
+    { "replayed Shift under a held Alt", AppPolicy::INJECTION_KEYS, CapitalPause, HoldAlt },
+};
+
+std::vector<uintptr_t> Run(const Scenario& scenario, bool deliver, bool signedInput, Hook* keep = nullptr) {
+    Hook local;
+    Hook& hook = keep ? *keep : local;
+    hook.SetInjection(scenario.injection);
+    scenario.correct(hook);
+    scenario.after(hook, deliver, signedInput);
+    return hook.Fingerprint();
+}
+
+int Check() {
+    bool ok = true;
+
+    for (const Scenario& scenario : SCENARIOS) {
+        // The reference never sees its own input; the old app saw it unsigned
+        std::vector<uintptr_t> reference = Run(scenario, false, true);
+        Hook hook;
+        std::vector<uintptr_t> late = Run(scenario, true, true, &hook);
+        bool sent = !hook.Sent().empty() && hook.Pending() == 0;
+        bool stamped = true;
+        for (const INPUT& input : hook.Sent()) {
+            stamped = stamped && input.ki.dwExtraInfo == InjectedInput::SIGNATURE;
+        }
+        ok = Report(scenario.name, sent && stamped && late == reference) && ok;
+        ok = Report("  and would have been recorded unsigned", Run(scenario, true, false) != reference) && ok;
+    }
+
+    {
+        Hook hook;
+        hook.SetInjection(AppPolicy::INJECTION_KEYS);
+        CapitalPause(hook);
+        hook.Key(VK_MENU, false);
+        hook.Deliver(hook.Pending(), false);
+        ok = Report("unsigned replayed Shift under Alt switches layout", hook.LayoutSwitches() > 0) && ok;
+    }
+
+    // Only our own input is dropped
+    {
+        Hook typed;
+        Hook foreign;
+        typed.Type("ghbdtn");
+        for (const char* c = "GHBDTN"; *c; ++c) foreign.Foreign(static_cast<DWORD>(*c));
+        ok = Report("other programs' injected keys are recorded", typed.Fingerprint() == foreign.Fingerprint()) && ok;
+
+        KBDLLHOOKSTRUCT event = {};
+        event.vkCode = 'A';
+        event.dwExtraInfo = InjectedInput::SIGNATURE;
+        bool typing = !InjectedInput::IsOwn(event);
+        event.flags = LLKHF_INJECTED;
+        ok = Report("the signature without LLKHF_INJECTED is typing", typing && InjectedInput::IsOwn(event)) && ok;
+    }
+
+    // Pause pressed again while the first correction's input is still on
+    // its way: it takes the correction back, as it would once delivered
+    {
+        Hook early;
+        Pause(early);
+        early.Tap(VK_PAUSE);
+        early.Deliver(early.Pending());
+        Hook settled;
+        Pause(settled);
+        settled.Deliver(settled.Pending());
+        settled.Tap(VK_PAUSE);
+        settled.Deliver(settled.Pending());
+        ok = Report("a second Pause before delivery undoes the first", early.Fingerprint() == settled.Fingerprint()) && ok;
+    }
+
+    return ok ? 0 : 1;
+}
+
+int Bench() {
+    const size_t EVENTS = 10000000;
+
+    Hook hook;
+    KBDLLHOOKSTRUCT typed = {};
+    typed.vkCode = 'G';
+    KBDLLHOOKSTRUCT own = typed;
+    own.flags = LLKHF_INJECTED;
+    own.dwExtraInfo = InjectedInput::SIGNATURE;
+    KBDLLHOOKSTRUCT foreign = own;
+    foreign.dwExtraInfo = 0;
+
+    double results[3];
+    const KBDLLHOOKSTRUCT* events[3] = { &typed, &own, &foreign };
+    size_t suppressed = 0;
+    for (size_t kind = 0; kind < 3; ++kind) {
+        KBDLLHOOKSTRUCT down = *events[kind];
+        KBDLLHOOKSTRUCT up = down;
+        up.flags |= LLKHF_UP;
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < EVENTS; i += 2) {
+            suppressed += hook.Dispatch(down) ? 1 : 0;
+            suppressed += hook.Dispatch(up) ? 1 : 0;
+        }
+        results[kind] = Seconds(start) * 1e9 / EVENTS;
+    }
+
+    // A correction's whole round trip through the hook: the Pause, then
+    // everything it sent coming back
+    const size_t CORRECTIONS = 100000;
+    double trips[2];
+    for (int signedInput = 0; signedInput < 2; ++signedInput) {
+        Hook corrector;
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < CORRECTIONS; ++i) {
+            corrector.Type(" ghbdtn");
+            corrector.Tap(VK_PAUSE);
+            corrector.Deliver(corrector.Pending(), signedInput != 0);
+            corrector.Forget();
+        }
+        trips[signedInput] = Seconds(start) * 1e9 / CORRECTIONS;
+    }
+
+    printf("%zu events per kind\n", EVENTS);
+    printf("dispatch: %6.1f ns typed, %6.1f ns own injected, %6.1f ns other programs' injected\n",
+           results[0], results[1], results[2]);
+    printf("word typed, corrected and delivered back: %6.0f ns unsigned, %6.0f ns signed\n", trips[0], trips[1]);
+    return suppressed == 0 ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 2 && strcmp(argv[1], "--bench") == 0) {
+        return Bench();
+    }
+    if (argc == 1 || (argc == 2 && strcmp(argv[1], "--check") == 0)) {
+        return Check();
+    }
+    PrintUsage();
+    return 1;
+}
\ No newline at end of file
@@ -0,0 +1,254 @@
+// kswitcher-keystrokes: checks the packed keystroke ring and the per-window
+// double buffer against plain vectors, and measures both against the vector
+// path they replaced.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "KeystrokeRing.h"
+#include "ToolSupport.h"
+#include "WindowBufferCache.h"
+#include "Win32Compat.h"
+
+namespace {
+
+void PrintUsage() {
+    printf("Usage:\n"
+           "  kswitcher-keystrokes --check\n"
+           "  kswitcher-keystrokes --bench\n");
+}
+
+// The keystroke the interceptor used to record
+struct VectorKeystroke {
+    int virtualKey;
+    bool shift;
+    bool capsLock;
+};
+
+// The old buffers: the word grows without limit, a correction copies it out
+// and again into the last corrected word
+struct VectorBuffer {
+    std::vector<VectorKeystroke> typing;
+    std::vector<VectorKeystroke> lastCorrected;
+
+    void Push(int virtualKey, bool shift) { typing.push_back({ virtualKey, shift, false }); }
+
+    template <typename Replay>
+    void Correct(Replay replay) {
+        std::vector<VectorKeystroke> bufferToCorrect;
+        if (!typing.empty()) {
+            bufferToCorrect = typing;
+        } else if (!lastCorrected.empty()) {
+            bufferToCorrect = lastCorrected;
+        } else {
+            return;
+        }
+        for (const VectorKeystroke& keystroke : bufferToCorrect) {
+            replay(keystroke.virtualKey, keystroke.shift);
+        }
+        lastCorrected = bufferToCorrect;
+        typing.clear();
+    }
+
+    size_t HeldBytes() const {
+        return (typing.capacity() + lastCorrected.capacity()) * sizeof(VectorKeystroke);
+    }
+};
+
+// The same through WindowBuffer: replay reads the ring in place, and the
+// typed word becomes the last corrected one by swapping rings
+struct RingBuffer {
+    WindowBuffer window;
+
+    explicit RingBuffer(size_t capacity) { window.SetCapacity(capacity); }
+
+    void Push(int virtualKey, bool shift) { window.Typing().Push(KeystrokeInfo::Make(virtualKey, shift, false)); }
+
+    template <typename Replay>
+    void Correct(Replay replay) {
+        bool recorrect = window.Typing().IsEmpty();
+        const KeystrokeRing& ring = recorrect ? window.LastCorrected() : window.Typing();
+        const KeystrokeInfo* keys = ring.Data();
+        for (size_t i = 0; i < ring.Size(); ++i) {
+            replay(keys[i].VirtualKey(), keys[i].Shift());
+        }
+        if (!recorrect) window.SwapAfterCorrection();
+    }
+};
+
+bool SameKeys(const KeystrokeRing& ring, const std::vector<KeystrokeInfo>& keys) {
+    if (ring.Size() != keys.size()) return false;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (ring.Data()[i].bits != keys[i].bits) return false;
+    }
+    return keys.empty() || ring.Back().bits == keys.back().bits;
+}
+
+int Check() {
+    bool ok = true;
+
+    {
+        KeystrokeInfo keystroke = KeystrokeInfo::Make(VK_OEM_PERIOD, true, true, true);
+        bool packed = keystroke.VirtualKey() == VK_OEM_PERIOD && keystroke.Shift() && keystroke.CapsLock() &&
+                      keystroke.Extended() && !KeystrokeInfo::Make('A', false, false).Extended() &&
+                      KeystrokeInfo::Make(0x1FF, false, false).VirtualKey() == 0xFF;
+        ok = Report("keystrokes pack into 16 bits", packed && sizeof(KeystrokeInfo) == 2) && ok;
+    }
+
+    {
+        KeystrokeRing ring;
+        bool clamped = ring.Capacity() == KeystrokeRing::DEFAULT_CAPACITY;
+        ring.SetCapacity(0);
+        clamped = ring.Capacity() == 1 && clamped;
+        ring.SetCapacity(KeystrokeRing::MAX_CAPACITY + 1);
+        clamped = ring.Capacity() == KeystrokeRing::MAX_CAPACITY && clamped;
+        ring.Push(KeystrokeInfo::Make('A', false, false));
+        ring.SetCapacity(8);
+        clamped = ring.IsEmpty() && ring.Capacity() == 8 && clamped;
+        ok = Report("capacity is clamped and resets the ring", clamped) && ok;
+    }
+
+    // Against a vector that keeps only its newest capacity keys, at every
+    // capacity, through wraparound and backspaces
+    {
+        Random random(0x94D049BB133111EBull);
+        bool same = true;
+        for (size_t capacity = 1; capacity <= KeystrokeRing::MAX_CAPACITY && same; ++capacity) {
+            KeystrokeRing ring;
+            ring.SetCapacity(capacity);
+            std::vector<KeystrokeInfo> reference;
+            for (int step = 0; step < 2000; ++step) {
+                if (random.Below(5) == 0) {
+                    ring.PopBack();
+                    if (!reference.empty()) reference.pop_back();
+                } else {
+                    KeystrokeInfo keystroke = KeystrokeInfo::Make('A' + random.Below(26), random.Below(2) == 0,
+                                                                  random.Below(8) == 0);
+                    ring.Push(keystroke);
+                    reference.push_back(keystroke);
+                    if (reference.size() > capacity) reference.erase(reference.begin());
+                }
+                same = SameKeys(ring, reference) && same;
+            }
+        }
+        ok = Report("ring keeps the newest keys, contiguous", same) && ok;
+    }
+
+    // Correcting hands the typed ring over without copying it; correcting
+    // again reads the same keys
+    {
+        WindowBuffer window;
+        window.SetCapacity(16);
+        std::vector<KeystrokeInfo> word;
+        for (const char* c = "GHBDTN"; *c; ++c) {
+            word.push_back(KeystrokeInfo::Make(*c, word.empty(), false));
+            window.Typing().Push(word.back());
+        }
+        const KeystrokeInfo* typed = window.Typing().Data();
+        window.SwapAfterCorrection();
+        bool swapped = window.LastCorrected().Data() == typed && SameKeys(window.LastCorrected(), word) &&
+                       window.Typing().IsEmpty();
+        window.Typing().Push(KeystrokeInfo::Make('A', false, false));
+        swapped = SameKeys(window.LastCorrected(), word) && window.Typing().Data() != typed && swapped;
+        window.SwapAfterCorrection();
+        swapped = window.LastCorrected().Size() == 1 && window.Typing().IsEmpty() && swapped;
+        ok = Report("correction swaps rings instead of copying", swapped) && ok;
+    }
+
+    return ok ? 0 : 1;
+}
+
+// Words of 2 to 12 keys with a correction every few words
+template <typename Buffer>
+void Type(Buffer& buffer, Random& random, size_t words, size_t& replayed) {
+    for (size_t i = 0; i < words; ++i) {
+        size_t length = 2 + random.Below(11);
+        for (size_t j = 0; j < length; ++j) {
+            buffer.Push('A' + random.Below(26), random.Below(10) == 0);
+        }
+        if (i % 4 == 0) {
+            buffer.Correct([&replayed](int virtualKey, bool) { replayed += virtualKey; });
+            if (i % 8 == 0) buffer.Correct([&replayed](int virtualKey, bool) { replayed += virtualKey; });
+        }
+        buffer.Push(VK_SPACE, false);
+    }
+}
+
+int Bench() {
+    const size_t WORDS = 1 << 20;
+    const size_t RUN = 10000;
+    const size_t ROUNDS = 200;
+    size_t replayed = 0;
+
+    // The old buffer was cleared on the first key of the next word; do the
+    // same for both, so they hold one word at a time
+    struct VectorWords : VectorBuffer {
+        void Push(int virtualKey, bool shift) {
+            if (virtualKey == VK_SPACE) typing.clear();
+            else VectorBuffer::Push(virtualKey, shift);
+        }
+    };
+    struct RingWords : RingBuffer {
+        RingWords() : RingBuffer(KeystrokeRing::DEFAULT_CAPACITY) {}
+        void Push(int virtualKey, bool shift) {
+            if (virtualKey == VK_SPACE) window.Typing().Clear();
+            else RingBuffer::Push(virtualKey, shift);
+        }
+    };
+
+    Random random(0xD6E8FEB86659FD93ull);
+    VectorWords vectorWords;
+    Clock::time_point start = Clock::now();
+    Type(vectorWords, random, WORDS, replayed);
+    double vectorWordSeconds = Seconds(start);
+
+    random = Random(0xD6E8FEB86659FD93ull);
+    RingWords ringWords;
+    start = Clock::now();
+    Type(ringWords, random, WORDS, replayed);
+    double ringWordSeconds = Seconds(start);
+
+    // A pasted identifier or URL: no spaces, then a correction and a second one
+    double vectorRunSeconds = 0;
+    double ringRunSeconds = 0;
+    size_t vectorHeld = 0;
+    for (size_t round = 0; round < ROUNDS; ++round) {
+        VectorBuffer vectorRun;
+        start = Clock::now();
+        for (size_t i = 0; i < RUN; ++i) vectorRun.Push('A' + i % 26, false);
+        vectorRun.Correct([&replayed](int virtualKey, bool) { replayed += virtualKey; });
+        vectorRun.Correct([&replayed](int virtualKey, bool) { replayed += virtualKey; });
+        vectorRunSeconds += Seconds(start);
+        vectorHeld = vectorRun.HeldBytes();
+
+        RingBuffer ringRun(KeystrokeRing::DEFAULT_CAPACITY);
+        start = Clock::now();
+        for (size_t i = 0; i < RUN; ++i) ringRun.Push('A' + i % 26, false);
+        ringRun.Correct([&replayed](int virtualKey, bool) { replayed += virtualKey; });
+        ringRun.Correct([&replayed](int virtualKey, bool) { replayed += virtualKey; });
+        ringRunSeconds += Seconds(start);
+    }
+
+    printf("%zu words with a correction every 4th, re-corrected every 8th\n", WORDS);
+    printf("  vector: %8.2f ms\n", vectorWordSeconds * 1000.0);
+    printf("  ring:   %8.2f ms\n", ringWordSeconds * 1000.0);
+    printf("%zu-key run without spaces, corrected twice\n", RUN);
+    printf("  vector: %8.2f us, holds %zu bytes\n", vectorRunSeconds * 1e6 / ROUNDS, vectorHeld);
+    printf("  ring:   %8.2f us, holds %zu bytes, keeps the last %zu keys\n", ringRunSeconds * 1e6 / ROUNDS,
+           sizeof(WindowBuffer), KeystrokeRing::DEFAULT_CAPACITY);
+    printf("keystroke: %zu bytes packed, %zu before\n", sizeof(KeystrokeInfo), sizeof(VectorKeystroke));
+    return replayed > 0 ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 2 && strcmp(argv[1], "--check") == 0) {
+        return Check();
+    }
+    if (argc == 2 && strcmp(argv[1], "--bench") == 0) {
+        return Bench();
+    }
+    PrintUsage();
+    return 1;
+}
\ No newline at end of file
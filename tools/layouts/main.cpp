@@ -0,0 +1,185 @@
+// kswitcher-layouts: checks the built-in en-US and ru-RU translation tables,
+// their serialized form and text round trips between them, and measures
+// lookups and (de)serialization.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "LayoutTable.h"
+#include "ToolSupport.h"
+#include "Win32Compat.h"
+
+namespace {
+
+void PrintUsage() {
+    printf("Usage:\n"
+           "  kswitcher-layouts --check\n"
+           "  kswitcher-layouts --bench\n");
+}
+
+bool SameTable(const LayoutTable& a, const LayoutTable& b) {
+    if (a.GetLayoutId() != b.GetLayoutId()) return false;
+    for (int key = 0; key < LayoutTable::KEY_COUNT; ++key) {
+        if (a.Translate(key, false) != b.Translate(key, false) || a.Translate(key, true) != b.Translate(key, true) ||
+            a.IsCapsAffected(key) != b.IsCapsAffected(key)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Text typed as meant in from, read back under to; empty when some
+// character has no key
+std::u16string Retype(const std::u16string& text, const LayoutTable& from, const LayoutTable& to) {
+    std::u16string result;
+    for (char16_t ch : text) {
+        int virtualKey;
+        bool shift;
+        if (!from.FindKey(ch, virtualKey, shift)) return std::u16string();
+        char16_t translated = to.Translate(virtualKey, shift);
+        if (translated == 0) return std::u16string();
+        result += translated;
+    }
+    return result;
+}
+
+// Every character the table produces
+std::u16string Alphabet(const LayoutTable& table) {
+    std::u16string text;
+    for (int key = 0; key < LayoutTable::KEY_COUNT; ++key) {
+        for (int shift = 0; shift < 2; ++shift) {
+            char16_t ch = table.Translate(key, shift != 0);
+            if (ch && text.find(ch) == std::u16string::npos) text += ch;
+        }
+    }
+    return text;
+}
+
+int Check() {
+    bool ok = true;
+    LayoutTable english = LayoutTable::EnglishUS();
+    LayoutTable russian = LayoutTable::RussianRU();
+
+    ok = Report("known words read across", Retype(u"ghbdtn", english, russian) == u"привет" &&
+                                               Retype(u"Ghbdtn? vbh!", english, russian) == u"Привет, мир!" &&
+                                               Retype(u"руддщ", russian, english) == u"hello" &&
+                                               Retype(u"Ёж", russian, english) == u"~;") && ok;
+
+    ok = Report("Caps Lock inverts Shift on letters only",
+                russian.Translate('G', false, true) == u'П' && russian.Translate('G', true, true) == u'п' &&
+                russian.Translate(VK_OEM_3, false, true) == u'Ё' && english.Translate(VK_OEM_3, false, true) == u'`' &&
+                english.Translate('1', false, true) == u'1' && english.Translate('Q', false, true) == u'Q') && ok;
+
+    ok = Report("keys without characters read as 0",
+                english.Translate(VK_LEFT, false) == 0 && russian.Translate(VK_RETURN, true) == 0 &&
+                english.Translate(-1, false) == 0 && english.Translate(LayoutTable::KEY_COUNT, false) == 0) && ok;
+
+    // Each character maps to a key that types it again
+    int virtualKey;
+    bool shift;
+    bool keys = !english.FindKey(u'ж', virtualKey, shift);
+    for (const LayoutTable* table : { &english, &russian }) {
+        for (char16_t ch : Alphabet(*table)) {
+            keys = table->FindKey(ch, virtualKey, shift) && table->Translate(virtualKey, shift) == ch && keys;
+        }
+    }
+    ok = Report("every character finds a key that types it", keys) && ok;
+
+    // Whole alphabets there and back
+    std::u16string englishText = Alphabet(english);
+    std::u16string russianText = Alphabet(russian);
+    ok = Report("en-US text round-trips through ru-RU",
+                Retype(Retype(englishText, english, russian), russian, english) == englishText) && ok;
+    ok = Report("ru-RU text round-trips through en-US",
+                Retype(Retype(russianText, russian, english), english, russian) == russianText) && ok;
+
+    // The serialized form carries the whole table
+    bool serialized = true;
+    for (const LayoutTable* table : { &english, &russian }) {
+        std::vector<uint8_t> data = table->Serialize();
+        LayoutTable loaded;
+        serialized = LayoutTable::Deserialize(data.data(), data.size(), loaded) && SameTable(*table, loaded) &&
+                     loaded.Serialize() == data && serialized;
+    }
+    ok = Report("tables survive serializing", serialized) && ok;
+
+    std::vector<uint8_t> data = russian.Serialize();
+    LayoutTable untouched = english;
+    bool rejected = !LayoutTable::Deserialize(data.data(), data.size() - 1, untouched) &&
+                    !LayoutTable::Deserialize(nullptr, data.size(), untouched);
+    std::vector<uint8_t> wrongMagic = data;
+    wrongMagic[0] ^= 0xFF;
+    std::vector<uint8_t> wrongVersion = data;
+    wrongVersion[4] += 1;
+    rejected = !LayoutTable::Deserialize(wrongMagic.data(), wrongMagic.size(), untouched) &&
+               !LayoutTable::Deserialize(wrongVersion.data(), wrongVersion.size(), untouched) &&
+               SameTable(untouched, english) && rejected;
+    ok = Report("truncated or foreign data is rejected", rejected) && ok;
+
+    return ok ? 0 : 1;
+}
+
+int Bench() {
+    const size_t LOOKUPS = size_t(1) << 26;
+    const size_t TEXT_ROUNDS = 20000;
+    LayoutTable english = LayoutTable::EnglishUS();
+    LayoutTable russian = LayoutTable::RussianRU();
+
+    std::vector<uint16_t> keys(4096);
+    Random random(0x6A09E667F3BCC909ull);
+    for (uint16_t& key : keys) {
+        key = static_cast<uint16_t>(random.Below(LayoutTable::KEY_COUNT * 4));
+    }
+
+    size_t found = 0;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < LOOKUPS; ++i) {
+        uint16_t key = keys[i & (keys.size() - 1)];
+        found += russian.Translate(key >> 2, (key & 1) != 0, (key & 2) != 0) ? 1 : 0;
+    }
+    double translateNs = Seconds(start) * 1e9 / LOOKUPS;
+
+    // Reverse lookups and whole-text conversion
+    std::u16string text = Alphabet(english);
+    start = Clock::now();
+    size_t converted = 0;
+    for (size_t i = 0; i < TEXT_ROUNDS; ++i) {
+        converted += Retype(text, english, russian).size();
+    }
+    double retypeNs = Seconds(start) * 1e9 / (TEXT_ROUNDS * text.size());
+
+    const size_t SERIAL_ROUNDS = 100000;
+    std::vector<uint8_t> data;
+    start = Clock::now();
+    for (size_t i = 0; i < SERIAL_ROUNDS; ++i) {
+        data = russian.Serialize();
+    }
+    double serializeUs = Seconds(start) * 1e6 / SERIAL_ROUNDS;
+    LayoutTable loaded;
+    start = Clock::now();
+    for (size_t i = 0; i < SERIAL_ROUNDS; ++i) {
+        found += LayoutTable::Deserialize(data.data(), data.size(), loaded) ? 1 : 0;
+    }
+    double deserializeUs = Seconds(start) * 1e6 / SERIAL_ROUNDS;
+
+    printf("table:       %zu bytes in memory, %zu serialized\n", sizeof(LayoutTable), data.size());
+    printf("translate:   %6.2f ns per key\n", translateNs);
+    printf("retype:      %6.1f ns per character (reverse lookup and translate)\n", retypeNs);
+    printf("serialize:   %6.2f us\n", serializeUs);
+    printf("deserialize: %6.2f us\n", deserializeUs);
+    return found > 0 && converted == TEXT_ROUNDS * text.size() ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 2 && strcmp(argv[1], "--check") == 0) {
+        return Check();
+    }
+    if (argc == 2 && strcmp(argv[1], "--bench") == 0) {
+        return Bench();
+    }
+    PrintUsage();
+    return 1;
+}
\ No newline at end of file
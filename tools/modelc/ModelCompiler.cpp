@@ -0,0 +1,131 @@
+#include "ModelCompiler.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include "DawgBuilder.h"
+#include "LanguageModel.h"
+#include "TextUtils.h"
+
+bool ModelCompiler::ReadFile(const std::string& path, std::string& content, std::string& error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    _stats.inputBytes += content.size();
+    return true;
+}
+
+bool ModelCompiler::AddWordList(const std::string& path, std::string& error) {
+    std::string content;
+    if (!ReadFile(path, content, error)) return false;
+
+    size_t lineStart = 0;
+    while (lineStart < content.size()) {
+        size_t lineEnd = content.find('\n', lineStart);
+        if (lineEnd == std::string::npos) lineEnd = content.size();
+
+        // Word, then an optional frequency after a tab or space
+        size_t wordEnd = lineStart;
+        while (wordEnd < lineEnd && content[wordEnd] != '\t' && content[wordEnd] != ' ' && content[wordEnd] != '\r') {
+            ++wordEnd;
+        }
+
+        uint64_t weight = 1;
+        if (wordEnd < lineEnd) {
+            unsigned long long parsed = strtoull(content.c_str() + wordEnd, nullptr, 10);
+            if (parsed > 0) weight = parsed;
+        }
+
+        std::u16string word = Utf8ToUtf16(content.data() + lineStart, wordEnd - lineStart);
+        if (!word.empty() && word[0] != u'#') {
+            for (auto& ch : word) ch = ToLowerChar(ch);
+            _ngrams.AddText(word.data(), word.size(), weight);
+            _words.push_back(std::move(word));
+        }
+
+        lineStart = lineEnd + 1;
+    }
+
+    return true;
+}
+
+bool ModelCompiler::AddCorpus(const std::string& path, std::string& error) {
+    std::string content;
+    if (!ReadFile(path, content, error)) return false;
+
+    std::u16string text = Utf8ToUtf16(content.data(), content.size());
+    _ngrams.AddText(text.data(), text.size());
+    return true;
+}
+
+std::vector<uint8_t> ModelCompiler::Compile(const std::string& locale) {
+    std::sort(_words.begin(), _words.end());
+    _words.erase(std::unique(_words.begin(), _words.end()), _words.end());
+
+    DawgBuilder dictionary;
+    for (const auto& word : _words) {
+        dictionary.Add(word);
+    }
+
+    std::vector<uint8_t> dictionaryData = dictionary.Serialize();
+    std::vector<uint8_t> trigramData = _ngrams.Serialize();
+
+    LanguageModelWriter writer;
+    writer.AddSection(LanguageModel::SECTION_DICTIONARY, dictionaryData);
+    writer.AddSection(LanguageModel::SECTION_TRIGRAMS, trigramData);
+    std::vector<uint8_t> model = writer.Finish(locale.c_str());
+
+    _stats.words = dictionary.WordCount();
+    _stats.ngrams = _ngrams.NgramCount();
+    _stats.dictionaryBytes = dictionaryData.size();
+    _stats.trigramBytes = trigramData.size();
+    _stats.modelBytes = model.size();
+    return model;
+}
+
+std::u16string ModelCompiler::Utf8ToUtf16(const char* text, size_t length) {
+    std::u16string result;
+    result.reserve(length);
+
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(text);
+    size_t i = 0;
+    while (i < length) {
+        unsigned char lead = bytes[i];
+        uint32_t codePoint;
+        size_t extra;
+
+        if (lead < 0x80) { codePoint = lead; extra = 0; }
+        else if ((lead & 0xE0) == 0xC0) { codePoint = lead & 0x1F; extra = 1; }
+        else if ((lead & 0xF0) == 0xE0) { codePoint = lead & 0x0F; extra = 2; }
+        else if ((lead & 0xF8) == 0xF0) { codePoint = lead & 0x07; extra = 3; }
+        else { ++i; continue; }
+
+        bool valid = true;
+        for (size_t k = 1; k <= extra; ++k) {
+            if (i + k >= length || (bytes[i + k] & 0xC0) != 0x80) {
+                valid = false;
+                break;
+            }
+            codePoint = (codePoint << 6) | (bytes[i + k] & 0x3F);
+        }
+
+        if (!valid) {
+            ++i;
+            continue;
+        }
+
+        // Layouts only produce BMP characters; anything above is a separator
+        result.push_back(codePoint <= 0xFFFF ? static_cast<char16_t>(codePoint) : u' ');
+        i += extra + 1;
+    }
+
+    // Byte order mark
+    if (!result.empty() && result[0] == 0xFEFF) {
+        result.erase(0, 1);
+    }
+    return result;
+}
\ No newline at end of file
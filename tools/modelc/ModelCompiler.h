@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "NgramTable.h"
+
+// Turns word lists and text corpora into a LanguageModel file image
+class ModelCompiler {
+public:
+    struct Stats {
+        size_t inputBytes = 0;
+        size_t words = 0;
+        size_t ngrams = 0;
+        size_t dictionaryBytes = 0;
+        size_t trigramBytes = 0;
+        size_t modelBytes = 0;
+    };
+
+    // One word per line, optionally followed by whitespace and a frequency
+    // that weights the word's n-grams. UTF-8.
+    bool AddWordList(const std::string& path, std::string& error);
+
+    // Free UTF-8 text, only used for n-gram statistics
+    bool AddCorpus(const std::string& path, std::string& error);
+
+    std::vector<uint8_t> Compile(const std::string& locale);
+
+    const Stats& GetStats() const { return _stats; }
+
+    static std::u16string Utf8ToUtf16(const char* text, size_t length);
+
+private:
+    bool ReadFile(const std::string& path, std::string& content, std::string& error);
+
+    std::vector<std::u16string> _words;
+    NgramTableBuilder _ngrams;
+    Stats _stats;
+};
\ No newline at end of file
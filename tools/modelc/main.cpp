@@ -0,0 +1,233 @@
+// kswitcher-modelc: compiles word lists and corpora into the binary language
+// models kSwitcher memory-maps at runtime, and checks the compiler against the
+// loader.
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "AppendFile.h"
+#include "LanguageModel.h"
+#include "ModelCompiler.h"
+#include "ToolSupport.h"
+
+namespace {
+
+void PrintUsage() {
+    printf("Usage:\n"
+           "  kswitcher-modelc --locale <name> --words <file> [--words <file>...]\n"
+           "                   [--corpus <file>...] --output <model.kslm>\n"
+           "  kswitcher-modelc --info <model.kslm>\n"
+           "  kswitcher-modelc --check <scratch directory>\n"
+           "\n"
+           "Word lists hold one word per line with an optional frequency.\n"
+           "Corpora are plain UTF-8 text used for n-gram statistics.\n"
+           "The locale must match the Windows locale name, e.g. en-US or ru-RU.\n");
+}
+
+// Loads the model the way the app does and reports what it contains
+int PrintInfo(const std::string& path) {
+    NativePath nativePath = MappedFile::PathFromUtf8(path);
+    LanguageModel model;
+    Clock::time_point start = Clock::now();
+    if (!model.Open(nativePath, false)) {
+        fprintf(stderr, "error: %s is not a valid model\n", path.c_str());
+        return 1;
+    }
+    double mapSeconds = Seconds(start);
+
+    start = Clock::now();
+    bool checksumValid = model.Open(nativePath, true);
+    double verifySeconds = Seconds(start);
+
+    printf("model:       %s\n", path.c_str());
+    printf("locale:      %s\n", model.Locale());
+    printf("size:        %zu bytes\n", model.SizeInBytes());
+    printf("checksum:    %s\n", checksumValid ? "ok" : "MISMATCH");
+    if (const Dawg* dictionary = model.Dictionary()) {
+        printf("dictionary:  %u words, %zu bytes\n", dictionary->WordCount(), dictionary->SizeInBytes());
+    }
+    if (const NgramTable* trigrams = model.Trigrams()) {
+        printf("trigrams:    %u\n", trigrams->NgramCount());
+    }
+    printf("load time:   %.3f ms mapped, %.3f ms with checksum\n", mapSeconds * 1000.0, verifySeconds * 1000.0);
+    return checksumValid ? 0 : 1;
+}
+
+bool WriteFile(const std::string& path, const std::string& content) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    return file.write(content.data(), content.size()).good();
+}
+
+bool WriteFile(const std::string& path, const std::vector<uint8_t>& data, size_t size) {
+    return WriteFile(path, std::string(reinterpret_cast<const char*>(data.data()), size));
+}
+
+bool Contains(const Dawg* dictionary, const char16_t* word) {
+    return dictionary && dictionary->Contains(word, std::char_traits<char16_t>::length(word));
+}
+
+// Compiles a small model in directory, then loads it and damaged copies of
+// it the way the app does
+int Check(const std::string& directory) {
+    bool ok = true;
+    std::string wordsPath = directory + "/check-words.txt";
+    std::string corpusPath = directory + "/check-corpus.txt";
+    std::string modelPath = directory + "/check.kslm";
+    std::string damagedPath = directory + "/check-damaged.kslm";
+
+    // A byte order mark, a comment, frequencies, CRLF, capitals and a repeat
+    bool written = WriteFile(wordsPath, "\xEF\xBB\xBF# common words\n"
+                                        "\xD0\xBF\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82\t500\r\n"
+                                        "\xD0\x9C\xD0\xB8\xD1\x80 20\n"
+                                        "\xD0\xBC\xD0\xB8\xD1\x80\n"
+                                        "\xD0\xB4\xD0\xBE\xD0\xBC") &&
+                   WriteFile(corpusPath, "\xD0\xB4\xD0\xBE\xD0\xBC \xD0\xB8 \xD0\xBC\xD0\xB8\xD1\x80\n");
+    if (!written) {
+        fprintf(stderr, "error: cannot write to %s\n", directory.c_str());
+        return 1;
+    }
+
+    ModelCompiler compiler;
+    std::string error;
+    bool missing = !compiler.AddWordList(directory + "/no-such-list.txt", error) && !error.empty();
+    ok = Report("missing input is reported", missing) && ok;
+
+    bool added = compiler.AddWordList(wordsPath, error) && compiler.AddCorpus(corpusPath, error);
+    std::vector<uint8_t> model = compiler.Compile("ru-RU");
+    const ModelCompiler::Stats& stats = compiler.GetStats();
+    ok = Report("word list parsed and words merged",
+                added && stats.words == 3 && stats.ngrams > 0 && stats.modelBytes == model.size()) && ok;
+
+    LanguageModel loaded;
+    bool opened = WriteFile(modelPath, model, model.size()) && loaded.Open(MappedFile::PathFromUtf8(modelPath));
+    const Dawg* dictionary = loaded.Dictionary();
+    opened = opened && strcmp(loaded.Locale(), "ru-RU") == 0 && loaded.SizeInBytes() == model.size() &&
+             dictionary && dictionary->WordCount() == 3 && loaded.Trigrams() &&
+             loaded.Trigrams()->NgramCount() == stats.ngrams;
+    ok = Report("compiled model loads with its checksum", opened) && ok;
+
+    bool words = Contains(dictionary, u"привет") && Contains(dictionary, u"мир") && Contains(dictionary, u"дом") &&
+                 !Contains(dictionary, u"Мир") && !Contains(dictionary, u"при") && !Contains(dictionary, u"и");
+    ok = Report("dictionary holds the listed words only", words) && ok;
+    loaded.Close();
+
+    // Changed data past the header fails the checksum
+    std::vector<uint8_t> damaged = model;
+    damaged[damaged.size() - 1] ^= 0x40;
+    bool crc = WriteFile(damagedPath, damaged, damaged.size()) &&
+               !loaded.Open(MappedFile::PathFromUtf8(damagedPath)) && !loaded.IsValid() &&
+               loaded.Open(MappedFile::PathFromUtf8(damagedPath), false);
+    loaded.Close();
+    ok = Report("checksum mismatch is rejected", crc) && ok;
+
+    // Cut short anywhere: inside the sections, the section table or the header
+    bool truncated = true;
+    const size_t cuts[] = { model.size() - 1, sizeof(ModelHeader) + sizeof(ModelSection) / 2,
+                            sizeof(ModelHeader) - 1, 0 };
+    for (size_t size : cuts) {
+        truncated = WriteFile(damagedPath, model, size) && !loaded.Open(MappedFile::PathFromUtf8(damagedPath), false) &&
+                    truncated;
+    }
+    ok = Report("truncated files are rejected", truncated) && ok;
+
+    // The header is outside the checksum, so each field is checked itself
+    ModelHeader header;
+    memcpy(&header, model.data(), sizeof(header));
+    ModelHeader newer = header;
+    newer.version = LanguageModel::VERSION + 1;
+    ModelHeader foreign = header;
+    foreign.magic ^= 0xFF;
+    bool rejected = true;
+    for (const ModelHeader& changed : { newer, foreign }) {
+        damaged = model;
+        memcpy(damaged.data(), &changed, sizeof(changed));
+        rejected = WriteFile(damagedPath, damaged, damaged.size()) &&
+                   !loaded.Open(MappedFile::PathFromUtf8(damagedPath), false) && rejected;
+    }
+    ok = Report("other versions and foreign files are rejected", rejected) && ok;
+
+    AppendFile::Remove(MappedFile::PathFromUtf8(wordsPath));
+    AppendFile::Remove(MappedFile::PathFromUtf8(corpusPath));
+    AppendFile::Remove(MappedFile::PathFromUtf8(modelPath));
+    AppendFile::Remove(MappedFile::PathFromUtf8(damagedPath));
+    return ok ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string locale;
+    std::string output;
+    std::vector<std::string> wordLists;
+    std::vector<std::string> corpora;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (strcmp(arg, "--info") == 0 && value) {
+            return PrintInfo(value);
+        } else if (strcmp(arg, "--check") == 0 && value) {
+            return Check(value);
+        } else if (strcmp(arg, "--locale") == 0 && value) {
+            locale = value;
+            ++i;
+        } else if (strcmp(arg, "--words") == 0 && value) {
+            wordLists.push_back(value);
+            ++i;
+        } else if (strcmp(arg, "--corpus") == 0 && value) {
+            corpora.push_back(value);
+            ++i;
+        } else if ((strcmp(arg, "--output") == 0 || strcmp(arg, "-o") == 0) && value) {
+            output = value;
+            ++i;
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (locale.empty() || output.empty() || wordLists.empty()) {
+        PrintUsage();
+        return 1;
+    }
+
+    Clock::time_point start = Clock::now();
+    ModelCompiler compiler;
+    std::string error;
+
+    for (const auto& path : wordLists) {
+        if (!compiler.AddWordList(path, error)) {
+            fprintf(stderr, "error: %s\n", error.c_str());
+            return 1;
+        }
+    }
+    for (const auto& path : corpora) {
+        if (!compiler.AddCorpus(path, error)) {
+            fprintf(stderr, "error: %s\n", error.c_str());
+            return 1;
+        }
+    }
+
+    std::vector<uint8_t> model = compiler.Compile(locale);
+    double buildSeconds = Seconds(start);
+
+    std::ofstream file(output, std::ios::binary | std::ios::trunc);
+    if (!file.is_open() || !file.write(reinterpret_cast<const char*>(model.data()), model.size())) {
+        fprintf(stderr, "error: cannot write %s\n", output.c_str());
+        return 1;
+    }
+    file.close();
+
+    const ModelCompiler::Stats& stats = compiler.GetStats();
+    double megabytes = stats.inputBytes / (1024.0 * 1024.0);
+    printf("input:       %.2f MB\n", megabytes);
+    printf("words:       %zu (%zu bytes)\n", stats.words, stats.dictionaryBytes);
+    printf("trigrams:    %zu (%zu bytes)\n", stats.ngrams, stats.trigramBytes);
+    printf("build time:  %.3f s, %.2f MB/s\n", buildSeconds, buildSeconds > 0 ? megabytes / buildSeconds : 0.0);
+    printf("\n");
+
+    return PrintInfo(output);
+}
\ No newline at end of file
@@ -0,0 +1,412 @@
+// kswitcher-modifiers: checks the hook-side modifier tracker over every
+// combination of held keys and lock states and against a simulated system
+// key state, and measures it against the GetKeyState calls it replaced.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "ModifierState.h"
+#include "ToolSupport.h"
+#include "Win32Compat.h"
+
+namespace {
+
+void PrintUsage() {
+    printf("Usage:\n"
+           "  kswitcher-modifiers --check\n"
+           "  kswitcher-modifiers --bench\n");
+}
+
+const DWORD LEFT_SHIFT_SCAN_CODE = 0x2A;
+const DWORD RIGHT_SHIFT_SCAN_CODE = 0x36;
+const DWORD ALT_GR_CTRL_SCAN_CODE = 0x21D;
+
+KBDLLHOOKSTRUCT Event(DWORD virtualKey, DWORD scanCode = 0, bool extended = false) {
+    KBDLLHOOKSTRUCT event = {};
+    event.vkCode = virtualKey;
+    event.scanCode = scanCode;
+    event.flags = extended ? LLKHF_EXTENDED : 0;
+    return event;
+}
+
+// The system's key state as GetKeyState reports it: 0x80 while down, 0x01
+// toggled on each press of a lock key, generic codes following either side
+class Keyboard {
+public:
+    Keyboard() { memset(_state, 0, sizeof(_state)); }
+
+    void Apply(UINT message, const KBDLLHOOKSTRUCT& event) {
+        bool down = message == WM_KEYDOWN || message == WM_SYSKEYDOWN;
+        DWORD key = event.vkCode;
+        if (down && !(_state[key] & 0x80) && (key == VK_CAPITAL || key == VK_NUMLOCK)) _state[key] ^= 0x01;
+        _state[key] = static_cast<uint8_t>(down ? _state[key] | 0x80 : _state[key] & ~0x80);
+        SyncGeneric(VK_SHIFT, VK_LSHIFT, VK_RSHIFT);
+        SyncGeneric(VK_CONTROL, VK_LCONTROL, VK_RCONTROL);
+        SyncGeneric(VK_MENU, VK_LMENU, VK_RMENU);
+    }
+
+    short GetKeyState(int virtualKey) const {
+        uint8_t state = _state[virtualKey & 0xFF];
+        return static_cast<short>(((state & 0x80) ? 0x8000 : 0) | (state & 0x01));
+    }
+
+    const uint8_t* State() const { return _state; }
+
+private:
+    void SyncGeneric(int generic, int left, int right) {
+        bool down = ((_state[left] | _state[right]) & 0x80) != 0;
+        _state[generic] = static_cast<uint8_t>(down ? 0x80 : 0);
+    }
+
+    uint8_t _state[256];
+};
+
+// What the recorder asks of the modifiers, read either way
+struct Reading {
+    bool shift;
+    bool ctrl;
+    bool alt;
+    bool win;
+    bool capsLock;
+    bool numLock;
+
+    bool operator==(const Reading& other) const {
+        return shift == other.shift && ctrl == other.ctrl && alt == other.alt && win == other.win &&
+               capsLock == other.capsLock && numLock == other.numLock;
+    }
+};
+
+Reading Read(ModifierState::Snapshot modifiers) {
+    // AltGr is what the system reports as Ctrl held with Right Alt
+    return { modifiers.Any(ModifierState::SHIFT), modifiers.Any(ModifierState::CTRL | ModifierState::ALT_GR),
+             modifiers.Any(ModifierState::ALT), modifiers.Any(ModifierState::WIN),
+             modifiers.Any(ModifierState::CAPS_LOCK), modifiers.Any(ModifierState::NUM_LOCK) };
+}
+
+Reading Read(const Keyboard& keyboard) {
+    return { (keyboard.GetKeyState(VK_SHIFT) & 0x8000) != 0, (keyboard.GetKeyState(VK_CONTROL) & 0x8000) != 0,
+             (keyboard.GetKeyState(VK_MENU) & 0x8000) != 0,
+             ((keyboard.GetKeyState(VK_LWIN) | keyboard.GetKeyState(VK_RWIN)) & 0x8000) != 0,
+             (keyboard.GetKeyState(VK_CAPITAL) & 0x0001) != 0, (keyboard.GetKeyState(VK_NUMLOCK) & 0x0001) != 0 };
+}
+
+// A physical key and the hook events it produces. On layouts with AltGr the
+// right Alt key sends a fake Left Ctrl first; the system keeps one state for
+// both Left Ctrls, so the physical one is left out there.
+struct PhysicalKey {
+    KBDLLHOOKSTRUCT events[2];
+    size_t count;
+};
+
+std::vector<PhysicalKey> Keys(bool altGr) {
+    std::vector<PhysicalKey> keys = {
+        { { Event(VK_LSHIFT, LEFT_SHIFT_SCAN_CODE) }, 1 }, { { Event(VK_RSHIFT, RIGHT_SHIFT_SCAN_CODE) }, 1 },
+        { { Event(VK_LCONTROL, 0x1D) }, 1 },               { { Event(VK_RCONTROL, 0x1D, true) }, 1 },
+        { { Event(VK_LMENU, 0x38) }, 1 },                  { { Event(VK_LWIN, 0x5B, true) }, 1 },
+        { { Event(VK_RWIN, 0x5C, true) }, 1 },             { { Event(VK_CAPITAL, 0x3A) }, 1 },
+        { { Event(VK_NUMLOCK, 0x45) }, 1 },                { { Event('A', 0x1E) }, 1 },
+    };
+    if (altGr) {
+        keys.erase(keys.begin() + 2);
+        keys.push_back({ { Event(VK_LCONTROL, ALT_GR_CTRL_SCAN_CODE), Event(VK_RMENU, 0x38, true) }, 2 });
+    } else {
+        keys.push_back({ { Event(VK_RMENU, 0x38, true) }, 1 });
+    }
+    return keys;
+}
+
+// Presses send the events in order, releases in reverse
+void Send(const PhysicalKey& key, bool down, ModifierState& modifiers, Keyboard& keyboard) {
+    for (size_t i = 0; i < key.count; ++i) {
+        const KBDLLHOOKSTRUCT& event = key.events[down ? i : key.count - 1 - i];
+        UINT message = down ? WM_KEYDOWN : WM_KEYUP;
+        modifiers.Update(message, event);
+        keyboard.Apply(message, event);
+    }
+}
+
+int Check() {
+    bool ok = true;
+
+    // Side resolution for every key, generic or not, however flagged
+    {
+        bool resolved = true;
+        const DWORD scanCodes[] = { 0, LEFT_SHIFT_SCAN_CODE, RIGHT_SHIFT_SCAN_CODE, 0x1D, ALT_GR_CTRL_SCAN_CODE };
+        for (DWORD key = 0; key < 256; ++key) {
+            for (DWORD scanCode : scanCodes) {
+                for (int extended = 0; extended < 2; ++extended) {
+                    uint16_t bit = ModifierState::KeyBit(Event(key, scanCode, extended != 0));
+                    uint16_t expected = 0;
+                    switch (key) {
+                        case VK_LSHIFT:   expected = ModifierState::LEFT_SHIFT; break;
+                        case VK_RSHIFT:   expected = ModifierState::RIGHT_SHIFT; break;
+                        case VK_SHIFT:
+                            expected = scanCode == RIGHT_SHIFT_SCAN_CODE ? ModifierState::RIGHT_SHIFT
+                                                                         : ModifierState::LEFT_SHIFT;
+                            break;
+                        case VK_LCONTROL:
+                            expected = scanCode == ALT_GR_CTRL_SCAN_CODE ? ModifierState::ALT_GR
+                                                                         : ModifierState::LEFT_CTRL;
+                            break;
+                        case VK_RCONTROL: expected = ModifierState::RIGHT_CTRL; break;
+                        case VK_CONTROL:  expected = extended ? ModifierState::RIGHT_CTRL : ModifierState::LEFT_CTRL; break;
+                        case VK_LMENU:    expected = ModifierState::LEFT_ALT; break;
+                        case VK_RMENU:    expected = ModifierState::RIGHT_ALT; break;
+                        case VK_MENU:     expected = extended ? ModifierState::RIGHT_ALT : ModifierState::LEFT_ALT; break;
+                        case VK_LWIN:     expected = ModifierState::LEFT_WIN; break;
+                        case VK_RWIN:     expected = ModifierState::RIGHT_WIN; break;
+                        case VK_CAPITAL:  expected = ModifierState::CAPS_LOCK_KEY; break;
+                        case VK_NUMLOCK:  expected = ModifierState::NUM_LOCK_KEY; break;
+                    }
+                    resolved = bit == expected && resolved;
+                }
+            }
+        }
+        ok = Report("every key resolves to its side", resolved) && ok;
+    }
+
+    // Every combination of the eight side keys, pressed up and released down
+    {
+        const DWORD sideKeys[] = { VK_LSHIFT, VK_RSHIFT, VK_LCONTROL, VK_RCONTROL,
+                                   VK_LMENU,  VK_RMENU,  VK_LWIN,     VK_RWIN };
+        bool held = true;
+        for (uint32_t mask = 0; mask < 256; ++mask) {
+            ModifierState modifiers;
+            Keyboard keyboard;
+            uint16_t expected = 0;
+            for (int i = 0; i < 8; ++i) {
+                if (!(mask & (1u << i))) continue;
+                KBDLLHOOKSTRUCT event = Event(sideKeys[i]);
+                modifiers.Update(WM_KEYDOWN, event);
+                keyboard.Apply(WM_KEYDOWN, event);
+                expected |= static_cast<uint16_t>(1u << i);
+                ModifierState::Snapshot snapshot = modifiers.Load();
+                held = snapshot.bits == expected && snapshot.changed == (1u << i) &&
+                       Read(snapshot) == Read(keyboard) && held;
+            }
+            // Other keys leave the state and clear what changed
+            modifiers.Update(WM_KEYDOWN, Event('A'));
+            held = modifiers.Load().bits == mask && modifiers.Load().changed == 0 && held;
+            for (int i = 7; i >= 0; --i) {
+                if (!(mask & (1u << i))) continue;
+                KBDLLHOOKSTRUCT event = Event(sideKeys[i]);
+                modifiers.Update(WM_SYSKEYUP, event);
+                keyboard.Apply(WM_SYSKEYUP, event);
+                expected &= static_cast<uint16_t>(~(1u << i));
+                held = modifiers.Load().bits == expected && Read(modifiers.Load()) == Read(keyboard) && held;
+            }
+            held = modifiers.Load().bits == 0 && held;
+        }
+        ok = Report("all 256 held-key combinations are tracked", held) && ok;
+    }
+
+    // Lock keys toggle once per press, however long auto-repeat runs
+    {
+        ModifierState modifiers;
+        bool toggled = true;
+        for (int press = 1; press <= 4; ++press) {
+            for (int repeat = 0; repeat < press * 3; ++repeat) {
+                modifiers.Update(WM_KEYDOWN, Event(VK_CAPITAL));
+                modifiers.Update(WM_KEYDOWN, Event(VK_NUMLOCK));
+            }
+            bool on = press % 2 == 1;
+            toggled = modifiers.Load().Any(ModifierState::CAPS_LOCK) == on &&
+                      modifiers.Load().Any(ModifierState::NUM_LOCK) == on &&
+                      modifiers.Load().Any(ModifierState::CAPS_LOCK_KEY | ModifierState::NUM_LOCK_KEY) && toggled;
+            modifiers.Update(WM_KEYUP, Event(VK_CAPITAL));
+            modifiers.Update(WM_KEYUP, Event(VK_NUMLOCK));
+            toggled = modifiers.Load().bits == (on ? ModifierState::CAPS_LOCK | ModifierState::NUM_LOCK : 0) &&
+                      toggled;
+        }
+        ok = Report("lock keys toggle once per press", toggled) && ok;
+    }
+
+    // AltGr is not Ctrl+Alt, and ends with Right Alt even if the fake Ctrl
+    // release never arrives
+    {
+        ModifierState modifiers;
+        modifiers.Update(WM_KEYDOWN, Event(VK_LCONTROL, ALT_GR_CTRL_SCAN_CODE));
+        modifiers.Update(WM_SYSKEYDOWN, Event(VK_RMENU, 0x38, true));
+        bool altGr = modifiers.Load().bits == (ModifierState::ALT_GR | ModifierState::RIGHT_ALT);
+        modifiers.Update(WM_KEYUP, Event(VK_RMENU, 0x38, true));
+        altGr = modifiers.Load().bits == 0 && altGr;
+        ok = Report("AltGr is tracked apart from Ctrl", altGr) && ok;
+    }
+
+    // Every combination of the ten keys Resync reads and both toggles
+    {
+        const uint8_t resyncKeys[] = { VK_LSHIFT, VK_RSHIFT, VK_LCONTROL, VK_RCONTROL, VK_LMENU,
+                                       VK_RMENU,  VK_LWIN,   VK_RWIN,     VK_CAPITAL,  VK_NUMLOCK };
+        const uint16_t resyncBits[] = { ModifierState::LEFT_SHIFT,    ModifierState::RIGHT_SHIFT,
+                                        ModifierState::LEFT_CTRL,     ModifierState::RIGHT_CTRL,
+                                        ModifierState::LEFT_ALT,      ModifierState::RIGHT_ALT,
+                                        ModifierState::LEFT_WIN,      ModifierState::RIGHT_WIN,
+                                        ModifierState::CAPS_LOCK_KEY, ModifierState::NUM_LOCK_KEY };
+        bool resynced = true;
+        ModifierState modifiers;
+        uint16_t previous = 0;
+        for (uint32_t mask = 0; mask < (1u << 12); ++mask) {
+            uint8_t keyState[256] = {};
+            uint16_t expected = 0;
+            for (int i = 0; i < 10; ++i) {
+                if (mask & (1u << i)) {
+                    keyState[resyncKeys[i]] |= 0x80;
+                    expected |= resyncBits[i];
+                }
+            }
+            if (mask & (1u << 10)) {
+                keyState[VK_CAPITAL] |= 0x01;
+                expected |= ModifierState::CAPS_LOCK;
+            }
+            if (mask & (1u << 11)) {
+                keyState[VK_NUMLOCK] |= 0x01;
+                expected |= ModifierState::NUM_LOCK;
+            }
+            modifiers.Resync(keyState);
+            resynced = modifiers.Load().bits == expected && modifiers.Load().changed == (expected ^ previous) &&
+                       resynced;
+            previous = expected;
+        }
+
+        // Held AltGr looks like Left Ctrl + Right Alt to the system; a known
+        // AltGr survives the resync
+        modifiers.Update(WM_KEYDOWN, Event(VK_LCONTROL, ALT_GR_CTRL_SCAN_CODE));
+        modifiers.Update(WM_SYSKEYDOWN, Event(VK_RMENU, 0x38, true));
+        uint8_t keyState[256] = {};
+        keyState[VK_LCONTROL] = 0x80;
+        keyState[VK_RMENU] = 0x80;
+        modifiers.Resync(keyState);
+        resynced = modifiers.Load().bits == (ModifierState::ALT_GR | ModifierState::RIGHT_ALT) && resynced;
+        ok = Report("resync reads all 4096 key state combinations", resynced) && ok;
+    }
+
+    {
+        ModifierState modifiers;
+        bool requested = !modifiers.TakeResyncRequest();
+        modifiers.RequestResync();
+        requested = modifiers.TakeResyncRequest() && !modifiers.TakeResyncRequest() && requested;
+        ok = Report("a resync request is taken once", requested) && ok;
+    }
+
+    // Random typing against the simulated system state, with and without
+    // AltGr, resyncing now and then as a focus change would
+    {
+        bool same = true;
+        Random random(0x2127599BF4325C37ull);
+        for (int layout = 0; layout < 2; ++layout) {
+            std::vector<PhysicalKey> keys = Keys(layout == 1);
+            std::vector<bool> down(keys.size(), false);
+            ModifierState modifiers;
+            Keyboard keyboard;
+            for (int step = 0; step < 500000; ++step) {
+                size_t key = random.Below(static_cast<uint32_t>(keys.size()));
+                // Held keys repeat or come up, others go down
+                bool press = !down[key] || random.Below(3) == 0;
+                Send(keys[key], press, modifiers, keyboard);
+                down[key] = press;
+                if (random.Below(1000) == 0) modifiers.Resync(keyboard.State());
+                same = Read(modifiers.Load()) == Read(keyboard) && same;
+            }
+        }
+        ok = Report("random typing reads as GetKeyState would", same) && ok;
+    }
+
+    return ok ? 0 : 1;
+}
+
+#ifdef _WIN32
+short KeyState(int virtualKey) {
+    return GetKeyState(virtualKey);
+}
+#else
+// The host has no system key state; the stub reads a simulated one
+const Keyboard* stubKeyboard = nullptr;
+short KeyState(int virtualKey) {
+    return stubKeyboard->GetKeyState(virtualKey);
+}
+#endif
+
+// Kept out of line, as a call into user32 would be
+short (*volatile getKeyState)(int) = KeyState;
+
+int Bench() {
+    const size_t EVENTS = 1 << 24;
+    std::vector<PhysicalKey> keys = Keys(false);
+
+    // Mostly letters, Shift now and then, as typing looks to the hook
+    std::vector<std::pair<UINT, KBDLLHOOKSTRUCT>> events;
+    events.reserve(4096);
+    Random random(0x9FB21C651E98DF25ull);
+    bool shift = false;
+    while (events.size() < 4096) {
+        if (random.Below(8) == 0) {
+            shift = !shift;
+            events.push_back({ static_cast<UINT>(shift ? WM_KEYDOWN : WM_KEYUP), keys[0].events[0] });
+        } else {
+            events.push_back({ WM_KEYDOWN, Event('A' + random.Below(26)) });
+        }
+    }
+
+    Keyboard keyboard;
+#ifndef _WIN32
+    stubKeyboard = &keyboard;
+#endif
+    size_t seen = 0;
+
+    // Before: four GetKeyState calls for each character key
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < EVENTS; ++i) {
+        const std::pair<UINT, KBDLLHOOKSTRUCT>& event = events[i & (events.size() - 1)];
+        if (ModifierState::KeyBit(event.second) != 0) continue;
+        bool shifted = (getKeyState(VK_SHIFT) & 0x8000) != 0;
+        bool capsLock = (getKeyState(VK_CAPITAL) & 0x0001) != 0;
+        bool ctrl = (getKeyState(VK_CONTROL) & 0x8000) != 0;
+        bool alt = (getKeyState(VK_MENU) & 0x8000) != 0;
+        seen += shifted + capsLock + ctrl + alt + 1;
+    }
+    double getKeyStateNs = Seconds(start) * 1e9 / EVENTS;
+
+    // After: every event updates the tracker, character keys read it once
+    ModifierState modifiers;
+    start = Clock::now();
+    for (size_t i = 0; i < EVENTS; ++i) {
+        const std::pair<UINT, KBDLLHOOKSTRUCT>& event = events[i & (events.size() - 1)];
+        modifiers.Update(event.first, event.second);
+        ModifierState::Snapshot snapshot = modifiers.Load();
+        if (snapshot.changed) continue;
+        seen += snapshot.Any(ModifierState::SHIFT) + snapshot.Any(ModifierState::CAPS_LOCK) +
+                snapshot.Any(ModifierState::CTRL) + snapshot.Any(ModifierState::ALT) + 1;
+    }
+    double trackerNs = Seconds(start) * 1e9 / EVENTS;
+
+    uint8_t keyState[256] = {};
+    const size_t RESYNCS = 1 << 20;
+    start = Clock::now();
+    for (size_t i = 0; i < RESYNCS; ++i) {
+        keyState[VK_LSHIFT] = static_cast<uint8_t>(i & 0x80);
+        modifiers.Resync(keyState);
+    }
+    double resyncNs = Seconds(start) * 1e9 / RESYNCS;
+
+#ifdef _WIN32
+    printf("GetKeyState x4: %6.2f ns per event\n", getKeyStateNs);
+#else
+    printf("GetKeyState x4: %6.2f ns per event (host stub; the user32 call costs more)\n", getKeyStateNs);
+#endif
+    printf("ModifierState:  %6.2f ns per event (update and one load)\n", trackerNs);
+    printf("Resync:         %6.2f ns\n", resyncNs);
+    return seen > 0 ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 2 && strcmp(argv[1], "--check") == 0) {
+        return Check();
+    }
+    if (argc == 2 && strcmp(argv[1], "--bench") == 0) {
+        return Bench();
+    }
+    PrintUsage();
+    return 1;
+}
\ No newline at end of file
@@ -0,0 +1,510 @@
+// kswitcher-phrase: checks how the phrase history splits typing into words
+// against a plain reference, drives Shift+Pause through the correction
+// engine on the built-in layouts and reads back the text an application
+// would show, and measures segmenting and re-planning long phrases.
+
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+#include "CorrectionEngine.h"
+#include "FakeBackend.h"
+#include "LatencyMetrics.h"
+#include "NgramTable.h"
+#include "PhraseHistory.h"
+#include "ToolSupport.h"
+
+namespace {
+
+// Typed as phrases and read by the trigram models; the models only need to
+// tell the two languages apart
+const char16_t ENGLISH_TEXT[] =
+    u"the quick brown fox jumps over the lazy dog while the farmer watches from the window of his "
+    u"house and thinks about the weather for tomorrow morning when he has to drive into town to buy "
+    u"bread and milk for the whole family and then come back before the rain starts again";
+const char16_t RUSSIAN_TEXT[] =
+    u"съешь же еще этих мягких французских булок да выпей чаю потом мы пойдем гулять в парк где "
+    u"растут старые деревья и поют птицы а вечером будем читать книги и пить горячий чай с "
+    u"малиновым вареньем пока за окном идет долгий осенний дождь";
+
+const size_t ENGLISH = 0;
+const size_t RUSSIAN = 1;
+
+void PrintUsage() {
+    printf("Usage:\n"
+           "  kswitcher-phrase [--check]  segmenting and Shift+Pause checks\n"
+           "  kswitcher-phrase --bench    segmenting and re-planning cost\n");
+}
+
+std::vector<std::u16string> SplitWords(const char16_t* text) {
+    std::vector<std::u16string> words(1);
+    for (const char16_t* c = text; *c; ++c) {
+        if (*c == u' ') {
+            words.emplace_back();
+        } else {
+            words.back() += *c;
+        }
+    }
+    return words;
+}
+
+// First count words of text, cycling through it, each followed by a space
+std::u16string Phrase(const char16_t* text, size_t count) {
+    std::vector<std::u16string> words = SplitWords(text);
+    std::u16string phrase;
+    for (size_t i = 0; i < count; ++i) {
+        phrase += words[i % words.size()];
+        phrase += u' ';
+    }
+    return phrase;
+}
+
+struct Language {
+    LayoutTable table;
+    std::vector<uint8_t> trigramData;
+    NgramTable trigrams;
+};
+
+void BuildLanguage(const LayoutTable& table, const char16_t* text, Language& language) {
+    language.table = table;
+    NgramTableBuilder builder;
+    builder.AddText(text, std::char_traits<char16_t>::length(text));
+    language.trigramData = builder.Serialize();
+    language.trigrams.Attach(language.trigramData.data(), language.trigramData.size());
+}
+
+class CountingBackend : public FakeBackend {
+public:
+    void Send(const INPUT* inputs, size_t count) override {
+        ++_batches;
+        FakeBackend::Send(inputs, count);
+    }
+    size_t Batches() const { return _batches; }
+
+private:
+    size_t _batches = 0;
+};
+
+// The engine and a fake with the two built-in layouts, and the text each
+// window would show: typed keys read under the active layout, injected
+// input applied as an application applies it
+class Editor {
+public:
+    explicit Editor(Language* languages)
+        : _engine(_backend, _latency, KeystrokeRing::DEFAULT_CAPACITY), _window(1), _shift(false), _applied(0),
+          _time(0) {
+        for (size_t i = 0; i < 2; ++i) {
+            _tables[i] = &languages[i].table;
+            _layouts[i] = _backend.AddLayout(languages[i].table, nullptr, &languages[i].trigrams);
+        }
+        Focus(1);
+    }
+
+    // Presses the keys that type text in layout meant, whatever layout is
+    // active
+    bool Type(const std::u16string& text, size_t meant) {
+        for (char16_t c : text) {
+            int virtualKey;
+            bool shift;
+            if (!_tables[meant]->FindKey(c, virtualKey, shift)) return false;
+            Press(virtualKey, shift ? KeyEvent::Shift : 0);
+            _texts[_window] += ActiveTable().Translate(virtualKey, shift);
+        }
+        return true;
+    }
+
+    void Backspace(size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            Press(VK_BACK, 0);
+            if (!_texts[_window].empty()) _texts[_window].pop_back();
+        }
+    }
+
+    void Click() {
+        KeyEvent event = {};
+        event.flags = KeyEvent::MouseClick;
+        _engine.Process(event);
+    }
+
+    void Focus(uintptr_t window) {
+        _window = window;
+        _backend.SetForegroundWindow(reinterpret_cast<HWND>(window));
+        _engine.UpdateFocus();
+    }
+
+    CorrectionEngine::Result Pause() {
+        CorrectionEngine::Result result = _engine.Correct();
+        ApplySent();
+        return result;
+    }
+
+    CorrectionEngine::Result ShiftPause() {
+        CorrectionEngine::Result result = _engine.CorrectPhrase();
+        ApplySent();
+        return result;
+    }
+
+    // Shift+Pause with the text left as it was, for timing
+    void Replan() {
+        _engine.CorrectPhrase();
+        _backend.ClearHistory();
+        _applied = 0;
+    }
+
+    void SetPhraseWords(size_t words) { _engine.SetPhraseWords(words); }
+    void SetLayout(size_t layout) { _backend.SetActiveLayout(_layouts[layout]); }
+    size_t Layout() const { return _backend.ActiveLayout() == _layouts[ENGLISH] ? ENGLISH : RUSSIAN; }
+
+    const std::u16string& Text() { return _texts[_window]; }
+    size_t Batches() const { return _backend.Batches(); }
+    const PhraseHistory& History() const { return _engine.State().Phrase(); }
+    const LatencyMetrics& Latency() const { return _latency; }
+
+private:
+    const LayoutTable& ActiveTable() const { return *_tables[Layout()]; }
+
+    void Press(int virtualKey, uint16_t flags) {
+        KeyEvent event = {};
+        event.virtualKey = static_cast<uint16_t>(virtualKey);
+        event.flags = static_cast<uint16_t>(KeyEvent::KeyDown | flags);
+        event.time = _time += 120;
+        _engine.Process(event);
+    }
+
+    void ApplySent() {
+        const std::vector<INPUT>& sent = _backend.SentInputs();
+        std::u16string& text = _texts[_window];
+        for (; _applied < sent.size(); ++_applied) {
+            const KEYBDINPUT& key = sent[_applied].ki;
+            bool up = (key.dwFlags & KEYEVENTF_KEYUP) != 0;
+            if (key.dwFlags & KEYEVENTF_UNICODE) {
+                if (!up) text += static_cast<char16_t>(key.wScan);
+            } else if (key.wVk == VK_SHIFT) {
+                _shift = !up;
+            } else if (!up && key.wVk == VK_BACK) {
+                if (!text.empty()) text.pop_back();
+            } else if (!up) {
+                text += ActiveTable().Translate(key.wVk, _shift);
+            }
+        }
+    }
+
+    CountingBackend _backend;
+    LatencyMetrics _latency;
+    CorrectionEngine _engine;
+    const LayoutTable* _tables[2];
+    HKL _layouts[2];
+    std::u16string _texts[3];
+    uintptr_t _window;
+    bool _shift;
+    size_t _applied;
+    uint32_t _time;
+};
+
+// What the keys that type text in from show under to
+std::u16string Reading(const std::u16string& text, const LayoutTable& from, const LayoutTable& to) {
+    std::u16string reading;
+    for (char16_t c : text) {
+        int virtualKey;
+        bool shift;
+        reading += from.FindKey(c, virtualKey, shift) ? to.Translate(virtualKey, shift) : u'?';
+    }
+    return reading;
+}
+
+// What the history should hold, as a list of words without limits on how
+// they are stored
+struct ReferenceHistory {
+    std::deque<std::vector<KeystrokeInfo>> words;
+    size_t keys = 0;
+
+    void Push(KeystrokeInfo keystroke) {
+        bool space = keystroke.VirtualKey() == VK_SPACE;
+        if (words.empty() || (!space && words.back().back().VirtualKey() == VK_SPACE)) {
+            if (words.size() == PhraseHistory::MAX_WORDS) DropWord();
+            words.emplace_back();
+        }
+        if (keys == PhraseHistory::MAX_KEYS) {
+            if (words.size() > 1) {
+                DropWord();
+            } else {
+                words.front().erase(words.front().begin());
+                --keys;
+            }
+        }
+        words.back().push_back(keystroke);
+        ++keys;
+    }
+
+    void PopBack() {
+        if (words.empty()) return;
+        words.back().pop_back();
+        --keys;
+        if (words.back().empty()) words.pop_back();
+    }
+
+    void Clear() {
+        words.clear();
+        keys = 0;
+    }
+
+    void DropWord() {
+        keys -= words.front().size();
+        words.pop_front();
+    }
+
+    bool Matches(const PhraseHistory& history, size_t last) const {
+        size_t first = last == 0 || last > words.size() ? 0 : words.size() - last;
+        std::vector<KeystrokeInfo> expected;
+        for (size_t i = first; i < words.size(); ++i) {
+            expected.insert(expected.end(), words[i].begin(), words[i].end());
+        }
+        size_t count;
+        const KeystrokeInfo* keystrokes = history.Last(last, count);
+        if (count != expected.size()) return false;
+        for (size_t i = 0; i < count; ++i) {
+            if (keystrokes[i].bits != expected[i].bits) return false;
+        }
+        return true;
+    }
+};
+
+// Mostly short words and single spaces, now and then a run of spaces, a
+// backspace, a word longer than the history or a cleared buffer
+bool CheckSegmenting() {
+    Random random(2463534242u);
+    PhraseHistory history;
+    ReferenceHistory reference;
+    const size_t checkedWords[] = { 0, 1, 2, 5, PhraseHistory::MAX_WORDS - 1, PhraseHistory::MAX_WORDS + 1 };
+
+    for (size_t op = 0; op < 300000; ++op) {
+        uint32_t roll = random.Below(1000);
+        if (roll < 2) {
+            history.Clear();
+            reference.Clear();
+        } else if (roll < 4) {
+            for (size_t i = 0; i < PhraseHistory::MAX_KEYS + 50; ++i) {
+                KeystrokeInfo keystroke = KeystrokeInfo::Make('A' + random.Below(26), false, false);
+                history.Push(keystroke);
+                reference.Push(keystroke);
+            }
+        } else if (roll < 100) {
+            history.PopBack();
+            reference.PopBack();
+        } else {
+            KeystrokeInfo keystroke = roll < 280 ? KeystrokeInfo::Make(VK_SPACE, false, false)
+                                                 : KeystrokeInfo::Make('A' + random.Below(26), roll % 7 == 0, false);
+            history.Push(keystroke);
+            reference.Push(keystroke);
+        }
+
+        if (history.Size() != reference.keys || history.WordCount() != reference.words.size()) {
+            return false;
+        }
+        for (size_t last : checkedWords) {
+            if (!reference.Matches(history, last)) return false;
+        }
+    }
+    return true;
+}
+
+int Check() {
+    bool ok = true;
+    Language languages[2];
+    BuildLanguage(LayoutTable::EnglishUS(), ENGLISH_TEXT, languages[ENGLISH]);
+    BuildLanguage(LayoutTable::RussianRU(), RUSSIAN_TEXT, languages[RUSSIAN]);
+    const LayoutTable& english = languages[ENGLISH].table;
+    const LayoutTable& russian = languages[RUSSIAN].table;
+
+    ok = Report("words and spaces are split as the reference", CheckSegmenting()) && ok;
+
+    std::u16string russianPhrase = Phrase(RUSSIAN_TEXT, 8);
+    std::u16string englishPhrase = Phrase(ENGLISH_TEXT, 8);
+    {
+        Editor editor(languages);
+        editor.SetLayout(ENGLISH);
+        editor.Type(russianPhrase, RUSSIAN);
+        size_t batches = editor.Batches();
+        CorrectionEngine::Result result = editor.ShiftPause();
+        ok = Report("phrase typed in the wrong layout is corrected",
+                    editor.Text() == russianPhrase && editor.Layout() == RUSSIAN) && ok;
+        ok = Report("whole phrase goes out in one batch",
+                    result == CorrectionEngine::Result::Unicode && editor.Batches() == batches + 1) && ok;
+        editor.ShiftPause();
+        ok = Report("another Shift+Pause puts the phrase back",
+                    editor.Text() == Reading(russianPhrase, russian, english) && editor.Layout() == ENGLISH) && ok;
+    }
+    {
+        Editor editor(languages);
+        editor.SetLayout(RUSSIAN);
+        editor.Type(englishPhrase, ENGLISH);
+        editor.ShiftPause();
+        ok = Report("English typed in the Russian layout is corrected",
+                    editor.Text() == englishPhrase && editor.Layout() == ENGLISH) && ok;
+    }
+
+    // Three words typed wrong, the third fixed with Pause, which switches
+    // the layout, and two more typed right after it
+    {
+        std::vector<std::u16string> words = SplitWords(RUSSIAN_TEXT);
+        Editor editor(languages);
+        editor.SetLayout(ENGLISH);
+        for (size_t i = 0; i < 3; ++i) {
+            editor.Type(words[i] + u' ', RUSSIAN);
+        }
+        editor.Pause();
+        bool wordFixed = editor.Layout() == RUSSIAN;
+        for (size_t i = 3; i < 5; ++i) {
+            editor.Type(words[i] + u' ', RUSSIAN);
+        }
+        editor.ShiftPause();
+        ok = Report("words already right come out unchanged",
+                    wordFixed && editor.Text() == Phrase(RUSSIAN_TEXT, 5) && editor.Layout() == RUSSIAN) && ok;
+    }
+    {
+        Editor editor(languages);
+        editor.SetPhraseWords(2);
+        editor.SetLayout(ENGLISH);
+        editor.Type(russianPhrase, RUSSIAN);
+        editor.ShiftPause();
+        std::u16string lastTwo = Phrase(RUSSIAN_TEXT, 8).substr(Phrase(RUSSIAN_TEXT, 6).size());
+        std::u16string before = russianPhrase.substr(0, russianPhrase.size() - lastTwo.size());
+        ok = Report("phraseCorrection.words limits the words",
+                    editor.Text() == Reading(before, russian, english) + lastTwo) && ok;
+    }
+
+    // Backspaces over a word and its space, then another word
+    {
+        std::vector<std::u16string> words = SplitWords(RUSSIAN_TEXT);
+        Editor editor(languages);
+        editor.SetLayout(ENGLISH);
+        editor.Type(words[0] + u' ' + words[1], RUSSIAN);
+        editor.Backspace(words[1].size() + 1);
+        editor.Type(u' ' + words[2] + u' ', RUSSIAN);
+        editor.ShiftPause();
+        ok = Report("backspaces across a word end",
+                    editor.Text() == words[0] + u' ' + words[2] + u' ' && editor.History().WordCount() == 2) && ok;
+    }
+
+    // Focus moves: the phrase is what was typed since
+    {
+        Editor editor(languages);
+        editor.SetLayout(ENGLISH);
+        editor.Type(russianPhrase, RUSSIAN);
+        editor.Focus(2);
+        bool nothing = editor.ShiftPause() == CorrectionEngine::Result::Nothing;
+        editor.Focus(1);
+        std::u16string more = Phrase(RUSSIAN_TEXT, 3);
+        editor.Type(more, RUSSIAN);
+        editor.ShiftPause();
+        ok = Report("the phrase starts where focus came back",
+                    nothing && editor.Text() == Reading(russianPhrase, russian, english) + more) && ok;
+
+        editor.Type(englishPhrase, ENGLISH);
+        editor.Click();
+        ok = Report("a click ends the phrase", editor.ShiftPause() == CorrectionEngine::Result::Nothing) && ok;
+    }
+
+    // More than the history holds: the oldest words stay as typed, and the
+    // corrected part starts at a word
+    {
+        Editor editor(languages);
+        editor.SetLayout(ENGLISH);
+        std::u16string longPhrase = Phrase(RUSSIAN_TEXT, 60);
+        editor.Type(longPhrase, RUSSIAN);
+        size_t kept = editor.History().Size();
+        size_t cut = longPhrase.size() - kept;
+        editor.ShiftPause();
+        ok = Report("a long phrase keeps whole words from its end",
+                    cut > 0 && longPhrase[cut - 1] == u' ' &&
+                        editor.History().WordCount() <= PhraseHistory::MAX_WORDS &&
+                        editor.Text() == Reading(longPhrase.substr(0, cut), russian, english) +
+                                             longPhrase.substr(cut)) && ok;
+    }
+    return ok ? 0 : 1;
+}
+
+int Bench() {
+    const size_t KEYS = 20000000;
+
+    // Words of 1 to 12 letters with one space after each
+    Random random(88675123u);
+    std::vector<KeystrokeInfo> keys;
+    keys.reserve(KEYS);
+    while (keys.size() < KEYS) {
+        size_t length = 1 + random.Below(12);
+        for (size_t i = 0; i < length; ++i) {
+            keys.push_back(KeystrokeInfo::Make('A' + random.Below(26), false, false));
+        }
+        keys.push_back(KeystrokeInfo::Make(VK_SPACE, false, false));
+    }
+
+    KeystrokeRing ring;
+    ring.SetCapacity(KeystrokeRing::MAX_CAPACITY);
+    Clock::time_point start = Clock::now();
+    for (KeystrokeInfo keystroke : keys) {
+        ring.Push(keystroke);
+    }
+    double ringPush = Seconds(start) * 1e9 / keys.size();
+
+    PhraseHistory history;
+    size_t total = ring.Back().bits;
+    start = Clock::now();
+    for (KeystrokeInfo keystroke : keys) {
+        history.Push(keystroke);
+    }
+    double historyPush = Seconds(start) * 1e9 / keys.size();
+
+    start = Clock::now();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        size_t count;
+        history.Last(i % (PhraseHistory::MAX_WORDS + 1), count);
+        total += count;
+    }
+    double last = Seconds(start) * 1e9 / keys.size();
+
+    printf("segmenting, %zu keys\n", keys.size());
+    printf("  push:  %6.2f ns per key, %6.2f ns into a plain KeystrokeRing\n", historyPush, ringPush);
+    printf("  last:  %6.2f ns to find the last 0 to %zu words, %.1f keys on average\n", last,
+           PhraseHistory::MAX_WORDS, static_cast<double>(total) / keys.size());
+
+    Language languages[2];
+    BuildLanguage(LayoutTable::EnglishUS(), ENGLISH_TEXT, languages[ENGLISH]);
+    BuildLanguage(LayoutTable::RussianRU(), RUSSIAN_TEXT, languages[RUSSIAN]);
+
+    printf("re-planning a Russian phrase typed in the English layout\n");
+    printf("  %6s %6s %12s %12s\n", "words", "keys", "rank us", "total us");
+    const size_t PHRASE_WORDS[] = { 1, 4, 8, 16, 32 };
+    const size_t REPEATS = 20000;
+    for (size_t words : PHRASE_WORDS) {
+        Editor editor(languages);
+        editor.SetLayout(ENGLISH);
+        editor.Type(Phrase(RUSSIAN_TEXT, words), RUSSIAN);
+
+        start = Clock::now();
+        for (size_t i = 0; i < REPEATS; ++i) {
+            editor.Replan();
+        }
+        double seconds = Seconds(start);
+
+        LatencyHistogram::Snapshot rank;
+        editor.Latency().Get(LatencyMetrics::PHRASE_DETECT).Read(rank);
+        printf("  %6zu %6zu %12.2f %12.2f\n", editor.History().WordCount(), editor.History().Size(),
+               rank.Mean() / 1e3, seconds * 1e6 / REPEATS);
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 2 && strcmp(argv[1], "--bench") == 0) {
+        return Bench();
+    }
+    if (argc == 1 || (argc == 2 && strcmp(argv[1], "--check") == 0)) {
+        return Check();
+    }
+    PrintUsage();
+    return 1;
+}
\ No newline at end of file
@@ -0,0 +1,254 @@
+// kswitcher-planner: checks the inputs the correction planner lays out for
+// key replay and Unicode plans, and measures plan-build cost and how many
+// inputs each word length sends.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "CorrectionPlanner.h"
+#include "InjectedInput.h"
+#include "KeystrokeRing.h"
+#include "LayoutTable.h"
+#include "ToolSupport.h"
+
+namespace {
+
+void PrintUsage() {
+    printf("Usage:\n"
+           "  kswitcher-planner --check\n"
+           "  kswitcher-planner --bench\n");
+}
+
+// Keys for text on the US layout; capitals are typed with Shift
+std::vector<KeystrokeInfo> Keys(const char* text) {
+    std::vector<KeystrokeInfo> keys;
+    for (const char* c = text; *c; ++c) {
+        bool shift = *c >= 'A' && *c <= 'Z';
+        int virtualKey = *c == ' ' ? VK_SPACE : (*c >= 'a' && *c <= 'z' ? *c - 'a' + 'A' : *c);
+        keys.push_back(KeystrokeInfo::Make(virtualKey, shift, false));
+    }
+    return keys;
+}
+
+// An expected input: a key, or a character when virtualKey is 0
+struct Expected {
+    WORD virtualKey;
+    char16_t ch;
+    bool up;
+    bool extended;
+};
+
+void ExpectTap(std::vector<Expected>& expected, WORD virtualKey, bool extended = false) {
+    expected.push_back({ virtualKey, 0, false, extended });
+    expected.push_back({ virtualKey, 0, true, extended });
+}
+
+void ExpectChar(std::vector<Expected>& expected, char16_t ch) {
+    expected.push_back({ 0, ch, false, false });
+    expected.push_back({ 0, ch, true, false });
+}
+
+bool Matches(const CorrectionPlan& plan, const std::vector<Expected>& expected) {
+    if (plan.inputs.size() != expected.size()) return false;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        const INPUT& input = plan.inputs[i];
+        const Expected& want = expected[i];
+        DWORD flags = (want.ch ? KEYEVENTF_UNICODE : 0) | (want.up ? KEYEVENTF_KEYUP : 0) |
+                      (want.extended ? KEYEVENTF_EXTENDEDKEY : 0);
+        if (input.type != INPUT_KEYBOARD || input.ki.wVk != want.virtualKey ||
+            input.ki.wScan != static_cast<WORD>(want.ch) || input.ki.dwFlags != flags ||
+            input.ki.dwExtraInfo != InjectedInput::SIGNATURE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int Check() {
+    bool ok = true;
+    CorrectionPlan plan;
+    LayoutTable russian = LayoutTable::RussianRU();
+
+    // Backspaces first, one tap per keystroke, then the keys
+    {
+        std::vector<KeystrokeInfo> keys = Keys("ghbdtn");
+        CorrectionPlanner::BuildPlan(keys.data(), keys.size(), plan);
+        std::vector<Expected> expected;
+        for (size_t i = 0; i < keys.size(); ++i) ExpectTap(expected, VK_BACK);
+        for (const char* c = "GHBDTN"; *c; ++c) ExpectTap(expected, static_cast<WORD>(*c));
+        ok = Report("key plan: backspaces, then each key tapped",
+                    Matches(plan, expected) && plan.deleteCount == 12 && plan.ReplayCount() == 12 &&
+                    plan.ReplayInputs() == plan.inputs.data() + 12) && ok;
+    }
+
+    // One Shift press per run of shifted keys, released before the end
+    {
+        std::vector<KeystrokeInfo> keys = Keys("HEllO W");
+        CorrectionPlanner::BuildPlan(keys.data(), keys.size(), plan);
+        std::vector<Expected> expected;
+        for (size_t i = 0; i < keys.size(); ++i) ExpectTap(expected, VK_BACK);
+        expected.push_back({ VK_SHIFT, 0, false, false });
+        ExpectTap(expected, 'H');
+        ExpectTap(expected, 'E');
+        expected.push_back({ VK_SHIFT, 0, true, false });
+        ExpectTap(expected, 'L');
+        ExpectTap(expected, 'L');
+        expected.push_back({ VK_SHIFT, 0, false, false });
+        ExpectTap(expected, 'O');
+        expected.push_back({ VK_SHIFT, 0, true, false });
+        ExpectTap(expected, VK_SPACE);
+        expected.push_back({ VK_SHIFT, 0, false, false });
+        ExpectTap(expected, 'W');
+        expected.push_back({ VK_SHIFT, 0, true, false });
+        ok = Report("key plan: shifted runs share one Shift press", Matches(plan, expected)) && ok;
+    }
+
+    // Keys recorded as extended go back out as extended; backspaces and Shift
+    // never are
+    {
+        std::vector<KeystrokeInfo> keys = {
+            KeystrokeInfo::Make(VK_NUMPAD0, false, false), KeystrokeInfo::Make(VK_OEM_2, true, false, true),
+            KeystrokeInfo::Make('A', false, false)
+        };
+        CorrectionPlanner::BuildPlan(keys.data(), keys.size(), plan);
+        std::vector<Expected> expected;
+        for (size_t i = 0; i < keys.size(); ++i) ExpectTap(expected, VK_BACK);
+        ExpectTap(expected, VK_NUMPAD0);
+        expected.push_back({ VK_SHIFT, 0, false, false });
+        ExpectTap(expected, VK_OEM_2, true);
+        expected.push_back({ VK_SHIFT, 0, true, false });
+        ExpectTap(expected, 'A');
+        ok = Report("key plan: extended keys keep KEYEVENTF_EXTENDEDKEY", Matches(plan, expected)) && ok;
+    }
+
+    // Characters of the target layout, in one batch after the backspaces
+    {
+        std::vector<KeystrokeInfo> keys = Keys("Ghbdtn");
+        bool built = CorrectionPlanner::BuildUnicodePlan(keys.data(), keys.size(), russian, plan);
+        std::vector<Expected> expected;
+        for (size_t i = 0; i < keys.size(); ++i) ExpectTap(expected, VK_BACK);
+        for (char16_t ch : std::u16string(u"Привет")) ExpectChar(expected, ch);
+        ok = Report("Unicode plan: backspaces, then the characters",
+                    built && Matches(plan, expected) && plan.deleteCount == 12) && ok;
+    }
+
+    // Caps Lock flips letters only
+    {
+        std::vector<KeystrokeInfo> keys = {
+            KeystrokeInfo::Make('G', false, true), KeystrokeInfo::Make('G', true, true),
+            KeystrokeInfo::Make('1', false, true)
+        };
+        bool built = CorrectionPlanner::BuildUnicodePlan(keys.data(), keys.size(), russian, plan);
+        std::vector<Expected> expected;
+        for (size_t i = 0; i < keys.size(); ++i) ExpectTap(expected, VK_BACK);
+        ExpectChar(expected, u'П');
+        ExpectChar(expected, u'п');
+        ExpectChar(expected, u'1');
+        ok = Report("Unicode plan: Caps Lock inverts Shift on letters", built && Matches(plan, expected)) && ok;
+    }
+
+    // A key the target layout has no character for leaves no plan
+    {
+        std::vector<KeystrokeInfo> keys = Keys("ab");
+        keys.push_back(KeystrokeInfo::Make(VK_LEFT, false, false));
+        bool built = CorrectionPlanner::BuildUnicodePlan(keys.data(), keys.size(), russian, plan);
+        ok = Report("Unicode plan refuses keys without a character",
+                    !built && plan.inputs.empty() && plan.deleteCount == 0) && ok;
+    }
+
+    {
+        CorrectionPlanner::BuildPlan(nullptr, 0, plan);
+        bool empty = plan.inputs.empty() && plan.deleteCount == 0;
+        empty = CorrectionPlanner::BuildUnicodePlan(nullptr, 0, russian, plan) && plan.inputs.empty() && empty;
+        ok = Report("an empty word plans nothing", empty) && ok;
+    }
+
+    // Random words stay within the bound, and a reused plan stops allocating
+    {
+        Random random(0x853C49E6748FEA9Bull);
+        CorrectionPlan reused;
+        std::vector<KeystrokeInfo> longest(KeystrokeRing::MAX_CAPACITY,
+                                           KeystrokeInfo::Make('A', false, false));
+        for (size_t i = 0; i < longest.size(); i += 2) longest[i] = KeystrokeInfo::Make('A', true, false);
+        CorrectionPlanner::BuildPlan(longest.data(), longest.size(), reused);
+        bool bounded = reused.inputs.size() <= CorrectionPlanner::MaxInputCount(longest.size());
+        const INPUT* storage = reused.inputs.data();
+        for (int round = 0; round < 10000; ++round) {
+            std::vector<KeystrokeInfo> keys(1 + random.Below(KeystrokeRing::MAX_CAPACITY));
+            for (KeystrokeInfo& key : keys) {
+                key = KeystrokeInfo::Make('A' + random.Below(26), random.Below(3) == 0, false);
+            }
+            CorrectionPlanner::BuildPlan(keys.data(), keys.size(), reused);
+            bounded = reused.inputs.size() <= CorrectionPlanner::MaxInputCount(keys.size()) &&
+                      reused.deleteCount == keys.size() * 2 && bounded;
+        }
+        ok = Report("plans stay within MaxInputCount", bounded) && ok;
+        ok = Report("a reused plan keeps its storage", reused.inputs.data() == storage) && ok;
+    }
+
+    return ok ? 0 : 1;
+}
+
+int Bench() {
+    const size_t LENGTHS[] = { 1, 2, 4, 8, 12, 20, 32, 64, 256 };
+    const size_t KEYS_PER_LENGTH = 1 << 22;
+    LayoutTable russian = LayoutTable::RussianRU();
+    Random random(0xDA3E39CB94B95BDBull);
+    CorrectionPlan plan;
+
+    printf("%-7s %9s %9s %10s %9s %11s %11s\n", "length", "old calls", "keys", "keys+Shift", "unicode",
+           "keys ns", "unicode ns");
+    for (size_t length : LENGTHS) {
+        // Lower-case words, and the worst case of Shift on every other key
+        std::vector<KeystrokeInfo> plain(length);
+        std::vector<KeystrokeInfo> shifted(length);
+        for (size_t i = 0; i < length; ++i) {
+            int virtualKey = 'A' + random.Below(26);
+            plain[i] = KeystrokeInfo::Make(virtualKey, false, false);
+            shifted[i] = KeystrokeInfo::Make(virtualKey, i % 2 == 0, false);
+        }
+
+        CorrectionPlanner::BuildPlan(shifted.data(), length, plan);
+        size_t shiftedInputs = plan.inputs.size();
+        CorrectionPlanner::BuildUnicodePlan(plain.data(), length, russian, plan);
+        size_t unicodeInputs = plan.inputs.size();
+
+        size_t rounds = KEYS_PER_LENGTH / length;
+        size_t inputs = 0;
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < rounds; ++i) {
+            CorrectionPlanner::BuildPlan(plain.data(), length, plan);
+            inputs += plan.inputs.size();
+        }
+        double keysNs = Seconds(start) * 1e9 / rounds;
+        size_t keyInputs = inputs / rounds;
+
+        start = Clock::now();
+        for (size_t i = 0; i < rounds; ++i) {
+            CorrectionPlanner::BuildUnicodePlan(plain.data(), length, russian, plan);
+            inputs += plan.inputs.size();
+        }
+        double unicodeNs = Seconds(start) * 1e9 / rounds;
+
+        // Before plans: keybd_event down and up per backspace, one SendInput
+        // per replayed key
+        printf("%-7zu %9zu %9zu %10zu %9zu %11.1f %11.1f\n", length, length * 3, keyInputs, shiftedInputs,
+               unicodeInputs, keysNs, unicodeNs);
+    }
+    printf("\nKey plans go out in 2 SendInput calls, Unicode plans in 1.\n");
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 2 && strcmp(argv[1], "--check") == 0) {
+        return Check();
+    }
+    if (argc == 2 && strcmp(argv[1], "--bench") == 0) {
+        return Bench();
+    }
+    PrintUsage();
+    return 1;
+}
\ No newline at end of file
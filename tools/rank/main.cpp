@@ -0,0 +1,367 @@
+// kswitcher-rank: shows how the correction engine ranks the installed
+// layouts for a word, checks the ranker against the per-layout loop it
+// replaced, and measures what ranking costs as the number of layouts and the
+// word length grow.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "DawgBuilder.h"
+#include "LanguageModel.h"
+#include "LayoutRanker.h"
+#include "MappedFile.h"
+#include "TextUtils.h"
+#include "ToolSupport.h"
+
+namespace {
+
+const size_t LAYOUT_COUNTS[] = { 1, 2, 3, 4, 8, 16 };
+const size_t WORD_LENGTHS[] = { 4, 8, 16, 32, 64 };
+
+// Keys that carry letters on every synthetic layout
+const char LETTER_KEYS[] = "QWERTYUIOPASDFGHJKLZXCVBNM";
+const size_t LETTER_KEY_COUNT = sizeof(LETTER_KEYS) - 1;
+
+void PrintUsage() {
+    printf("Usage:\n"
+           "  kswitcher-rank [--model-en <file>] [--model-ru <file>] <word>...\n"
+           "  kswitcher-rank --check\n"
+           "  kswitcher-rank --bench\n"
+           "\n"
+           "Words are given as typed on the US layout, e.g. ghbdtn.\n");
+}
+
+std::string ToUtf8(const char16_t* text, size_t length) {
+    std::string out;
+    for (size_t i = 0; i < length; ++i) {
+        char16_t ch = text[i];
+        if (ch < 0x80) {
+            out += static_cast<char>(ch);
+        } else if (ch < 0x800) {
+            out += static_cast<char>(0xC0 | (ch >> 6));
+            out += static_cast<char>(0x80 | (ch & 0x3F));
+        } else {
+            out += static_cast<char>(0xE0 | (ch >> 12));
+            out += static_cast<char>(0x80 | ((ch >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (ch & 0x3F));
+        }
+    }
+    return out;
+}
+
+// Keystrokes that type text on the US layout; false if a character has no key
+bool ToKeystrokes(const char* text, std::vector<KeystrokeInfo>& keystrokes) {
+    LayoutTable us = LayoutTable::EnglishUS();
+    keystrokes.clear();
+    for (const char* p = text; *p; ++p) {
+        int virtualKey;
+        bool shift;
+        if (!us.FindKey(static_cast<char16_t>(static_cast<unsigned char>(*p)), virtualKey, shift)) return false;
+        keystrokes.push_back(KeystrokeInfo::Make(virtualKey, shift, false));
+    }
+    return true;
+}
+
+int Show(const std::vector<const char*>& words, const std::string modelPaths[2]) {
+    const char* names[2] = { "en-US", "ru-RU" };
+    LayoutTable tables[2] = { LayoutTable::EnglishUS(), LayoutTable::RussianRU() };
+    LanguageModel models[2];
+    LayoutCandidate candidates[2] = {};
+    for (size_t i = 0; i < 2; ++i) {
+        candidates[i].table = &tables[i];
+        if (modelPaths[i].empty()) continue;
+        if (!models[i].Open(MappedFile::PathFromUtf8(modelPaths[i]))) {
+            fprintf(stderr, "error: %s is not a valid model\n", modelPaths[i].c_str());
+            return 1;
+        }
+        candidates[i].dictionary = models[i].Dictionary();
+        candidates[i].trigrams = models[i].Trigrams();
+    }
+
+    LayoutRanker ranker;
+    ranker.SetCandidates(candidates, 2);
+    std::vector<KeystrokeInfo> keystrokes;
+    for (const char* text : words) {
+        if (!ToKeystrokes(text, keystrokes)) {
+            fprintf(stderr, "error: \"%s\" cannot be typed on the US layout\n", text);
+            return 1;
+        }
+
+        LayoutRanker::Ranking rankings[LayoutRanker::MAX_LAYOUTS];
+        size_t ranked = ranker.Rank(keystrokes.data(), keystrokes.size(), 0, rankings);
+        printf("%s\n", text);
+        for (size_t i = 0; i < ranked; ++i) {
+            char16_t word[LayoutRanker::MAX_WORD_LENGTH];
+            size_t length = ranker.Word(rankings[i].candidate, word, LayoutRanker::MAX_WORD_LENGTH);
+            // Padded by characters, not UTF-8 bytes
+            int padding = length < 20 ? static_cast<int>(20 - length) : 0;
+            printf("  %zu. %-6s %s%*s %8d%s\n", i + 1, names[rankings[i].candidate],
+                   ToUtf8(word, length).c_str(), padding, "", rankings[i].score,
+                   rankings[i].isWord ? "  word" : "");
+        }
+    }
+    return 0;
+}
+
+// A layout, its model, and the data the model points into
+struct SyntheticLayout {
+    LayoutTable table;
+    std::vector<uint8_t> trigramData;
+    std::vector<uint8_t> dictionaryData;
+    NgramTable trigrams;
+    Dawg dictionary;
+};
+
+uint32_t NextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Latin or Cyrillic letters on the letter keys, rotated per layout so no two
+// layouts read a key the same, with a model trained on random text in that
+// alphabet
+void BuildLayout(size_t index, SyntheticLayout& layout) {
+    bool cyrillic = index % 2 == 1;
+    char16_t base = cyrillic ? u'а' : u'a';
+    size_t alphabet = cyrillic ? 32 : 26;
+
+    layout.table = LayoutTable(0x04090409 + static_cast<uint32_t>(index));
+    char16_t letters[LETTER_KEY_COUNT];
+    for (size_t i = 0; i < LETTER_KEY_COUNT; ++i) {
+        letters[i] = static_cast<char16_t>(base + (i + index / 2) % alphabet);
+        layout.table.SetKey(LETTER_KEYS[i], letters[i], static_cast<char16_t>(letters[i] - 0x20), true);
+    }
+    layout.table.SetKey(' ', u' ', u' ', false);
+
+    uint32_t state = 0x9E3779B9u + static_cast<uint32_t>(index);
+    std::u16string text;
+    std::vector<std::u16string> words;
+    for (int i = 0; i < 20000; ++i) {
+        std::u16string word;
+        size_t length = 2 + NextRandom(state) % 9;
+        for (size_t j = 0; j < length; ++j) {
+            word += letters[NextRandom(state) % LETTER_KEY_COUNT];
+        }
+        text += word;
+        text += u' ';
+        words.push_back(word);
+    }
+
+    NgramTableBuilder trigrams;
+    trigrams.AddText(text.data(), text.size());
+    layout.trigramData = trigrams.Serialize();
+    layout.trigrams.Attach(layout.trigramData.data(), layout.trigramData.size());
+
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    DawgBuilder dictionary;
+    for (const std::u16string& word : words) {
+        dictionary.Add(word);
+    }
+    layout.dictionaryData = dictionary.Serialize();
+    layout.dictionary.Attach(layout.dictionaryData.data(), layout.dictionaryData.size());
+}
+
+// The straightforward per-layout loop the ranker replaces, the old
+// dictionary check plus trigram scoring. Kept to check the ranker's results
+// and to see what the transposed tables buy.
+LayoutRanker::Ranking RankScalar(const KeystrokeInfo* keystrokes, size_t count, const LayoutCandidate& candidate) {
+    const char16_t boundary = NgramTable::BOUNDARY;
+    char16_t word[LayoutRanker::MAX_WORD_LENGTH];
+    size_t length = 0;
+    size_t lastLetter = 0;
+    char16_t c0 = boundary;
+    char16_t c1 = boundary;
+    int score = 0;
+    for (size_t i = 0; i < count; ++i) {
+        char16_t ch = candidate.table->Translate(keystrokes[i].VirtualKey(), keystrokes[i].Shift(),
+                                                 keystrokes[i].CapsLock());
+        if (IsLetterChar(ch) || length > 0) {
+            word[length++] = ToLowerChar(ch);
+            if (IsLetterChar(ch)) lastLetter = length;
+        }
+
+        ch = NgramTable::Normalize(ch);
+        if (ch == boundary && c1 == boundary) continue;
+        score += candidate.trigrams->LogProb(c0, c1, ch);
+        c0 = c1;
+        c1 = ch;
+    }
+    if (c1 != boundary) score += candidate.trigrams->LogProb(c0, c1, boundary);
+
+    bool isWord = lastLetter > 0 && candidate.dictionary->Contains(word, lastLetter);
+    return { 0, score, isWord };
+}
+
+// Every synthetic layout as a ranker candidate
+struct SyntheticCandidates {
+    std::vector<SyntheticLayout> layouts;
+    LayoutCandidate candidates[LayoutRanker::MAX_LAYOUTS];
+
+    SyntheticCandidates() : layouts(LayoutRanker::MAX_LAYOUTS) {
+        for (size_t i = 0; i < layouts.size(); ++i) {
+            BuildLayout(i, layouts[i]);
+            candidates[i] = { &layouts[i].table, &layouts[i].dictionary, &layouts[i].trigrams };
+        }
+    }
+};
+
+const size_t WORD_COUNT = 256;
+
+// WORD_COUNT words of MAX_WORD_LENGTH keys: random letters with the odd
+// space, Shift and Caps Lock
+std::vector<KeystrokeInfo> RandomWords() {
+    std::vector<KeystrokeInfo> keystrokes(WORD_COUNT * LayoutRanker::MAX_WORD_LENGTH);
+    uint32_t state = 12345;
+    for (KeystrokeInfo& keystroke : keystrokes) {
+        uint32_t r = NextRandom(state);
+        int key = r % 16 == 0 ? ' ' : LETTER_KEYS[r % LETTER_KEY_COUNT];
+        keystroke = KeystrokeInfo::Make(key, (r >> 8) % 8 == 0, (r >> 12) % 16 == 0);
+    }
+    return keystrokes;
+}
+
+// Rankings that differ from the per-layout loop over the first length keys
+// of every word; ordered is cleared if some ranking is out of order
+size_t CountMismatches(LayoutRanker& ranker, const LayoutCandidate* candidates, size_t layoutCount,
+                       const std::vector<KeystrokeInfo>& keystrokes, size_t length, bool& ordered) {
+    LayoutRanker::Ranking rankings[LayoutRanker::MAX_LAYOUTS];
+    size_t mismatches = 0;
+    for (size_t w = 0; w < WORD_COUNT; ++w) {
+        const KeystrokeInfo* word = &keystrokes[w * LayoutRanker::MAX_WORD_LENGTH];
+        size_t ranked = ranker.Rank(word, length, 0, rankings);
+        if (ranked > layoutCount) ++mismatches;
+        for (size_t i = 0; i < ranked; ++i) {
+            LayoutRanker::Ranking expected = RankScalar(word, length, candidates[rankings[i].candidate]);
+            if (rankings[i].score != expected.score || rankings[i].isWord != expected.isWord) {
+                ++mismatches;
+            }
+            // Dictionary words first, then by score
+            if (i > 0 && (rankings[i].isWord > rankings[i - 1].isWord ||
+                          (rankings[i].isWord == rankings[i - 1].isWord && rankings[i].score > rankings[i - 1].score))) {
+                ordered = false;
+            }
+        }
+    }
+    return mismatches;
+}
+
+int Check() {
+    SyntheticCandidates synthetic;
+    std::vector<KeystrokeInfo> keystrokes = RandomWords();
+    LayoutRanker ranker;
+    size_t mismatches = 0;
+    bool ordered = true;
+    for (size_t layoutCount = 1; layoutCount <= LayoutRanker::MAX_LAYOUTS; ++layoutCount) {
+        ranker.SetCandidates(synthetic.candidates, layoutCount);
+        for (size_t length = 1; length <= LayoutRanker::MAX_WORD_LENGTH; length += length < 8 ? 1 : 7) {
+            mismatches += CountMismatches(ranker, synthetic.candidates, layoutCount, keystrokes, length, ordered);
+        }
+    }
+
+    bool ok = Report("scores match the per-layout loop", mismatches == 0);
+    ok = Report("words rank first, then by score", ordered) && ok;
+    return ok ? 0 : 1;
+}
+
+int Bench() {
+    SyntheticCandidates synthetic;
+    const LayoutCandidate* candidates = synthetic.candidates;
+    const size_t wordCount = WORD_COUNT;
+    const size_t maxLength = LayoutRanker::MAX_WORD_LENGTH;
+    std::vector<KeystrokeInfo> keystrokes = RandomWords();
+
+    LayoutRanker ranker;
+    LayoutRanker::Ranking rankings[LayoutRanker::MAX_LAYOUTS];
+    size_t mismatches = 0;
+    bool ordered = true;
+
+    printf("%-8s", "layouts");
+    for (size_t length : WORD_LENGTHS) {
+        printf(" %12zu", length);
+    }
+    printf("   (ns per ranking by word length; scalar loop in brackets)\n");
+
+    volatile size_t sink = 0;
+    for (size_t layoutCount : LAYOUT_COUNTS) {
+        ranker.SetCandidates(candidates, layoutCount);
+        printf("%-8zu", layoutCount);
+
+        for (size_t length : WORD_LENGTHS) {
+            // Same scores as the per-layout loop
+            mismatches += CountMismatches(ranker, candidates, layoutCount, keystrokes, length, ordered);
+
+            const size_t rounds = std::max<size_t>(1, 400000 / (layoutCount * length));
+            Clock::time_point start = Clock::now();
+            for (size_t round = 0; round < rounds; ++round) {
+                for (size_t w = 0; w < wordCount; w += 16) {
+                    sink = ranker.Rank(&keystrokes[w * maxLength], length, 0, rankings);
+                }
+            }
+            double rankNs = Seconds(start) * 1e9 / (rounds * (wordCount / 16));
+
+            start = Clock::now();
+            for (size_t round = 0; round < rounds; ++round) {
+                for (size_t w = 0; w < wordCount; w += 16) {
+                    size_t words = 0;
+                    for (size_t i = 0; i < layoutCount; ++i) {
+                        words += RankScalar(&keystrokes[w * maxLength], length, candidates[i]).isWord;
+                    }
+                    sink = words;
+                }
+            }
+            double scalarNs = Seconds(start) * 1e9 / (rounds * (wordCount / 16));
+
+            char cell[32];
+            snprintf(cell, sizeof(cell), "%.0f (%.0f)", rankNs, scalarNs);
+            printf(" %12s", cell);
+        }
+        printf("\n");
+    }
+
+    (void)sink;
+    printf("\nrankings: %s\n", mismatches || !ordered ? "MISMATCH" : "match the scalar loop");
+    return mismatches || !ordered ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 2 && strcmp(argv[1], "--check") == 0) {
+        return Check();
+    }
+    if (argc == 2 && strcmp(argv[1], "--bench") == 0) {
+        return Bench();
+    }
+
+    std::string modelPaths[2];
+    std::vector<const char*> words;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (strcmp(arg, "--model-en") == 0 && value) {
+            modelPaths[0] = value;
+            ++i;
+        } else if (strcmp(arg, "--model-ru") == 0 && value) {
+            modelPaths[1] = value;
+            ++i;
+        } else if (arg[0] == '-') {
+            PrintUsage();
+            return 1;
+        } else {
+            words.push_back(arg);
+        }
+    }
+
+    if (words.empty()) {
+        PrintUsage();
+        return 1;
+    }
+    return Show(words, modelPaths);
+}
\ No newline at end of file
@@ -0,0 +1,176 @@
+#include "TraceReplayer.h"
+#include "Hotkeys.h"
+
+TraceReplayer::TraceReplayer(size_t keystrokeCapacity)
+    : _engine(_backend, _dispatcher.GetLatency(), keystrokeCapacity),
+      _systemSource(_backend), _systemState(_systemSource), _foregroundSource(_backend),
+      _foreground(_foregroundSource), _dropEvery(0), _foregroundChanges(0), _lastLayout(nullptr), _lastPoll(0) {
+    _tables[0] = LayoutTable::EnglishUS();
+    _tables[1] = LayoutTable::RussianRU();
+    for (size_t i = 0; i < LAYOUT_COUNT; ++i) {
+        _layouts[i] = _backend.AddLayout(_tables[i]);
+    }
+
+    // Same handlers, in the same slots, as the app registers
+    _dispatcher.SetHandler(HookDispatcher::HANDLER_LAYOUT_SWITCH, OnLayoutSwitchKey, this);
+    _dispatcher.SetHandler(HookDispatcher::HANDLER_CORRECTION, OnCorrectionKey, this);
+    _dispatcher.SetHandler(HookDispatcher::HANDLER_RECORDING, OnRecordKey, this);
+    _dispatcher.SetEnabled(HookDispatcher::HANDLER_LAYOUT_SWITCH, true);
+    _dispatcher.SetEnabled(HookDispatcher::HANDLER_CORRECTION, true);
+    _dispatcher.SetEnabled(HookDispatcher::HANDLER_RECORDING, true);
+
+    _foreground.SetChangeHandler(OnForegroundChange, this);
+    _foreground.Start();
+}
+
+void TraceReplayer::SetModel(size_t layout, const LanguageModel* model) {
+    if (layout >= LAYOUT_COUNT) return;
+    _backend.SetDictionary(_layouts[layout], model ? model->Dictionary() : nullptr);
+    _backend.SetTrigrams(_layouts[layout], model ? model->Trigrams() : nullptr);
+}
+
+const LayoutTable& TraceReplayer::ActiveTable() const {
+    for (size_t i = 0; i < LAYOUT_COUNT; ++i) {
+        if (_layouts[i] == _backend.ActiveLayout()) return _tables[i];
+    }
+    return _tables[0];
+}
+
+void TraceReplayer::Reset() {
+    static const uint8_t released[256] = {};
+    _dispatcher.GetModifiers().Resync(released);
+    _foregroundSource.SetForeground(nullptr);
+    _backend.SetActiveLayout(_layouts[0]);
+    _backend.ClearHistory();
+    _engine.Reset();
+    _systemState.Reset();
+    _foreground.ResetCounters();
+    _foregroundChanges = 0;
+    _lastLayout = _backend.ActiveLayout();
+    _lastPoll = 0;
+    _stats = Stats();
+}
+
+void TraceReplayer::Feed(const TraceRecord& record) {
+    ++_stats.events;
+
+    HWND window = reinterpret_cast<HWND>(static_cast<uintptr_t>(record.window));
+    if (window != _backend.ForegroundWindow()) {
+        bool drop = _dropEvery && ++_foregroundChanges % _dropEvery == 0;
+        _foregroundSource.SetForeground(window, !drop);
+        if (drop) ++_stats.foregroundEventsDropped;
+    }
+    if (_engine.UpdateFocus()) {
+        ++_stats.focusChanges;
+    }
+    if (record.time - _lastPoll >= LAYOUT_POLL_MS) {
+        _lastPoll = record.time;
+        _foreground.Refresh();
+        _systemState.RefreshForegroundLayout();
+        ++_stats.layoutPolls;
+    }
+
+    if (InputTrace::IsMouseButton(record)) {
+        KeyEvent click = {};
+        click.flags = KeyEvent::MouseClick;
+        click.time = record.time;
+        _engine.Process(click);
+        ++_stats.mouseClicks;
+        return;
+    }
+
+    KBDLLHOOKSTRUCT event = {};
+    event.vkCode = record.virtualKey;
+    event.scanCode = record.scanCode;
+    event.flags = record.flags;
+    event.time = record.time;
+
+    bool keyUp = (record.flags & LLKHF_UP) != 0;
+    bool altDown = (record.flags & LLKHF_ALTDOWN) != 0;
+    UINT message = keyUp ? (altDown ? WM_SYSKEYUP : WM_KEYUP) : (altDown ? WM_SYSKEYDOWN : WM_KEYDOWN);
+    _dispatcher.Dispatch(message, event);
+}
+
+bool TraceReplayer::OnLayoutSwitchKey(void* context, UINT message, const KBDLLHOOKSTRUCT&) {
+    auto* self = static_cast<TraceReplayer*>(context);
+    if (!Hotkeys::IsLayoutSwitch(message, self->_dispatcher.GetModifiers().Load())) {
+        return false;
+    }
+    self->_backend.RequestLayout(self->_backend.ForegroundWindow(), nullptr);
+    self->NoteLayoutChange();
+    return true;
+}
+
+bool TraceReplayer::OnCorrectionKey(void* context, UINT message, const KBDLLHOOKSTRUCT& event) {
+    auto* self = static_cast<TraceReplayer*>(context);
+    if (!Hotkeys::IsCorrectionKey(event) || !Hotkeys::IsKeyDown(message)) {
+        return false;
+    }
+    ModifierState::Snapshot modifiers = self->_dispatcher.GetModifiers().Load();
+    if (Hotkeys::IsSelectionConversion(modifiers)) {
+        // Traces carry no selections; this only counts the requests
+        self->_engine.ConvertSelection();
+        ++self->_stats.selectionConversions;
+    } else {
+        self->Correct(Hotkeys::IsPhraseCorrection(modifiers));
+    }
+    return true;
+}
+
+bool TraceReplayer::OnRecordKey(void* context, UINT message, const KBDLLHOOKSTRUCT& event) {
+    auto* self = static_cast<TraceReplayer*>(context);
+    KeyEvent keyEvent;
+    if (InputStateMachine::MakeKeyEvent(message, event, self->_dispatcher.GetModifiers().Load(), keyEvent)) {
+        self->_engine.Process(keyEvent);
+        ++self->_stats.keystrokes;
+
+        // An auto-correction may have switched the layout
+        self->NoteLayoutChange();
+        self->_stats.injectedInputs = self->_backend.SentInputs().size();
+
+        if (self->_systemState.ForegroundLayout() != self->_backend.ActiveLayout()) {
+            ++self->_stats.staleLayoutReads;
+        }
+        if (self->_foreground.Window() != self->_backend.ForegroundWindow()) {
+            ++self->_stats.staleForegroundReads;
+        }
+    }
+    return false;
+}
+
+// As TrayApplication: the layout cached for the old window is stale
+void TraceReplayer::OnForegroundChange(void* context, HWND) {
+    auto* self = static_cast<TraceReplayer*>(context);
+    self->_systemState.OnEvent(SystemStateCache::EVENT_FOREGROUND_CHANGE);
+}
+
+void TraceReplayer::Correct(bool phrase) {
+    CorrectionEngine::Result result = phrase ? _engine.CorrectPhrase() : _engine.Correct();
+    NoteLayoutChange();
+
+    switch (result) {
+        case CorrectionEngine::Result::Nothing:
+            return;
+        case CorrectionEngine::Result::Refused:
+            ++_stats.refusedCorrections;
+            return;
+        case CorrectionEngine::Result::Unicode:
+            ++_stats.unicodePlans;
+            break;
+        case CorrectionEngine::Result::KeyReplay:
+            ++_stats.keyPlans;
+            break;
+    }
+    ++_stats.corrections;
+    if (phrase) {
+        ++_stats.phraseCorrections;
+    }
+    _stats.injectedInputs = _backend.SentInputs().size();
+}
+
+// The fake switches at once; the app learns of it from WM_INPUTLANGCHANGE
+void TraceReplayer::NoteLayoutChange() {
+    if (_backend.ActiveLayout() == _lastLayout) return;
+    _lastLayout = _backend.ActiveLayout();
+    _systemState.OnEvent(SystemStateCache::EVENT_INPUT_LANG_CHANGE);
+}
\ No newline at end of file
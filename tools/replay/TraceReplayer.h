@@ -0,0 +1,93 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "CorrectionEngine.h"
+#include "FakeBackend.h"
+#include "FakeForegroundSource.h"
+#include "FakeSystemState.h"
+#include "ForegroundTracker.h"
+#include "HookDispatcher.h"
+#include "InputTrace.h"
+#include "LanguageModel.h"
+#include "LayoutTable.h"
+#include "SystemStateCache.h"
+
+// Feeds trace records through the same path the app's hook and worker take:
+// the dispatcher with its modifier tracking and hotkey handlers, and the
+// correction engine. Only the OS is replaced, by a FakeBackend with the two
+// built-in layouts; corrections run synchronously instead of on a worker.
+// Every keystroke also reads the foreground layout from a SystemStateCache
+// fed with the focus and layout events the app would see, and the foreground
+// window from a ForegroundTracker fed with change events, to measure their
+// hit rates and catch reads that return stale values.
+class TraceReplayer {
+public:
+    static const size_t LAYOUT_COUNT = 2;
+
+    struct Stats {
+        size_t events = 0;
+        size_t keystrokes = 0;
+        size_t focusChanges = 0;
+        size_t mouseClicks = 0;
+        size_t corrections = 0;
+        size_t refusedCorrections = 0;
+        size_t phraseCorrections = 0;   // Shift+Pause, counted in corrections
+        size_t selectionConversions = 0;
+        size_t unicodePlans = 0;
+        size_t keyPlans = 0;
+        size_t injectedInputs = 0;
+        size_t layoutPolls = 0;
+        size_t staleLayoutReads = 0;
+        size_t foregroundEventsDropped = 0;
+        size_t staleForegroundReads = 0;
+    };
+
+    // As TrayApplication polls the foreground layout
+    static const uint32_t LAYOUT_POLL_MS = 150;
+
+    explicit TraceReplayer(size_t keystrokeCapacity);
+
+    // Optional models for the English and Russian layouts. Without them
+    // every correction goes to the other layout, as in the app.
+    void SetModel(size_t layout, const LanguageModel* model);
+    void SetAutoCorrect(const AutoCorrectOptions& options) { _engine.SetAutoCorrect(options); }
+
+    // Withholds every nth foreground change event, as the system sometimes
+    // does, so only the layout poll finds those changes. 0 delivers all.
+    void SetDroppedForegroundEvents(size_t every) { _dropEvery = every; }
+
+    void Reset();
+    void Feed(const TraceRecord& record);
+
+    const Stats& GetStats() const { return _stats; }
+    const CorrectionEngine::AutoCorrectStats& GetAutoCorrectStats() const { return _engine.GetAutoCorrectStats(); }
+    const InputStateMachine& State() const { return _engine.State(); }
+    const LayoutTable& ActiveTable() const;
+    const LatencyMetrics& Latency() const { return _dispatcher.GetLatency(); }
+    const SystemStateCache& SystemState() const { return _systemState; }
+    const ForegroundTracker& Foreground() const { return _foreground; }
+
+private:
+    static bool OnLayoutSwitchKey(void* context, UINT message, const KBDLLHOOKSTRUCT& event);
+    static bool OnCorrectionKey(void* context, UINT message, const KBDLLHOOKSTRUCT& event);
+    static bool OnRecordKey(void* context, UINT message, const KBDLLHOOKSTRUCT& event);
+    static void OnForegroundChange(void* context, HWND window);
+
+    void Correct(bool phrase);
+    void NoteLayoutChange();
+
+    HookDispatcher _dispatcher;
+    FakeBackend _backend;
+    CorrectionEngine _engine;
+    FakeSystemState _systemSource;
+    SystemStateCache _systemState;
+    FakeForegroundSource _foregroundSource;
+    ForegroundTracker _foreground;
+    size_t _dropEvery;
+    size_t _foregroundChanges;
+    HKL _lastLayout;
+    uint32_t _lastPoll;
+    LayoutTable _tables[LAYOUT_COUNT];
+    HKL _layouts[LAYOUT_COUNT];
+    Stats _stats;
+};
\ No newline at end of file
@@ -0,0 +1,295 @@
+#include "TraceSynthesizer.h"
+#include <fstream>
+#include "Win32Compat.h"
+
+namespace {
+
+const char16_t* const ENGLISH_WORDS[] = {
+    u"the", u"of", u"and", u"to", u"in", u"is", u"you", u"that", u"it", u"he",
+    u"was", u"for", u"on", u"are", u"as", u"with", u"his", u"they", u"at", u"be",
+    u"this", u"have", u"from", u"or", u"one", u"had", u"by", u"word", u"but", u"not",
+    u"what", u"all", u"were", u"we", u"when", u"your", u"can", u"said", u"there", u"use",
+    u"each", u"which", u"she", u"do", u"how", u"their", u"if", u"will", u"up", u"other",
+    u"about", u"out", u"many", u"then", u"them", u"these", u"so", u"some", u"her", u"would",
+    u"keyboard", u"layout", u"switch", u"correction", u"window", u"message", u"server", u"release",
+};
+
+// Common Russian words, written as escapes so the source stays ASCII
+const char16_t* const RUSSIAN_WORDS[] = {
+    u"\u043F\u0440\u0438\u0432\u0435\u0442", u"\u043A\u0430\u043A", u"\u0434\u0435\u043B\u0430",
+    u"\u0447\u0442\u043E", u"\u044D\u0442\u043E", u"\u0432\u0440\u0435\u043C\u044F",
+    u"\u0440\u0430\u0431\u043E\u0442\u0430", u"\u0447\u0435\u043B\u043E\u0432\u0435\u043A", u"\u0436\u0438\u0437\u043D\u044C",
+    u"\u0434\u0435\u043D\u044C", u"\u0440\u0443\u043A\u0430", u"\u0441\u043B\u043E\u0432\u043E",
+    u"\u043C\u0435\u0441\u0442\u043E", u"\u043B\u0438\u0446\u043E", u"\u0434\u0440\u0443\u0433",
+    u"\u0433\u043B\u0430\u0437", u"\u0432\u043E\u043F\u0440\u043E\u0441", u"\u0434\u043E\u043C",
+    u"\u0441\u0442\u043E\u0440\u043E\u043D\u0430", u"\u0441\u0442\u0440\u0430\u043D\u0430", u"\u043C\u0438\u0440",
+    u"\u0441\u043B\u0443\u0447\u0430\u0439", u"\u0433\u043E\u043B\u043E\u0432\u0430", u"\u0440\u0435\u0431\u0435\u043D\u043E\u043A",
+    u"\u0441\u0438\u043B\u0430", u"\u043A\u043E\u043D\u0435\u0446", u"\u0432\u0438\u0434",
+    u"\u0441\u0438\u0441\u0442\u0435\u043C\u0430", u"\u0447\u0430\u0441\u0442\u044C", u"\u0433\u043E\u0440\u043E\u0434",
+    u"\u043E\u0442\u043D\u043E\u0448\u0435\u043D\u0438\u0435", u"\u0436\u0435\u043D\u0449\u0438\u043D\u0430", u"\u0434\u0435\u043D\u044C\u0433\u0438",
+    u"\u0437\u0435\u043C\u043B\u044F", u"\u043C\u0430\u0448\u0438\u043D\u0430", u"\u0432\u043E\u0434\u0430",
+    u"\u043E\u0442\u0435\u0446", u"\u043F\u0440\u043E\u0431\u043B\u0435\u043C\u0430", u"\u0447\u0430\u0441",
+    u"\u043F\u0440\u0430\u0432\u043E", u"\u043D\u043E\u0433\u0430", u"\u0440\u0435\u0448\u0435\u043D\u0438\u0435",
+    u"\u0434\u0432\u0435\u0440\u044C", u"\u043E\u0431\u0440\u0430\u0437", u"\u0438\u0441\u0442\u043E\u0440\u0438\u044F",
+};
+
+const char16_t* const LONG_RUNS[] = {
+    u"https://example.com/projects/kswitcher/issues?state=open&sort=updated&direction=desc&page=3",
+    u"KeyboardInterceptor::PerformLayoutCorrection_with_a_deliberately_long_identifier_name_v2",
+    u"C:\\Users\\someone\\AppData\\Roaming\\LayoutSwitcher\\traces\\trace-20240101-120000.kstr",
+    u"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+    u"0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef",
+};
+
+const size_t ENGLISH_WORD_COUNT = sizeof(ENGLISH_WORDS) / sizeof(ENGLISH_WORDS[0]);
+const size_t RUSSIAN_WORD_COUNT = sizeof(RUSSIAN_WORDS) / sizeof(RUSSIAN_WORDS[0]);
+const size_t LONG_RUN_COUNT = sizeof(LONG_RUNS) / sizeof(LONG_RUNS[0]);
+
+const uint32_t WINDOW_EDITOR = 0x00010A2C;
+const uint32_t WINDOW_CHAT = 0x00020B3E;
+
+// Plain English prose in one window, with typos fixed by backspace and
+// line breaks. Measures the recording path alone.
+std::vector<uint8_t> TypingEnglishScenario() {
+    TraceSynthesizer trace(1);
+    LayoutTable english = LayoutTable::EnglishUS();
+    trace.Focus(WINDOW_EDITOR);
+
+    for (int word = 0; word < 400; ++word) {
+        std::u16string text = ENGLISH_WORDS[trace.Random(ENGLISH_WORD_COUNT)];
+        if (word % 12 == 0) text[0] = static_cast<char16_t>(text[0] - u'a' + u'A');
+
+        if (trace.Random(10) == 0) {
+            trace.Type(u"xq", english);
+            trace.Tap(VK_BACK);
+            trace.Tap(VK_BACK);
+        }
+        trace.Type(text, english);
+
+        if (word % 12 == 11) {
+            trace.Type(u".", english);
+            trace.Tap(VK_RETURN);
+        } else {
+            trace.Type(u" ", english);
+        }
+    }
+    return trace.Finish();
+}
+
+// Russian words typed on the English layout and fixed with Pause, sometimes
+// after the trailing space and sometimes pressed twice to cycle back.
+std::vector<uint8_t> WrongLayoutScenario() {
+    TraceSynthesizer trace(2);
+    LayoutTable russian = LayoutTable::RussianRU();
+    trace.Focus(WINDOW_CHAT);
+
+    for (int word = 0; word < 300; ++word) {
+        trace.Type(RUSSIAN_WORDS[trace.Random(RUSSIAN_WORD_COUNT)], russian);
+
+        switch (trace.Random(4)) {
+            case 0:
+                trace.Type(u" ", russian);
+                trace.Tap(VK_PAUSE);
+                break;
+            case 1:
+                trace.Tap(VK_PAUSE);
+                trace.Tap(VK_PAUSE);
+                trace.Type(u" ", russian);
+                break;
+            default:
+                trace.Tap(VK_PAUSE);
+                trace.Type(u" ", russian);
+                break;
+        }
+    }
+    return trace.Finish();
+}
+
+// A word started in one window, a detour through another via Alt+Tab, then
+// the word finished and corrected where it was started.
+std::vector<uint8_t> AltTabScenario() {
+    TraceSynthesizer trace(3);
+    LayoutTable english = LayoutTable::EnglishUS();
+    LayoutTable russian = LayoutTable::RussianRU();
+    trace.Focus(WINDOW_EDITOR);
+
+    for (int round = 0; round < 200; ++round) {
+        std::u16string word = RUSSIAN_WORDS[trace.Random(RUSSIAN_WORD_COUNT)];
+        size_t split = word.size() / 2;
+
+        trace.Type(word.substr(0, split), russian);
+        trace.AltTab(WINDOW_CHAT);
+        trace.Type(ENGLISH_WORDS[trace.Random(ENGLISH_WORD_COUNT)], english);
+        trace.Type(u" ", english);
+        trace.AltTab(WINDOW_EDITOR);
+        trace.Type(word.substr(split), russian);
+        trace.Tap(VK_PAUSE);
+        trace.Type(u" ", russian);
+    }
+    return trace.Finish();
+}
+
+// URLs, paths and identifiers far longer than the keystroke ring
+std::vector<uint8_t> LongRunsScenario() {
+    TraceSynthesizer trace(4);
+    LayoutTable english = LayoutTable::EnglishUS();
+    trace.Focus(WINDOW_EDITOR);
+
+    for (int run = 0; run < 40; ++run) {
+        trace.Type(LONG_RUNS[trace.Random(LONG_RUN_COUNT)], english);
+        if (trace.Random(2) == 0) trace.Tap(VK_PAUSE);
+        trace.Tap(VK_RETURN);
+    }
+    return trace.Finish();
+}
+
+// Everything that clears or bypasses the buffer: clicks, navigation,
+// shortcuts, Caps Lock, and focus moving across many windows
+std::vector<uint8_t> MixedScenario() {
+    TraceSynthesizer trace(5);
+    LayoutTable english = LayoutTable::EnglishUS();
+    LayoutTable russian = LayoutTable::RussianRU();
+    trace.Focus(WINDOW_EDITOR);
+
+    static const uint8_t navigation[] = { VK_LEFT, VK_RIGHT, VK_UP, VK_DOWN, VK_HOME, VK_END, VK_ESCAPE, VK_TAB };
+    static const uint8_t shortcuts[] = { 'C', 'V', 'Z', 'S', 'A' };
+
+    for (int step = 0; step < 600; ++step) {
+        switch (trace.Random(10)) {
+            case 0:
+                trace.Click();
+                break;
+            case 1:
+                trace.Tap(navigation[trace.Random(sizeof(navigation))]);
+                break;
+            case 2:
+                trace.Chord(VK_LCONTROL, shortcuts[trace.Random(sizeof(shortcuts))]);
+                break;
+            case 3:
+                trace.Tap(VK_CAPITAL);
+                trace.Type(ENGLISH_WORDS[trace.Random(ENGLISH_WORD_COUNT)], english);
+                trace.Tap(VK_CAPITAL);
+                break;
+            case 4:
+                trace.Focus(0x00030000 + trace.Random(48) * 0x10);
+                break;
+            case 5:
+                trace.Tap(VK_PAUSE);
+                break;
+            case 6:
+                trace.Type(RUSSIAN_WORDS[trace.Random(RUSSIAN_WORD_COUNT)], russian);
+                break;
+            default:
+                trace.Type(ENGLISH_WORDS[trace.Random(ENGLISH_WORD_COUNT)], english);
+                trace.Type(u" ", english);
+                break;
+        }
+    }
+    return trace.Finish();
+}
+
+} // namespace
+
+TraceSynthesizer::TraceSynthesizer(uint32_t seed)
+    : _writer(MAX_RECORDS), _state(seed * 2654435761u + 1), _time(1000), _window(0) {
+}
+
+uint32_t TraceSynthesizer::Random(uint32_t bound) {
+    // xorshift32, stable across compilers and standard libraries
+    _state ^= _state << 13;
+    _state ^= _state >> 17;
+    _state ^= _state << 5;
+    return bound ? _state % bound : 0;
+}
+
+void TraceSynthesizer::Press(uint8_t virtualKey, bool keyUp, uint8_t extraFlags) {
+    // Fast typist: 40-160 ms between events
+    _time += 40 + Random(120);
+
+    TraceRecord record;
+    record.time = _time;
+    record.window = _window;
+    record.scanCode = virtualKey == VK_LSHIFT ? 0x2A : 0;
+    record.virtualKey = virtualKey;
+    record.flags = static_cast<uint8_t>(extraFlags | (keyUp ? LLKHF_UP : 0));
+    _writer.Append(record);
+}
+
+void TraceSynthesizer::Focus(uint32_t window) {
+    _window = window;
+}
+
+void TraceSynthesizer::Type(const std::u16string& text, const LayoutTable& layout) {
+    bool shiftDown = false;
+    for (char16_t ch : text) {
+        int virtualKey;
+        bool shift;
+        if (!layout.FindKey(ch, virtualKey, shift)) continue;
+
+        if (shift != shiftDown) {
+            Press(VK_LSHIFT, shiftDown);
+            shiftDown = shift;
+        }
+        Press(static_cast<uint8_t>(virtualKey), false);
+        Press(static_cast<uint8_t>(virtualKey), true);
+    }
+    if (shiftDown) Press(VK_LSHIFT, true);
+}
+
+void TraceSynthesizer::Tap(uint8_t virtualKey) {
+    Press(virtualKey, false);
+    Press(virtualKey, true);
+}
+
+void TraceSynthesizer::Chord(uint8_t modifier, uint8_t virtualKey) {
+    Press(modifier, false);
+    Tap(virtualKey);
+    Press(modifier, true);
+}
+
+void TraceSynthesizer::AltTab(uint32_t nextWindow) {
+    Press(VK_LMENU, false, LLKHF_ALTDOWN);
+    Press(VK_TAB, false, LLKHF_ALTDOWN);
+    Press(VK_TAB, true, LLKHF_ALTDOWN);
+    // Focus moves while Alt is still held
+    _window = nextWindow;
+    Press(VK_LMENU, true);
+}
+
+void TraceSynthesizer::Click() {
+    _time += 200 + Random(400);
+
+    TraceRecord record;
+    record.time = _time;
+    record.window = _window;
+    record.scanCode = 0;
+    record.virtualKey = VK_LBUTTON;
+    record.flags = 0;
+    _writer.Append(record);
+}
+
+bool TraceSynthesizer::WriteCorpus(const std::string& directory, std::string& error) {
+    struct Scenario {
+        const char* name;
+        std::vector<uint8_t> (*build)();
+    };
+    static const Scenario scenarios[] = {
+        { "typing-en", TypingEnglishScenario },
+        { "wrong-layout", WrongLayoutScenario },
+        { "alt-tab", AltTabScenario },
+        { "long-runs", LongRunsScenario },
+        { "mixed", MixedScenario },
+    };
+
+    for (const auto& scenario : scenarios) {
+        std::string path = directory + "/" + scenario.name + ".kstr";
+        std::vector<uint8_t> data = scenario.build();
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open() || !file.write(reinterpret_cast<const char*>(data.data()), data.size())) {
+            error = "cannot write " + path;
+            return false;
+        }
+    }
+    return true;
+}
\ No newline at end of file
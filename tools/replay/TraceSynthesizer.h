@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "InputTrace.h"
+#include "LayoutTable.h"
+
+// Generates deterministic input traces for the replay corpus. Every trace is
+// a pure function of its seed, so the corpus can be regenerated bit for bit.
+class TraceSynthesizer {
+public:
+    explicit TraceSynthesizer(uint32_t seed);
+
+    void Focus(uint32_t window);
+
+    // Types text with the keys that produce it in layout, pressing Shift
+    // around runs of shifted characters. Characters the layout lacks are
+    // skipped.
+    void Type(const std::u16string& text, const LayoutTable& layout);
+
+    void Tap(uint8_t virtualKey);
+    void Chord(uint8_t modifier, uint8_t virtualKey);
+    void AltTab(uint32_t nextWindow);
+    void Click();
+
+    std::vector<uint8_t> Finish() const { return _writer.Serialize(); }
+
+    uint32_t Random(uint32_t bound);
+
+    // Writes every built-in scenario as <directory>/<name>.kstr
+    static bool WriteCorpus(const std::string& directory, std::string& error);
+
+private:
+    static const size_t MAX_RECORDS = 1 << 20;
+
+    void Press(uint8_t virtualKey, bool keyUp, uint8_t extraFlags = 0);
+
+    InputTraceWriter _writer;
+    uint32_t _state;
+    uint32_t _time;
+    uint32_t _window;
+};
\ No newline at end of file
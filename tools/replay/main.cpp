@@ -0,0 +1,437 @@
+// kswitcher-replay: runs recorded input traces through the interceptor state
+// machine and reports throughput, per-event latency and the buffers left in
+// every window. Also measures what the app's latency histograms cost, and
+// checks the corrections and buffers a few short traces must leave.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "FakeForegroundSource.h"
+#include "InputTrace.h"
+#include "LanguageModel.h"
+#include "LatencyHistogram.h"
+#include "MappedFile.h"
+#include "ToolSupport.h"
+#include "TraceReplayer.h"
+#include "TraceSynthesizer.h"
+
+namespace {
+
+// Repeat short traces until at least this many events were replayed
+const size_t MIN_THROUGHPUT_EVENTS = 2000000;
+
+void PrintUsage() {
+    printf("Usage:\n"
+           "  kswitcher-replay [options] <trace.kstr>...\n"
+           "  kswitcher-replay --synthesize <directory>\n"
+           "  kswitcher-replay --check\n"
+           "\n"
+           "Options:\n"
+           "  --capacity <n>       keystrokes kept per window (default %zu)\n"
+           "  --model-en <file>    English model, enables dictionary decisions\n"
+           "  --model-ru <file>    Russian model\n"
+           "  --auto               correct words as they end, as with autoCorrect.enabled\n"
+           "  --drop-foreground <n> withhold every nth foreground change event\n"
+           "  --quiet              skip the per-window buffer dump\n",
+           KeystrokeRing::DEFAULT_CAPACITY);
+}
+
+std::string ToUtf8(const std::u16string& text) {
+    std::string out;
+    for (char16_t ch : text) {
+        if (ch < 0x80) {
+            out += static_cast<char>(ch);
+        } else if (ch < 0x800) {
+            out += static_cast<char>(0xC0 | (ch >> 6));
+            out += static_cast<char>(0x80 | (ch & 0x3F));
+        } else {
+            out += static_cast<char>(0xE0 | (ch >> 12));
+            out += static_cast<char>(0x80 | ((ch >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (ch & 0x3F));
+        }
+    }
+    return out;
+}
+
+std::string Render(const KeystrokeRing& ring, const LayoutTable& table) {
+    std::u16string text;
+    const KeystrokeInfo* keystrokes = ring.Data();
+    for (size_t i = 0; i < ring.Size(); ++i) {
+        char16_t ch = table.Translate(keystrokes[i].VirtualKey(), keystrokes[i].Shift(), keystrokes[i].CapsLock());
+        text += ch ? ch : u'?';
+    }
+    return ToUtf8(text);
+}
+
+double Percentile(const std::vector<uint32_t>& sorted, double fraction) {
+    if (sorted.empty()) return 0;
+    size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+// Clock read cost, included in every per-event sample
+double TimerOverhead() {
+    const int samples = 100000;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < samples; ++i) {
+        Clock::now();
+    }
+    return Seconds(start) * 1e9 / samples;
+}
+
+// Cost the app pays per timed hook callback or correction phase: the
+// histogram update alone, and with the clock read that ends the interval
+void HistogramOverhead(double& recordNs, double& recordSinceNs) {
+    const uint32_t samples = 10000000;
+    LatencyHistogram histogram;
+
+    // Spread values over the buckets a hook actually hits
+    uint32_t value = 1;
+    Clock::time_point start = Clock::now();
+    for (uint32_t i = 0; i < samples; ++i) {
+        value ^= value << 13;
+        value ^= value >> 17;
+        value ^= value << 5;
+        histogram.Record(value & 0xFFFF);
+    }
+    recordNs = Seconds(start) * 1e9 / samples;
+
+    uint64_t ticks = LatencyClock::Now();
+    start = Clock::now();
+    for (uint32_t i = 0; i < samples; ++i) {
+        ticks = histogram.RecordSince(ticks);
+    }
+    recordSinceNs = Seconds(start) * 1e9 / samples;
+
+    LatencyHistogram::Snapshot snapshot;
+    histogram.Read(snapshot);
+    if (snapshot.count != 2 * samples) {
+        fprintf(stderr, "warning: histogram counted %llu of %u samples\n",
+                static_cast<unsigned long long>(snapshot.count), 2 * samples);
+    }
+}
+
+// A tracked foreground read, what the hooks and the worker pay per key, and
+// an untracked one through the source's virtual call (on Windows, a user32
+// call instead)
+void ForegroundReadCost(double& trackedNs, double& queriedNs) {
+    const uint32_t samples = 10000000;
+    FakeBackend backend;
+    FakeForegroundSource source(backend);
+    ForegroundTracker tracker(source);
+    source.SetForeground(reinterpret_cast<HWND>(1));
+
+    volatile uintptr_t sink = 0;
+    Clock::time_point start = Clock::now();
+    for (uint32_t i = 0; i < samples; ++i) {
+        sink = reinterpret_cast<uintptr_t>(tracker.Window());
+    }
+    queriedNs = Seconds(start) * 1e9 / samples;
+
+    tracker.Start();
+    start = Clock::now();
+    for (uint32_t i = 0; i < samples; ++i) {
+        sink = reinterpret_cast<uintptr_t>(tracker.Window());
+    }
+    trackedNs = Seconds(start) * 1e9 / samples;
+    (void)sink;
+}
+
+// Windows the checks type into
+const uint32_t WINDOW_EDITOR = 0x00010A2C;
+const uint32_t WINDOW_CHAT = 0x00020B3E;
+
+void Feed(TraceReplayer& replayer, const std::vector<uint8_t>& data) {
+    InputTrace trace;
+    replayer.Reset();
+    if (!trace.Attach(data.data(), data.size())) return;
+    for (size_t i = 0; i < trace.Count(); ++i) {
+        replayer.Feed(trace.Records()[i]);
+    }
+}
+
+const WindowBuffer* Buffer(const TraceReplayer& replayer, uint32_t window) {
+    const WindowBufferCache& windows = replayer.State().Windows();
+    for (size_t i = 0; i < windows.Size(); ++i) {
+        if (windows.WindowAt(i) == window) return &windows.BufferAt(i);
+    }
+    return nullptr;
+}
+
+bool LastCorrected(const TraceReplayer& replayer, uint32_t window, const std::u16string& text) {
+    const WindowBuffer* buffer = Buffer(replayer, window);
+    return buffer && Render(buffer->LastCorrected(), replayer.ActiveTable()) == ToUtf8(text);
+}
+
+// Every window's buffers, rendered in the active layout
+std::string Buffers(const TraceReplayer& replayer) {
+    const WindowBufferCache& windows = replayer.State().Windows();
+    std::string text;
+    for (size_t i = 0; i < windows.Size(); ++i) {
+        const WindowBuffer& buffer = windows.BufferAt(i);
+        text += std::to_string(windows.WindowAt(i)) + ' ' + Render(buffer.Typing(), replayer.ActiveTable()) + ' ' +
+                Render(buffer.LastCorrected(), replayer.ActiveTable()) + '\n';
+    }
+    return text;
+}
+
+bool SameStats(const TraceReplayer::Stats& a, const TraceReplayer::Stats& b) {
+    return a.events == b.events && a.keystrokes == b.keystrokes && a.focusChanges == b.focusChanges &&
+           a.corrections == b.corrections && a.refusedCorrections == b.refusedCorrections &&
+           a.unicodePlans == b.unicodePlans && a.keyPlans == b.keyPlans && a.injectedInputs == b.injectedInputs;
+}
+
+int Check() {
+    bool ok = true;
+    LayoutTable english = LayoutTable::EnglishUS();
+    LayoutTable russian = LayoutTable::RussianRU();
+    TraceReplayer replayer(KeystrokeRing::DEFAULT_CAPACITY);
+
+    {
+        TraceSynthesizer trace(1);
+        trace.Focus(WINDOW_EDITOR);
+        trace.Type(u"ghbdtn", english);
+        trace.Tap(VK_PAUSE);
+        Feed(replayer, trace.Finish());
+        bool corrected = replayer.GetStats().corrections == 1 && replayer.GetStats().injectedInputs > 0 &&
+                         LastCorrected(replayer, WINDOW_EDITOR, u"привет");
+        trace.Tap(VK_PAUSE);
+        Feed(replayer, trace.Finish());
+        corrected = replayer.GetStats().corrections == 2 && LastCorrected(replayer, WINDOW_EDITOR, u"ghbdtn") &&
+                    corrected;
+        ok = Report("Pause corrects the word, and again takes it back", corrected) && ok;
+    }
+
+    // A word started before Alt+Tab is finished after it; the keys typed in
+    // between belong to the other window. The replayer keeps what the first
+    // check taught it, so this uses another word.
+    {
+        TraceSynthesizer trace(2);
+        trace.Focus(WINDOW_EDITOR);
+        trace.Type(u"ckj", english);
+        trace.AltTab(WINDOW_CHAT);
+        trace.Type(u"hello", english);
+        trace.AltTab(WINDOW_EDITOR);
+        trace.Type(u"dj", english);
+        trace.Tap(VK_PAUSE);
+        Feed(replayer, trace.Finish());
+        const WindowBuffer* chat = Buffer(replayer, WINDOW_CHAT);
+        bool split = replayer.GetStats().focusChanges == 3 && LastCorrected(replayer, WINDOW_EDITOR, u"слово") &&
+                     chat && Render(chat->Typing(), english) == "hello";
+        ok = Report("each window keeps its own keys across Alt+Tab", split) && ok;
+    }
+
+    // A long mixed trace, with foreground events withheld: every read stays
+    // current, and replaying it again leaves the same state
+    {
+        TraceSynthesizer trace(3);
+        trace.Focus(WINDOW_EDITOR);
+        for (int word = 0; word < 500; ++word) {
+            trace.Type(trace.Random(2) ? u"ghbdtn" : u"руддщ", trace.Random(2) ? english : russian);
+            if (trace.Random(3) == 0) trace.Tap(VK_PAUSE);
+            if (trace.Random(5) == 0) trace.AltTab(trace.Random(2) ? WINDOW_CHAT : WINDOW_EDITOR);
+            if (trace.Random(20) == 0) trace.Click();
+            trace.Type(u" ", english);
+        }
+        std::vector<uint8_t> data = trace.Finish();
+        replayer.SetDroppedForegroundEvents(3);
+        Feed(replayer, data);
+        TraceReplayer::Stats first = replayer.GetStats();
+        std::string buffers = Buffers(replayer);
+        Feed(replayer, data);
+        const TraceReplayer::Stats& second = replayer.GetStats();
+        replayer.SetDroppedForegroundEvents(0);
+        ok = Report("state reads are never stale", second.staleLayoutReads == 0 &&
+                    second.staleForegroundReads == 0 && second.foregroundEventsDropped > 0) && ok;
+        ok = Report("replaying again gives the same result",
+                    first.corrections > 0 && SameStats(first, second) && Buffers(replayer) == buffers) && ok;
+    }
+
+    return ok ? 0 : 1;
+}
+
+void Replay(const std::string& path, const InputTrace& trace, TraceReplayer& replayer, bool quiet) {
+    const TraceRecord* records = trace.Records();
+    size_t count = trace.Count();
+    if (count == 0) {
+        printf("%s: empty trace\n\n", path.c_str());
+        return;
+    }
+
+    // Throughput: whole passes, no per-event timing
+    size_t passes = std::max<size_t>(1, (MIN_THROUGHPUT_EVENTS + count - 1) / count);
+    Clock::time_point start = Clock::now();
+    for (size_t pass = 0; pass < passes; ++pass) {
+        replayer.Reset();
+        for (size_t i = 0; i < count; ++i) {
+            replayer.Feed(records[i]);
+        }
+    }
+    double seconds = Seconds(start);
+    double eventsPerSecond = passes * count / seconds;
+
+    // Latency: one pass, every event timed
+    std::vector<uint32_t> latencies(count);
+    LatencyHistogram histogram;
+    replayer.Reset();
+    for (size_t i = 0; i < count; ++i) {
+        Clock::time_point before = Clock::now();
+        replayer.Feed(records[i]);
+        latencies[i] = static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - before).count());
+        histogram.Record(latencies[i]);
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    // The same samples through the app's histogram, to see its bucket error
+    LatencyHistogram::Snapshot snapshot;
+    histogram.Read(snapshot);
+
+    const TraceReplayer::Stats& stats = replayer.GetStats();
+    printf("%s\n", path.c_str());
+    printf("  events:       %zu (%zu keystrokes, %zu clicks, %zu focus changes)\n",
+           stats.events, stats.keystrokes, stats.mouseClicks, stats.focusChanges);
+    printf("  corrections:  %zu (%zu unicode, %zu key replay, %zu refused), %zu inputs injected\n",
+           stats.corrections, stats.unicodePlans, stats.keyPlans, stats.refusedCorrections, stats.injectedInputs);
+    if (stats.phraseCorrections) {
+        printf("  phrases:      %zu Shift+Pause corrections\n", stats.phraseCorrections);
+    }
+    if (stats.selectionConversions) {
+        printf("  selections:   %zu Alt+Pause presses\n", stats.selectionConversions);
+    }
+    const CorrectionEngine::AutoCorrectStats& autoStats = replayer.GetAutoCorrectStats();
+    if (autoStats.words) {
+        printf("  auto-correct: %zu words, %zu corrected, %zu undone\n",
+               autoStats.words, autoStats.corrections, autoStats.undos);
+    }
+    const SystemStateCache::Counters& layoutReads =
+        replayer.SystemState().GetCounters(SystemStateCache::ITEM_FOREGROUND_LAYOUT);
+    printf("  state cache:  %llu layout reads, %.1f%% hits, %llu refreshes (%zu polls), %zu stale\n",
+           static_cast<unsigned long long>(layoutReads.reads),
+           layoutReads.reads ? 100.0 * layoutReads.hits / layoutReads.reads : 0.0,
+           static_cast<unsigned long long>(layoutReads.refreshes), stats.layoutPolls, stats.staleLayoutReads);
+    const ForegroundTracker::Counters& foreground = replayer.Foreground().GetCounters();
+    printf("  foreground:   %llu events (%zu withheld), %llu changes, %llu found by polls, %zu stale reads\n",
+           static_cast<unsigned long long>(foreground.events), stats.foregroundEventsDropped,
+           static_cast<unsigned long long>(foreground.changes),
+           static_cast<unsigned long long>(foreground.missed), stats.staleForegroundReads);
+    printf("  throughput:   %.2f M events/s, %.1f ns/event over %zu passes\n",
+           eventsPerSecond / 1e6, 1e9 / eventsPerSecond, passes);
+    printf("  latency ns:   p50 %.0f  p90 %.0f  p99 %.0f  p99.9 %.0f  max %u\n",
+           Percentile(latencies, 0.50), Percentile(latencies, 0.90), Percentile(latencies, 0.99),
+           Percentile(latencies, 0.999), latencies.back());
+    printf("  histogram ns: p50 %llu  p90 %llu  p99 %llu  p99.9 %llu  max %llu\n",
+           static_cast<unsigned long long>(snapshot.Percentile(0.50)),
+           static_cast<unsigned long long>(snapshot.Percentile(0.90)),
+           static_cast<unsigned long long>(snapshot.Percentile(0.99)),
+           static_cast<unsigned long long>(snapshot.Percentile(0.999)),
+           static_cast<unsigned long long>(snapshot.max));
+
+    if (!quiet) {
+        const WindowBufferCache& windows = replayer.State().Windows();
+        printf("  windows:      %zu\n", windows.Size());
+        for (size_t i = 0; i < windows.Size(); ++i) {
+            const WindowBuffer& buffer = windows.BufferAt(i);
+            if (buffer.Typing().IsEmpty() && buffer.LastCorrected().IsEmpty()) continue;
+
+            printf("    %08zx typed \"%s\" last corrected \"%s\" corrections %d%s\n",
+                   static_cast<size_t>(windows.WindowAt(i)),
+                   Render(buffer.Typing(), replayer.ActiveTable()).c_str(),
+                   Render(buffer.LastCorrected(), replayer.ActiveTable()).c_str(),
+                   buffer.correctionCount, buffer.correctionRefused ? " refused" : "");
+        }
+    }
+    printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t capacity = KeystrokeRing::DEFAULT_CAPACITY;
+    std::string modelPaths[TraceReplayer::LAYOUT_COUNT];
+    std::vector<std::string> traces;
+    bool quiet = false;
+    AutoCorrectOptions autoCorrect;
+    size_t dropForeground = 0;
+
+    if (argc == 2 && strcmp(argv[1], "--check") == 0) {
+        return Check();
+    }
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (strcmp(arg, "--synthesize") == 0 && value) {
+            std::string error;
+            if (!TraceSynthesizer::WriteCorpus(value, error)) {
+                fprintf(stderr, "error: %s\n", error.c_str());
+                return 1;
+            }
+            return 0;
+        } else if (strcmp(arg, "--capacity") == 0 && value) {
+            capacity = static_cast<size_t>(strtoul(value, nullptr, 10));
+            ++i;
+        } else if (strcmp(arg, "--model-en") == 0 && value) {
+            modelPaths[0] = value;
+            ++i;
+        } else if (strcmp(arg, "--model-ru") == 0 && value) {
+            modelPaths[1] = value;
+            ++i;
+        } else if (strcmp(arg, "--drop-foreground") == 0 && value) {
+            dropForeground = static_cast<size_t>(strtoul(value, nullptr, 10));
+            ++i;
+        } else if (strcmp(arg, "--auto") == 0) {
+            autoCorrect.enabled = true;
+        } else if (strcmp(arg, "--quiet") == 0) {
+            quiet = true;
+        } else if (arg[0] == '-') {
+            PrintUsage();
+            return 1;
+        } else {
+            traces.push_back(arg);
+        }
+    }
+
+    if (traces.empty()) {
+        PrintUsage();
+        return 1;
+    }
+
+    TraceReplayer replayer(capacity);
+    replayer.SetAutoCorrect(autoCorrect);
+    replayer.SetDroppedForegroundEvents(dropForeground);
+    LanguageModel models[TraceReplayer::LAYOUT_COUNT];
+    for (size_t i = 0; i < TraceReplayer::LAYOUT_COUNT; ++i) {
+        if (modelPaths[i].empty()) continue;
+        if (!models[i].Open(MappedFile::PathFromUtf8(modelPaths[i]))) {
+            fprintf(stderr, "error: %s is not a valid model\n", modelPaths[i].c_str());
+            return 1;
+        }
+        replayer.SetModel(i, &models[i]);
+    }
+
+    double recordNs, recordSinceNs;
+    HistogramOverhead(recordNs, recordSinceNs);
+    printf("timer overhead: %.1f ns per sample, included in latencies\n", TimerOverhead());
+    printf("histogram:      %.1f ns per record, %.1f ns with the clock read\n", recordNs, recordSinceNs);
+    double trackedNs, queriedNs;
+    ForegroundReadCost(trackedNs, queriedNs);
+    printf("foreground:     %.2f ns per tracked read, %.2f ns asking the source\n\n", trackedNs, queriedNs);
+
+    int result = 0;
+    for (const auto& path : traces) {
+        MappedFile file;
+        InputTrace trace;
+        if (!file.Open(MappedFile::PathFromUtf8(path)) || !trace.Attach(file.Data(), file.Size())) {
+            fprintf(stderr, "error: %s is not a valid trace\n", path.c_str());
+            result = 1;
+            continue;
+        }
+        Replay(path, trace, replayer, quiet);
+    }
+    return result;
+}
\ No newline at end of file
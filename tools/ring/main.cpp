@@ -0,0 +1,214 @@
+// kswitcher-ring: checks the hook-to-worker event ring through wraparound,
+// overflow and two threads, and measures push and drain per event.
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include "KeyEventRing.h"
+#include "ToolSupport.h"
+
+namespace {
+
+const size_t BATCH = 64;       // As KeyboardInterceptor drains
+
+void PrintUsage() {
+    printf("Usage:\n"
+           "  kswitcher-ring --check\n"
+           "  kswitcher-ring --bench\n");
+}
+
+// Events carry their sequence number in time, so order can be checked
+KeyEvent Numbered(uint32_t sequence) {
+    KeyEvent event = {};
+    event.virtualKey = static_cast<uint16_t>('A' + sequence % 26);
+    event.flags = KeyEvent::KeyDown;
+    event.time = sequence;
+    return event;
+}
+
+// Pops everything, checking the events continue from next
+bool DrainInOrder(KeyEventRing& ring, uint32_t& next) {
+    KeyEvent batch[BATCH];
+    size_t count;
+    while ((count = ring.PopBatch(batch, BATCH)) > 0) {
+        for (size_t i = 0; i < count; ++i) {
+            if (batch[i].time != next++) return false;
+        }
+    }
+    return true;
+}
+
+int Check() {
+    bool ok = true;
+
+    {
+        std::unique_ptr<KeyEventRing> ring(new KeyEventRing());
+        KeyEvent batch[BATCH];
+        bool empty = ring->IsEmpty() && ring->PopBatch(batch, BATCH) == 0;
+        ring->Push(Numbered(0));
+        empty = empty && !ring->IsEmpty();
+        uint32_t next = 0;
+        empty = empty && DrainInOrder(*ring, next) && ring->IsEmpty() && next == 1;
+        ok = Report("empty ring pops nothing", empty) && ok;
+    }
+
+    // Uneven pushes and pops carry the indices many times round
+    {
+        std::unique_ptr<KeyEventRing> ring(new KeyEventRing());
+        Random random(0x9E3779B97F4A7C15ull);
+        uint32_t pushed = 0;
+        uint32_t next = 0;
+        bool ordered = true;
+        while (pushed < KeyEventRing::CAPACITY * 50) {
+            size_t burst = random.Below(KeyEventRing::CAPACITY);
+            for (size_t i = 0; i < burst; ++i) {
+                ordered = ring->Push(Numbered(pushed++)) && ordered;
+            }
+            KeyEvent batch[BATCH];
+            size_t take = random.Below(BATCH) + 1;
+            size_t rounds = random.Below(static_cast<uint32_t>(burst / take + 2));
+            for (size_t i = 0; i < rounds; ++i) {
+                size_t count = ring->PopBatch(batch, take);
+                for (size_t j = 0; j < count; ++j) {
+                    ordered = batch[j].time == next++ && ordered;
+                }
+            }
+            ordered = DrainInOrder(*ring, next) && ordered;
+        }
+        ok = Report("events keep their order across wraparound",
+                    ordered && next == pushed && ring->OverflowCount() == 0) && ok;
+    }
+
+    // A full ring refuses new events, counts each one and keeps the old
+    {
+        std::unique_ptr<KeyEventRing> ring(new KeyEventRing());
+        bool accepted = true;
+        for (uint32_t i = 0; i < KeyEventRing::CAPACITY; ++i) {
+            accepted = ring->Push(Numbered(i)) && accepted;
+        }
+        bool refused = true;
+        for (uint32_t i = 0; i < 5; ++i) {
+            refused = !ring->Push(Numbered(0xFFFF)) && refused;
+        }
+        ok = Report("full ring refuses and counts each overflow",
+                    accepted && refused && ring->OverflowCount() == 5) && ok;
+
+        uint32_t next = 0;
+        bool kept = DrainInOrder(*ring, next) && next == KeyEventRing::CAPACITY;
+        ok = Report("refused events leave the queued ones intact", kept) && ok;
+
+        kept = ring->Push(Numbered(next));
+        kept = DrainInOrder(*ring, next) && kept;
+        ok = Report("a drained ring accepts events again", kept && ring->OverflowCount() == 5) && ok;
+    }
+
+    // The mark is the deepest backlog a drain found, and only grows
+    {
+        std::unique_ptr<KeyEventRing> ring(new KeyEventRing());
+        uint32_t pushed = 0;
+        uint32_t next = 0;
+        bool marks = true;
+        const size_t depths[] = { 3, 200, 17 };
+        for (size_t depth : depths) {
+            for (size_t i = 0; i < depth; ++i) ring->Push(Numbered(pushed++));
+            marks = DrainInOrder(*ring, next) && marks;
+        }
+        ok = Report("high-water mark is the deepest backlog", marks && ring->HighWaterMark() == 200) && ok;
+    }
+
+    // The hook thread and the worker, the producer backing off when full
+    {
+        const uint32_t EVENTS = 200000;
+        std::unique_ptr<KeyEventRing> ring(new KeyEventRing());
+        size_t refused = 0;
+        std::thread producer([&ring, &refused] {
+            for (uint32_t i = 0; i < EVENTS; ++i) {
+                while (!ring->Push(Numbered(i))) {
+                    ++refused;
+                    std::this_thread::yield();
+                }
+            }
+        });
+        uint32_t next = 0;
+        bool ordered = true;
+        KeyEvent batch[BATCH];
+        while (next < EVENTS && ordered) {
+            size_t count = ring->PopBatch(batch, BATCH);
+            if (count == 0) std::this_thread::yield();
+            for (size_t i = 0; i < count; ++i) {
+                ordered = batch[i].time == next++ && ordered;
+            }
+        }
+        producer.join();
+        ok = Report("two threads see every event in order",
+                    ordered && next == EVENTS && ring->OverflowCount() == refused) && ok;
+    }
+
+    return ok ? 0 : 1;
+}
+
+int Bench() {
+    const size_t EVENTS = size_t(1) << 25;
+    std::unique_ptr<KeyEventRing> ring(new KeyEventRing());
+    KeyEvent batch[BATCH];
+    size_t drained = 0;
+
+    // One thread, timing the two sides apart: fill half the ring, drain it
+    const size_t BURST = KeyEventRing::CAPACITY / 2;
+    double pushSeconds = 0;
+    double drainSeconds = 0;
+    for (size_t done = 0; done < EVENTS; done += BURST) {
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < BURST; ++i) {
+            ring->Push(Numbered(static_cast<uint32_t>(done + i)));
+        }
+        pushSeconds += Seconds(start);
+        start = Clock::now();
+        size_t count;
+        while ((count = ring->PopBatch(batch, BATCH)) > 0) {
+            drained += count;
+        }
+        drainSeconds += Seconds(start);
+    }
+
+    // Two threads as in the app, each yielding instead of waiting
+    const uint32_t THREADED_EVENTS = 5000000;
+    std::unique_ptr<KeyEventRing> shared(new KeyEventRing());
+    Clock::time_point start = Clock::now();
+    std::thread producer([&shared] {
+        for (uint32_t i = 0; i < THREADED_EVENTS; ++i) {
+            while (!shared->Push(Numbered(i))) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    size_t received = 0;
+    while (received < THREADED_EVENTS) {
+        size_t count = shared->PopBatch(batch, BATCH);
+        if (count == 0) std::this_thread::yield();
+        received += count;
+    }
+    producer.join();
+    double threadedSeconds = Seconds(start);
+
+    printf("%zu events on one thread, %u on two, batches of %zu\n", EVENTS, THREADED_EVENTS, BATCH);
+    printf("push:     %6.2f ns per event\n", pushSeconds * 1e9 / EVENTS);
+    printf("drain:    %6.2f ns per event\n", drainSeconds * 1e9 / EVENTS);
+    printf("threaded: %6.2f ns per event, %zu refused while full, deepest backlog %zu\n",
+           threadedSeconds * 1e9 / THREADED_EVENTS, shared->OverflowCount(), shared->HighWaterMark());
+    return drained == EVENTS ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 2 && strcmp(argv[1], "--check") == 0) {
+        return Check();
+    }
+    if (argc == 2 && strcmp(argv[1], "--bench") == 0) {
+        return Bench();
+    }
+    PrintUsage();
+    return 1;
+}
\ No newline at end of file
@@ -0,0 +1,299 @@
+// kswitcher-rules: shows which application rule of a settings file applies
+// to a process and window class, checks rule lookups against a linear scan
+// of the rules and measures both.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "AppRuleMatcher.h"
+#include "FakeAppIdentity.h"
+#include "MappedFile.h"
+#include "Settings.h"
+#include "TextUtils.h"
+#include "ToolSupport.h"
+
+namespace {
+
+const size_t RULE_COUNTS[] = {100, 1000, 4000, 16000};
+const size_t LOOKUPS = 1u << 20;
+
+// Windows the foreground moves between, as a long session would see
+const size_t WINDOW_COUNT = 64;
+
+void PrintUsage() {
+    printf("Usage:\n"
+           "  kswitcher-rules <settings.yml> <process> [window class]\n"
+           "  kswitcher-rules --check\n"
+           "  kswitcher-rules --bench\n");
+}
+
+void PrintPolicy(const AppPolicy& policy) {
+    printf("buffering: %s\n", policy.flags & AppPolicy::NO_BUFFERING ? "false" : "true");
+    printf("hotkeys:   %s\n", policy.flags & AppPolicy::NO_HOTKEYS ? "false" : "true");
+    if (policy.layout) {
+        printf("layout:    0x%0*x\n", policy.layout <= 0xFFFF ? 4 : 8, policy.layout);
+    } else {
+        printf("layout:    unchanged\n");
+    }
+    printf("injection: %s\n", policy.injection == AppPolicy::INJECTION_KEYS ? "keys" : "auto");
+}
+
+std::u16string Widen(const std::string& text) {
+    return std::u16string(text.begin(), text.end());
+}
+
+// What the table replaces: the first rule from the end that names the
+// process or class, with names compared the way the table folds them
+bool SameName(const std::string& rule, const std::u16string& name) {
+    if (rule.size() != name.size()) return false;
+    for (size_t i = 0; i < name.size(); ++i) {
+        if (ToLowerChar(static_cast<char16_t>(static_cast<unsigned char>(rule[i]))) != ToLowerChar(name[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const AppPolicy* LinearMatch(const std::vector<AppRule>& rules, const std::u16string& process,
+                             const std::u16string& windowClass) {
+    for (size_t i = rules.size(); i-- > 0;) {
+        if (!rules[i].windowClass.empty() && SameName(rules[i].windowClass, windowClass)) return &rules[i].policy;
+    }
+    for (size_t i = rules.size(); i-- > 0;) {
+        if (!rules[i].process.empty() && SameName(rules[i].process, process)) return &rules[i].policy;
+    }
+    return nullptr;
+}
+
+// Every fourth rule is a window class rule, the rest name a process
+std::vector<AppRule> MakeRules(size_t count) {
+    std::vector<AppRule> rules(count);
+    for (size_t i = 0; i < count; ++i) {
+        AppRule& rule = rules[i];
+        rule.name = "app" + std::to_string(i);
+        if (i % 4 == 3) {
+            rule.windowClass = "App" + std::to_string(i) + "WindowClass";
+            rule.policy.flags = AppPolicy::NO_BUFFERING;
+        } else {
+            rule.process = "app" + std::to_string(i);
+            rule.policy.flags = i % 3 ? 0 : AppPolicy::NO_HOTKEYS;
+            rule.policy.layout = static_cast<uint32_t>(0x04090409 + i);
+            rule.policy.injection = i % 2 ? AppPolicy::INJECTION_KEYS : AppPolicy::INJECTION_AUTO;
+        }
+    }
+    return rules;
+}
+
+struct Query {
+    std::u16string process;     // As the system reports it: a full path
+    std::u16string windowClass;
+    std::u16string shortProcess;
+};
+
+// Half the queries name a ruled application, in other case than the rule
+std::vector<Query> MakeQueries(size_t ruleCount, size_t count) {
+    std::vector<Query> queries(count);
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < count; ++i) {
+        seed = seed * 1103515245 + 12345;
+        size_t app = (seed >> 8) % ruleCount;
+        bool known = i % 2 == 0;
+        std::string name = (known ? "APP" : "other") + std::to_string(app);
+        queries[i].shortProcess = Widen(name);
+        queries[i].process = u"C:\\Program Files\\" + Widen(name) + u"\\" + Widen(name) + u".EXE";
+        queries[i].windowClass = Widen((known ? "app" : "Other") + std::to_string(app) + "windowclass");
+    }
+    return queries;
+}
+
+template <typename Lookup>
+double TimeLookups(const std::vector<Query>& queries, size_t rounds, size_t& found, Lookup lookup) {
+    found = 0;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < rounds; ++i) {
+        const Query& query = queries[i % queries.size()];
+        found += lookup(query) ? 1 : 0;
+    }
+    return Seconds(start) * 1e9 / rounds;
+}
+
+const AppPolicy* TableMatch(const AppRuleTable& table, const Query& query) {
+    return table.Match(AppRuleTable::ProcessKey(query.process.data(), query.process.size()),
+                       AppRuleTable::ClassKey(query.windowClass.data(), query.windowClass.size()));
+}
+
+bool SamePolicy(const AppPolicy* a, const AppPolicy* b) {
+    return (a == nullptr) == (b == nullptr) && (!a || *a == *b);
+}
+
+// Windows on the fake identity, one per query
+void AddWindows(FakeAppIdentity& identity, const std::vector<Query>& queries) {
+    for (size_t i = 0; i < WINDOW_COUNT; ++i) {
+        const Query& query = queries[i];
+        HWND window = reinterpret_cast<HWND>(static_cast<uintptr_t>(0x1000 + i));
+        identity.AddWindow(window, static_cast<uint32_t>(100 + i), static_cast<uint32_t>(1000 + i), query.windowClass);
+        identity.SetImageName(static_cast<uint32_t>(100 + i), query.process);
+    }
+}
+
+int Check() {
+    bool ok = true;
+
+    bool same = true;
+    const size_t counts[] = { 1, 7, 100, 1000 };
+    for (size_t count : counts) {
+        std::vector<AppRule> rules = MakeRules(count);
+        std::vector<Query> queries = MakeQueries(count, 1024);
+        AppRuleTable table;
+        table.Build(rules);
+        same = table.KeyCount() == count && same;
+        for (const Query& query : queries) {
+            same = SamePolicy(TableMatch(table, query), LinearMatch(rules, query.shortProcess, query.windowClass)) &&
+                   same;
+        }
+    }
+    ok = Report("table picks the rule a scan would", same) && ok;
+
+    // A later rule for the same name replaces the earlier one
+    {
+        std::vector<AppRule> rules = MakeRules(8);
+        AppRule later = rules[0];
+        later.name = "later";
+        later.policy.layout = 0x04190419;
+        rules.push_back(later);
+        AppRuleTable table;
+        table.Build(rules);
+        Query query = { u"C:\\Tools\\APP0.exe", u"Unruled", u"APP0" };
+        const AppPolicy* policy = TableMatch(table, query);
+        ok = Report("a later rule for the same name wins",
+                    policy && *policy == later.policy &&
+                    SamePolicy(policy, LinearMatch(rules, query.shortProcess, query.windowClass))) && ok;
+    }
+
+    // The matcher resolves what the table would, opening each process once
+    {
+        std::vector<AppRule> rules = MakeRules(100);
+        std::vector<Query> queries = MakeQueries(100, WINDOW_COUNT);
+        FakeAppIdentity identity;
+        AddWindows(identity, queries);
+        AppRuleMatcher matcher(identity);
+        matcher.SetRules(rules);
+        bool resolved = true;
+        for (size_t round = 0; round < 3; ++round) {
+            for (size_t i = 0; i < WINDOW_COUNT; ++i) {
+                AppPolicy policy = matcher.Resolve(reinterpret_cast<HWND>(static_cast<uintptr_t>(0x1000 + i)));
+                const AppPolicy* expected = LinearMatch(rules, queries[i].shortProcess, queries[i].windowClass);
+                resolved = policy == (expected ? *expected : AppPolicy()) && resolved;
+            }
+        }
+        ok = Report("matcher resolves each window, opening it once",
+                    resolved && identity.ImageQueries() == WINDOW_COUNT) && ok;
+    }
+
+    return ok ? 0 : 1;
+}
+
+bool BenchRules(size_t ruleCount) {
+    std::vector<AppRule> rules = MakeRules(ruleCount);
+    std::vector<Query> queries = MakeQueries(ruleCount, 4096);
+
+    AppRuleTable table;
+    Clock::time_point start = Clock::now();
+    table.Build(rules);
+    double buildMs = Seconds(start) * 1e3;
+    if (table.KeyCount() != ruleCount) {
+        printf("%6zu rules: table has %zu names\n", ruleCount, table.KeyCount());
+        return false;
+    }
+
+    // The table must pick the rule a scan of the settings would
+    size_t mismatches = 0;
+    for (const Query& query : queries) {
+        if (!SamePolicy(TableMatch(table, query), LinearMatch(rules, query.shortProcess, query.windowClass))) {
+            ++mismatches;
+        }
+    }
+
+    size_t hashedFound = 0;
+    double hashedNs = TimeLookups(queries, LOOKUPS, hashedFound, [&](const Query& query) {
+        return TableMatch(table, query);
+    });
+    size_t linearRounds = std::max<size_t>(LOOKUPS / ruleCount, 256);
+    size_t linearFound = 0;
+    double linearNs = TimeLookups(queries, linearRounds, linearFound, [&](const Query& query) {
+        return LinearMatch(rules, query.shortProcess, query.windowClass);
+    });
+
+    // Focus changes through the matcher: the first visit to each window
+    // opens its process, later ones hit the cache
+    FakeAppIdentity identity;
+    AddWindows(identity, queries);
+    AppRuleMatcher matcher(identity);
+    matcher.SetRules(rules);
+    start = Clock::now();
+    for (size_t i = 0; i < WINDOW_COUNT; ++i) {
+        matcher.Resolve(reinterpret_cast<HWND>(static_cast<uintptr_t>(0x1000 + i)));
+    }
+    double coldNs = Seconds(start) * 1e9 / WINDOW_COUNT;
+    start = Clock::now();
+    for (size_t i = 0; i < LOOKUPS; ++i) {
+        matcher.Resolve(reinterpret_cast<HWND>(static_cast<uintptr_t>(0x1000 + i % WINDOW_COUNT)));
+    }
+    double cachedNs = Seconds(start) * 1e9 / LOOKUPS;
+    bool cached = identity.ImageQueries() == WINDOW_COUNT;
+
+    printf("%6zu rules: build %7.2f ms, lookup %5.1f ns (linear %9.1f ns), resolve %5.1f ns cold %5.1f ns cached%s%s\n",
+           ruleCount, buildMs, hashedNs, linearNs, coldNs, cachedNs,
+           mismatches ? ", MISMATCH" : "", cached ? "" : ", UNCACHED");
+    return mismatches == 0 && cached && hashedFound > 0 && linearFound > 0;
+}
+
+int Bench() {
+    printf("%zu lookups, half of them for names no rule mentions\n\n", LOOKUPS);
+    bool ok = true;
+    for (size_t count : RULE_COUNTS) {
+        ok = BenchRules(count) && ok;
+    }
+    return ok ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 2 && strcmp(argv[1], "--check") == 0) {
+        return Check();
+    }
+    if (argc == 2 && strcmp(argv[1], "--bench") == 0) {
+        return Bench();
+    }
+    if ((argc != 3 && argc != 4) || argv[1][0] == '-') {
+        PrintUsage();
+        return 1;
+    }
+
+    MappedFile file;
+    if (!file.Open(MappedFile::PathFromUtf8(argv[1]))) {
+        fprintf(stderr, "error: cannot open %s\n", argv[1]);
+        return 1;
+    }
+    Settings settings = Settings::Parse(reinterpret_cast<const char*>(file.Data()), file.Size());
+
+    AppRuleTable table;
+    table.Build(settings.appRules);
+    uint64_t classKey = AppRuleTable::NO_KEY;
+    if (argc == 4) {
+        classKey = AppRuleTable::ClassKey(argv[3]);
+    }
+    const AppPolicy* policy = table.Match(AppRuleTable::ProcessKey(argv[2]), classKey);
+    printf("%zu rules, %zu names\n\n", settings.appRules.size(), table.KeyCount());
+    if (!policy) {
+        printf("no rule matches, defaults apply\n");
+        PrintPolicy(AppPolicy());
+        return 2;
+    }
+    PrintPolicy(*policy);
+    return 0;
+}
\ No newline at end of file
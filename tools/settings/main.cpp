@@ -0,0 +1,248 @@
+// kswitcher-settings: parses settings files with the app's reader, prints
+// what the app would keep, checks the format round trip and measures the
+// parser on large configs.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "MappedFile.h"
+#include "Settings.h"
+#include "ToolSupport.h"
+
+namespace {
+
+// Repeat parsing until at least this much text was read, and saving until
+// as much was written
+const size_t MIN_BENCH_BYTES = 256u * 1024 * 1024;
+
+void PrintUsage() {
+    printf("Usage:\n"
+           "  kswitcher-settings <settings.yml>\n"
+           "  kswitcher-settings --check\n"
+           "  kswitcher-settings --bench <settings.yml>\n"
+           "  kswitcher-settings --synthesize <settings.yml> <rules>\n");
+}
+
+void PrintStats(const Settings::ParseStats& stats) {
+    printf("lines:   %zu\n", stats.read.lines);
+    printf("entries: %zu (%zu unknown, %zu invalid)\n",
+           stats.read.entries, stats.unknownKeys, stats.invalidValues);
+    if (stats.read.errors > 0) {
+        printf("errors:  %zu, first on line %zu\n", stats.read.errors, stats.read.firstErrorLine);
+    } else {
+        printf("errors:  0\n");
+    }
+}
+
+// Known settings followed by a rules: section with one rule per
+// application, as a large per-application config would look
+std::string SynthesizedYaml(size_t sections) {
+    std::string yaml = Settings().Serialize();
+    if (sections > 0) {
+        yaml += "rules:\n";
+    }
+    for (size_t i = 0; i < sections; ++i) {
+        char block[512];
+        int length = i % 4 == 3
+            ? snprintf(block, sizeof(block),
+                       "  # dialogs of application %zu\n"
+                       "  class%zu:\n"
+                       "    windowClass: \"App%zuWindowClass\"\n"
+                       "    buffering: false\n",
+                       i, i, i)
+            : snprintf(block, sizeof(block),
+                       "  # rules for application %zu\n"
+                       "  app%zu:\n"
+                       "    process: \"app%zu.exe\"\n"
+                       "    hotkeys: %s\n"
+                       "    layout: 0x%08zx\n"
+                       "    injection: %s\n",
+                       i, i, i, i % 3 ? "true" : "false", 0x04090409 + i, i % 2 ? "keys" : "auto");
+        yaml.append(block, static_cast<size_t>(length));
+    }
+    return yaml;
+}
+
+bool Synthesize(const char* path, size_t sections) {
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+
+    std::string yaml = SynthesizedYaml(sections);
+    bool written = fwrite(yaml.data(), 1, yaml.size(), file) == yaml.size();
+    return fclose(file) == 0 && written;
+}
+
+Settings Parse(const std::string& yaml, Settings::ParseStats& stats) {
+    return Settings::Parse(yaml.data(), yaml.size(), &stats);
+}
+
+bool Clean(const Settings::ParseStats& stats) {
+    return stats.read.errors == 0 && stats.unknownKeys == 0 && stats.invalidValues == 0;
+}
+
+int Check() {
+    bool ok = true;
+    Settings::ParseStats stats;
+
+    std::string defaults = Settings().Serialize();
+    ok = Report("defaults read back unchanged", Parse(defaults, stats).Serialize() == defaults && Clean(stats)) && ok;
+
+    // Every setting away from its default, and a rule using every field
+    {
+        Settings changed;
+        changed.textCorrectionEnabled = false;
+        changed.layoutSwitchEnabled = false;
+        changed.autoStartWithWindows = true;
+        changed.keystrokeBufferSize = 200;
+        changed.showLayoutInTray = false;
+        changed.autoCorrectEnabled = true;
+        changed.autoCorrectMinLetters = 7;
+        changed.autoCorrectMargin = 0;
+        changed.layoutMemoryEnabled = true;
+        changed.layoutMemoryPerApplication = true;
+        changed.phraseCorrectionWords = 32;
+        AppRule rule;
+        rule.name = "remoteDesktop";
+        rule.process = "mstsc.exe";
+        rule.windowClass = "TscShellContainerClass";
+        rule.policy.flags = AppPolicy::NO_BUFFERING | AppPolicy::NO_HOTKEYS;
+        rule.policy.layout = 0x04190419;
+        rule.policy.injection = AppPolicy::INJECTION_KEYS;
+        changed.appRules.push_back(rule);
+        std::string yaml = changed.Serialize();
+        Settings loaded = Parse(yaml, stats);
+        ok = Report("every setting and rule field round-trips",
+                    yaml != defaults && loaded.Serialize() == yaml && Clean(stats) && loaded.appRules.size() == 1 &&
+                    loaded.appRules[0].policy == rule.policy && loaded.appRules[0].windowClass == rule.windowClass) && ok;
+    }
+
+    // Rules named after their executable: the field follows the last dot
+    {
+        Settings loaded = Parse("rules:\n"
+                                "  mstsc.exe:\n"
+                                "    process: mstsc.exe\n"
+                                "    buffering: false\n"
+                                "  my.app.exe:\n"
+                                "    windowClass: \"Main\"\n", stats);
+        std::string yaml = loaded.Serialize();
+        bool dotted = Clean(stats) && loaded.appRules.size() == 2 && loaded.appRules[0].name == "mstsc.exe" &&
+                      loaded.appRules[0].process == "mstsc.exe" &&
+                      loaded.appRules[0].policy.flags == AppPolicy::NO_BUFFERING &&
+                      loaded.appRules[1].name == "my.app.exe" && loaded.appRules[1].windowClass == "Main";
+        Settings reloaded = Parse(yaml, stats);
+        dotted = dotted && Clean(stats) && reloaded.Serialize() == yaml && reloaded.appRules.size() == 2 &&
+                 reloaded.appRules[1].name == "my.app.exe";
+        ok = Report("rule names with dots round-trip", dotted) && ok;
+    }
+
+    {
+        Settings loaded = Parse("keystrokeBufferSize: 1000\n"
+                                "autoCorrect:\n"
+                                "  minLetters: 0\n"
+                                "  margin: -5\n", stats);
+        ok = Report("numbers are clamped to their range",
+                    loaded.keystrokeBufferSize == 256 && loaded.autoCorrectMinLetters == 1 &&
+                    loaded.autoCorrectMargin == 0 && Clean(stats)) && ok;
+    }
+
+    // Bad entries are counted and keep their defaults; the rest still apply
+    {
+        Settings loaded = Parse("textCorrectionEnabled: maybe\n"
+                                "futureSetting: 3\n"
+                                "layoutSwitchEnabled: false\n"
+                                "this line has no colon\n"
+                                "rules:\n"
+                                "  terminal:\n"
+                                "    process: \"wt.exe\"\n"
+                                "    injection: sideways\n"
+                                "    colour: blue\n", stats);
+        ok = Report("bad entries are counted and skipped",
+                    loaded.textCorrectionEnabled && !loaded.layoutSwitchEnabled && loaded.appRules.size() == 1 &&
+                    loaded.appRules[0].process == "wt.exe" &&
+                    loaded.appRules[0].policy.injection == AppPolicy::INJECTION_AUTO && stats.invalidValues == 2 &&
+                    stats.unknownKeys == 2 && stats.read.errors == 1 && stats.read.firstErrorLine == 4) && ok;
+    }
+
+    {
+        std::string yaml = SynthesizedYaml(1000);
+        Settings loaded = Parse(yaml, stats);
+        bool rules = loaded.appRules.size() == 1000 && Clean(stats) && loaded.appRules[3].windowClass == "App3WindowClass" &&
+                     loaded.appRules[998].process == "app998.exe";
+        ok = Report("a 1000-rule config reads back whole", rules) && ok;
+    }
+
+    return ok ? 0 : 1;
+}
+
+void Bench(const MappedFile& file) {
+    const char* data = reinterpret_cast<const char*>(file.Data());
+    size_t size = file.Size();
+    size_t rounds = size > 0 ? MIN_BENCH_BYTES / size + 1 : 1;
+
+    Settings::ParseStats stats;
+    Settings settings;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < rounds; ++i) {
+        settings = Settings::Parse(data, size, &stats);
+    }
+    double parseSeconds = Seconds(start);
+
+    // Saving scales with the rules as parsing does
+    size_t serializeRounds = MIN_BENCH_BYTES / settings.Serialize().size() + 1;
+    size_t written = 0;
+    start = Clock::now();
+    for (size_t i = 0; i < serializeRounds; ++i) {
+        written += settings.Serialize().size();
+    }
+    double serializeSeconds = Seconds(start);
+
+    PrintStats(stats);
+    printf("\nparse:     %.1f us per file, %.0f MB/s, %.1f ns per line\n",
+           parseSeconds * 1e6 / rounds,
+           size * static_cast<double>(rounds) / parseSeconds / 1e6,
+           parseSeconds * 1e9 / (static_cast<double>(rounds) * stats.read.lines));
+    printf("serialize: %.0f ns per save (%zu bytes)\n",
+           serializeSeconds * 1e9 / serializeRounds, written / serializeRounds);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 4 && strcmp(argv[1], "--synthesize") == 0) {
+        size_t sections = static_cast<size_t>(strtoul(argv[3], nullptr, 10));
+        if (!Synthesize(argv[2], sections)) {
+            fprintf(stderr, "error: cannot write %s\n", argv[2]);
+            return 1;
+        }
+        return 0;
+    }
+
+    if (argc == 2 && strcmp(argv[1], "--check") == 0) {
+        return Check();
+    }
+
+    bool bench = argc == 3 && strcmp(argv[1], "--bench") == 0;
+    if (!bench && (argc != 2 || argv[1][0] == '-')) {
+        PrintUsage();
+        return 1;
+    }
+
+    const char* path = argv[argc - 1];
+    MappedFile file;
+    if (!file.Open(MappedFile::PathFromUtf8(path))) {
+        fprintf(stderr, "error: cannot open %s\n", path);
+        return 1;
+    }
+
+    if (bench) {
+        Bench(file);
+        return 0;
+    }
+
+    Settings::ParseStats stats;
+    Settings settings = Settings::Parse(reinterpret_cast<const char*>(file.Data()), file.Size(), &stats);
+    PrintStats(stats);
+    printf("\n%s", settings.Serialize().c_str());
+    return stats.read.errors > 0 ? 2 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,302 @@
+// kswitcher-transcode: converts text between the built-in layouts the way
+// Alt+Pause converts a selection, checks the vector transcoder against the
+// scalar one, and measures both in GB/s of UTF-16 input.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "CorrectionEngine.h"
+#include "FakeBackend.h"
+#include "TextTranscoder.h"
+#include "ToolSupport.h"
+
+namespace {
+
+const size_t BENCH_SIZES[] = { 4 << 10, 64 << 10, 1 << 20, 16 << 20, 64 << 20 };
+
+// Bytes converted per measurement, spread over as many rounds as it takes
+const size_t BENCH_VOLUME = 512 << 20;
+
+void PrintUsage() {
+    printf("Usage:\n"
+           "  kswitcher-transcode <text>...\n"
+           "  kswitcher-transcode --check\n"
+           "  kswitcher-transcode --bench\n"
+           "\n"
+           "Text is converted between en-US and ru-RU, e.g. ghbdtn or руддщ.\n");
+}
+
+std::u16string FromUtf8(const char* text) {
+    std::u16string out;
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(text);
+    while (*p) {
+        uint32_t code = *p++;
+        int trailing = code >= 0xF0 ? 3 : code >= 0xE0 ? 2 : code >= 0xC0 ? 1 : 0;
+        if (trailing) code &= 0x3F >> trailing;
+        for (; trailing > 0 && (*p & 0xC0) == 0x80; --trailing) {
+            code = (code << 6) | (*p++ & 0x3F);
+        }
+        if (code >= 0x10000) {
+            code -= 0x10000;
+            out += static_cast<char16_t>(0xD800 + (code >> 10));
+            out += static_cast<char16_t>(0xDC00 + (code & 0x3FF));
+        } else {
+            out += static_cast<char16_t>(code);
+        }
+    }
+    return out;
+}
+
+std::string ToUtf8(const std::u16string& text) {
+    std::string out;
+    for (size_t i = 0; i < text.size(); ++i) {
+        uint32_t code = text[i];
+        if (code >= 0xD800 && code < 0xDC00 && i + 1 < text.size()) {
+            code = 0x10000 + ((code - 0xD800) << 10) + (text[++i] - 0xDC00);
+        }
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+    return out;
+}
+
+// Each argument goes through the engine as a selection, so the layouts are
+// picked exactly as the app picks them
+int Convert(const std::vector<const char*>& texts) {
+    LayoutTable tables[2] = { LayoutTable::EnglishUS(), LayoutTable::RussianRU() };
+    const char* names[2] = { "en-US", "ru-RU" };
+    FakeBackend backend;
+    HKL layouts[2];
+    for (size_t i = 0; i < 2; ++i) {
+        layouts[i] = backend.AddLayout(tables[i]);
+    }
+    backend.SetForegroundWindow(reinterpret_cast<HWND>(1));
+
+    LatencyMetrics latency;
+    CorrectionEngine engine(backend, latency, 64);
+    for (const char* text : texts) {
+        backend.SetSelection(FromUtf8(text));
+        if (!engine.ConvertSelection()) {
+            fprintf(stderr, "error: \"%s\" is empty\n", text);
+            return 1;
+        }
+        const char* target = names[backend.ActiveLayout() == layouts[1] ? 1 : 0];
+        printf("%s -> %s  (%s)\n", text, ToUtf8(backend.PastedText()).c_str(), target);
+    }
+    return 0;
+}
+
+uint32_t NextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+enum TextKind { TEXT_LATIN, TEXT_CYRILLIC, TEXT_MIXED, TEXT_FALLBACK, TEXT_KIND_COUNT };
+
+const char* KIND_NAMES[TEXT_KIND_COUNT] = { "latin", "cyrillic", "mixed", "fallback" };
+const char* SIMD_NAMES[] = { "scalar", "ssse3", "avx2" };
+
+// Words of letters and the odd punctuation. Mixed switches script every
+// word; fallback puts a character outside both ranges in about one block
+// in two, as dashes and quotes do in prose.
+void MakeText(TextKind kind, size_t length, uint32_t seed, std::u16string& text) {
+    static const char16_t others[] = { u'—', u'«', u'»', u'ґ', u'…' };
+    uint32_t state = seed;
+    text.clear();
+    text.reserve(length);
+    bool cyrillic = kind == TEXT_CYRILLIC;
+    while (text.size() < length) {
+        size_t word = 2 + NextRandom(state) % 9;
+        for (size_t i = 0; i < word && text.size() < length; ++i) {
+            uint32_t r = NextRandom(state);
+            char16_t ch = cyrillic ? static_cast<char16_t>(u'а' + r % 32) : static_cast<char16_t>(u'a' + r % 26);
+            if (r % 8 == 0) ch = static_cast<char16_t>(ch - 0x20);
+            text += ch;
+        }
+        if (text.size() < length) {
+            uint32_t r = NextRandom(state);
+            text += kind == TEXT_FALLBACK && r % 6 == 0 ? others[r % 5] : r % 10 == 0 ? u',' : u' ';
+        }
+        if (kind == TEXT_MIXED) cyrillic = !cyrillic;
+        if (kind == TEXT_FALLBACK) cyrillic = NextRandom(state) % 2 == 0;
+    }
+}
+
+// Any UTF-16 code unit, weighted towards the two ranges and their edges
+char16_t RandomUnit(uint32_t& state) {
+    uint32_t r = NextRandom(state);
+    switch (r % 6) {
+        case 0: return static_cast<char16_t>((r >> 8) % 0x80);
+        case 1: return static_cast<char16_t>(0x400 + (r >> 8) % 0x80);
+        case 2: return static_cast<char16_t>(0x370 + (r >> 8) % 0x120);
+        case 3: return static_cast<char16_t>(0xD800 + (r >> 8) % 0x800);
+        default: return static_cast<char16_t>(r >> 16);
+    }
+}
+
+int Check() {
+    LayoutTable en = LayoutTable::EnglishUS();
+    LayoutTable ru = LayoutTable::RussianRU();
+    TextTranscoder transcoders[2];
+    transcoders[0].Build(en, ru);
+    transcoders[1].Build(ru, en);
+    size_t failures = 0;
+
+    // Every character a key types becomes what the other layout types there
+    for (size_t t = 0; t < 2; ++t) {
+        const LayoutTable& source = t == 0 ? en : ru;
+        const LayoutTable& target = t == 0 ? ru : en;
+        for (int key = 0; key < LayoutTable::KEY_COUNT; ++key) {
+            for (int shift = 0; shift < 2; ++shift) {
+                char16_t from = source.Translate(key, shift != 0);
+                char16_t to = target.Translate(key, shift != 0);
+                int firstKey;
+                bool firstShift;
+                // Characters on several keys keep their first key
+                if (!from || !to || !source.FindKey(from, firstKey, firstShift)) continue;
+                if (firstKey != key || firstShift != (shift != 0)) continue;
+                if (transcoders[t].Map(from) != to) ++failures;
+            }
+        }
+    }
+    printf("key mapping:   %s\n", failures ? "FAILED" : "ok");
+
+    // Random units at every length and alignment, out of place and in
+    // place, on every vector path the CPU has
+    size_t mismatches = 0;
+    uint32_t state = 0x2545F491u;
+    std::vector<char16_t> input(300);
+    std::vector<char16_t> expected(300);
+    std::vector<char16_t> output(300);
+    std::vector<char16_t> inPlace(300);
+    for (int round = 0; round < 3000; ++round) {
+        const TextTranscoder& transcoder = transcoders[round % 2];
+        size_t offset = NextRandom(state) % 8;
+        size_t length = NextRandom(state) % (input.size() - offset);
+
+        // Most blocks entirely in range, so the vector paths are taken
+        bool inRange = round % 3 != 0;
+        for (size_t i = 0; i < input.size(); ++i) {
+            input[i] = inRange ? static_cast<char16_t>((NextRandom(state) % 2 ? 0x400 : 0) + NextRandom(state) % 0x80)
+                               : RandomUnit(state);
+        }
+        transcoder.TranscodeScalar(&input[offset], length, &expected[offset]);
+
+        for (int level = TextTranscoder::SIMD_SSSE3; level <= TextTranscoder::Simd(); ++level) {
+            TextTranscoder::SimdLevel path = static_cast<TextTranscoder::SimdLevel>(level);
+            transcoder.Transcode(&input[offset], length, &output[offset], path);
+            if (!std::equal(&expected[offset], &expected[offset] + length, &output[offset])) ++mismatches;
+
+            inPlace = input;
+            transcoder.Transcode(&inPlace[offset], length, &inPlace[offset], path);
+            if (!std::equal(&expected[offset], &expected[offset] + length, &inPlace[offset])) ++mismatches;
+        }
+    }
+    printf("vector paths:  %s (%s)\n", mismatches ? "MISMATCH" : "match scalar",
+           SIMD_NAMES[TextTranscoder::Simd()]);
+
+    // Text typed in one layout, converted there and back, comes out as it
+    // went in. Mixed text need not: б read as Latin is a comma, and a comma
+    // read as Russian is a question mark.
+    size_t roundTrips = 0;
+    std::u16string text;
+    std::u16string converted;
+    for (size_t t = 0; t < 2; ++t) {
+        MakeText(t == 0 ? TEXT_LATIN : TEXT_CYRILLIC, 10000, 7, text);
+        converted.resize(text.size());
+        transcoders[t].Transcode(text.data(), text.size(), &converted[0]);
+        transcoders[1 - t].Transcode(converted.data(), converted.size(), &converted[0]);
+        if (converted != text) ++roundTrips;
+    }
+    printf("round trip:    %s\n", roundTrips ? "FAILED" : "ok");
+
+    return failures || mismatches || roundTrips ? 1 : 0;
+}
+
+// GB/s of input through path, or through memcpy when path is negative
+double Measure(const TextTranscoder& transcoder, const std::u16string& text, std::u16string& output, int path) {
+    size_t bytes = text.size() * sizeof(char16_t);
+    size_t rounds = std::max<size_t>(1, BENCH_VOLUME / bytes);
+    Clock::time_point start = Clock::now();
+    for (size_t round = 0; round < rounds; ++round) {
+        if (path < 0) {
+            memcpy(&output[0], text.data(), bytes);
+        } else {
+            transcoder.Transcode(text.data(), text.size(), &output[0], static_cast<TextTranscoder::SimdLevel>(path));
+        }
+    }
+    double seconds = Seconds(start);
+    return static_cast<double>(bytes) * rounds / seconds / 1e9;
+}
+
+int Bench() {
+    TextTranscoder transcoder;
+    transcoder.Build(LayoutTable::EnglishUS(), LayoutTable::RussianRU());
+
+    printf("%-18s", "text");
+    for (size_t size : BENCH_SIZES) {
+        std::string label = size >= (1 << 20) ? std::to_string(size >> 20) + " MB" : std::to_string(size >> 10) + " KB";
+        printf(" %8s", label.c_str());
+    }
+    printf("   (GB/s of UTF-16 input)\n");
+
+    std::u16string text;
+    std::u16string output;
+    for (int kind = 0; kind < TEXT_KIND_COUNT; ++kind) {
+        // The fastest path first; memcpy of the same text for the memory bound
+        for (int path = TextTranscoder::Simd(); path >= -1; --path) {
+            std::string label = std::string(KIND_NAMES[kind]) + " " + (path < 0 ? "memcpy" : SIMD_NAMES[path]);
+            printf("%-18s", label.c_str());
+            for (size_t size : BENCH_SIZES) {
+                MakeText(static_cast<TextKind>(kind), size / sizeof(char16_t), 42, text);
+                output.assign(text.size(), 0);
+                printf(" %8.2f", Measure(transcoder, text, output, path));
+                fflush(stdout);
+            }
+            printf("\n");
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 2 && strcmp(argv[1], "--check") == 0) {
+        return Check();
+    }
+    if (argc == 2 && strcmp(argv[1], "--bench") == 0) {
+        return Bench();
+    }
+
+    std::vector<const char*> texts;
+    for (int i = 1; i < argc; ++i) {
+        if (argv[i][0] == '-') {
+            PrintUsage();
+            return 1;
+        }
+        texts.push_back(argv[i]);
+    }
+    if (texts.empty()) {
+        PrintUsage();
+        return 1;
+    }
+    return Convert(texts);
+}
\ No newline at end of file
@@ -0,0 +1,274 @@
+// kswitcher-userdict: shows what the user dictionary in a directory holds,
+// checks its journal and compaction against crashes at awkward moments, and
+// measures learning, lookups and loading.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include "AppendFile.h"
+#include "MappedFile.h"
+#include "ToolSupport.h"
+#include "UserDictionary.h"
+
+namespace {
+
+const HKL LAYOUT_EN = reinterpret_cast<HKL>(static_cast<uintptr_t>(0x04090409));
+const HKL LAYOUT_RU = reinterpret_cast<HKL>(static_cast<uintptr_t>(0x04190419));
+
+void PrintUsage() {
+    printf("Usage:\n"
+           "  kswitcher-userdict <directory>\n"
+           "  kswitcher-userdict --check <scratch directory>\n"
+           "  kswitcher-userdict --bench <scratch directory>\n");
+}
+
+NativePath FilePath(const NativePath& directory, const char* name) {
+    NativePath path = directory;
+#ifdef _WIN32
+    path += L'\\';
+#else
+    path += '/';
+#endif
+    for (const char* c = name; *c; ++c) {
+        path += static_cast<NativePath::value_type>(*c);
+    }
+    return path;
+}
+
+void RemoveFiles(const NativePath& directory) {
+    AppendFile::Remove(FilePath(directory, UserDictionary::SNAPSHOT_NAME));
+    AppendFile::Remove(FilePath(directory, UserDictionary::JOURNAL_NAME));
+    AppendFile::Remove(FilePath(directory, UserDictionary::ROTATED_JOURNAL_NAME));
+}
+
+// What the dictionary should hold, kept without limits or files
+struct Reference {
+    struct Word {
+        UserDictionary::Verdict verdict;
+        HKL layout;
+    };
+    std::unordered_map<uint64_t, Word> words;
+
+    // Mostly new words, some changed back and forth
+    void Learn(UserDictionary& dictionary, Random& random, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t key = random.Next() % (words.size() + count) + 1;
+            UserDictionary::Verdict verdict = random.Next() % 4 == 0 ? UserDictionary::VERDICT_REJECTED
+                                                                     : UserDictionary::VERDICT_ACCEPTED;
+            HKL layout = verdict == UserDictionary::VERDICT_REJECTED || random.Next() % 2 ? LAYOUT_EN : LAYOUT_RU;
+            dictionary.Learn(key, verdict, layout);
+            words[key] = { verdict, layout };
+        }
+    }
+
+    bool Matches(UserDictionary& dictionary) const {
+        if (dictionary.Count() != words.size()) return false;
+        for (const auto& word : words) {
+            const UserDictionary::Entry* entry = dictionary.Lookup(word.first);
+            if (!entry || entry->verdict != word.second.verdict ||
+                entry->layout != UserDictionary::LayoutId(word.second.layout)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+int Check(const NativePath& directory) {
+    bool ok = true;
+    Random random(88172645463325252ull);
+    Reference reference;
+    RemoveFiles(directory);
+
+    // Keys ignore Shift and trailing spaces, not the layout
+    KeystrokeInfo word[] = {
+        KeystrokeInfo::Make('G', true, false), KeystrokeInfo::Make('H', false, false),
+        KeystrokeInfo::Make(VK_SPACE, false, false)
+    };
+    KeystrokeInfo lower[] = { KeystrokeInfo::Make('G', false, false), KeystrokeInfo::Make('H', false, false) };
+    ok = Report("key ignores Shift and trailing spaces",
+                UserDictionary::Key(word, 3, LAYOUT_EN) == UserDictionary::Key(lower, 2, LAYOUT_EN) &&
+                UserDictionary::Key(word, 3, LAYOUT_EN) != UserDictionary::Key(word, 3, LAYOUT_RU)) && ok;
+
+    {
+        UserDictionary dictionary;
+        dictionary.Open(directory);
+        reference.Learn(dictionary, random, 1000);
+    }
+    {
+        UserDictionary dictionary;
+        dictionary.Open(directory);
+        ok = Report("journal replays after reopening", reference.Matches(dictionary)) && ok;
+
+        // Several compactions, each while learning goes on
+        reference.Learn(dictionary, random, UserDictionary::COMPACT_RECORDS * 5);
+        ok = Report("words stay while compacting", reference.Matches(dictionary)) && ok;
+        const UserDictionary::Counters& counters = dictionary.GetCounters();
+        ok = Report("journal is compacted", counters.compactions >= counters.learned / UserDictionary::COMPACT_RECORDS &&
+                                                dictionary.JournalRecords() < UserDictionary::COMPACT_RECORDS) && ok;
+    }
+    {
+        UserDictionary dictionary;
+        dictionary.Open(directory);
+        ok = Report("snapshot and journal load together", reference.Matches(dictionary)) && ok;
+        reference.Learn(dictionary, random, 100);
+    }
+
+    // A crash in the middle of an append
+    {
+        AppendFile journal;
+        journal.Open(FilePath(directory, UserDictionary::JOURNAL_NAME));
+        const uint8_t torn[7] = { 1, 2, 3, 4, 5, 6, 7 };
+        journal.Append(torn, sizeof(torn));
+    }
+    {
+        UserDictionary dictionary;
+        dictionary.Open(directory);
+        ok = Report("torn record is skipped", reference.Matches(dictionary) &&
+                                                  dictionary.GetCounters().badRecords > 0) && ok;
+        reference.Learn(dictionary, random, 100);
+    }
+    {
+        UserDictionary dictionary;
+        dictionary.Open(directory);
+        ok = Report("records after a torn one load", reference.Matches(dictionary)) && ok;
+        dictionary.Compact();
+        reference.Learn(dictionary, random, 300);
+    }
+
+    // A crash after the journal was set aside, before the snapshot was
+    // written: the snapshot is old, the rest is in the two journals
+    {
+        UserDictionary dictionary;
+        dictionary.Open(directory);
+        reference.Learn(dictionary, random, 200);
+    }
+    AppendFile::Move(FilePath(directory, UserDictionary::JOURNAL_NAME),
+                     FilePath(directory, UserDictionary::ROTATED_JOURNAL_NAME));
+    {
+        UserDictionary dictionary;
+        dictionary.Open(directory);
+        ok = Report("interrupted compaction loses nothing", reference.Matches(dictionary)) && ok;
+        reference.Learn(dictionary, random, 200);
+        dictionary.WaitForCompaction();
+        ok = Report("set-aside journal is removed once compacted",
+                    !AppendFile::Exists(FilePath(directory, UserDictionary::ROTATED_JOURNAL_NAME))) && ok;
+    }
+    {
+        UserDictionary dictionary;
+        dictionary.Open(directory);
+        ok = Report("recovered dictionary reopens", reference.Matches(dictionary)) && ok;
+    }
+
+    // A journal that is not one is started over; the snapshot stays
+    {
+        UserDictionary dictionary;
+        dictionary.Open(directory);
+        dictionary.Compact();
+    }
+    const char garbage[] = "not a journal at all";
+    AppendFile::WriteAtomically(FilePath(directory, UserDictionary::JOURNAL_NAME), garbage, sizeof(garbage));
+    {
+        UserDictionary dictionary;
+        dictionary.Open(directory);
+        ok = Report("bad journal header keeps the snapshot", reference.Matches(dictionary)) && ok;
+        reference.Learn(dictionary, random, 100);
+    }
+    {
+        UserDictionary dictionary;
+        dictionary.Open(directory);
+        ok = Report("restarted journal replays", reference.Matches(dictionary)) && ok;
+    }
+
+    RemoveFiles(directory);
+    return ok ? 0 : 1;
+}
+
+int Bench(const NativePath& directory) {
+    const size_t WORDS = 100000;
+    const size_t LOOKUPS = 10000000;
+    RemoveFiles(directory);
+
+    double learnJournal;
+    double compactSeconds;
+    {
+        UserDictionary dictionary;
+        dictionary.Open(directory);
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < WORDS; ++i) {
+            dictionary.Learn(i * 0x9E3779B97F4A7C15ull + 1, UserDictionary::VERDICT_ACCEPTED, LAYOUT_RU);
+        }
+        dictionary.WaitForCompaction();
+        learnJournal = Seconds(start) * 1e9 / WORDS;
+
+        start = Clock::now();
+        dictionary.Compact();
+        dictionary.WaitForCompaction();
+        compactSeconds = Seconds(start);
+    }
+
+    UserDictionary memory;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < WORDS; ++i) {
+        memory.Learn(i * 0x9E3779B97F4A7C15ull + 1, UserDictionary::VERDICT_ACCEPTED, LAYOUT_RU);
+    }
+    double learnMemory = Seconds(start) * 1e9 / WORDS;
+
+    size_t found = 0;
+    start = Clock::now();
+    for (size_t i = 0; i < LOOKUPS; ++i) {
+        found += memory.Lookup((i % WORDS) * 0x9E3779B97F4A7C15ull + 1) ? 1 : 0;
+    }
+    double hit = Seconds(start) * 1e9 / LOOKUPS;
+    start = Clock::now();
+    for (size_t i = 0; i < LOOKUPS; ++i) {
+        found += memory.Lookup(i * 0xC2B2AE3D27D4EB4Full | 1) ? 1 : 0;
+    }
+    double miss = Seconds(start) * 1e9 / LOOKUPS;
+
+    UserDictionary loaded;
+    start = Clock::now();
+    loaded.Open(directory);
+    double openSeconds = Seconds(start);
+    bool complete = loaded.Count() == WORDS && found >= LOOKUPS;
+    loaded.Close();
+
+    printf("%zu words\n", WORDS);
+    printf("learn:   %6.1f ns per word in memory, %6.1f ns with the journal (compactions included)\n",
+           learnMemory, learnJournal);
+    printf("lookup:  %6.1f ns hit, %6.1f ns miss\n", hit, miss);
+    printf("compact: %6.2f ms, snapshot written and synced\n", compactSeconds * 1e3);
+    printf("open:    %6.2f ms from the snapshot%s\n", openSeconds * 1e3, complete ? "" : ", INCOMPLETE");
+
+    RemoveFiles(directory);
+    return complete ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 3 && strcmp(argv[1], "--check") == 0) {
+        return Check(MappedFile::PathFromUtf8(argv[2]));
+    }
+    if (argc == 3 && strcmp(argv[1], "--bench") == 0) {
+        return Bench(MappedFile::PathFromUtf8(argv[2]));
+    }
+    if (argc != 2 || argv[1][0] == '-') {
+        PrintUsage();
+        return 1;
+    }
+
+    // Opens the dictionary as the app does, which may compact it
+    UserDictionary dictionary;
+    if (!dictionary.Open(MappedFile::PathFromUtf8(argv[1]))) {
+        fprintf(stderr, "error: cannot open the journal in %s\n", argv[1]);
+        return 1;
+    }
+    const UserDictionary::Counters& counters = dictionary.GetCounters();
+    printf("%zu words from %llu records, %llu bad\n", dictionary.Count(),
+           static_cast<unsigned long long>(counters.loadedRecords),
+           static_cast<unsigned long long>(counters.badRecords));
+    printf("%s", dictionary.Format().c_str());
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,249 @@
+// kswitcher-windows: checks the per-window buffer cache against a plain LRU
+// list, including probes after deletions, and measures window switches.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <vector>
+#include "ToolSupport.h"
+#include "WindowBufferCache.h"
+
+namespace {
+
+void PrintUsage() {
+    printf("Usage:\n"
+           "  kswitcher-windows --check\n"
+           "  kswitcher-windows --bench\n");
+}
+
+// Handles as Windows hands them out: small, word-aligned and close together
+uintptr_t Handle(size_t index) {
+    return 0x10000 + index * 4;
+}
+
+// Every cached window, most recently used first
+class Reference {
+public:
+    explicit Reference(size_t capacity) : _capacity(capacity), _evictions(0) {}
+
+    // Returns true when the window was cached
+    bool Acquire(uintptr_t window) {
+        std::list<uintptr_t>::iterator it = std::find(_windows.begin(), _windows.end(), window);
+        bool cached = it != _windows.end();
+        if (cached) {
+            _windows.erase(it);
+        } else if (_windows.size() == _capacity) {
+            _windows.pop_back();
+            ++_evictions;
+        }
+        _windows.push_front(window);
+        return cached;
+    }
+
+    bool Contains(uintptr_t window) const {
+        return std::find(_windows.begin(), _windows.end(), window) != _windows.end();
+    }
+
+    void Remove(uintptr_t window) { _windows.remove(window); }
+    void Clear() { _windows.clear(); }
+
+    size_t Size() const { return _windows.size(); }
+    size_t Evictions() const { return _evictions; }
+    uintptr_t LeastRecent() const { return _windows.back(); }
+
+private:
+    size_t _capacity;
+    size_t _evictions;
+    std::list<uintptr_t> _windows;
+};
+
+// Each buffer is tagged with its window, so a buffer that moves inside the
+// cache can be told from one that lost its contents
+bool Tagged(const WindowBuffer* buffer, uintptr_t window) {
+    return buffer && buffer->typedLayout == window && buffer->Typing().Size() == 1;
+}
+
+void Tag(WindowBuffer& buffer, uintptr_t window) {
+    buffer.typedLayout = window;
+    buffer.Typing().Push(KeystrokeInfo::Make('A' + window % 26, false, false));
+}
+
+bool AllFound(WindowBufferCache& cache, const Reference& reference, size_t handles) {
+    bool found = true;
+    for (size_t i = 0; i < handles; ++i) {
+        uintptr_t window = Handle(i);
+        WindowBuffer* buffer = cache.Find(window);
+        found = (reference.Contains(window) ? Tagged(buffer, window) : buffer == nullptr) && found;
+    }
+    return found && cache.Size() == reference.Size();
+}
+
+int Check() {
+    bool ok = true;
+
+    // The least recently used window goes first, and touching it saves it
+    {
+        WindowBufferCache cache(4, 8);
+        for (size_t i = 0; i < 4; ++i) Tag(cache.Acquire(Handle(i)), Handle(i));
+        cache.Acquire(Handle(0));
+        cache.Find(Handle(1));      // Looking does not count as use
+        Tag(cache.Acquire(Handle(4)), Handle(4));
+        bool order = !cache.Find(Handle(1)) && Tagged(cache.Find(Handle(0)), Handle(0)) && cache.EvictionCount() == 1;
+        Tag(cache.Acquire(Handle(5)), Handle(5));
+        order = !cache.Find(Handle(2)) && Tagged(cache.Find(Handle(3)), Handle(3)) && order;
+        WindowBuffer& returning = cache.Acquire(Handle(1));
+        order = returning.Typing().Size() == 0 && returning.typedLayout == 0 && !cache.Find(Handle(3)) && order;
+        ok = Report("least recently used window is evicted", order && cache.EvictionCount() == 3) && ok;
+    }
+
+    // Random use against the reference: small capacity, many handles, so
+    // evictions and index collisions are constant
+    {
+        const size_t CAPACITY = 24;
+        const size_t HANDLES = 64;
+        WindowBufferCache cache(CAPACITY, 4);
+        Reference reference(CAPACITY);
+        Random random(0xA0761D6478BD642Full);
+        bool same = true;
+        bool evictedOldest = true;
+        for (int step = 0; step < 200000 && same; ++step) {
+            uintptr_t window = Handle(random.Below(HANDLES));
+            uint32_t action = random.Below(100);
+            if (action < 70) {
+                uintptr_t oldest = reference.Size() ? reference.LeastRecent() : 0;
+                size_t evictions = cache.EvictionCount();
+                bool cached = reference.Acquire(window);
+                WindowBuffer& buffer = cache.Acquire(window);
+                if (cached) {
+                    same = Tagged(&buffer, window) && same;
+                } else {
+                    same = buffer.Typing().Size() == 0 && same;
+                    Tag(buffer, window);
+                }
+                if (cache.EvictionCount() != evictions) evictedOldest = !cache.Find(oldest) && evictedOldest;
+            } else if (action < 90) {
+                WindowBuffer* buffer = cache.Find(window);
+                same = (reference.Contains(window) ? Tagged(buffer, window) : buffer == nullptr) && same;
+            } else if (action < 99) {
+                reference.Remove(window);
+                cache.Remove(window);
+            } else if (random.Below(20) == 0) {
+                reference.Clear();
+                cache.Clear();
+            }
+            same = cache.Size() == reference.Size() && cache.EvictionCount() == reference.Evictions() && same;
+        }
+        same = AllFound(cache, reference, HANDLES) && same;
+        ok = Report("random use matches a plain LRU list", same) && ok;
+        ok = Report("each eviction takes the oldest window", evictedOldest) && ok;
+    }
+
+    // Backward-shift deletion: removing windows from the middle of probe
+    // runs must leave every other window reachable
+    {
+        const size_t CAPACITY = 32;
+        WindowBufferCache cache(CAPACITY, 4);
+        Reference reference(CAPACITY);
+        Random random(0xE7037ED1A0B428DBull);
+        bool reachable = true;
+        for (int round = 0; round < 2000; ++round) {
+            // Handles a page apart collide more often once masked
+            while (reference.Size() < CAPACITY) {
+                uintptr_t window = Handle(random.Below(256) * 1024);
+                if (!reference.Contains(window)) Tag(cache.Acquire(window), window);
+                reference.Acquire(window);
+            }
+            for (size_t i = random.Below(CAPACITY); i < CAPACITY; i += 1 + random.Below(4)) {
+                uintptr_t window = cache.WindowAt(i % cache.Size());
+                reference.Remove(window);
+                cache.Remove(window);
+            }
+            for (size_t i = 0; i < 256; ++i) {
+                uintptr_t window = Handle(i * 1024);
+                WindowBuffer* buffer = cache.Find(window);
+                reachable = (reference.Contains(window) ? Tagged(buffer, window) : buffer == nullptr) && reachable;
+            }
+        }
+        ok = Report("windows stay reachable after deletions", reachable && cache.Size() == reference.Size()) && ok;
+    }
+
+    // However many windows come and go, the cache holds what it was given
+    {
+        WindowBufferCache cache(WindowBufferCache::DEFAULT_CAPACITY);
+        size_t memory = cache.MemoryUsage();
+        bool capped = memory >= WindowBufferCache::DEFAULT_CAPACITY * sizeof(WindowBuffer);
+        for (size_t i = 0; i < 100000; ++i) {
+            cache.Acquire(Handle(i));
+            capped = cache.Size() <= cache.Capacity() && capped;
+        }
+        capped = cache.MemoryUsage() == memory && cache.Size() == cache.Capacity() &&
+                 cache.EvictionCount() == 100000 - WindowBufferCache::DEFAULT_CAPACITY && capped;
+        ok = Report("size and memory stay within the capacity", capped) && ok;
+    }
+
+    return ok ? 0 : 1;
+}
+
+int Bench() {
+    const size_t SWITCHES = 1 << 24;
+    const size_t CAPACITY = WindowBufferCache::DEFAULT_CAPACITY;
+    // Windows in use: a few, all the cache holds, and more than it holds
+    const size_t WORKING_SETS[] = { 4, 16, CAPACITY, CAPACITY * 2, CAPACITY * 32 };
+
+    std::unique_ptr<WindowBufferCache> cache(new WindowBufferCache(CAPACITY));
+    printf("capacity %zu windows, %zu bytes (%zu per window)\n\n", CAPACITY, cache->MemoryUsage(),
+           cache->MemoryUsage() / CAPACITY);
+    printf("%-8s %11s %11s %11s %10s\n", "windows", "acquire ns", "find ns", "remove ns", "evicted");
+
+    Random random(0x8EBC6AF09C88C6E3ull);
+    std::vector<uintptr_t> switches(4096);
+    size_t touched = 0;
+    for (size_t windows : WORKING_SETS) {
+        for (uintptr_t& window : switches) {
+            window = Handle(random.Below(static_cast<uint32_t>(windows)));
+        }
+
+        cache->Clear();
+        size_t evictions = cache->EvictionCount();
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < SWITCHES; ++i) {
+            touched += cache->Acquire(switches[i & (switches.size() - 1)]).correctionCount + 1;
+        }
+        double acquireNs = Seconds(start) * 1e9 / SWITCHES;
+        double evicted = static_cast<double>(cache->EvictionCount() - evictions) / SWITCHES;
+
+        start = Clock::now();
+        for (size_t i = 0; i < SWITCHES; ++i) {
+            touched += cache->Find(switches[i & (switches.size() - 1)]) ? 1 : 0;
+        }
+        double findNs = Seconds(start) * 1e9 / SWITCHES;
+
+        // Windows closing and opening: each remove probes and shifts the index
+        start = Clock::now();
+        for (size_t i = 0; i < SWITCHES / 4; ++i) {
+            uintptr_t window = switches[i & (switches.size() - 1)];
+            cache->Remove(window);
+            touched += cache->Acquire(window).correctionCount + 1;
+        }
+        double removeNs = Seconds(start) * 1e9 / (SWITCHES / 4);
+
+        printf("%-8zu %11.2f %11.2f %11.2f %9.1f%%\n", windows, acquireNs, findNs, removeNs, evicted * 100.0);
+    }
+    printf("\nremove ns includes acquiring the window again\n");
+    return touched > 0 ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 2 && strcmp(argv[1], "--check") == 0) {
+        return Check();
+    }
+    if (argc == 2 && strcmp(argv[1], "--bench") == 0) {
+        return Bench();
+    }
+    PrintUsage();
+    return 1;
+}
\ No newline at end of file